@@ -94,6 +94,12 @@ public:
 
     IndexedPhrasesPair(const phrase_t& srcPhrase, const phrase_t& tgtPhrase, orientation_info_index_t orientationInfo, const alignment_t& alignment);
 
+    /**
+     * @param data Source phrase followed by target phrase.
+     * @param alignment Alignment points, source and target point of each pair in turn.
+     */
+    IndexedPhrasesPair(const token_index_t* data, size_t srcPhraseLength, size_t tgtPhraseLength, orientation_info_index_t orientationInfo, const alignment_point_t* alignment, size_t alignmentLength);
+
     IndexedPhrasesPair(const IndexedPhrasesPair<OrientationIndexType, TokenIndexType>& copy);
 
     ~IndexedPhrasesPair(void);
@@ -143,6 +149,20 @@ IndexedPhrasesPair<OrientationIndexType, TokenIndexType>::IndexedPhrasesPair(con
 
 }
 
+template<class OrientationIndexType, class TokenIndexType>
+IndexedPhrasesPair<OrientationIndexType, TokenIndexType>::IndexedPhrasesPair(const token_index_t* data, size_t srcPhraseLength, size_t tgtPhraseLength, orientation_info_index_t orientationInfo, const alignment_point_t* alignment, size_t alignmentLength):
+    _data(NULL), _alignment(NULL), _orientationInfoIndex(orientationInfo), _srcPhraseLength(static_cast<alignment_point_t>(srcPhraseLength)), _tgtPhraseLength(static_cast<alignment_point_t>(tgtPhraseLength)), _alignmentLength(static_cast<alignment_point_t>(alignmentLength)) {
+
+    // Save alignment.
+    _alignment = new alignment_point_t[2 * _alignmentLength]; // Note: *2 for each pair.
+    memcpy(_alignment, alignment, _alignmentLength * 2 * sizeof(alignment_point_t));
+
+    // Save data.
+    _data = new token_index_t[_srcPhraseLength + _tgtPhraseLength];
+    std::copy(data, data + _srcPhraseLength + _tgtPhraseLength, _data);
+
+}
+
 template<class OrientationIndexType, class TokenIndexType>
 IndexedPhrasesPair<OrientationIndexType, TokenIndexType>::IndexedPhrasesPair(const IndexedPhrasesPair<OrientationIndexType, TokenIndexType>& copy):
     _data(NULL), _alignment(NULL), _orientationInfoIndex(copy._orientationInfoIndex), _srcPhraseLength(copy._srcPhraseLength), _tgtPhraseLength(copy._tgtPhraseLength), _alignmentLength(copy._alignmentLength) {
@@ -113,6 +113,12 @@ public:
      */
     const_iterator begin(void) const { return LossyCounterIterator<T>(threshold(), _storage.begin(), _storage.end()); }
 
+    /**
+     * @param threshold Minimum frequency of items to iterate over.
+     * @return Constant iterator pointing to the beginning of storage.
+     */
+    const_iterator begin(double threshold) const { return LossyCounterIterator<T>(threshold, _storage.begin(), _storage.end()); }
+
     /**
      * @return Constant iterator pointing to the end of storage.
      */
@@ -123,6 +129,12 @@ public:
      */
     erasing_iterator beginErase(void) { return LossyCounterErasingIterator<T>(threshold(), _storage); }
 
+    /**
+     * @param threshold Minimum frequency of items to iterate over.
+     * @return Erasing iterator pointing to the beginning of storage.
+     */
+    erasing_iterator beginErase(double threshold) { return LossyCounterErasingIterator<T>(threshold, _storage); }
+
     /**
      * @return Erasing iterator pointing to the end of storage.
      */
@@ -201,7 +213,7 @@ public:
     // Constructors.
 
     LossyCounterIterator<T>(const_iterator end):
-        _threshold(0), _current(_end), _end(end) {}
+        _threshold(0), _current(end), _end(end) {}
 
     LossyCounterIterator<T>(double threshold, const_iterator begin, const_iterator end):
         _threshold(threshold), _current(begin), _end(end) {
@@ -247,7 +259,7 @@ protected:
     /**
      * @param init Check also the item that iterator _current points to? Useful when initializing.
      */
-    void forward(bool init);
+    void forward(bool init = false);
 
 };
 
@@ -277,7 +289,7 @@ protected:
     /**
      * @param init Check also the item that iterator _current points to? Useful when initializing.
      */
-    void forward(bool init);
+    void forward(bool init = false);
 
 };
 
@@ -344,7 +356,7 @@ LossyCounterIterator<T> LossyCounterIterator<T>::operator++(int junk) {
 }
 
 template<class T>
-void LossyCounterIterator<T>::forward(bool init = false) {
+void LossyCounterIterator<T>::forward(bool init) {
     if ( _current == _end ) {
         return; // Nowhere to go, we're at the end already.
     }
@@ -362,7 +374,7 @@ void LossyCounterIterator<T>::forward(bool init = false) {
 ////////////////////////////////////////////////////////////////////////////////
 
 template<class T>
-void LossyCounterErasingIterator<T>::forward(bool init = false) {
+void LossyCounterErasingIterator<T>::forward(bool init) {
     if (this->_current == this->_end ) {
         return; // Nowhere to go, we're at the end already.
     }
@@ -0,0 +1,161 @@
+/**
+ * ShardedLossyCounter - set of lossy counters over disjoint parts of a single
+ * data stream.
+ *
+ * (C) Moses: http://www.statmt.org/moses/
+ *
+ * $Id$
+ */
+
+#ifndef SHARDEDLOSSYCOUNTER_H
+#define	SHARDEDLOSSYCOUNTER_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "LossyCounter.h"
+
+
+/**
+ * The stream is partitioned into shards (eg. by hash of the item), so that
+ * every item is always counted by the same shard and the shards can be fed
+ * by separate threads. Every shard is a lossy counter with the same error
+ * and support parameters and it counts Nj items of the stream.
+ *
+ * Estimated frequency of an item in its shard falls below the true one by at
+ * most εNj <= εN, where N is the sum of all Nj. Thresholds and maximum error
+ * are therefore computed from N: listing items of all shards with frequency
+ * at least (s-ε)N gives the same guarantees as a single lossy counter over
+ * the whole stream - all items with true frequency at least sN are listed
+ * and no item with true frequency below (s-ε)N is.
+ */
+template<class T>
+class ShardedLossyCounter {
+
+public:
+
+    typedef LossyCounter<T> shard_t;
+
+    typedef typename shard_t::error_t error_t;
+
+    typedef typename shard_t::support_t support_t;
+
+    typedef typename shard_t::counter_t counter_t;
+
+    typedef typename shard_t::frequency_t frequency_t;
+
+    /** @var Error parameter value (ε) */
+    const error_t error;
+
+    /** @var Supprort parameter value (s) */
+    const support_t support;
+
+private:
+
+    /** @var Lossy counters of individual shards */
+    std::vector<shard_t *> _shards;
+
+public:
+
+    /**
+     * @param _error Value from interval [0.0, 1.0).
+     * @param _support Value from interval [0.0, 1.0).
+     * @param shards Number of shards.
+     */
+    ShardedLossyCounter<T>(error_t _error, support_t _support, size_t shards = 1):
+        error(_error), support(_support), _shards() { this->setShards(shards); }
+
+    ~ShardedLossyCounter<T>(void) { this->clear(); }
+
+    /**
+     * Drops all counts and sets up given number of (empty) shards.
+     * @param shards Number of shards.
+     */
+    void setShards(size_t shards);
+
+    /**
+     * @return Number of shards.
+     */
+    size_t shards(void) const { return _shards.size(); }
+
+    /**
+     * @param i Index of shard.
+     * @return Lossy counter of i-th shard.
+     */
+    shard_t& shard(size_t i) { return *_shards[i]; }
+
+    /**
+     * @return Number of items added to all shards so far (N).
+     */
+    counter_t count(void) const;
+
+    /**
+     * @return Number of items currently in storage of all shards.
+     */
+    size_t size(void) const;
+
+    /**
+     * @param positive Return sN value instead of (s-ε)N?
+     * @return Threshold (either positive or negative) value.
+     */
+    double threshold(bool positive = false) const { return positive ? support * count() : (support - error) * count(); }
+
+    /**
+     * @return The maximum value of which estimated frequencies are less than the true frequencies.
+     */
+    double maxError(void) const { return error * count(); }
+
+private:
+
+    void clear(void);
+
+    // Shards are not meant to be copied.
+    ShardedLossyCounter<T>(const ShardedLossyCounter<T>&);
+
+    ShardedLossyCounter<T>& operator=(const ShardedLossyCounter<T>&);
+
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////// Sharded Lossy Counter Implementation //////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+template<class T>
+void ShardedLossyCounter<T>::setShards(size_t shards) {
+    this->clear();
+    for ( size_t i = 0; i < shards; ++i ) {
+        _shards.push_back(new shard_t(error, support));
+    }
+}
+
+
+template<class T>
+typename ShardedLossyCounter<T>::counter_t ShardedLossyCounter<T>::count(void) const {
+    counter_t count = 0;
+    for ( size_t i = 0; i < _shards.size(); ++i ) {
+        count += _shards[i]->count();
+    }
+    return count;
+}
+
+
+template<class T>
+size_t ShardedLossyCounter<T>::size(void) const {
+    size_t size = 0;
+    for ( size_t i = 0; i < _shards.size(); ++i ) {
+        size += _shards[i]->size();
+    }
+    return size;
+}
+
+
+template<class T>
+void ShardedLossyCounter<T>::clear(void) {
+    for ( size_t i = 0; i < _shards.size(); ++i ) {
+        delete _shards[i];
+    }
+    _shards.clear();
+}
+
+#endif	/* SHARDEDLOSSYCOUNTER_H */
@@ -11,6 +11,7 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <stdlib.h>
 #include <string.h>
 
 #include "config.h"
@@ -66,7 +67,7 @@ void program_info(void) {
 void read_optional_params(int argc, char* argv[], int optionalParamsStart);
 
 void usage(const char* programName) {
-    std::cerr << std::endl << "Syntax: " << std::string(programName) << " tgt src align extract lossy-counter [lossy-counter-2 [...]] [--compact] [--sort] [orientation [ --model [wbe|phrase|hier]-[msd|mslr|mono] ]]" << std::endl;
+    std::cerr << std::endl << "Syntax: " << std::string(programName) << " tgt src align extract lossy-counter [lossy-counter-2 [...]] [--compact] [--sort] [--threads N] [orientation [ --model [wbe|phrase|hier]-[msd|mslr|mono] ]]" << std::endl;
     std::cerr << get_lossy_counting_params_format();
     exit(1);
 }
@@ -124,11 +125,29 @@ int main(int argc, char* argv[]) {
         ++paramIdx;
     }
 
+    if ( (argc > paramIdx) && (strcmp(argv[paramIdx], "--threads") == 0) ) {
+        if ( (argc <= paramIdx + 1) || (atoi(argv[paramIdx + 1]) < 1) ) {
+            std::cerr << "ERROR: --threads requires a positive number of threads!" << std::endl;
+            usage(argv[0]);
+        }
+        threadsNum = atoi(argv[paramIdx + 1]);
+#ifndef WITH_THREADS
+        if ( threadsNum > 1 ) {
+            std::cerr << "ERROR: eppex has been compiled without threads support!" << std::endl;
+            exit(1);
+        }
+#endif
+        paramIdx += 2;
+    }
+
     //
     read_optional_params(argc, argv, paramIdx);
 
     std::cerr << "Starting epochal phrase table extraction with params:" << lossyCountersParams << std::endl;
     std::cerr << "Output will be " << (sortedOutput ? "sorted" : "unsorted") << "." << std::endl;
+    if ( threadsNum > 1 ) {
+        std::cerr << "Extracting and counting phrase pairs in " << threadsNum << " threads." << std::endl;
+    }
 
     // open input files
     std::ifstream eFile(fileNameE);
@@ -13,6 +13,13 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <deque>
+
+#include <boost/functional/hash.hpp>
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
 
 #include "phrase-extract.h"
 #include "ISS.h"
@@ -22,6 +29,9 @@
 
 #define LINE_MAX_LENGTH 60000
 
+// Number of sentences read and extracted at once.
+#define BATCH_SIZE 1000
+
 
 //////// Helping functions ////////
 
@@ -49,6 +59,150 @@ void processUnsortedOutput(OutputProcessor& processor);
 
 void flushPhrasePair(OutputProcessor& processor, const indexed_phrases_pair_t& indexedPhrasePair, PhrasePairsLossyCounter::frequency_t frequency, int mode);
 
+// For batch processing.
+struct ExtractedPhrasePair {
+    // Index of lossy counter the phrase pair belongs to.
+    size_t lossyCounterIdx;
+    // Position of source and target phrase in batch tokens.
+    size_t tokensOffset;
+    // Position of alignment in batch alignment points.
+    size_t alignmentOffset;
+    indexed_phrases_pair_t::alignment_point_t srcPhraseLength;
+    indexed_phrases_pair_t::alignment_point_t tgtPhraseLength;
+    indexed_phrases_pair_t::alignment_point_t alignmentLength;
+    orientation_info_index_t orientationInfo;
+};
+
+/**
+ * Input sentences and phrase pairs extracted from them. Words and orientation
+ * infos are indexed by storages local to the batch, so that batches can be
+ * extracted by several threads at once, and mapped to global indices when the
+ * batch is committed (in input order).
+ */
+struct ExtractedBatch {
+    /** @var Order of batch in input */
+    size_t sequenceNum;
+    /** @var ID of the first sentence in batch */
+    int firstSentenceId;
+    /** @var Target, source and alignment line of each sentence */
+    std::vector<std::string> lines;
+    /** @var Batch-local words indices */
+    IndexedStringsStorage<word_index_t> strings;
+    /** @var Batch-local orientation infos indices */
+    IndexedStringsStorage<orientation_info_index_t> orientations;
+    /** @var Source and target phrases of all phrase pairs */
+    std::vector<word_index_t> tokens;
+    /** @var Alignments of all phrase pairs */
+    std::vector<indexed_phrases_pair_t::alignment_point_t> alignment;
+    /** @var Extracted phrase pairs */
+    std::vector<ExtractedPhrasePair> phrasePairs;
+    /** @var Indices of phrase pairs to be counted by each shard */
+    std::vector<std::vector<size_t> > shards;
+    /** @var Number of shards that haven't counted the batch yet */
+    size_t pendingShards;
+};
+
+void extractBatch(ExtractedBatch& batch);
+
+void commitBatch(ExtractedBatch& batch, size_t shards);
+
+void countBatch(ExtractedBatch& batch, size_t shard);
+
+void processBatch(ExtractedBatch* batch);
+
+#ifdef WITH_THREADS
+/**
+ * Queue of batches passed between threads.
+ */
+class BatchQueue {
+
+    std::deque<ExtractedBatch *> _batches;
+
+    bool _closed;
+
+    boost::mutex _mutex;
+
+    boost::condition_variable _changed;
+
+public:
+    BatchQueue(void): _closed(false) {}
+
+    void push(ExtractedBatch* batch);
+
+    /**
+     * @return Next batch or NULL, if the queue is closed and empty.
+     */
+    ExtractedBatch* pop(void);
+
+    /**
+     * No more batches are going to be pushed.
+     */
+    void close(void);
+};
+
+/**
+ * Extracts phrase pairs from batches of sentences on several threads and
+ * counts them by the same number of threads, each owning one shard of every
+ * lossy counter. Batches are committed by the submitting thread in input order
+ * and every shard counts them in this order as well, so the results do not
+ * depend on threads scheduling.
+ */
+class ParallelExtraction {
+
+    const size_t _threadsNum;
+
+    /** @var Maximum number of batches being processed at once */
+    const size_t _maxPendingBatches;
+
+    BatchQueue _extractionQueue;
+
+    std::vector<BatchQueue *> _countingQueues;
+
+    boost::thread_group _threads;
+
+    boost::mutex _mutex;
+
+    boost::condition_variable _changed;
+
+    /** @var Extracted batches waiting for commit (by sequence number) */
+    std::map<size_t, ExtractedBatch *> _extracted;
+
+    size_t _submitted;
+
+    size_t _committed;
+
+    size_t _pending;
+
+public:
+    ParallelExtraction(size_t threadsNum);
+
+    ~ParallelExtraction(void);
+
+    /**
+     * Takes ownership of the batch. Blocks, if too many batches are being
+     * processed already.
+     */
+    void submit(ExtractedBatch* batch);
+
+    /**
+     * Waits until all the submitted batches are counted.
+     */
+    void finish(void);
+
+private:
+    void extractionThread(void);
+
+    void countingThread(size_t shard);
+
+    /**
+     * Commits the next batch in input order, if it has been extracted already.
+     * @param lock Lock of _mutex, released during the commit.
+     * @return True, if a batch has been committed.
+     */
+    bool commitNext(boost::unique_lock<boost::mutex>& lock);
+};
+#endif
+
 
 //////// Define variables declared as extern in the header /////////////////////
 bool allModelsOutputFlag = false;
@@ -64,6 +218,7 @@ int maxPhraseLength = 0; // Eg. 7
 bool translationFlag = true; // Generate extract and extract.inv
 bool orientationFlag = false; // Ordering info needed?
 bool sortedOutput = false; // Sort output?
+size_t threadsNum = 1; // Number of extraction and counting threads.
 
 LossyCountersVector lossyCounters;
 
@@ -77,6 +232,10 @@ std::vector<size_t> phrasePairsCounters;
 IndexedStringsStorage<word_index_t> strings;
 IndexedStringsStorage<orientation_info_index_t> orientations;
 
+#ifdef WITH_THREADS
+ParallelExtraction* parallelExtraction = NULL;
+#endif
+
 
 //////// Untouched Philipp Koehn's code :) /////////////////////////////////////
 
@@ -285,7 +444,7 @@ bool isAligned ( SentenceAlignment &sentence, int fi, int ei )
 
 /////// Slightly modified Philipp Koehn's code :) //////////////////////////////
 
-void extract(SentenceAlignment &sentence) {
+void extract(SentenceAlignment &sentence, ExtractedBatch &batch) {
 
     int countE = sentence.target.size();
     int countF = sentence.source.size();
@@ -389,7 +548,7 @@ void extract(SentenceAlignment &sentence) {
                                 wordNextOrient = getOrientWordModel(sentence, wordType, connectedLeftTopN, connectedRightTopN, endF, startF, endE, startE, 0, countF, -1, &lt, &ge);
                                 orientationInfo += getOrientString(wordPrevOrient, wordType) + " " + getOrientString(wordNextOrient, wordType);
                             }
-                            addPhrase(sentence, startE, endE, startF, endF, orientationInfo);
+                            addPhrase(sentence, startE, endE, startF, endF, orientationInfo, batch);
                         }
                     }
                 }
@@ -449,7 +608,7 @@ void extract(SentenceAlignment &sentence) {
                             ((hierModel)? getOrientString(hierPrevOrient, hierType) + " " + getOrientString(hierNextOrient, hierType) : "");
             }
             
-            addPhrase(sentence, startE, endE, startF, endF, orientationInfo);
+            addPhrase(sentence, startE, endE, startF, endF, orientationInfo, batch);
             
         } // end of for loop through inbound phrases
 
@@ -465,45 +624,48 @@ void extract(SentenceAlignment &sentence) {
  * @param startF
  * @param endF
  * @param orientationInfo
+ * @param batch Batch to store the phrase pair in.
  */
-void addPhrase(SentenceAlignment &sentence, int startE, int endE, int startF, int endF, std::string &orientationInfo) {
+void addPhrase(SentenceAlignment &sentence, int startE, int endE, int startF, int endF, std::string &orientationInfo, ExtractedBatch &batch) {
 
 #ifdef GET_COUNTS_ONLY
     // Just get the length of phrase pair (which is now defined as maximum of the two).
     phrasePairsCounters[std::max(endF - startF, endE - startE) + 1] += 1; // Don't forget +1 (span is inclusive)!
 #else
-    alignment_t alignment;
+    ExtractedPhrasePair phrasePair;
 
     // alignment
+    phrasePair.alignmentOffset = batch.alignment.size();
     for (int ei = startE; ei <= endE; ++ei) {
         for (int i = 0; i < sentence.alignedToT[ei].size(); ++i) {
             int fi = sentence.alignedToT[ei][i];
-            alignment.push_back(alignment_t::value_type(fi-startF, ei-startE));
+            batch.alignment.push_back(fi-startF);
+            batch.alignment.push_back(ei-startE);
         }
     }
+    phrasePair.alignmentLength = (batch.alignment.size() - phrasePair.alignmentOffset) / 2;
 
-    indexed_phrases_pair_t::phrase_t srcPhraseIndices, tgtPhraseIndices;
+    phrasePair.tokensOffset = batch.tokens.size();
 
     // source phrase
     for (int fi = startF; fi <= endF; ++fi) {
-        srcPhraseIndices.push_back(strings.put(sentence.source[fi].c_str()));
+        batch.tokens.push_back(batch.strings.put(sentence.source[fi].c_str()));
     }
 
     // target phrase
     for (int ei = startE; ei <= endE; ++ei) {
-        tgtPhraseIndices.push_back(strings.put(sentence.target[ei].c_str()));
+        batch.tokens.push_back(batch.strings.put(sentence.target[ei].c_str()));
     }
 
+    phrasePair.srcPhraseLength = endF - startF + 1;
+    phrasePair.tgtPhraseLength = endE - startE + 1;
+    phrasePair.orientationInfo = batch.orientations.put(orientationInfo.c_str());
+
     // TODO: Allow for switching between min and max here.
-    size_t idx = std::max(srcPhraseIndices.size(), tgtPhraseIndices.size());
+    phrasePair.lossyCounterIdx = std::max(phrasePair.srcPhraseLength, phrasePair.tgtPhraseLength);
 
-    // Add phrase pair.
-    lossyCounters[idx]->lossyCounter.add(indexed_phrases_pair_t(srcPhraseIndices, tgtPhraseIndices, orientations.put(orientationInfo.c_str()), alignment));
-    //
-    if ( lossyCounters[idx]->lossyCounter.aboutToPrune() ) {
-        // Next addition will lead to pruning, inform:
-        std::cerr << 'P' << idx << std::flush;
-    }
+    // Add phrase pair (it gets counted once the batch is committed).
+    batch.phrasePairs.push_back(phrasePair);
 #endif
 } // end of addPhrase()
 
@@ -512,11 +674,26 @@ void addPhrase(SentenceAlignment &sentence, int startE, int endE, int startF, in
 
 void readInput(std::istream& eFile, std::istream& fFile, std::istream& aFile) {
 
+    // Every counting thread owns one shard of each lossy counter.
+    for ( size_t i = 1; i < lossyCounters.size(); ++i ) {
+        if ( (lossyCounters[i] != NULL) && (lossyCounters[i]->lossyCounter.shards() != threadsNum) ) {
+            lossyCounters[i]->lossyCounter.setShards(threadsNum);
+        }
+    }
+
+#ifdef WITH_THREADS
+    if ( threadsNum > 1 ) {
+        parallelExtraction = new ParallelExtraction(threadsNum);
+    }
+#endif
+
     // Note: moved out of the loop.
     char englishString[LINE_MAX_LENGTH];
     char foreignString[LINE_MAX_LENGTH];
     char alignmentString[LINE_MAX_LENGTH];
 
+    ExtractedBatch* batch = NULL;
+
     int i = 0;
 
     while(true) {
@@ -528,16 +705,290 @@ void readInput(std::istream& eFile, std::istream& fFile, std::istream& aFile) {
         SAFE_GETLINE(fFile, foreignString, LINE_MAX_LENGTH, '\n', __FILE__);
         SAFE_GETLINE(aFile, alignmentString, LINE_MAX_LENGTH, '\n', __FILE__);
 
+        if ( batch == NULL ) {
+            batch = new ExtractedBatch();
+            batch->firstSentenceId = i;
+        }
+
+        batch->lines.push_back(englishString);
+        batch->lines.push_back(foreignString);
+        batch->lines.push_back(alignmentString);
+
+        if ( batch->lines.size() == 3 * BATCH_SIZE ) {
+            processBatch(batch);
+            batch = NULL;
+        }
+    }
+
+    if ( batch != NULL ) {
+        processBatch(batch);
+    }
+
+#ifdef WITH_THREADS
+    if ( parallelExtraction != NULL ) {
+        parallelExtraction->finish();
+        delete parallelExtraction;
+        parallelExtraction = NULL;
+    }
+#endif
+
+}
+
+
+void processBatch(ExtractedBatch* batch) {
+#ifdef WITH_THREADS
+    if ( parallelExtraction != NULL ) {
+        parallelExtraction->submit(batch);
+        return;
+    }
+#endif
+    extractBatch(*batch);
+    commitBatch(*batch, 1);
+    countBatch(*batch, 0);
+    delete batch;
+}
+
+
+void extractBatch(ExtractedBatch& batch) {
+
+    std::vector<char> englishString, foreignString, alignmentString;
+
+    for ( size_t i = 0; i < batch.lines.size(); i += 3 ) {
+        // SentenceAlignment::create() wants modifiable strings.
+        englishString.assign(batch.lines[i].c_str(), batch.lines[i].c_str() + batch.lines[i].size() + 1);
+        foreignString.assign(batch.lines[i+1].c_str(), batch.lines[i+1].c_str() + batch.lines[i+1].size() + 1);
+        alignmentString.assign(batch.lines[i+2].c_str(), batch.lines[i+2].c_str() + batch.lines[i+2].size() + 1);
+
         SentenceAlignment sentence;
 
-        if (sentence.create(englishString, foreignString, alignmentString, i)) {
-            extract(sentence);
+        if (sentence.create(&englishString[0], &foreignString[0], &alignmentString[0], batch.firstSentenceId + i/3)) {
+            extract(sentence, batch);
         }
     }
 
+    // Input is not needed anymore.
+    std::vector<std::string>().swap(batch.lines);
+
 }
 
 
+/**
+ * Maps batch-local indices to global ones and splits phrase pairs among shards
+ * by hash of their phrases. Committing batches in input order assigns the very
+ * same indices as extracting the sentences one by one would.
+ */
+void commitBatch(ExtractedBatch& batch, size_t shards) {
+
+    std::vector<word_index_t> stringsMap(batch.strings.size());
+    for ( size_t i = 0; i < stringsMap.size(); ++i ) {
+        stringsMap[i] = strings.put(batch.strings.get(i));
+    }
+
+    std::vector<orientation_info_index_t> orientationsMap(batch.orientations.size());
+    for ( size_t i = 0; i < orientationsMap.size(); ++i ) {
+        orientationsMap[i] = orientations.put(batch.orientations.get(i));
+    }
+
+    for ( std::vector<word_index_t>::iterator iter = batch.tokens.begin(); iter != batch.tokens.end(); ++iter ) {
+        *iter = stringsMap[*iter];
+    }
+
+    batch.shards.assign(shards, std::vector<size_t>());
+
+    for ( size_t i = 0; i < batch.phrasePairs.size(); ++i ) {
+        ExtractedPhrasePair& phrasePair = batch.phrasePairs[i];
+        phrasePair.orientationInfo = orientationsMap[phrasePair.orientationInfo];
+        // Same phrases always end up in the same shard.
+        std::vector<word_index_t>::const_iterator phrases = batch.tokens.begin() + phrasePair.tokensOffset;
+        size_t hash = boost::hash_range(phrases, phrases + phrasePair.srcPhraseLength + phrasePair.tgtPhraseLength);
+        batch.shards[hash % shards].push_back(i);
+    }
+
+}
+
+
+void countBatch(ExtractedBatch& batch, size_t shard) {
+
+    const std::vector<size_t>& phrasePairs = batch.shards[shard];
+
+    for ( std::vector<size_t>::const_iterator iter = phrasePairs.begin(); iter != phrasePairs.end(); ++iter ) {
+        const ExtractedPhrasePair& phrasePair = batch.phrasePairs[*iter];
+        PhrasePairsLossyCounter& lossyCounter = lossyCounters[phrasePair.lossyCounterIdx]->lossyCounter.shard(shard);
+
+        // Add phrase pair.
+        lossyCounter.add(indexed_phrases_pair_t(&batch.tokens[phrasePair.tokensOffset], phrasePair.srcPhraseLength, phrasePair.tgtPhraseLength, phrasePair.orientationInfo, &batch.alignment[0] + phrasePair.alignmentOffset, phrasePair.alignmentLength));
+        //
+        if ( lossyCounter.aboutToPrune() ) {
+            // Next addition will lead to pruning, inform:
+            std::cerr << 'P' << phrasePair.lossyCounterIdx << std::flush;
+        }
+    }
+
+}
+
+
+#ifdef WITH_THREADS
+void BatchQueue::push(ExtractedBatch* batch) {
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    _batches.push_back(batch);
+    _changed.notify_one();
+}
+
+
+ExtractedBatch* BatchQueue::pop(void) {
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    while ( _batches.empty() && !_closed ) {
+        _changed.wait(lock);
+    }
+    if ( _batches.empty() ) {
+        return NULL;
+    }
+    ExtractedBatch* batch = _batches.front();
+    _batches.pop_front();
+    return batch;
+}
+
+
+void BatchQueue::close(void) {
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    _closed = true;
+    _changed.notify_all();
+}
+
+
+ParallelExtraction::ParallelExtraction(size_t threadsNum):
+    _threadsNum(threadsNum), _maxPendingBatches(4 * threadsNum), _submitted(0), _committed(0), _pending(0) {
+
+    for ( size_t i = 0; i < _threadsNum; ++i ) {
+        _countingQueues.push_back(new BatchQueue());
+    }
+    for ( size_t i = 0; i < _threadsNum; ++i ) {
+        _threads.create_thread(boost::bind(&ParallelExtraction::extractionThread, this));
+        _threads.create_thread(boost::bind(&ParallelExtraction::countingThread, this, i));
+    }
+}
+
+
+ParallelExtraction::~ParallelExtraction(void) {
+    for ( size_t i = 0; i < _countingQueues.size(); ++i ) {
+        delete _countingQueues[i];
+    }
+}
+
+
+void ParallelExtraction::submit(ExtractedBatch* batch) {
+
+    boost::unique_lock<boost::mutex> lock(_mutex);
+
+    while ( this->commitNext(lock) );
+
+    // Keep the memory bounded.
+    while ( _pending >= _maxPendingBatches ) {
+        if ( !this->commitNext(lock) ) {
+            _changed.wait(lock);
+        }
+    }
+
+    batch->sequenceNum = _submitted++;
+    ++_pending;
+
+    lock.unlock();
+    _extractionQueue.push(batch);
+
+}
+
+
+void ParallelExtraction::finish(void) {
+
+    boost::unique_lock<boost::mutex> lock(_mutex);
+
+    while ( _committed < _submitted ) {
+        if ( !this->commitNext(lock) ) {
+            _changed.wait(lock);
+        }
+    }
+
+    lock.unlock();
+
+    _extractionQueue.close();
+    for ( size_t i = 0; i < _countingQueues.size(); ++i ) {
+        _countingQueues[i]->close();
+    }
+    _threads.join_all();
+
+}
+
+
+void ParallelExtraction::extractionThread(void) {
+
+    ExtractedBatch* batch;
+
+    while ( (batch = _extractionQueue.pop()) != NULL ) {
+        extractBatch(*batch);
+
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        _extracted[batch->sequenceNum] = batch;
+        _changed.notify_all();
+    }
+
+}
+
+
+void ParallelExtraction::countingThread(size_t shard) {
+
+    ExtractedBatch* batch;
+
+    while ( (batch = _countingQueues[shard]->pop()) != NULL ) {
+        countBatch(*batch, shard);
+
+        bool counted;
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            counted = (--batch->pendingShards == 0);
+        }
+
+        if ( counted ) {
+            delete batch;
+
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            --_pending;
+            _changed.notify_all();
+        }
+    }
+
+}
+
+
+bool ParallelExtraction::commitNext(boost::unique_lock<boost::mutex>& lock) {
+
+    std::map<size_t, ExtractedBatch *>::iterator iter = _extracted.find(_committed);
+
+    if ( iter == _extracted.end() ) {
+        return false;
+    }
+
+    ExtractedBatch* batch = iter->second;
+    _extracted.erase(iter);
+    ++_committed;
+
+    // Only the submitting thread commits, the lock is not needed meanwhile.
+    lock.unlock();
+
+    commitBatch(*batch, _threadsNum);
+
+    batch->pendingShards = _threadsNum;
+    for ( size_t i = 0; i < _threadsNum; ++i ) {
+        _countingQueues[i]->push(batch);
+    }
+
+    lock.lock();
+
+    return true;
+
+}
+#endif
+
+
 void processOutput(OutputProcessor& processor) {
     if ( sortedOutput ) {
         processSortedOutput(processor);
@@ -651,13 +1102,17 @@ void processSortedOutput(OutputProcessor& processor) {
     for ( size_t i = 1; i < lossyCounters.size(); ++i ) { // Intentionally skip 0.
         current = lossyCounters[i];
         if ( current != prev ) {
-            PhrasePairsLossyCounter& lossyCounter = current->lossyCounter;
-            for ( PhrasePairsLossyCounter::erasing_iterator phraseIter = lossyCounter.beginErase(); phraseIter != lossyCounter.endErase(); ++phraseIter ) {
-                // Store and...
-                output.push_back(std::make_pair(phraseIter.item(), phraseIter.frequency()));
-                // ...update counters.
-                current->outputMass += phraseIter.frequency();
-                current->outputSize += 1;
+            // Threshold is given by all the shards together.
+            double threshold = current->lossyCounter.threshold();
+            for ( size_t shard = 0; shard < current->lossyCounter.shards(); ++shard ) {
+                PhrasePairsLossyCounter& lossyCounter = current->lossyCounter.shard(shard);
+                for ( PhrasePairsLossyCounter::erasing_iterator phraseIter = lossyCounter.beginErase(threshold); phraseIter != lossyCounter.endErase(); ++phraseIter ) {
+                    // Store and...
+                    output.push_back(std::make_pair(phraseIter.item(), phraseIter.frequency()));
+                    // ...update counters.
+                    current->outputMass += phraseIter.frequency();
+                    current->outputSize += 1;
+                }
             }
             //
             prev = current;
@@ -694,14 +1149,20 @@ void processUnsortedOutput(OutputProcessor& processor) {
 
         if ( current != prev ) {
 
-            const PhrasePairsLossyCounter& lossyCounter = current->lossyCounter;
+            // Threshold is given by all the shards together.
+            double threshold = current->lossyCounter.threshold();
+
+            for ( size_t shard = 0; shard < current->lossyCounter.shards(); ++shard ) {
 
-            for ( PhrasePairsLossyCounter::const_iterator phraseIter = lossyCounter.begin(); phraseIter != lossyCounter.end(); ++phraseIter ) {
-                // Flush and...
-                flushPhrasePair(processor, phraseIter.item(), phraseIter.frequency(), 0);
-                // ...update counters.
-                current->outputMass += phraseIter.frequency();
-                current->outputSize += 1;
+                const PhrasePairsLossyCounter& lossyCounter = current->lossyCounter.shard(shard);
+
+                for ( PhrasePairsLossyCounter::const_iterator phraseIter = lossyCounter.begin(threshold); phraseIter != lossyCounter.end(); ++phraseIter ) {
+                    // Flush and...
+                    flushPhrasePair(processor, phraseIter.item(), phraseIter.frequency(), 0);
+                    // ...update counters.
+                    current->outputMass += phraseIter.frequency();
+                    current->outputSize += 1;
+                }
             }
 
             //
@@ -23,6 +23,8 @@
 
 #include "typedefs.h"
 
+using MosesTraining::SentenceAlignment;
+
 
 //////// Types definitions /////////////////////////////////////////////////////
 
@@ -54,8 +56,8 @@ struct LossyCounterInstance {
     // phrases flushing (ie. when input processing is done):
     size_t outputMass; // unique * freq
     size_t outputSize; // unique
-    //
-    PhrasePairsLossyCounter lossyCounter;
+    // One shard per counting thread.
+    ShardedPhrasePairsLossyCounter lossyCounter;
 
     LossyCounterInstance(PhrasePairsLossyCounter::error_t error, PhrasePairsLossyCounter::support_t support): outputMass(0), outputSize(0), lossyCounter(error, support) {}
 };
@@ -63,6 +65,9 @@ struct LossyCounterInstance {
 //
 typedef std::vector<LossyCounterInstance *> LossyCountersVector;
 
+// Phrase pairs extracted from a batch of input sentences.
+struct ExtractedBatch;
+
 struct OutputProcessor {
     virtual void operator() (const std::string& srcPhrase, const std::string& tgtPhrase, const std::string& orientationInfo, const alignment_t& alignment, const size_t frequency, int mode) = 0;
 };
@@ -96,10 +101,10 @@ bool ge(int, int);
 bool le(int, int);
 bool lt(int, int);
 bool isAligned (SentenceAlignment &, int, int);
-void extract(SentenceAlignment &);
+void extract(SentenceAlignment &, ExtractedBatch &);
 
 //// Modified ////
-void addPhrase(SentenceAlignment &, int, int, int, int, std::string &);
+void addPhrase(SentenceAlignment &, int, int, int, int, std::string &, ExtractedBatch &);
 
 //// Added ////
 void readInput(std::istream& eFile, std::istream& fFile, std::istream& aFile);
@@ -123,6 +128,7 @@ extern int maxPhraseLength; // Eg. 7
 extern bool translationFlag; // Generate extract and extract.inv
 extern bool orientationFlag; // Ordering info needed?
 extern bool sortedOutput; // Sort output?
+extern size_t threadsNum; // Number of extraction and counting threads.
 
 extern LossyCountersVector lossyCounters;
 
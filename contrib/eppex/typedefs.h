@@ -9,6 +9,7 @@
 
 #include "IndexedPhrasesPair.h"
 #include "LossyCounter.h"
+#include "ShardedLossyCounter.h"
 
 // Type capable of holding all words (tokens) indices:
 typedef unsigned int word_index_t;
@@ -18,6 +19,8 @@ typedef unsigned char orientation_info_index_t;
 typedef IndexedPhrasesPair<orientation_info_index_t, word_index_t>  indexed_phrases_pair_t;
 // Lossy Counter type.
 typedef LossyCounter<indexed_phrases_pair_t> PhrasePairsLossyCounter;
+// Lossy Counter split into shards.
+typedef ShardedLossyCounter<indexed_phrases_pair_t> ShardedPhrasePairsLossyCounter;
 // Shortcut to alignment interface.
 typedef indexed_phrases_pair_t::alignment_t alignment_t;
 
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 PhraseScorer*
 LexicalDecompositionPhraseScorer::create_scorer(const char *argv[], int &argp, bool reverse, const PhraseScorerFactory &ptf)
@@ -77,17 +78,16 @@ LexicalDecompositionPhraseScorer::get_weight(Count src, Count tgt) const
 }
 
 void
-LexicalDecompositionPhraseScorer::do_score_phrases()
+LexicalDecompositionPhraseScorer::do_collect_statistics(ScorerStatistics &stats)
 {
 
-  //Estimate p(J|I) = p(src_len|tgt_len)
+  //Count the source lengths for each target length
 
-  black_box_scorer->score_phrases();
+  black_box_scorer->collect_statistics(stats);
 
-  std::cerr<<"LexicalDecompositionPhraseScorer::do_score_phrases"<<std::endl;
+  std::cerr<<"LexicalDecompositionPhraseScorer::do_collect_statistics"<<std::endl;
 
   std::map<unsigned, std::map<unsigned, Count> > count_srclen_tgtlen;
-  std::map<unsigned, Count>  total_tgtlen;
 
   for(PhraseTable::iterator it = phrase_table_.begin(); it != phrase_table_.end(); it++) {
     const PhrasePairInfo &ppair = *it;
@@ -96,22 +96,47 @@ LexicalDecompositionPhraseScorer::do_score_phrases()
     unsigned src_len = src.get_phrase().size();
     unsigned tgt_len = tgt.get_phrase().size();
 
-    /*//Debug code
-    for (unsigned i=0; i<src_len; i++)
-      std::cerr<<src.get_phrase().word(i)<<" ";
-    std::cerr<<"-> "<<src_len<<" ||| ";
-    for (unsigned i=0; i<tgt_len; i++)
-      std::cerr<<tgt.get_phrase().word(i)<<" ";
-    std::cerr<<"-> "<<tgt_len<<std::endl;
-    */
-
     count_srclen_tgtlen[src_len][tgt_len]+=ppair.get_count();
-    total_tgtlen[tgt_len]+=ppair.get_count();
   }
 
   std::map<unsigned, std::map<unsigned, Count> >::iterator its;
   std::map<unsigned, Count>::iterator itt;
 
+  for (its=count_srclen_tgtlen.begin(); its!=count_srclen_tgtlen.end(); its++) {
+    for(itt=its->second.begin(); itt!=its->second.end(); itt++) {
+      std::ostringstream key;
+      key<<"lengths "<<its->first<<" "<<itt->first;
+      stats[key.str()]+=itt->second;
+    }
+  }
+}
+
+void
+LexicalDecompositionPhraseScorer::do_set_statistics(const ScorerStatistics &stats)
+{
+
+  //Estimate p(J|I) = p(src_len|tgt_len)
+
+  black_box_scorer->set_statistics(stats);
+
+  std::map<unsigned, std::map<unsigned, Count> > count_srclen_tgtlen;
+  std::map<unsigned, Count>  total_tgtlen;
+
+  for(ScorerStatistics::const_iterator it=stats.begin(); it!=stats.end(); it++) {
+    IStringStream key(it->first);
+    String name;
+    unsigned src_len, tgt_len;
+    if(!(key>>name>>src_len>>tgt_len) || name!="lengths")
+      continue;
+
+    count_srclen_tgtlen[src_len][tgt_len]+=it->second;
+    total_tgtlen[tgt_len]+=it->second;
+  }
+
+  std::map<unsigned, std::map<unsigned, Count> >::iterator its;
+  std::map<unsigned, Count>::iterator itt;
+
+  prob_srclen_tgtlen_.clear();
   for (its=count_srclen_tgtlen.begin(); its!=count_srclen_tgtlen.end(); its++) {
     unsigned src_len=its->first;
 
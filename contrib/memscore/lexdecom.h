@@ -17,7 +17,8 @@ private:
   explicit LexicalDecompositionPhraseScorer(PhraseTable &pd, bool reverse, const String &lwfile,
       const char *argv[], int &argp,  const PhraseScorerFactory &ptf);
 
-  virtual void do_score_phrases();
+  virtual void do_collect_statistics(ScorerStatistics &stats);
+  virtual void do_set_statistics(const ScorerStatistics &stats);
   virtual Score do_get_score(const PhraseTable::const_iterator &it);
 
   Score get_weight(const String &s_src, const String &s_tgt) const;
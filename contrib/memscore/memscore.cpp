@@ -2,24 +2,19 @@
 // Christian Hardmeier, FBK-irst, Trento, 2010
 // $Id$
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
+#include "partition.h"
 #include "phrasetable.h"
 #include "scorer.h"
 
 const char *progname;
 
-typedef PhrasePairInfo::AlignmentVector::value_type VP;
-
-bool cmp_counts(const VP &a1, const VP &a2);
 int main(int argc, const char *argv[]);
 
-bool cmp_counts(const VP &a1, const VP &a2)
-{
-  return a1.second < a2.second;
-}
-
 int main(int argc, const char *argv[])
 {
   progname = argv[0];
@@ -32,12 +27,30 @@ int main(int argc, const char *argv[])
   MemoryPhraseTable pt;
   PhraseScorerFactory psf(pt);
 
-  typedef std::vector<PhraseScorer *> ScorerList;
-  ScorerList scorers;
+  PhraseScorerList scorers;
+  size_t memory_budget = 0;
+  Count nworkers = 1;
+  String tmpdir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
 
   for(int argp = 1; argp < argc; ) {
     bool reverse;
-    if(!strcmp(argv[argp], "-s"))
+    if(!strcmp(argv[argp], "-m") && argp + 1 < argc) {
+      memory_budget = static_cast<size_t>(atof(argv[argp + 1]) * 1024 * 1024);
+      if(memory_budget == 0)
+        usage();
+      argp += 2;
+      continue;
+    } else if(!strcmp(argv[argp], "-j") && argp + 1 < argc) {
+      nworkers = atoi(argv[argp + 1]);
+      if(nworkers == 0)
+        usage();
+      argp += 2;
+      continue;
+    } else if(!strcmp(argv[argp], "-T") && argp + 1 < argc) {
+      tmpdir = argv[argp + 1];
+      argp += 2;
+      continue;
+    } else if(!strcmp(argv[argp], "-s"))
       reverse = false;
     else if(!strcmp(argv[argp], "-r"))
       reverse = true;
@@ -47,35 +60,40 @@ int main(int argc, const char *argv[])
     scorers.push_back(psf.create_scorer(argv, ++argp, reverse));
   }
 
+  if(scorers.empty()) {
+    std::cerr << "No scorers specified." << std::endl;
+    usage();
+  }
+
+  if(memory_budget > 0) {
+    PartitionedScoring ps(pt, scorers, memory_budget, nworkers, tmpdir);
+    ps.score(std::cin, std::cout);
+    return 0;
+  }
+
   pt.load_data(std::cin);
   pt.compute_phrase_statistics();
 
-  for(ScorerList::iterator s = scorers.begin(); s != scorers.end(); ++s)
+  for(PhraseScorerList::iterator s = scorers.begin(); s != scorers.end(); ++s)
     (*s)->score_phrases();
 
-  for(PhrasePairCounts::const_iterator it = pt.raw_begin(); it != pt.raw_end(); ++it) {
-    PhrasePairInfo ppi(it);
-    Phrase src = ppi.get_src();
-    Phrase tgt = ppi.get_tgt();
-    const PhrasePairInfo::AlignmentVector av = ppi.get_alignments();
-
-    PhraseAlignment alig = std::max_element(av.begin(), av.end(), cmp_counts)->first;
-
-    std::cout << pt.get_src_phrase(src) << " ||| " << pt.get_tgt_phrase(tgt) << " ||| " << alig << " |||";
-
-    for(ScorerList::iterator s = scorers.begin(); s != scorers.end(); ++s)
-      std::cout << ' ' << (*s)->get_score(it);
-    std::cout << '\n'; // don't use std::endl to avoid flushing
-  }
+  for(PhrasePairCounts::const_iterator it = pt.raw_begin(); it != pt.raw_end(); ++it)
+    write_scored_pair(std::cout, pt, it, scorers);
 }
 
 void usage()
 {
-  std::cerr <<	"Usage: " << progname << " <scorer1> <scorer2> ..." << std::endl <<
+  std::cerr <<	"Usage: " << progname << " [options] <scorer1> <scorer2> ..." << std::endl <<
             "       where each scorer is specified as" << std::endl <<
             "       -s <scorer> <args>         to estimate p(s|t)" << std::endl <<
             "       -r <scorer> <args>         to estimate p(t|s)" << std::endl << std::endl;
 
+  std::cerr <<	"Options:" << std::endl <<
+            "       -m <megabytes>             score the table in partitions on disk, using about" << std::endl <<
+            "                                  this much memory for the worker processes" << std::endl <<
+            "       -j <workers>               number of partitions scored at the same time (default 1)" << std::endl <<
+            "       -T <directory>             directory for the partitions (default $TMPDIR or /tmp)" << std::endl << std::endl;
+
   std::cerr <<	"Implemented scorers:" << std::endl;
 
   const std::vector<String> &v = PhraseScorerFactory::scorer_list();
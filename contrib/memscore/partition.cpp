@@ -0,0 +1,472 @@
+// memscore - in-memory phrase scoring for Statistical Machine Translation
+// Christian Hardmeier, FBK-irst, Trento, 2010
+// $Id$
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/functional/hash.hpp>
+
+#include "partition.h"
+#include "timestamp.h"
+
+// Rough peak memory of a worker per byte of its temporary files, for the
+// raw input lines of a target partition and the aggregated pair records of
+// a source partition.
+static const size_t TARGET_BYTES_PER_BYTE = 6;
+static const size_t SOURCE_BYTES_PER_BYTE = 8;
+
+static void check_stream(const std::ios &s, const String &name)
+{
+  if(s.fail()) {
+    std::cerr << "Problem with temporary file: " << name << std::endl;
+    exit(1);
+  }
+}
+
+static size_t file_size(const String &name)
+{
+  struct stat st;
+  if(stat(name.c_str(), &st) == -1)
+    return 0;
+  return st.st_size;
+}
+
+PartitionedScoring::PartitionedScoring(MemoryPhraseTable &pt, const PhraseScorerList &scorers,
+                                       size_t memory_budget, Count nworkers, const String &tmpdir) :
+  phrase_table_(pt), scorers_(scorers), memory_budget_(memory_budget), nworkers_(nworkers)
+{
+  String dir_template = tmpdir + "/memscore.XXXXXX";
+  std::vector<char> buf(dir_template.begin(), dir_template.end());
+  buf.push_back('\0');
+  if(mkdtemp(&buf[0]) == NULL) {
+    std::cerr << "Cannot create temporary directory in " << tmpdir << ": " << strerror(errno) << std::endl;
+    exit(1);
+  }
+  tmpdir_ = &buf[0];
+}
+
+Count PartitionedScoring::bucket(const String &phrase)
+{
+  return boost::hash<String>()(phrase) % NBUCKETS;
+}
+
+String PartitionedScoring::file_name(const char *prefix, Count i, Count j) const
+{
+  std::ostringstream os;
+  os << tmpdir_ << '/' << prefix << '.' << i << '.' << j;
+  return os.str();
+}
+
+// Group consecutive buckets so that each group fits into the memory of one
+// worker.  A bucket that is too large on its own gets a group of its own.
+std::vector<PartitionedScoring::Partition> PartitionedScoring::make_partitions(const std::vector<size_t> &sizes, size_t bytes_per_byte) const
+{
+  size_t worker_budget = memory_budget_ / nworkers_;
+  std::vector<Partition> partitions;
+  size_t current = 0;
+
+  for(Count b = 0; b < sizes.size(); b++) {
+    if(sizes[b] == 0)
+      continue;
+
+    size_t needed = sizes[b] * bytes_per_byte;
+    if(partitions.empty() || current + needed > worker_budget) {
+      if(needed > worker_budget)
+        std::cerr << "Warning: partition needs about " << (needed >> 20) << " MB, more than the "
+                  << (worker_budget >> 20) << " MB available per worker." << std::endl;
+      partitions.push_back(Partition());
+      current = 0;
+    }
+    partitions.back().push_back(b);
+    current += needed;
+  }
+
+  return partitions;
+}
+
+// Run task for each partition in a child process, at most nworkers_ at a time.
+void PartitionedScoring::run_workers(Count ntasks, Task task)
+{
+  std::cout.flush();
+  std::cerr.flush();
+
+  Count next = 0, running = 0;
+  bool failed = false;
+  while(running > 0 || (next < ntasks && !failed)) {
+    if(next < ntasks && running < nworkers_ && !failed) {
+      pid_t pid = fork();
+      if(pid == -1) {
+        std::cerr << "Cannot start worker process: " << strerror(errno) << std::endl;
+        failed = true;
+        continue;
+      }
+      if(pid == 0) {
+        (this->*task)(next);
+        std::cout.flush();
+        _exit(0);
+      }
+      next++;
+      running++;
+    } else {
+      int status;
+      if(wait(&status) == -1) {
+        std::cerr << "Cannot wait for worker process: " << strerror(errno) << std::endl;
+        abort();
+      }
+      running--;
+      if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        failed = true;
+    }
+  }
+
+  if(failed) {
+    std::cerr << "A worker process failed, temporary files are left in " << tmpdir_ << std::endl;
+    exit(1);
+  }
+}
+
+// Split the input lines by target phrase, prefixed with their line numbers.
+void PartitionedScoring::spill_input(std::istream &instream)
+{
+  std::vector<std::ofstream *> buckets(NBUCKETS);
+  for(Count b = 0; b < NBUCKETS; b++) {
+    buckets[b] = new std::ofstream(file_name("tgt", b).c_str());
+    check_stream(*buckets[b], file_name("tgt", b));
+  }
+
+  std::vector<size_t> sizes(NBUCKETS, 0);
+  Timestamp t_load;
+  size_t nlines = 0;
+  String line;
+  while(getline(instream, line)) {
+    size_t sep1 = line.find(" ||| ");
+    if(sep1 == line.npos) {
+      std::cerr << "Phrase separator not found in: " << line << std::endl;
+      abort();
+    }
+    size_t sep2 = line.find(" ||| ", sep1 + 1);
+    String s_tgt(line, sep1 + 5, sep2 - sep1 - 5);
+
+    Count b = bucket(s_tgt);
+    *buckets[b] << nlines << ' ' << line << '\n';
+    sizes[b] += line.size();
+
+    nlines++;
+    if(nlines % 1000000 == 0)
+      std:: cerr << "Spilled " << nlines << " lines in " << (t_load.elapsed_time() / 1000) << " ms." << std::endl;
+  }
+
+  for(Count b = 0; b < NBUCKETS; b++) {
+    buckets[b]->close();
+    check_stream(*buckets[b], file_name("tgt", b));
+    delete buckets[b];
+  }
+
+  tgt_partitions_ = make_partitions(sizes, TARGET_BYTES_PER_BYTE);
+  std::cerr << "Spilled " << nlines << " lines into " << tgt_partitions_.size() << " target partitions." << std::endl;
+}
+
+namespace
+{
+
+struct PairRecord {
+  size_t first;
+  Count count;
+  std::vector<std::pair<String,Count> > alignments;
+
+  PairRecord() : first(0), count(0) {}
+};
+
+struct TargetRecord {
+  size_t first;
+  PhraseCounts counts;
+  std::map<String,PairRecord> pairs;
+};
+
+}
+
+// Aggregate the phrase pairs of a target partition and write them to the
+// source buckets, with the marginal counts of the target phrase.  The record
+// for a pair is a header line followed by the source and target phrases and
+// a line per alignment.
+void PartitionedScoring::aggregate_targets(Count partition)
+{
+  typedef std::map<String,TargetRecord> TargetMap;
+  TargetMap targets;
+
+  const Partition &p = tgt_partitions_[partition];
+  for(Partition::const_iterator b = p.begin(); b != p.end(); ++b) {
+    std::ifstream in(file_name("tgt", *b).c_str());
+    check_stream(in, file_name("tgt", *b));
+
+    String line;
+    while(getline(in, line)) {
+      size_t lineno = strtoul(line.c_str(), NULL, 10);
+      line.erase(0, line.find(' ') + 1);
+
+      size_t sep1 = line.find(" ||| ");
+      size_t sep2 = line.find(" ||| ", sep1 + 1);
+      String s_src(line, 0, sep1);
+      String s_tgt(line, sep1 + 5, sep2 - sep1 - 5);
+      String s_alignment(line, sep2 + 5);
+
+      // Lines are read in input order, so the first one seen is the first
+      // occurrence of the target phrase and of the pair.
+      std::pair<TargetMap::iterator,bool> ti = targets.insert(std::make_pair(s_tgt, TargetRecord()));
+      TargetRecord &tr = ti.first->second;
+      if(ti.second)
+        tr.first = lineno;
+      tr.counts.inc_count();
+
+      std::pair<std::map<String,PairRecord>::iterator,bool> pi = tr.pairs.insert(std::make_pair(s_src, PairRecord()));
+      PairRecord &pr = pi.first->second;
+      if(pi.second) {
+        pr.first = lineno;
+        tr.counts.inc_distinct();
+      }
+      pr.count++;
+
+      std::vector<std::pair<String,Count> >::iterator ai = pr.alignments.begin();
+      while(ai != pr.alignments.end() && ai->first != s_alignment)
+        ++ai;
+      if(ai == pr.alignments.end())
+        pr.alignments.push_back(std::make_pair(s_alignment, 1));
+      else
+        ai->second++;
+    }
+  }
+
+  std::vector<std::ofstream *> buckets(NBUCKETS);
+  for(Count b = 0; b < NBUCKETS; b++) {
+    buckets[b] = new std::ofstream(file_name("src", b, partition).c_str());
+    check_stream(*buckets[b], file_name("src", b, partition));
+  }
+
+  for(TargetMap::iterator t = targets.begin(); t != targets.end(); ++t) {
+    TargetRecord &tr = t->second;
+    for(std::map<String,PairRecord>::const_iterator pi = tr.pairs.begin(); pi != tr.pairs.end(); ++pi)
+      tr.counts.count_pair(pi->second.count);
+
+    for(std::map<String,PairRecord>::const_iterator pi = tr.pairs.begin(); pi != tr.pairs.end(); ++pi) {
+      const PairRecord &pr = pi->second;
+      std::ostream &out = *buckets[bucket(pi->first)];
+      out << pr.first << ' ' << tr.first << ' ' << tr.counts.get_count() << ' ' << tr.counts.get_distinct() << ' '
+          << tr.counts.get_n1() << ' ' << tr.counts.get_n2() << ' ' << tr.counts.get_n3plus() << ' '
+          << pr.alignments.size() << '\n' << pi->first << '\n' << t->first << '\n';
+      for(std::vector<std::pair<String,Count> >::const_iterator ai = pr.alignments.begin(); ai != pr.alignments.end(); ++ai)
+        out << ai->second << ' ' << ai->first << '\n';
+    }
+  }
+
+  for(Count b = 0; b < NBUCKETS; b++) {
+    buckets[b]->close();
+    check_stream(*buckets[b], file_name("src", b, partition));
+    delete buckets[b];
+  }
+}
+
+// Load the phrase pairs of a source partition into the phrase table and give
+// the target phrases their counts in the whole table.
+void PartitionedScoring::load_partition(Count partition)
+{
+  std::vector<PhraseCounts> tgt_counts;
+
+  const Partition &p = src_partitions_[partition];
+  for(Partition::const_iterator b = p.begin(); b != p.end(); ++b) {
+    for(Count t = 0; t < tgt_partitions_.size(); t++) {
+      std::ifstream in(file_name("src", *b, t).c_str());
+      check_stream(in, file_name("src", *b, t));
+
+      String header, s_src, s_tgt, alignment;
+      while(getline(in, header) && getline(in, s_src) && getline(in, s_tgt)) {
+        IStringStream is(header);
+        size_t pair_first, tgt_first;
+        Count count, distinct, n1, n2, n3plus, nalignments;
+        is >> pair_first >> tgt_first >> count >> distinct >> n1 >> n2 >> n3plus >> nalignments;
+
+        PhrasePair pair;
+        for(Count i = 0; i < nalignments; i++) {
+          getline(in, alignment);
+          size_t pos = alignment.find(' ');
+          Count acount = strtoul(alignment.c_str(), NULL, 10);
+          pair = phrase_table_.add_phrase_pair(s_src, s_tgt, alignment.substr(pos + 1), acount);
+        }
+        check_stream(in, file_name("src", *b, t));
+
+        if(pair.first >= src_first_.size())
+          src_first_.resize(pair.first + 1, std::numeric_limits<size_t>::max());
+        src_first_[pair.first] = std::min(src_first_[pair.first], pair_first);
+
+        if(pair.second >= tgt_first_.size()) {
+          tgt_first_.resize(pair.second + 1);
+          tgt_counts.resize(pair.second + 1);
+        }
+        tgt_first_[pair.second] = tgt_first;
+        tgt_counts[pair.second] = PhraseCounts(count, distinct, n1, n2, n3plus);
+      }
+    }
+  }
+
+  phrase_table_.count_pairs();
+  for(Phrase tgt = 0; tgt < tgt_counts.size(); tgt++)
+    phrase_table_.get_tgt_phrase(tgt).set_counts(tgt_counts[tgt]);
+}
+
+void PartitionedScoring::collect_statistics(Count partition)
+{
+  load_partition(partition);
+
+  std::ofstream out(file_name("stats", partition).c_str());
+  for(Count s = 0; s < scorers_.size(); s++) {
+    ScorerStatistics stats;
+    scorers_[s]->collect_statistics(stats);
+    for(ScorerStatistics::const_iterator it = stats.begin(); it != stats.end(); ++it)
+      out << s << ' ' << it->second << ' ' << it->first << '\n';
+  }
+  out.close();
+  check_stream(out, file_name("stats", partition));
+}
+
+namespace
+{
+
+typedef std::pair<std::pair<size_t,size_t>,PhrasePairCounts::const_iterator> OrderedPair;
+
+bool cmp_order(const OrderedPair &p1, const OrderedPair &p2)
+{
+  return p1.first < p2.first;
+}
+
+}
+
+// Score a source partition.  Each output line is prefixed with the first
+// occurrences of its source and target phrases in the input, the order of
+// the phrase ids in the in-memory phrase table.
+void PartitionedScoring::score_partition(Count partition)
+{
+  load_partition(partition);
+
+  std::vector<OrderedPair> order;
+  order.reserve(phrase_table_.get_joint_counts().size());
+  for(PhrasePairCounts::const_iterator it = phrase_table_.raw_begin(); it != phrase_table_.raw_end(); ++it)
+    order.push_back(std::make_pair(std::make_pair(src_first_[it->first.first], tgt_first_[it->first.second]), it));
+  std::sort(order.begin(), order.end(), cmp_order);
+
+  std::ofstream out(file_name("out", partition).c_str());
+  for(std::vector<OrderedPair>::const_iterator it = order.begin(); it != order.end(); ++it) {
+    out << it->first.first << ' ' << it->first.second << ' ';
+    write_scored_pair(out, phrase_table_, it->second, scorers_);
+  }
+  out.close();
+  check_stream(out, file_name("out", partition));
+}
+
+namespace
+{
+
+typedef std::pair<std::pair<size_t,size_t>,Count> MergeEntry;
+
+bool read_merge_entry(std::istream &in, String &line, Count partition, std::priority_queue<MergeEntry,std::vector<MergeEntry>,std::greater<MergeEntry> > &queue)
+{
+  if(!getline(in, line))
+    return false;
+
+  IStringStream is(line);
+  size_t src_first, tgt_first;
+  is >> src_first >> tgt_first;
+  line.erase(0, line.find(' ', line.find(' ') + 1) + 1);
+  queue.push(std::make_pair(std::make_pair(src_first, tgt_first), partition));
+  return true;
+}
+
+}
+
+void PartitionedScoring::merge_output(std::ostream &outstream)
+{
+  Count n = src_partitions_.size();
+  std::vector<std::ifstream *> in(n);
+  std::vector<String> lines(n);
+  std::priority_queue<MergeEntry,std::vector<MergeEntry>,std::greater<MergeEntry> > queue;
+
+  for(Count i = 0; i < n; i++) {
+    in[i] = new std::ifstream(file_name("out", i).c_str());
+    check_stream(*in[i], file_name("out", i));
+    read_merge_entry(*in[i], lines[i], i, queue);
+  }
+
+  while(!queue.empty()) {
+    Count i = queue.top().second;
+    queue.pop();
+    outstream << lines[i] << '\n';
+    read_merge_entry(*in[i], lines[i], i, queue);
+  }
+
+  for(Count i = 0; i < n; i++)
+    delete in[i];
+}
+
+void PartitionedScoring::remove_files()
+{
+  for(Count b = 0; b < NBUCKETS; b++) {
+    remove(file_name("tgt", b).c_str());
+    for(Count t = 0; t < tgt_partitions_.size(); t++)
+      remove(file_name("src", b, t).c_str());
+  }
+  for(Count s = 0; s < src_partitions_.size(); s++) {
+    remove(file_name("stats", s).c_str());
+    remove(file_name("out", s).c_str());
+  }
+  rmdir(tmpdir_.c_str());
+}
+
+void PartitionedScoring::score(std::istream &instream, std::ostream &outstream)
+{
+  Timestamp t_score;
+
+  spill_input(instream);
+  run_workers(tgt_partitions_.size(), &PartitionedScoring::aggregate_targets);
+  for(Count b = 0; b < NBUCKETS; b++)
+    remove(file_name("tgt", b).c_str());
+
+  std::vector<size_t> sizes(NBUCKETS, 0);
+  for(Count b = 0; b < NBUCKETS; b++)
+    for(Count t = 0; t < tgt_partitions_.size(); t++)
+      sizes[b] += file_size(file_name("src", b, t));
+  src_partitions_ = make_partitions(sizes, SOURCE_BYTES_PER_BYTE);
+  std::cerr << "Aggregated phrase pairs into " << src_partitions_.size() << " source partitions in "
+            << (t_score.elapsed_time() / 1000) << " ms." << std::endl;
+
+  run_workers(src_partitions_.size(), &PartitionedScoring::collect_statistics);
+
+  std::vector<ScorerStatistics> stats(scorers_.size());
+  for(Count i = 0; i < src_partitions_.size(); i++) {
+    std::ifstream in(file_name("stats", i).c_str());
+    check_stream(in, file_name("stats", i));
+    Count s, value;
+    String key;
+    while(in >> s >> value && in.get() == ' ' && getline(in, key))
+      stats[s][key] += value;
+  }
+  for(Count s = 0; s < scorers_.size(); s++)
+    scorers_[s]->set_statistics(stats[s]);
+
+  run_workers(src_partitions_.size(), &PartitionedScoring::score_partition);
+  merge_output(outstream);
+  std::cerr << "Scored " << src_partitions_.size() << " partitions in " << (t_score.elapsed_time() / 1000) << " ms." << std::endl;
+
+  remove_files();
+}
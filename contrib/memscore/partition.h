@@ -0,0 +1,72 @@
+// memscore - in-memory phrase scoring for Statistical Machine Translation
+// Christian Hardmeier, FBK-irst, Trento, 2010
+// $Id$
+
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <iostream>
+#include <vector>
+
+#include "phrasetable.h"
+#include "scorer.h"
+
+// Scoring of phrase tables that do not fit into memory.
+//
+// The input is spilled to temporary files, partitioned by the hash of the
+// target phrase.  Each target partition is aggregated into phrase pair
+// records that carry the marginal counts of their target phrase, and these
+// are partitioned again by the hash of the source phrase.  Every source
+// partition then holds all pairs of its source phrases and the complete
+// counts of their target phrases, so it can be scored in memory: first to
+// collect the scorer statistics, which are summed over the partitions, then
+// to compute the scores.  The scored partitions are merged in the order of
+// the in-memory phrase table, so the output is the same.
+//
+// The partitions are processed by separate worker processes, as the phrase
+// table keeps its dictionaries in static storage.  They are made small
+// enough for the given number of workers to stay within the memory budget
+// together, as far as the hash buckets allow.
+class PartitionedScoring
+{
+public:
+  PartitionedScoring(MemoryPhraseTable &pt, const PhraseScorerList &scorers,
+                     size_t memory_budget, Count nworkers, const String &tmpdir);
+
+  void score(std::istream &instream, std::ostream &outstream);
+
+private:
+  typedef std::vector<Count> Partition;
+  typedef void (PartitionedScoring::*Task)(Count partition);
+
+  static const Count NBUCKETS = 256;
+
+  MemoryPhraseTable &phrase_table_;
+  const PhraseScorerList &scorers_;
+  size_t memory_budget_;
+  Count nworkers_;
+  String tmpdir_;
+
+  std::vector<Partition> tgt_partitions_;
+  std::vector<Partition> src_partitions_;
+
+  // Per source partition, indexed by phrase id.
+  std::vector<size_t> src_first_;
+  std::vector<size_t> tgt_first_;
+
+  static Count bucket(const String &phrase);
+
+  String file_name(const char *prefix, Count i, Count j = 0) const;
+  std::vector<Partition> make_partitions(const std::vector<size_t> &sizes, size_t bytes_per_byte) const;
+  void run_workers(Count ntasks, Task task);
+
+  void spill_input(std::istream &instream);
+  void aggregate_targets(Count partition);
+  void load_partition(Count partition);
+  void collect_statistics(Count partition);
+  void score_partition(Count partition);
+  void merge_output(std::ostream &outstream);
+  void remove_files();
+};
+
+#endif
@@ -187,7 +187,7 @@ PhrasePairInfo::AlignmentVector PhrasePairInfo::get_alignments() const
   return vec;
 }
 
-void PhrasePairInfo::add_alignment(Count new_alignment)
+void PhrasePairInfo::add_alignment(Count new_alignment, Count count)
 {
   Count i = 0;
   bool last;
@@ -196,7 +196,7 @@ void PhrasePairInfo::add_alignment(Count new_alignment)
     last = !(aligd[0] & CONTINUATION_BIT);
     Count alig = aligd[0] & ~CONTINUATION_BIT;
     if(alig == new_alignment) {
-      aligd[1]++;
+      aligd[1] += count;
       return;
     }
   } while(!last);
@@ -208,7 +208,7 @@ void PhrasePairInfo::add_alignment(Count new_alignment)
 
   Count *this_aligd = alignment_data(i);
   this_aligd[0] = new_alignment;
-  this_aligd[1] = 1;
+  this_aligd[1] = count;
 }
 
 void PhrasePairInfo::realloc_data(Count nalignments)
@@ -288,8 +288,6 @@ void PhraseInfoList::compute_statistics()
 
 void MemoryPhraseTable::load_data(std::istream &instream)
 {
-  Count total_count = 0;
-
   Timestamp t_load;
   Count nlines = 1;
   String line;
@@ -304,31 +302,49 @@ void MemoryPhraseTable::load_data(std::istream &instream)
     String s_tgt(line, sep1 + 5, sep2 - sep1 - 5);
     String s_alignment(line, sep2 + 5);
 
-    Phrase src = src_info_.index_phrase(s_src);
-    Phrase tgt = tgt_info_.index_phrase(s_tgt);
-    Count alignment = PhraseAlignment::index_alignment(src_info_[src].get_phrase().size(), tgt_info_[tgt].get_phrase().size(), s_alignment);
-
-    src_info_[src].inc_count();
-    tgt_info_[tgt].inc_count();
-    total_count++;
-
-    PhrasePair stpair(src, tgt);
-    PhrasePairCounts::iterator it = joint_counts_.find(stpair);
-
-    if(it == joint_counts_.end()) {
-      src_info_[src].inc_distinct();
-      tgt_info_[tgt].inc_distinct();
-      joint_counts_.insert(std::make_pair(stpair, PhrasePairInfo(src, tgt, alignment, 1).get_phrase_pair_data()));
-    } else {
-      PhrasePairInfo pi(src, tgt, it->second);
-      pi.inc_count();
-      pi.add_alignment(alignment);
-      it->second = pi.get_phrase_pair_data(); // may have changed by adding the alignment
-    }
+    add_phrase_pair(s_src, s_tgt, s_alignment);
+
     if(nlines % 50000 == 0)
       std:: cerr << "Read " << nlines << " lines in " << (t_load.elapsed_time() / 1000) << " ms." << std::endl;
     nlines++;
   }
+
+  count_pairs();
+}
+
+PhrasePair MemoryPhraseTable::add_phrase_pair(const String &s_src, const String &s_tgt, const String &s_alignment, Count count)
+{
+  Phrase src = src_info_.index_phrase(s_src);
+  Phrase tgt = tgt_info_.index_phrase(s_tgt);
+  Count alignment = PhraseAlignment::index_alignment(src_info_[src].get_phrase().size(), tgt_info_[tgt].get_phrase().size(), s_alignment);
+
+  src_info_[src].inc_count(count);
+  tgt_info_[tgt].inc_count(count);
+
+  PhrasePair stpair(src, tgt);
+  PhrasePairCounts::iterator it = joint_counts_.find(stpair);
+
+  if(it == joint_counts_.end()) {
+    src_info_[src].inc_distinct();
+    tgt_info_[tgt].inc_distinct();
+    joint_counts_.insert(std::make_pair(stpair, PhrasePairInfo(src, tgt, alignment, count).get_phrase_pair_data()));
+  } else {
+    PhrasePairInfo pi(src, tgt, it->second);
+    pi.inc_count(count);
+    pi.add_alignment(alignment, count);
+    it->second = pi.get_phrase_pair_data(); // may have changed by adding the alignment
+  }
+
+  return stpair;
+}
+
+void MemoryPhraseTable::count_pairs()
+{
+  for(PhrasePairCounts::const_iterator it = joint_counts_.begin(); it != joint_counts_.end(); ++it) {
+    PhrasePairInfo ppinfo(it);
+    src_info_[ppinfo.get_src()].count_pair(ppinfo.get_count());
+    tgt_info_[ppinfo.get_tgt()].count_pair(ppinfo.get_count());
+  }
 }
 
 void MemoryPhraseTable::attach_src_statistic(PhraseStatistic &s)
@@ -95,45 +95,31 @@ public:
   }
 };
 
-class PhraseInfo
+// Marginal counts of a phrase: how often it occurs, with how many different
+// partners, and how many of its phrase pairs occur once, twice or three or
+// four times (the latter for modified Kneser-Ney discounting).
+class PhraseCounts
 {
-  friend class boost::object_pool<PhraseInfo>;
-  friend std::ostream &operator<<(std::ostream &os, const PhraseInfo &pt);
-
 protected:
-  Count data_size_;
-
   Count count_;
   Count distinct_;
-  PhraseText phrase_;
-  Score *data_;
 
   Count n1_;
   Count n2_;
   Count n3plus_;
 
-  PhraseInfo(Count data_size, const String &phrase) :
-    data_size_(data_size), count_(0), distinct_(0), phrase_(phrase), n1_(0), n2_(0), n3plus_(0) {
-    data_ = DataStorage<Score>::get_instance().alloc(data_size_);
-  }
-
 public:
-  Score &data(Count base, Count i = 0) {
-    assert(base + i < data_size_);
-    return *(data_ + base + i);
-  }
+  PhraseCounts() : count_(0), distinct_(0), n1_(0), n2_(0), n3plus_(0) {}
 
-  const Score &data(Count base, Count i = 0) const {
-    assert(base + i < data_size_);
-    return *(data_ + base + i);
-  }
+  PhraseCounts(Count count, Count distinct, Count n1, Count n2, Count n3plus) :
+    count_(count), distinct_(distinct), n1_(n1), n2_(n2), n3plus_(n3plus) {}
 
   Count get_count() const {
     return count_;
   }
 
-  void inc_count() {
-    count_++;
+  void inc_count(Count n = 1) {
+    count_ += n;
   }
 
   Count get_distinct() const {
@@ -144,34 +130,67 @@ public:
     distinct_++;
   }
 
-  const PhraseText &get_phrase() const {
-    return phrase_;
+  Count get_n1() const {
+    return n1_;
   }
 
-  void inc_n1() {
-    n1_++;
+  Count get_n2() const {
+    return n2_;
   }
 
-  Count get_n1() {
-    return n1_;
+  Count get_n3plus() const {
+    return n3plus_;
   }
 
-  void inc_n2() {
-    n2_++;
+  void count_pair(Count joint_count) {
+    switch(joint_count) {
+    case 1:
+      n1_++;
+      break;
+    case 2:
+      n2_++;
+      break;
+    case 3:
+    case 4:
+      n3plus_++;
+    }
   }
 
-  Count get_n2() {
-    return n2_;
+  void set_counts(const PhraseCounts &counts) {
+    *this = counts;
   }
+};
+
+class PhraseInfo : public PhraseCounts
+{
+  friend class boost::object_pool<PhraseInfo>;
+  friend std::ostream &operator<<(std::ostream &os, const PhraseInfo &pt);
+
+protected:
+  Count data_size_;
+
+  PhraseText phrase_;
+  Score *data_;
 
-  void inc_n3plus() {
-    n3plus_++;
+  PhraseInfo(Count data_size, const String &phrase) :
+    data_size_(data_size), phrase_(phrase) {
+    data_ = DataStorage<Score>::get_instance().alloc(data_size_);
   }
 
-  Count get_n3plus() {
-    return n3plus_;
+public:
+  Score &data(Count base, Count i = 0) {
+    assert(base + i < data_size_);
+    return *(data_ + base + i);
   }
 
+  const Score &data(Count base, Count i = 0) const {
+    assert(base + i < data_size_);
+    return *(data_ + base + i);
+  }
+
+  const PhraseText &get_phrase() const {
+    return phrase_;
+  }
 };
 
 inline std::ostream &operator<<(std::ostream &os, const PhraseInfo &pt)
@@ -383,12 +402,12 @@ public:
     return count_data(data_, base, index);
   }
 
-  void inc_count() {
-    count_data(data_, COUNT_COUNT_IDX)++;
+  void inc_count(Count n = 1) {
+    count_data(data_, COUNT_COUNT_IDX) += n;
   }
 
   AlignmentVector get_alignments() const;
-  void add_alignment(Count alignment);
+  void add_alignment(Count alignment, Count count = 1);
 
 private:
   static Score &score_data(PhrasePairData data, DataIndex base, DataIndex index = 0) {
@@ -612,6 +631,11 @@ public:
 
   void load_data(std::istream &instream);
 
+  // Add count occurrences of a phrase pair with the given alignment.
+  // Call count_pairs() once all pairs have been added.
+  PhrasePair add_phrase_pair(const String &s_src, const String &s_tgt, const String &s_alignment, Count count = 1);
+  void count_pairs();
+
   virtual PhraseInfo &get_src_phrase(Phrase src) {
     assert(src < src_info_.size());
     return src_info_[src];
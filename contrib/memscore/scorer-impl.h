@@ -14,7 +14,6 @@ private:
   explicit MLPhraseScorer(PhraseTable &pd, bool reverse) :
     PhraseScorer(pd, reverse) {}
 
-  virtual void do_score_phrases();
   virtual Score do_get_score(const PhraseTable::const_iterator &it);
 
 public:
@@ -41,7 +40,8 @@ private:
   explicit AbsoluteDiscountPhraseScorer(PhraseTable &pd, bool reverse) :
     PhraseScorer(pd, reverse) {}
 
-  virtual void do_score_phrases();
+  virtual void do_collect_statistics(ScorerStatistics &stats);
+  virtual void do_set_statistics(const ScorerStatistics &stats);
   virtual Score do_get_score(const PhraseTable::const_iterator &it);
 
 public:
@@ -59,7 +59,8 @@ private:
   explicit KNDiscount1PhraseScorer(PhraseTable &pd, bool reverse) :
     PhraseScorer(pd, reverse) {}
 
-  virtual void do_score_phrases();
+  virtual void do_collect_statistics(ScorerStatistics &stats);
+  virtual void do_set_statistics(const ScorerStatistics &stats);
   virtual Score do_get_score(const PhraseTable::const_iterator &it);
 
 public:
@@ -80,7 +81,8 @@ private:
   explicit KNDiscount3PhraseScorer(PhraseTable &pd, bool reverse) :
     PhraseScorer(pd, reverse) {}
 
-  virtual void do_score_phrases();
+  virtual void do_collect_statistics(ScorerStatistics &stats);
+  virtual void do_set_statistics(const ScorerStatistics &stats);
   virtual Score do_get_score(const PhraseTable::const_iterator &it);
 
 public:
@@ -101,7 +103,6 @@ private:
   Score get_weight(const String &s_src, const String &s_tgt) const;
   Score get_weight(Count src, Count tgt) const;
 
-  virtual void do_score_phrases();
   virtual Score do_get_score(const PhraseTable::const_iterator &it);
 
 public:
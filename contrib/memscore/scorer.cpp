@@ -2,12 +2,12 @@
 // Christian Hardmeier, FBK-irst, Trento, 2010
 // $Id$
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <fstream>
 
 #include "scorer-impl.h"
-#include "timestamp.h"
 #include "lexdecom.h"
 
 #ifdef ENABLE_CHANNEL_SCORER
@@ -71,25 +71,6 @@ PhraseScorer *MLPhraseScorer::create_scorer(const char *argv[], int &argp, bool
   return new MLPhraseScorer(ptf.get_phrase_table(), reverse);
 }
 
-#if 1
-void MLPhraseScorer::do_score_phrases() {}
-#else
-void MLPhraseScorer::do_score_phrases()
-{
-  Score bla = 0;
-  Timestamp t_it;
-  for(Count i = 0; i < 200; i++) {
-    for(PhraseTable::iterator it = phrase_table_.begin(); it != phrase_table_.end(); ++it) {
-      PhrasePairInfo ppair = *it;
-      Phrase tgt = ppair.get_tgt();
-      bla += bla * ppair.get_count() / phrase_table_.get_tgt_phrase(tgt).get_count();
-    }
-  }
-  std::cerr << "Time for 200 iterations with ML estimation: " << (t_it.elapsed_time() / 1000) << " ms" << std::endl;
-  std::cerr << bla << std::endl;
-}
-#endif
-
 Score MLPhraseScorer::do_get_score(const PhraseTable::const_iterator &it)
 {
   PhraseInfo &tgt_phrase = phrase_table_.get_tgt_phrase(it->get_tgt());
@@ -114,9 +95,9 @@ PhraseScorer *AbsoluteDiscountPhraseScorer::create_scorer(const char *argv[], in
 }
 // p(s|t) = (c(s,t) - beta) / c(t)    <-- absolute discounting
 
-void AbsoluteDiscountPhraseScorer::do_score_phrases()
+void AbsoluteDiscountPhraseScorer::do_collect_statistics(ScorerStatistics &stats)
 {
-  Count n1 = 0, n2 = 0;
+  Count &n1 = stats["n1"], &n2 = stats["n2"];
 
   for(PhraseTable::iterator it = phrase_table_.begin(); it != phrase_table_.end(); ++it) {
     PhrasePairInfo ppinfo = *it;
@@ -129,6 +110,11 @@ void AbsoluteDiscountPhraseScorer::do_score_phrases()
       n2++;
     }
   }
+}
+
+void AbsoluteDiscountPhraseScorer::do_set_statistics(const ScorerStatistics &stats)
+{
+  Count n1 = get_statistic(stats, "n1"), n2 = get_statistic(stats, "n2");
 
   discount_ = static_cast<Score>(n1) / (n1 + 2*n2);
 }
@@ -150,10 +136,10 @@ PhraseScorer *KNDiscount1PhraseScorer::create_scorer(const char *argv[], int &ar
 }
 
 
-void KNDiscount1PhraseScorer::do_score_phrases()
+void KNDiscount1PhraseScorer::do_collect_statistics(ScorerStatistics &stats)
 {
-  Count n1 = 0, n2 = 0;
-  Count total_count = 0;
+  Count &n1 = stats["n1"], &n2 = stats["n2"];
+  Count &total_count = stats["total_count"];
 
   for(PhraseTable::iterator it = phrase_table_.begin(); it != phrase_table_.end(); ++it) {
     PhrasePairInfo ppinfo = *it;
@@ -169,10 +155,14 @@ void KNDiscount1PhraseScorer::do_score_phrases()
       n2++;
     }
   }
+}
 
-  discount_ = static_cast<Score>(n1) / (n1 + 2*n2);
-  total_count_ = static_cast<Count>(total_count);
+void KNDiscount1PhraseScorer::do_set_statistics(const ScorerStatistics &stats)
+{
+  Count n1 = get_statistic(stats, "n1"), n2 = get_statistic(stats, "n2");
 
+  discount_ = static_cast<Score>(n1) / (n1 + 2*n2);
+  total_count_ = get_statistic(stats, "total_count");
 }
 
 Score KNDiscount1PhraseScorer::do_get_score(const PhraseTable::const_iterator &it)
@@ -188,58 +178,44 @@ PhraseScorer *KNDiscount3PhraseScorer::create_scorer(const char *argv[], int &ar
 }
 
 
-void KNDiscount3PhraseScorer::do_score_phrases()
+// The counts of counts of the individual phrases are collected by the
+// phrase table (PhraseCounts::count_pair).
+void KNDiscount3PhraseScorer::do_collect_statistics(ScorerStatistics &stats)
 {
-  Count n1 = 0, n2 = 0, n3 = 0, n4 = 0;
-  Count total_count = 0; //total number of source or target phrases (including repetitions)
-  Count total_distinct_n1 = 0; //sum_{s} n1plus(s,*)
-  Count total_distinct_n2 = 0;
-  Count total_distinct_n3plus = 0;
-  Score y;
+  Count &n1 = stats["n1"], &n2 = stats["n2"], &n3 = stats["n3"], &n4 = stats["n4"];
 
   for(PhraseTable::iterator it = phrase_table_.begin(); it != phrase_table_.end(); ++it) {
     PhrasePairInfo ppinfo = *it;
-    PhraseInfo &src_phrase = phrase_table_.get_src_phrase(it->get_src());
-    PhraseInfo &tgt_phrase = phrase_table_.get_tgt_phrase(it->get_tgt());
-
-    total_count += src_phrase.get_count();
-
     Count c = ppinfo.get_count();
     switch(c) {
     case 1:
       n1++;
-      tgt_phrase.inc_n1();
-      src_phrase.inc_n1();
-      total_distinct_n1++;
       break;
     case 2:
       n2++;
-      tgt_phrase.inc_n2();
-      src_phrase.inc_n2();
-      total_distinct_n2++;
       break;
     case 3:
       n3++;
-      tgt_phrase.inc_n3plus();
-      src_phrase.inc_n3plus();
-      total_distinct_n3plus++;
       break;
     case 4:
       n4++;
-      tgt_phrase.inc_n3plus();
-      src_phrase.inc_n3plus();
-      total_distinct_n3plus++;
     }
-
   }
+}
+
+void KNDiscount3PhraseScorer::do_set_statistics(const ScorerStatistics &stats)
+{
+  Count n1 = get_statistic(stats, "n1"), n2 = get_statistic(stats, "n2");
+  Count n3 = get_statistic(stats, "n3"), n4 = get_statistic(stats, "n4");
+  Score y;
 
   y = (Score)(n1) / (n1 + 2*n2);
   discount1_ = static_cast<Score> (1) - (2)*(y)*(n2 / n1);
   discount2_ = static_cast<Score> (2) - (3)*(y)*(n3 / n2);
   discount3plus_ = static_cast<Score> (3) - (4)*(y)*(n4 / n3);
-  total_distinct_n1_ = static_cast<Count>(total_distinct_n1);
-  total_distinct_n2_ = static_cast<Count>(total_distinct_n2);
-  total_distinct_n3plus_ = static_cast<Count>(total_distinct_n3plus);
+  total_distinct_n1_ = n1;
+  total_distinct_n2_ = n2;
+  total_distinct_n3plus_ = n3 + n4;
 }
 
 Score KNDiscount3PhraseScorer::do_get_score(const PhraseTable::const_iterator &it)
@@ -321,26 +297,6 @@ inline Score LexicalWeightPhraseScorer::get_weight(Count src, Count tgt) const
   return it->second;
 }
 
-#if 1
-void LexicalWeightPhraseScorer::do_score_phrases() {}
-#else
-void LexicalWeightPhraseScorer::do_score_phrases()
-{
-  Score bla = 0;
-  Timestamp t_it;
-  for(Count i = 0; i < 200; i++) {
-    for(PhraseTable::iterator it = phrase_table_.begin(); it != phrase_table_.end(); ++it) {
-      PhrasePairInfo ppair = *it;
-      Phrase src = ppair.get_src();
-      Phrase tgt = ppair.get_tgt();
-      bla += bla * get_score(src, tgt);
-    }
-  }
-  std::cerr << "Time for 200 iterations with lexical weights: " << (t_it.elapsed_time() / 1000) << " ms" << std::endl;
-  std::cerr << bla << std::endl;
-}
-#endif
-
 Score LexicalWeightPhraseScorer::do_get_score(const PhraseTable::const_iterator &it)
 {
   const Phrase src = it->get_src();
@@ -400,3 +356,24 @@ Score ConstantPhraseScorer::do_get_score(const PhraseTable::const_iterator &it)
   return constant_;
 }
 
+static bool cmp_counts(const PhrasePairInfo::AlignmentVector::value_type &a1, const PhrasePairInfo::AlignmentVector::value_type &a2)
+{
+  return a1.second < a2.second;
+}
+
+void write_scored_pair(std::ostream &os, PhraseTable &pt, const PhrasePairCounts::const_iterator &it, const PhraseScorerList &scorers)
+{
+  PhrasePairInfo ppi(it);
+  Phrase src = ppi.get_src();
+  Phrase tgt = ppi.get_tgt();
+  const PhrasePairInfo::AlignmentVector av = ppi.get_alignments();
+
+  PhraseAlignment alig = std::max_element(av.begin(), av.end(), cmp_counts)->first;
+
+  os << pt.get_src_phrase(src) << " ||| " << pt.get_tgt_phrase(tgt) << " ||| " << alig << " |||";
+
+  for(PhraseScorerList::const_iterator s = scorers.begin(); s != scorers.end(); ++s)
+    os << ' ' << (*s)->get_score(it);
+  os << '\n'; // don't use std::endl to avoid flushing
+}
+
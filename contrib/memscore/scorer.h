@@ -5,8 +5,17 @@
 #ifndef SCORER_H
 #define SCORER_H
 
+#include <map>
+#include <ostream>
+#include <vector>
+
 #include "memscore.h"
 
+// Statistics a scorer needs about the whole phrase table, such as the counts
+// of counts for discounting.  They are sums over the phrase pairs, so the
+// statistics of a table that is scored in parts are the sums over the parts.
+typedef std::map<String,Count> ScorerStatistics;
+
 class PhraseScorerFactory
 {
 private:
@@ -40,8 +49,14 @@ protected:
     return it;
   }
 
+  static Count get_statistic(const ScorerStatistics &stats, const String &key) {
+    ScorerStatistics::const_iterator it = stats.find(key);
+    return it != stats.end() ? it->second : 0;
+  }
+
 private:
-  virtual void do_score_phrases() {}
+  virtual void do_collect_statistics(ScorerStatistics &stats) {}
+  virtual void do_set_statistics(const ScorerStatistics &stats) {}
 
   virtual Score do_get_score(const PhraseTable::const_iterator &it) = 0;
 
@@ -50,8 +65,20 @@ public:
 
   virtual Score get_discount() {}
 
+  // Add the statistics of the phrase table to stats.
+  void collect_statistics(ScorerStatistics &stats) {
+    do_collect_statistics(stats);
+  }
+
+  // Prepare for scoring with the statistics of the whole table.
+  void set_statistics(const ScorerStatistics &stats) {
+    do_set_statistics(stats);
+  }
+
   void score_phrases() {
-    do_score_phrases();
+    ScorerStatistics stats;
+    collect_statistics(stats);
+    set_statistics(stats);
   }
 
   Score get_score(const PhrasePairCounts::const_iterator &it) {
@@ -68,4 +95,8 @@ public:
   }
 };
 
+typedef std::vector<PhraseScorer *> PhraseScorerList;
+
+void write_scored_pair(std::ostream &os, PhraseTable &pt, const PhrasePairCounts::const_iterator &it, const PhraseScorerList &scorers);
+
 #endif
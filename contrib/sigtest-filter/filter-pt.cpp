@@ -3,13 +3,19 @@
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <ctime>
 #include <algorithm>
 
 #include "_SuffixArraySearchApplicationBase.h"
 
 #include <vector>
+#include <deque>
 #include <iostream>
-#include <set>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
 
 #ifdef WIN32
 #include "WIN32_functions.h"
@@ -17,8 +23,9 @@
 #include <unistd.h>
 #endif
 
-typedef std::set<TextLenType> SentIdSet;
-typedef std::map<std::string, SentIdSet> PhraseSetMap;
+// sorted ids of the sentences a phrase occurs in
+typedef std::vector<TextLenType> SentIdSet;
+typedef boost::unordered_map<std::string, SentIdSet> PhraseSetMap;
 
 #undef min
 
@@ -30,6 +37,8 @@ const std::string SEPARATOR       = " ||| ";
 const double ALPHA_PLUS_EPS  = -1000.0;        // dummy value
 const double ALPHA_MINUS_EPS = -2000.0;        // dummy value
 
+const size_t PHRASES_PER_BLOCK  = 1000;       // source phrases handed to a thread at once
+
 // configuration params
 int pfe_filter_limit = 0;               // 0 = don't filter anything based on P(f|e)
 bool print_cooc_counts = false;         // add cooc counts to phrase table?
@@ -38,18 +47,38 @@ double sig_filter_limit = 0;            // keep phrase pairs with -log(sig) > si
 //    higher = filter-more
 bool pef_filter_only = false;           // only filter based on pef
 bool hierarchical = false;
+int num_threads = 1;
 
 // globals
-PhraseSetMap esets;
-PhraseSetMap fsets;
 double p_111 = 0.0;                     // alpha
-size_t nremoved_sigfilter = 0;
-size_t nremoved_pfefilter = 0;
 
-C_SuffixArraySearchApplicationBase e_sa;
-C_SuffixArraySearchApplicationBase f_sa;
+// A suffix array shared by all threads.  SALM does not promise that its
+// searches are thread-safe, so one thread at a time searches each array;
+// the set operations and significance tests still run in parallel.
+// Everything else a thread changes is in its FilterState.
+struct SuffixArray {
+  C_SuffixArraySearchApplicationBase sa;
+#ifdef WITH_THREADS
+  boost::mutex mutex;
+#endif
+};
+
+SuffixArray e_sa;
+SuffixArray f_sa;
 int num_lines;
 
+// per-thread caches of large occurrence sets and counts
+struct FilterState {
+  PhraseSetMap esets;
+  PhraseSetMap fsets;
+  size_t nremoved_sigfilter;
+  size_t nremoved_pfefilter;
+  size_t lookups;
+  size_t cache_hits;
+
+  FilterState() : nremoved_sigfilter(0), nremoved_pfefilter(0), lookups(0), cache_hits(0) {}
+};
+
 void usage()
 {
   std::cerr << "\nFilter phrase table using significance testing as described\n"
@@ -62,7 +91,8 @@ void usage()
             << "   [-n num      ] 0, 1...: 0=no filtering, >0 sort by P(e|f) and keep the top num elements\n"
             << "   [-c          ] add the cooccurence counts to the phrase table\n"
             << "   [-p          ] add -log(significance) to the phrasetable\n"
-            << "   [-h          ] filter hierarchical rule table\n";
+            << "   [-h          ] filter hierarchical rule table\n"
+            << "   [-t threads  ] number of threads looking up phrases (default 1)\n";
   exit(1);
 }
 
@@ -198,43 +228,94 @@ double fisher_exact(int cfe, int ce, int cf)
   return total_p;
 }
 
-template <class setType>
-setType unordered_set_intersect(setType & set_1, setType & set_2)
+// number of sentences in both sets
+size_t count_intersection(const SentIdSet & set_1, const SentIdSet & set_2)
 {
-    setType set_out;
-
-    if (set_1.size() < set_2.size()) {
-        for (SentIdSet::iterator i=set_1.begin(); i != set_1.end(); ++i) {
-            if (set_2.find(*i) != set_2.end()) set_out.insert(*i);
-    }
+  const SentIdSet & small = set_1.size() < set_2.size() ? set_1 : set_2;
+  const SentIdSet & large = set_1.size() < set_2.size() ? set_2 : set_1;
+  size_t count = 0;
+  if (small.size() * 16 < large.size()) {
+    // far apart in size: search each element of the small set
+    SentIdSet::const_iterator from = large.begin();
+    for (SentIdSet::const_iterator i=small.begin(); i != small.end() && from != large.end(); ++i) {
+      from = std::lower_bound(from, large.end(), *i);
+      if (from != large.end() && *from == *i) ++count;
     }
-    else {
-        for (SentIdSet::iterator i=set_2.begin(); i != set_2.end(); ++i) {
-            if (set_1.find(*i) != set_1.end()) set_out.insert(*i);
-        }
+  } else {
+    SentIdSet::const_iterator i=small.begin(), j=large.begin();
+    while (i != small.end() && j != large.end()) {
+      if (*i < *j) ++i;
+      else if (*j < *i) ++j;
+      else {
+        ++count;
+        ++i;
+        ++j;
+      }
     }
-    return set_out;
+  }
+  return count;
 }
 
+SentIdSet set_intersect(const SentIdSet & set_1, const SentIdSet & set_2)
+{
+  SentIdSet set_out;
+  std::set_intersection(set_1.begin(), set_1.end(), set_2.begin(), set_2.end(),
+                        std::back_inserter(set_out));
+  return set_out;
+}
 
-SentIdSet lookup_phrase(const std::string & phrase, C_SuffixArraySearchApplicationBase & my_sa)
+
+SentIdSet lookup_phrase(const std::string & phrase, SuffixArray & my_sa)
 {
     SentIdSet occur_set;
     vector<S_SimplePhraseLocationElement> locations;
 
-    locations = my_sa.locateExactPhraseInCorpus(phrase.c_str());
+    {
+#ifdef WITH_THREADS
+        boost::mutex::scoped_lock lock(my_sa.mutex);
+#endif
+        locations = my_sa.sa.locateExactPhraseInCorpus(phrase.c_str());
+    }
     if(locations.size()==0) {
         cerr<<"No occurrences found!!\n";
     }
+    occur_set.reserve(locations.size());
     for (vector<S_SimplePhraseLocationElement>::iterator i=locations.begin(); i != locations.end(); ++i) {
-        occur_set.insert(i->sentIdInCorpus);
+        occur_set.push_back(i->sentIdInCorpus);
     }
+    std::sort(occur_set.begin(), occur_set.end());
+    occur_set.erase(std::unique(occur_set.begin(), occur_set.end()), occur_set.end());
     return occur_set;
 }
 
 
+// the occurrences of phrase, through the cache of large sets
+const SentIdSet & cached_lookup(const std::string & phrase, SuffixArray & my_sa, PhraseSetMap & cache, FilterState & state)
+{
+    ++state.lookups;
+    SentIdSet & set = cache[phrase];
+    if (set.empty()) {
+        set = lookup_phrase(phrase, my_sa);
+    } else {
+        ++state.cache_hits;
+    }
+    return set;
+}
+
+// drop the phrases with few occurrences, which are cheap to look up again
+void trim_cache(const std::vector<std::string> & phrases, PhraseSetMap & cache)
+{
+    for (std::vector<std::string>::const_iterator phrase=phrases.begin(); phrase != phrases.end(); ++phrase) {
+        PhraseSetMap::iterator i = cache.find(*phrase);
+        if (i != cache.end() && i->second.size() < MINIMUM_SIZE_TO_KEEP) {
+            cache.erase(i);
+        }
+    }
+}
+
+
 // slight simplicifaction: we consider all sentences in which "a" and "b" occur to be instances of the rule "a [X][X] b".
-SentIdSet lookup_multiple_phrases(vector<std::string> & phrases, C_SuffixArraySearchApplicationBase & my_sa, const std::string & rule, PhraseSetMap & cache) 
+SentIdSet lookup_multiple_phrases(vector<std::string> & phrases, SuffixArray & my_sa, const std::string & rule, PhraseSetMap & cache, FilterState & state) 
 {
 
     if (phrases.size() == 1) {
@@ -242,39 +323,17 @@ SentIdSet lookup_multiple_phrases(vector<std::string> & phrases, C_SuffixArraySe
     }
 
     else {
-        SentIdSet main_set;
-        SentIdSet & first_set = cache[phrases.front()];
-        bool first = true;
-        if (first_set.empty()) {
-            first_set = lookup_phrase(phrases.front(), my_sa);
-        }
+        SentIdSet main_set = cached_lookup(phrases.front(), my_sa, cache, state);
         for (vector<std::string>::iterator phrase=phrases.begin()+1; phrase != phrases.end(); ++phrase) {
-            SentIdSet & temp_set = cache[*phrase];
-            if (temp_set.empty()) {
-                temp_set = lookup_phrase(*phrase, my_sa);
-            }
-            if (first) {
-                main_set = unordered_set_intersect(first_set,temp_set);
-                first = false;
-            }
-            else {
-                main_set = unordered_set_intersect(main_set,temp_set);
-            }
-            if (temp_set.size() < MINIMUM_SIZE_TO_KEEP) {
-                cache.erase(*phrase);
-            }
-        }
-
-        if (first_set.size() < MINIMUM_SIZE_TO_KEEP) {
-            cache.erase(phrases.front());
+            main_set = set_intersect(main_set, cached_lookup(*phrase, my_sa, cache, state));
         }
-
+        trim_cache(phrases, cache);
         return main_set;
     }
 }
 
 
-SentIdSet find_occurrences(const std::string& rule, C_SuffixArraySearchApplicationBase & my_sa, PhraseSetMap & cache)
+SentIdSet find_occurrences(const std::string& rule, SuffixArray & my_sa, PhraseSetMap & cache, FilterState & state)
 {
     SentIdSet sa_set;
 
@@ -301,7 +360,7 @@ SentIdSet find_occurrences(const std::string& rule, C_SuffixArraySearchApplicati
         if (endPos > pos) {
             phrases.push_back(rule.substr(pos,endPos-pos));
         }
-        sa_set = lookup_multiple_phrases(phrases, my_sa, rule, cache);
+        sa_set = lookup_multiple_phrases(phrases, my_sa, rule, cache, state);
     }
     else {
         sa_set = lookup_phrase(rule, my_sa);
@@ -311,10 +370,10 @@ SentIdSet find_occurrences(const std::string& rule, C_SuffixArraySearchApplicati
 
 
 // input: unordered list of translation options for a single source phrase
-void compute_cooc_stats_and_filter(std::vector<PTEntry*>& options)
+void compute_cooc_stats_and_filter(std::vector<PTEntry*>& options, FilterState& state)
 {
   if (pfe_filter_limit>0 && options.size() > pfe_filter_limit) {
-    nremoved_pfefilter += (options.size() - pfe_filter_limit);
+    state.nremoved_pfefilter += (options.size() - pfe_filter_limit);
     std::nth_element(options.begin(), options.begin()+pfe_filter_limit, options.end(), PfeComparer());
     for (std::vector<PTEntry*>::iterator i=options.begin()+pfe_filter_limit; i != options.end(); ++i)
       delete *i;
@@ -323,46 +382,147 @@ void compute_cooc_stats_and_filter(std::vector<PTEntry*>& options)
   if (pef_filter_only) return;
 //   std::cerr << "f phrase: " << options.front()->f_phrase << "\n";
   SentIdSet fset;
-  fset = find_occurrences(options.front()->f_phrase, f_sa, fsets);
+  fset = find_occurrences(options.front()->f_phrase, f_sa, state.fsets, state);
   size_t cf = fset.size();
   for (std::vector<PTEntry*>::iterator i=options.begin(); i != options.end(); ++i) {
     const std::string& e_phrase = (*i)->e_phrase;
-    size_t cef=0;
-    SentIdSet& eset = esets[e_phrase];
+    ++state.lookups;
+    SentIdSet& eset = state.esets[e_phrase];
     if (eset.empty()) {
-        eset = find_occurrences(e_phrase, e_sa, esets);
+        eset = find_occurrences(e_phrase, e_sa, state.esets, state);
         //std::cerr << "Looking up e-phrase: " << e_phrase << "\n";
-    }
-    size_t ce=eset.size();
-    if (ce < cf) {
-      for (SentIdSet::iterator i=eset.begin(); i != eset.end(); ++i) {
-        if (fset.find(*i) != fset.end()) cef++;
-      }
     } else {
-      for (SentIdSet::iterator i=fset.begin(); i != fset.end(); ++i) {
-        if (eset.find(*i) != eset.end()) cef++;
-      }
+        ++state.cache_hits;
     }
+    size_t ce=eset.size();
+    size_t cef=count_intersection(eset, fset);
     double nlp = -log(fisher_exact(cef, cf, ce));
     (*i)->set_cooc_stats(cef, cf, ce, nlp);
     if (ce < MINIMUM_SIZE_TO_KEEP) {
-      esets.erase(e_phrase);
+      state.esets.erase(e_phrase);
     }
 
   }
   std::vector<PTEntry*>::iterator new_end =
     std::remove_if(options.begin(), options.end(), NlogSigThresholder(sig_filter_limit));
-  nremoved_sigfilter += (options.end() - new_end);
+  state.nremoved_sigfilter += (options.end() - new_end);
   options.erase(new_end,options.end());
 }
 
+// consecutive source phrases with their translation options
+struct Block {
+  std::vector<std::vector<PTEntry*> > phrases;
+  bool done;
+
+  Block() : done(false) {}
+};
+
+void filter_block(Block& block, FilterState& state)
+{
+  for (size_t i = 0; i < block.phrases.size(); ++i) {
+    compute_cooc_stats_and_filter(block.phrases[i], state);
+  }
+}
+
+void print_block(Block& block)
+{
+  for (size_t p = 0; p < block.phrases.size(); ++p) {
+    std::vector<PTEntry*>& options = block.phrases[p];
+    for (std::vector<PTEntry*>::iterator i=options.begin(); i != options.end(); ++i) {
+      std::cout << **i << std::endl;
+      delete *i;
+    }
+  }
+}
+
+#ifdef WITH_THREADS
+// Blocks are filtered by a pool of threads, each with its own caches, and
+// printed by the main thread in input order.
+class BlockFilter
+{
+public:
+  explicit BlockFilter(int threads) : m_states(threads), m_closed(false) {
+    for (int i = 0; i < threads; ++i) {
+      m_threads.create_thread(boost::bind(&BlockFilter::Work, this, &m_states[i]));
+    }
+  }
+
+  void Filter(Block* block) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_queue.push_back(block);
+    m_pending.push_back(block);
+    m_workAvailable.notify_one();
+  }
+
+  size_t Pending() const {
+    return m_pending.size();
+  }
+
+  // wait for the oldest block, print it and delete it
+  void PrintOldest() {
+    Block* block = m_pending.front();
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      while (!block->done) m_blockDone.wait(lock);
+      m_pending.pop_front();
+    }
+    print_block(*block);
+    delete block;
+  }
+
+  // finish and merge the counts of all threads into total
+  void Finish(FilterState& total) {
+    while (!m_pending.empty()) PrintOldest();
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_closed = true;
+      m_workAvailable.notify_all();
+    }
+    m_threads.join_all();
+    for (size_t i = 0; i < m_states.size(); ++i) {
+      total.nremoved_pfefilter += m_states[i].nremoved_pfefilter;
+      total.nremoved_sigfilter += m_states[i].nremoved_sigfilter;
+      total.lookups += m_states[i].lookups;
+      total.cache_hits += m_states[i].cache_hits;
+    }
+  }
+
+private:
+  void Work(FilterState* state) {
+    for (;;) {
+      Block* block;
+      {
+        boost::mutex::scoped_lock lock(m_mutex);
+        while (m_queue.empty() && !m_closed) m_workAvailable.wait(lock);
+        if (m_queue.empty()) return;
+        block = m_queue.front();
+        m_queue.pop_front();
+      }
+      filter_block(*block, *state);
+      boost::mutex::scoped_lock lock(m_mutex);
+      block->done = true;
+      m_blockDone.notify_all();
+    }
+  }
+
+  std::vector<FilterState> m_states;
+  std::deque<Block*> m_queue;    // blocks no thread has taken yet
+  std::deque<Block*> m_pending;  // blocks not printed yet, in input order
+  boost::thread_group m_threads;
+  boost::mutex m_mutex;
+  boost::condition_variable m_workAvailable;
+  boost::condition_variable m_blockDone;
+  bool m_closed;
+};
+#endif
+
 int main(int argc, char * argv[])
 {
   int c;
   const char* efile=0;
   const char* ffile=0;
   int pfe_index = 2;
-  while ((c = getopt(argc, argv, "cpf:e:i:n:l:h")) != -1) {
+  while ((c = getopt(argc, argv, "cpf:e:i:n:l:ht:")) != -1) {
     switch (c) {
     case 'e':
       efile = optarg;
@@ -386,6 +546,16 @@ int main(int argc, char * argv[])
     case 'h':
       hierarchical = true;
       break;
+    case 't':
+      num_threads = atoi(optarg);
+      if (num_threads < 1) usage();
+#ifndef WITH_THREADS
+      if (num_threads > 1) {
+        std::cerr << "Threads are not supported by this build, using 1\n";
+        num_threads = 1;
+      }
+#endif
+      break;
     case 'l':
       std::cerr << "-l = " << optarg << "\n";
       if (strcmp(optarg,"a+e") == 0) {
@@ -413,10 +583,10 @@ int main(int argc, char * argv[])
 
   //load the indexed corpus with vocabulary(noVoc=false) and with offset(noOffset=false)
   if (!pef_filter_only) {
-    e_sa.loadData_forSearch(efile, false, false);
-    f_sa.loadData_forSearch(ffile, false, false);
-    size_t elines = e_sa.returnTotalSentNumber();
-    size_t flines = f_sa.returnTotalSentNumber();
+    e_sa.sa.loadData_forSearch(efile, false, false);
+    f_sa.sa.loadData_forSearch(ffile, false, false);
+    size_t elines = e_sa.sa.returnTotalSentNumber();
+    size_t flines = f_sa.sa.returnTotalSentNumber();
     if (elines != flines) {
       std::cerr << "Number of lines in e-corpus != number of lines in f-corpus!\n";
       usage();
@@ -436,45 +606,62 @@ int main(int argc, char * argv[])
     std::cerr << "Filtering using P(e|f) only. n=" << pfe_filter_limit << std::endl;
   }
 
-  char tmpString[10000];
+  std::string line;
   std::string prev = "";
-  std::vector<PTEntry*> options;
+  Block* block = new Block;
+  FilterState total;
   size_t pt_lines = 0;
-  while(!cin.eof()) {
-    cin.getline(tmpString,10000,'\n');
+  size_t f_phrases = 0;
+  time_t start = time(NULL);
+#ifdef WITH_THREADS
+  BlockFilter* filter = num_threads > 1 ? new BlockFilter(num_threads) : NULL;
+#endif
+  while(getline(std::cin, line)) {
     if(++pt_lines%10000==0) {
       std::cerr << ".";
       if(pt_lines%500000==0) std::cerr << "[n:"<<pt_lines<<"]\n";
     }
 
-    if(strlen(tmpString)>0) {
-      PTEntry* pp = new PTEntry(tmpString, pfe_index);
+    if(line.size()>0) {
+      PTEntry* pp = new PTEntry(line, pfe_index);
       if (prev != pp->f_phrase) {
         prev = pp->f_phrase;
-
-        if (!options.empty()) {  // always true after first line
-          compute_cooc_stats_and_filter(options);
-        }
-        for (std::vector<PTEntry*>::iterator i=options.begin(); i != options.end(); ++i) {
-          std::cout << **i << std::endl;
-          delete *i;
+        ++f_phrases;
+
+        if (block->phrases.size() == PHRASES_PER_BLOCK) {
+#ifdef WITH_THREADS
+          if (filter) {
+            filter->Filter(block);
+            if (filter->Pending() > 4 * (size_t)num_threads) filter->PrintOldest();
+            block = new Block;
+          } else
+#endif
+          {
+            filter_block(*block, total);
+            print_block(*block);
+            block->phrases.clear();
+          }
         }
-        options.clear();
-        options.push_back(pp);
-
-      } else {
-        options.push_back(pp);
+        block->phrases.push_back(std::vector<PTEntry*>());
       }
-      //			  for(int i=0;i<locations.size(); i++){
-      //				  cout<<"SentId="<<locations[i].sentIdInCorpus<<" Pos="<<(int)locations[i].posInSentInCorpus<<endl;
-      //			  }
+      block->phrases.back().push_back(pp);
     }
   }
-  compute_cooc_stats_and_filter(options);
-  for (std::vector<PTEntry*>::iterator i=options.begin(); i != options.end(); ++i) {
-    std::cout << **i << std::endl;
-    delete *i;
+#ifdef WITH_THREADS
+  if (filter) {
+    filter->Filter(block);
+    filter->Finish(total);
+    delete filter;
+  } else
+#endif
+  {
+    filter_block(*block, total);
+    print_block(*block);
+    delete block;
   }
+  const size_t nremoved_pfefilter = total.nremoved_pfefilter;
+  const size_t nremoved_sigfilter = total.nremoved_sigfilter;
+  const double seconds = std::max(1.0, difftime(time(NULL), start));
   float pfefper = (100.0*(float)nremoved_pfefilter)/(float)pt_lines;
   float sigfper = (100.0*(float)nremoved_sigfilter)/(float)pt_lines;
   std::cerr << "\n\n------------------------------------------------------\n"
@@ -485,6 +672,10 @@ int main(int argc, char * argv[])
             << "            TOTAL FILTERED: " << (nremoved_pfefilter + nremoved_sigfilter) << "   (" << (sigfper + pfefper) << "%)\n"
             << "\n"
             << "     FILTERED phrase pairs: " << (pt_lines - nremoved_pfefilter - nremoved_sigfilter) << "   (" << (100.0-sigfper - pfefper) << "%)\n"
+            << "------------------------------------------------------\n"
+            << "  " << num_threads << " thread(s), " << seconds << " s: "
+            << pt_lines / seconds << " phrase pairs/s, " << f_phrases / seconds << " source phrases/s\n"
+            << "  cached occurrence sets: " << total.cache_hits << " of " << total.lookups << " lookups\n"
             << "------------------------------------------------------\n";
 
   return 0;
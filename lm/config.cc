@@ -14,6 +14,7 @@ Config::Config() :
   unknown_missing_logprob(-100.0),
   probing_multiplier(1.5),
   building_memory(1073741824ULL), // 1 GB
+  building_threads(1),
   temporary_directory_prefix(NULL),
   arpa_complain(ALL),
   write_mmap(NULL),
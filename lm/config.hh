@@ -58,6 +58,13 @@ struct Config {
   // models.
   std::size_t building_memory;
 
+  // Number of threads sorting n-grams while the ARPA file is parsed.  With
+  // more than one, building_memory is split into two halves so that one is
+  // sorted while the other is filled, and each order is merged in the
+  // background while the next is read.  Requires WITH_THREADS; otherwise
+  // building is sequential.  Only applies to trie models.
+  unsigned int building_threads;
+
   // Template for temporary directory appropriate for passing to mkdtemp.  
   // The characters XXXXXX are appended before passing to mkdtemp.  Only
   // applies to trie.  If NULL, defaults to write_mmap.  If that's NULL,
@@ -105,8 +112,9 @@ struct Config {
   
   // ONLY EFFECTIVE WHEN READING BINARY
   
-  // How to get the giant array into memory: lazy mmap, populate, read etc.
-  // See util/mmap.hh for details of MapMethod.  
+  // How to get the giant array into memory: lazy mmap, populate, read, or
+  // read into huge pages (optionally interleaved across NUMA nodes).
+  // See util/mmap.hh for details of LoadMethod.  
   util::LoadMethod load_method;
 
 
@@ -0,0 +1,166 @@
+#include "lm/filter/arpa_io.hh"
+
+#include "lm/filter/batch.hh"
+#include "lm/filter/vocab.hh"
+#include "lm/lm_exception.hh"
+#include "lm/read_arpa.hh"
+#include "util/file_piece.hh"
+#include "util/tokenize_piece.hh"
+
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+namespace lm {
+namespace filter {
+
+namespace {
+// Enough digits for any uint64_t.  
+const int kCountWidth = 20;
+
+const std::size_t kBatchLines = 16384;
+} // namespace
+
+ARPAOutput::ARPAOutput(const std::string &name) : name_(name), length_(0) {
+  util::scoped_fd fd(util::CreateOrThrow(name.c_str()));
+  file_.reset(util::FDOpenOrThrow(fd));
+}
+
+void ARPAOutput::BeginHeader(unsigned int order) {
+  counts_.assign(order, 0);
+  WriteHeader();
+}
+
+void ARPAOutput::BeginNGrams(unsigned int length) {
+  std::ostringstream header;
+  header << "\n\\" << length << "-grams:\n";
+  Write(header.str().data(), header.str().size());
+  length_ = length;
+}
+
+void ARPAOutput::Finish() {
+  const char kEnd[] = "\n\\end\\\n";
+  Write(kEnd, sizeof(kEnd) - 1);
+  UTIL_THROW_IF(std::fseek(file_.get(), 0, SEEK_SET), util::ErrnoException, "Could not seek to the beginning of " << name_ << " to write counts.  The output must be a regular file");
+  WriteHeader();
+  UTIL_THROW_IF(std::fflush(file_.get()), util::ErrnoException, "Failed to flush " << name_);
+  file_.reset();
+}
+
+void ARPAOutput::Write(const void *data, std::size_t size) {
+  UTIL_THROW_IF(size && 1 != std::fwrite(data, size, 1, file_.get()), util::ErrnoException, "Short write to " << name_);
+}
+
+void ARPAOutput::WriteHeader() {
+  std::ostringstream header;
+  header << "\\data\\\n";
+  for (std::size_t i = 0; i < counts_.size(); ++i) {
+    header << "ngram " << (i + 1) << '=' << std::setw(kCountWidth) << counts_[i] << '\n';
+  }
+  Write(header.str().data(), header.str().size());
+}
+
+namespace {
+
+// Output sets for each line of a batch.  
+struct Matches {
+  std::vector<uint32_t> sets;
+  std::vector<std::size_t> ends;
+  // Scratch space.  
+  std::vector<StringPiece> words;
+  std::vector<uint32_t> temp;
+};
+
+class NGramLines {
+  public:
+    NGramLines(util::FilePiece &in, uint64_t count) : in_(in), remaining_(count) {}
+
+    bool operator()(StringPiece &line) {
+      if (!remaining_) return false;
+      --remaining_;
+      line = in_.ReadLine();
+      return true;
+    }
+
+  private:
+    util::FilePiece &in_;
+    uint64_t remaining_;
+};
+
+class MatchNGrams {
+  public:
+    MatchNGrams(const VocabSets &vocab, unsigned int length) : vocab_(vocab), length_(length) {}
+
+    void operator()(const LineBatch &batch, Matches &out) const {
+      out.sets.clear();
+      out.ends.clear();
+      for (std::size_t i = 0; i < batch.Size(); ++i) {
+        out.words.clear();
+        // Probability, words, and optional backoff.  
+        util::TokenIter<util::AnyCharacter, true> token(batch[i], util::AnyCharacter(" \t"));
+        UTIL_THROW_IF(!token, FormatLoadException, "Empty " << length_ << "-gram line");
+        for (++token; token && out.words.size() < length_; ++token) {
+          out.words.push_back(*token);
+        }
+        UTIL_THROW_IF(out.words.size() != length_, FormatLoadException, "Too few words in the " << length_ << "-gram \"" << batch[i] << "\"");
+        vocab_.Intersect(out.words.begin(), out.words.end(), out.sets, out.temp);
+        out.ends.push_back(out.sets.size());
+      }
+    }
+
+  private:
+    const VocabSets &vocab_;
+    const unsigned int length_;
+};
+
+class WriteMatches {
+  public:
+    WriteMatches(std::size_t first_set, boost::ptr_vector<ARPAOutput> &outputs) : first_(first_set), outputs_(outputs) {}
+
+    void operator()(const LineBatch &batch, const Matches &matches) {
+      std::vector<uint32_t>::const_iterator set = matches.sets.begin();
+      for (std::size_t i = 0; i < batch.Size(); ++i) {
+        std::vector<uint32_t>::const_iterator end = matches.sets.begin() + matches.ends[i];
+        for (; set != end; ++set) {
+          // Sets are sorted, and only a window of them is open.  
+          if (*set < first_) continue;
+          if (*set - first_ >= outputs_.size()) {
+            set = end;
+            break;
+          }
+          outputs_[*set - first_].AddNGram(batch[i]);
+        }
+      }
+    }
+
+  private:
+    const std::size_t first_;
+    boost::ptr_vector<ARPAOutput> &outputs_;
+};
+
+} // namespace
+
+std::vector<uint64_t> FilterARPA(util::FilePiece &in, const VocabSets &vocab, std::size_t first_set, boost::ptr_vector<ARPAOutput> &outputs, unsigned int threads) {
+  std::vector<uint64_t> counts;
+  ReadARPACounts(in, counts);
+  for (boost::ptr_vector<ARPAOutput>::iterator i = outputs.begin(); i != outputs.end(); ++i) {
+    i->BeginHeader(counts.size());
+  }
+  WriteMatches write(first_set, outputs);
+  for (unsigned int length = 1; length <= counts.size(); ++length) {
+    ReadNGramHeader(in, length);
+    for (boost::ptr_vector<ARPAOutput>::iterator i = outputs.begin(); i != outputs.end(); ++i) {
+      i->BeginNGrams(length);
+    }
+    NGramLines read(in, counts[length - 1]);
+    ProcessBatches<Matches>(threads, kBatchLines, read, MatchNGrams(vocab, length), write);
+  }
+  ReadEnd(in);
+  for (boost::ptr_vector<ARPAOutput>::iterator i = outputs.begin(); i != outputs.end(); ++i) {
+    i->Finish();
+  }
+  return counts;
+}
+
+} // namespace filter
+} // namespace lm
@@ -0,0 +1,72 @@
+#ifndef LM_FILTER_ARPA_IO__
+#define LM_FILTER_ARPA_IO__
+
+// Streaming ARPA input and output for the filter.  
+
+#include "util/file.hh"
+#include "util/string_piece.hh"
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace util { class FilePiece; }
+
+namespace lm {
+namespace filter {
+
+class VocabSets;
+
+/* Write an ARPA file whose counts are only known at the end.  The header is
+ * written with room for the largest counts and overwritten by Finish, so the
+ * n-grams go straight to disk.  The output must therefore be seekable.  
+ */
+class ARPAOutput : boost::noncopyable {
+  public:
+    explicit ARPAOutput(const std::string &name);
+
+    // Reserve the header for a model of this order.  Call before BeginNGrams.  
+    void BeginHeader(unsigned int order);
+
+    void BeginNGrams(unsigned int length);
+
+    void AddNGram(const StringPiece &line) {
+      Write(line.data(), line.size());
+      Write("\n", 1);
+      ++counts_[length_ - 1];
+    }
+
+    void Finish();
+
+    const std::string &Name() const { return name_; }
+
+    const std::vector<uint64_t> &Counts() const { return counts_; }
+
+  private:
+    void Write(const void *data, std::size_t size);
+
+    void WriteHeader();
+
+    std::string name_;
+    util::scoped_FILE file_;
+    std::vector<uint64_t> counts_;
+    unsigned int length_;
+};
+
+/* Copy the n-grams of an ARPA file whose words are all in set first_set + i
+ * of vocab to outputs[i].  Sets outside that range are ignored, so a large
+ * number of sets can be written a group of files at a time.  Lines are
+ * filtered by threads in parallel batches and written in their original
+ * order.  Returns the counts of the input.  
+ */
+std::vector<uint64_t> FilterARPA(util::FilePiece &in, const VocabSets &vocab, std::size_t first_set, boost::ptr_vector<ARPAOutput> &outputs, unsigned int threads);
+
+} // namespace filter
+} // namespace lm
+
+#endif // LM_FILTER_ARPA_IO__
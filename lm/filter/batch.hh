@@ -0,0 +1,103 @@
+#ifndef LM_FILTER_BATCH__
+#define LM_FILTER_BATCH__
+
+// Process lines of a file in parallel batches while keeping their order.  
+
+#include "util/string_piece.hh"
+#include "util/workers.hh"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lm {
+namespace filter {
+
+// Lines copied out of the input so they outlive the file buffer.  
+class LineBatch {
+  public:
+    void Clear() {
+      text_.clear();
+      ends_.clear();
+    }
+
+    void Add(const StringPiece &line) {
+      text_.append(line.data(), line.size());
+      ends_.push_back(text_.size());
+    }
+
+    std::size_t Size() const { return ends_.size(); }
+
+    StringPiece operator[](std::size_t index) const {
+      std::size_t begin = index ? ends_[index - 1] : 0;
+      return StringPiece(text_.data() + begin, ends_[index] - begin);
+    }
+
+  private:
+    std::string text_;
+    std::vector<std::size_t> ends_;
+};
+
+namespace detail {
+template <class Process, class Result> class ProcessTask {
+  public:
+    ProcessTask(const Process &process, const LineBatch &batch, Result &result) : process_(process), batch_(batch), result_(result) {}
+
+    void operator()() const { process_(batch_, result_); }
+
+  private:
+    const Process &process_;
+    const LineBatch &batch_;
+    Result &result_;
+};
+
+// Fill up to batches.size() batches.  Returns how many are not empty.  
+template <class Reader> std::size_t FillBatches(Reader &read, std::size_t batch_lines, bool &more, std::vector<LineBatch> &batches) {
+  StringPiece line;
+  std::size_t filled = 0;
+  for (; more && filled < batches.size(); ++filled) {
+    LineBatch &batch = batches[filled];
+    batch.Clear();
+    while (batch.Size() < batch_lines && (more = read(line))) batch.Add(line);
+    if (!batch.Size()) break;
+  }
+  return filled;
+}
+} // namespace detail
+
+/* Read calls read(line) until it returns false, in rounds of one batch of
+ * batch_lines per thread.  Each batch is given to process(batch, result) on
+ * its own thread while the next round is read, then write(batch, result) is
+ * called on this thread in input order.  Result must be default constructible
+ * and is reused between rounds, so process should clear it.  
+ */
+template <class Result, class Reader, class Process, class Writer> void ProcessBatches(unsigned int threads, std::size_t batch_lines, Reader &read, const Process &process, Writer &write) {
+  std::vector<LineBatch> batches[2];
+  std::vector<Result> results[2];
+  for (unsigned int i = 0; i < 2; ++i) {
+    batches[i].resize(threads);
+    results[i].resize(threads);
+  }
+
+  util::Workers workers(threads);
+  bool more = true;
+  unsigned int current = 0;
+  std::size_t filled = detail::FillBatches(read, batch_lines, more, batches[current]);
+  while (filled) {
+    for (std::size_t i = 0; i < filled; ++i) {
+      workers.Run(detail::ProcessTask<Process, Result>(process, batches[current][i], results[current][i]));
+    }
+    std::size_t next_filled = detail::FillBatches(read, batch_lines, more, batches[current ^ 1]);
+    workers.Join();
+    for (std::size_t i = 0; i < filled; ++i) {
+      write(batches[current][i], results[current][i]);
+    }
+    current ^= 1;
+    filled = next_filled;
+  }
+}
+
+} // namespace filter
+} // namespace lm
+
+#endif // LM_FILTER_BATCH__
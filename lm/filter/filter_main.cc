@@ -0,0 +1,205 @@
+#include "lm/filter/arpa_io.hh"
+#include "lm/filter/phrase_table.hh"
+#include "lm/filter/vocab.hh"
+#include "lm/model.hh"
+#include "util/file_piece.hh"
+#include "util/usage.hh"
+#include "util/workers.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef WIN32
+#include "util/getopt.hh"
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace lm {
+namespace filter {
+namespace {
+
+void Usage(const char *name) {
+  std::cerr << "Usage: " << name << " [-v vocab] [-p phrase_table -i input] [-T threads] [-b probing|trie] [-m megabytes] union|sentence input.arpa output\n\n"
+"Keeps only the n-grams whose words are all in a vocabulary, so that a model\n"
+"can be restricted to the words a decoder could produce for a given input.\n\n"
+"union writes one model with the n-grams of any vocabulary.\n"
+"sentence writes output.0, output.1, ... with the n-grams of each sentence.\n\n"
+"-v reads the vocabulary from a file.  In sentence mode, each line is the\n"
+"   vocabulary of a sentence.\n"
+"-p reads a Moses phrase or rule table and keeps the target words of entries\n"
+"   whose source side appears in the input text given by -i.  Source words\n"
+"   are kept too since unknown words are copied.  May be repeated.\n"
+"-T sets the number of threads.  Default is 1.\n"
+"-b writes binary probing or trie models instead of ARPA.\n"
+"-m limits the memory used for sorting trie models, shared by the threads\n"
+"   building them.  Measured in MB.  Default is 1024MB.\n\n"
+"Outputs must be regular files.  <s>, </s>, and <unk> are always kept.  With\n"
+"more sentences than files that may be open at once, the input is read once\n"
+"per group of outputs, so it must be a file too.\n";
+  exit(1);
+}
+
+class BuildBinary {
+  public:
+    BuildBinary(const std::string &arpa, const std::string &binary, bool trie, std::size_t memory) : arpa_(arpa), binary_(binary), trie_(trie), memory_(memory) {}
+
+    void operator()() const {
+      ngram::Config config;
+      config.messages = NULL;
+      config.building_memory = memory_;
+      config.write_mmap = binary_.c_str();
+      if (trie_) {
+        config.write_method = ngram::Config::WRITE_MMAP;
+        ngram::TrieModel model(arpa_.c_str(), config);
+      } else {
+        config.write_method = ngram::Config::WRITE_AFTER;
+        ngram::ProbingModel model(arpa_.c_str(), config);
+      }
+      UTIL_THROW_IF(std::remove(arpa_.c_str()), util::ErrnoException, "Could not delete " << arpa_);
+    }
+
+  private:
+    std::string arpa_, binary_;
+    bool trie_;
+    std::size_t memory_;
+};
+
+// Number of output files to keep open at once, leaving descriptors for the
+// input and the rest of the process.  
+std::size_t OpenFileLimit() {
+#ifdef WIN32
+  return 256;
+#else
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) || limit.rlim_cur == RLIM_INFINITY) return 4096;
+  return std::max<std::size_t>(1, limit.rlim_cur / 2);
+#endif
+}
+
+} // namespace
+} // namespace filter
+} // namespace lm
+
+int main(int argc, char *argv[]) {
+  using namespace lm::filter;
+  try {
+    const char *vocab_file = NULL, *input_file = NULL, *binary = NULL;
+    std::vector<const char*> tables;
+    unsigned int threads = 1;
+    std::size_t building_memory = lm::ngram::Config().building_memory;
+    int opt;
+    while ((opt = getopt(argc, argv, "v:p:i:T:b:m:")) != -1) {
+      switch (opt) {
+        case 'v':
+          vocab_file = optarg;
+          break;
+        case 'p':
+          tables.push_back(optarg);
+          break;
+        case 'i':
+          input_file = optarg;
+          break;
+        case 'T':
+          threads = std::max(1, atoi(optarg));
+          break;
+        case 'b':
+          if (strcmp(optarg, "probing") && strcmp(optarg, "trie")) Usage(argv[0]);
+          binary = optarg;
+          break;
+        case 'm':
+          building_memory = static_cast<std::size_t>(std::max(1, atoi(optarg))) * 1048576;
+          break;
+        default:
+          Usage(argv[0]);
+      }
+    }
+    if (optind + 3 != argc) Usage(argv[0]);
+    bool per_sentence;
+    if (!strcmp(argv[optind], "union")) {
+      per_sentence = false;
+    } else if (!strcmp(argv[optind], "sentence")) {
+      per_sentence = true;
+    } else {
+      Usage(argv[0]);
+    }
+    if (!vocab_file == tables.empty() || !input_file != tables.empty()) {
+      std::cerr << "Specify either -v or both -p and -i." << std::endl;
+      Usage(argv[0]);
+    }
+    const char *arpa = argv[optind + 1];
+    const std::string output(argv[optind + 2]);
+
+    double start = util::WallTime();
+    VocabSets vocab;
+    if (vocab_file) {
+      util::FilePiece in(vocab_file);
+      ReadVocab(in, per_sentence, vocab);
+    } else {
+      util::FilePiece text(input_file);
+      PhraseTableVocab reachable(text, per_sentence);
+      for (std::vector<const char*>::const_iterator i = tables.begin(); i != tables.end(); ++i) {
+        util::FilePiece table(*i, &std::cerr);
+        reachable.Read(table, vocab, threads);
+      }
+    }
+    std::cerr << "Vocabulary of " << vocab.Words() << " words in " << vocab.Sets() << " set" << (vocab.Sets() == 1 ? "" : "s") << " took " << (util::WallTime() - start) << "s" << std::endl;
+
+    start = util::WallTime();
+    std::vector<std::string> arpa_names, binary_names;
+    for (std::size_t i = 0; i < vocab.Sets(); ++i) {
+      std::ostringstream name;
+      name << output;
+      if (per_sentence) name << '.' << i;
+      binary_names.push_back(name.str());
+      arpa_names.push_back(binary ? name.str() + ".arpa" : name.str());
+    }
+    // Only a group of outputs is open at a time, reading the input once per group.  
+    const std::size_t group = OpenFileLimit();
+    std::vector<uint64_t> counts, kept;
+    for (std::size_t first = 0; first < arpa_names.size(); first += group) {
+      util::FilePiece in(arpa, &std::cerr);
+      boost::ptr_vector<ARPAOutput> outputs;
+      for (std::size_t i = first; i < std::min(first + group, arpa_names.size()); ++i) {
+        outputs.push_back(new ARPAOutput(arpa_names[i]));
+      }
+      counts = FilterARPA(in, vocab, first, outputs, threads);
+      kept.resize(counts.size());
+      for (boost::ptr_vector<ARPAOutput>::const_iterator i = outputs.begin(); i != outputs.end(); ++i) {
+        for (std::size_t length = 0; length < counts.size(); ++length) {
+          kept[length] += i->Counts()[length];
+        }
+      }
+    }
+    for (std::size_t length = 1; length <= counts.size(); ++length) {
+      std::cerr << length << "-grams: kept " << kept[length - 1];
+      if (per_sentence) std::cerr << " (" << (static_cast<double>(kept[length - 1]) / arpa_names.size()) << " per sentence)";
+      std::cerr << " of " << counts[length - 1] << '\n';
+    }
+    std::cerr << "Filtering took " << (util::WallTime() - start) << "s" << std::endl;
+
+    if (binary) {
+      start = util::WallTime();
+      const unsigned int builders = std::min<std::size_t>(threads, arpa_names.size());
+      util::Workers workers(builders);
+      for (std::size_t i = 0; i < arpa_names.size(); ++i) {
+        workers.Run(BuildBinary(arpa_names[i], binary_names[i], !strcmp(binary, "trie"), building_memory / builders));
+      }
+      workers.Join();
+      std::cerr << "Building " << binary << " models took " << (util::WallTime() - start) << "s" << std::endl;
+    }
+    util::PrintUsage(std::cerr);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include "lm/filter/phrase_table.hh"
+
+#include "lm/filter/batch.hh"
+#include "lm/vocab.hh"
+#include "util/file_piece.hh"
+#include "util/tokenize_piece.hh"
+
+#include <algorithm>
+#include <utility>
+
+namespace lm {
+namespace filter {
+
+namespace {
+
+const std::size_t kBatchLines = 16384;
+
+typedef util::TokenIter<util::AnyCharacter, true> WordIter;
+
+bool IsNonTerminal(const StringPiece &word) {
+  return word.size() >= 2 && word.data()[0] == '[' && word.data()[word.size() - 1] == ']';
+}
+
+} // namespace
+
+PhraseTableVocab::PhraseTableVocab(util::FilePiece &text, bool per_sentence) : sentences_(0), sets_(0) {
+  std::vector<uint64_t> hashes;
+  try {
+    while (true) {
+      StringPiece line(text.ReadLine());
+      uint32_t set = per_sentence ? sentences_ : 0;
+      hashes.clear();
+      for (WordIter word(line, util::AnyCharacter(" \t\r")); word; ++word) {
+        hashes.push_back(ngram::detail::HashForVocab(*word));
+        words_.Insert(set, *word);
+      }
+      for (std::size_t begin = 0; begin < hashes.size(); ++begin) {
+        uint64_t hash = 0;
+        for (std::size_t end = begin; end < hashes.size(); ++end) {
+          hash = Extend(hash, hashes[end]);
+          std::vector<uint32_t> &sets = spans_[hash];
+          if (sets.empty() || sets.back() != set) sets.push_back(set);
+        }
+      }
+      ++sentences_;
+    }
+  } catch (const util::EndOfFileException &e) {}
+  sets_ = per_sentence ? sentences_ : 1;
+  words_.ReserveSets(sets_);
+  words_.FinishInsertion();
+}
+
+namespace {
+
+// (set, target word) pairs found in a batch.  
+struct Reached {
+  std::vector<std::pair<uint32_t, StringPiece> > words;
+  // Scratch space.  
+  std::vector<StringPiece> terminals;
+  std::vector<uint32_t> sets, temp;
+};
+
+class TableLines {
+  public:
+    explicit TableLines(util::FilePiece &in) : in_(in) {}
+
+    bool operator()(StringPiece &line) {
+      try {
+        line = in_.ReadLine();
+      } catch (const util::EndOfFileException &e) {
+        return false;
+      }
+      return true;
+    }
+
+  private:
+    util::FilePiece &in_;
+};
+
+class MatchEntries {
+  public:
+    MatchEntries(const boost::unordered_map<uint64_t, std::vector<uint32_t> > &spans, const VocabSets &words) : spans_(spans), words_(words) {}
+
+    void operator()(const LineBatch &batch, Reached &out) const {
+      out.words.clear();
+      for (std::size_t i = 0; i < batch.Size(); ++i) {
+        util::TokenIter<util::MultiCharacter> field(batch[i], util::MultiCharacter("|||"));
+        if (!field) continue;
+        StringPiece source(*field);
+        if (!++field) continue;
+        StringPiece target(*field);
+
+        out.sets.clear();
+        out.terminals.clear();
+        uint64_t hash = 0;
+        bool hierarchical = false;
+        for (WordIter word(source, util::AnyCharacter(" \t")); word; ++word) {
+          if (IsNonTerminal(*word)) {
+            hierarchical = true;
+          } else {
+            out.terminals.push_back(*word);
+            hash = PhraseTableVocab::Extend(hash, ngram::detail::HashForVocab(*word));
+          }
+        }
+        if (hierarchical) {
+          words_.Intersect(out.terminals.begin(), out.terminals.end(), out.sets, out.temp);
+        } else {
+          boost::unordered_map<uint64_t, std::vector<uint32_t> >::const_iterator found = spans_.find(hash);
+          if (found == spans_.end() || out.terminals.empty()) continue;
+          out.sets = found->second;
+        }
+
+        for (WordIter word(target, util::AnyCharacter(" \t")); word; ++word) {
+          if (IsNonTerminal(*word)) continue;
+          for (std::vector<uint32_t>::const_iterator set = out.sets.begin(); set != out.sets.end(); ++set) {
+            out.words.push_back(std::make_pair(*set, *word));
+          }
+        }
+      }
+    }
+
+  private:
+    const boost::unordered_map<uint64_t, std::vector<uint32_t> > &spans_;
+    const VocabSets &words_;
+};
+
+class InsertReached {
+  public:
+    explicit InsertReached(VocabSets &out) : out_(out) {}
+
+    void operator()(const LineBatch & /*batch*/, const Reached &reached) {
+      for (std::vector<std::pair<uint32_t, StringPiece> >::const_iterator i = reached.words.begin(); i != reached.words.end(); ++i) {
+        out_.Insert(i->first, i->second);
+      }
+    }
+
+  private:
+    VocabSets &out_;
+};
+
+} // namespace
+
+void PhraseTableVocab::Read(util::FilePiece &table, VocabSets &out, unsigned int threads) const {
+  TableLines read(table);
+  InsertReached write(out);
+  ProcessBatches<Reached>(threads, kBatchLines, read, MatchEntries(spans_, words_), write);
+  // Unknown words are copied to the output.  
+  out.Union(words_);
+  out.ReserveSets(sets_);
+  out.FinishInsertion();
+}
+
+} // namespace filter
+} // namespace lm
@@ -0,0 +1,56 @@
+#ifndef LM_FILTER_PHRASE_TABLE__
+#define LM_FILTER_PHRASE_TABLE__
+
+// Target vocabulary reachable from an input text through a Moses phrase table.  
+
+#include "lm/filter/vocab.hh"
+
+#include <boost/unordered_map.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include <stdint.h>
+
+namespace util { class FilePiece; }
+
+namespace lm {
+namespace filter {
+
+/* Source phrases of a text.  Every span of every sentence is hashed, so a
+ * phrase table entry matches when its source side hashes the same.  Entries of
+ * hierarchical tables (source sides containing non-terminals like [X][X]) match
+ * a sentence containing all of their terminals, which may let through words
+ * that a real parse could not reach but never loses one.  
+ */
+class PhraseTableVocab {
+  public:
+    // Sentence i is set i with per_sentence, otherwise every sentence is set 0.  
+    PhraseTableVocab(util::FilePiece &text, bool per_sentence);
+
+    // Add the target words of matching entries in table to out, as well as the
+    // source words since unknown words are copied to the output.  
+    void Read(util::FilePiece &table, VocabSets &out, unsigned int threads) const;
+
+    std::size_t Sentences() const { return sentences_; }
+
+    // Hash of a phrase from the vocabulary hashes of its words.  
+    static uint64_t Extend(uint64_t hash, uint64_t word) {
+      return (hash + word) * 0x9E3779B97F4A7C15ULL + 0x7F4A7C15ULL;
+    }
+
+  private:
+    typedef boost::unordered_map<uint64_t, std::vector<uint32_t> > Spans;
+
+    Spans spans_;
+
+    // Source words of each set, for hierarchical entries.  
+    VocabSets words_;
+
+    std::size_t sentences_, sets_;
+};
+
+} // namespace filter
+} // namespace lm
+
+#endif // LM_FILTER_PHRASE_TABLE__
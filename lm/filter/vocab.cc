@@ -0,0 +1,75 @@
+#include "lm/filter/vocab.hh"
+
+#include "lm/vocab.hh"
+#include "util/file_piece.hh"
+#include "util/tokenize_piece.hh"
+
+#include <algorithm>
+
+namespace lm {
+namespace filter {
+
+const std::vector<uint32_t> VocabSets::kAll;
+
+VocabSets::VocabSets() : sets_(0) {
+  specials_[0] = ngram::detail::HashForVocab("<s>", 3);
+  specials_[1] = ngram::detail::HashForVocab("</s>", 4);
+  specials_[2] = ngram::detail::HashForVocab("<unk>", 5);
+}
+
+void VocabSets::Insert(uint32_t set, const StringPiece &word) {
+  Insert(set, ngram::detail::HashForVocab(word));
+}
+
+void VocabSets::Union(const VocabSets &other) {
+  for (Map::const_iterator i = other.words_.begin(); i != other.words_.end(); ++i) {
+    for (std::vector<uint32_t>::const_iterator set = i->second.begin(); set != i->second.end(); ++set) {
+      Insert(*set, i->first);
+    }
+  }
+  ReserveSets(other.sets_);
+}
+
+void VocabSets::Insert(uint32_t set, uint64_t hash) {
+  std::vector<uint32_t> &sets = words_[hash];
+  // Sets are usually filled one at a time, so this catches most duplicates.  
+  if (sets.empty() || sets.back() != set) sets.push_back(set);
+  if (set >= sets_) sets_ = set + 1;
+}
+
+void VocabSets::FinishInsertion() {
+  for (Map::iterator i = words_.begin(); i != words_.end(); ++i) {
+    std::vector<uint32_t> &sets = i->second;
+    std::sort(sets.begin(), sets.end());
+    sets.erase(std::unique(sets.begin(), sets.end()), sets.end());
+  }
+}
+
+const std::vector<uint32_t> *VocabSets::Find(const StringPiece &word) const {
+  uint64_t hash = ngram::detail::HashForVocab(word);
+  if (hash == specials_[0] || hash == specials_[1] || hash == specials_[2]) return &kAll;
+  Map::const_iterator found = words_.find(hash);
+  return (found == words_.end()) ? NULL : &found->second;
+}
+
+void VocabSets::IntersectSorted(std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator first_end, std::vector<uint32_t>::const_iterator second, std::vector<uint32_t>::const_iterator second_end, std::vector<uint32_t> &out) {
+  std::set_intersection(first, first_end, second, second_end, std::back_inserter(out));
+}
+
+void ReadVocab(util::FilePiece &in, bool per_sentence, VocabSets &out) {
+  uint32_t set = 0;
+  try {
+    while (true) {
+      StringPiece line(in.ReadLine());
+      for (util::TokenIter<util::AnyCharacter, true> word(line, util::AnyCharacter(" \t\r")); word; ++word) {
+        out.Insert(set, *word);
+      }
+      if (per_sentence) out.ReserveSets(++set);
+    }
+  } catch (const util::EndOfFileException &e) {}
+  out.ReserveSets(1);
+  out.FinishInsertion();
+}
+
+} // namespace filter
+} // namespace lm
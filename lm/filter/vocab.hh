@@ -0,0 +1,102 @@
+#ifndef LM_FILTER_VOCAB__
+#define LM_FILTER_VOCAB__
+
+// Sets of words an n-gram must be drawn from to be kept by the filter.  
+
+#include "util/string_piece.hh"
+
+#include <boost/unordered_map.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include <stdint.h>
+
+namespace util { class FilePiece; }
+
+namespace lm {
+namespace filter {
+
+/* Numbered vocabulary sets, e.g. the target words reachable from each
+ * sentence of a test set.  Words are stored as their 64-bit vocabulary hash
+ * with the sorted list of sets containing them, so checking an n-gram
+ * against thousands of sets costs one lookup per word and an intersection of
+ * short lists.  <s>, </s>, and <unk> belong to every set.  
+ */
+class VocabSets {
+  public:
+    VocabSets();
+
+    // Add word to set.  Call FinishInsertion before querying.  
+    void Insert(uint32_t set, const StringPiece &word);
+
+    // Add every word of other to the same sets here.  
+    void Union(const VocabSets &other);
+
+    void FinishInsertion();
+
+    // Number of sets, including empty ones below the largest id inserted.  
+    std::size_t Sets() const { return sets_; }
+    // Declare sets that may have no words of their own.  
+    void ReserveSets(std::size_t sets) { if (sets > sets_) sets_ = sets; }
+
+    std::size_t Words() const { return words_.size(); }
+
+    /* Find the sets that contain all of the words and append them to out in
+     * increasing order.  temp is scratch space.  
+     */
+    template <class Iterator> void Intersect(Iterator begin, Iterator end, std::vector<uint32_t> &out, std::vector<uint32_t> &temp) const {
+      std::size_t start = out.size();
+      bool any = false;
+      for (Iterator i = begin; i != end; ++i) {
+        const std::vector<uint32_t> *sets = Find(*i);
+        if (sets == &kAll) continue;
+        if (!sets) {
+          out.resize(start);
+          return;
+        }
+        if (!any) {
+          out.insert(out.end(), sets->begin(), sets->end());
+          any = true;
+        } else {
+          temp.clear();
+          IntersectSorted(out.begin() + start, out.end(), sets->begin(), sets->end(), temp);
+          out.resize(start);
+          out.insert(out.end(), temp.begin(), temp.end());
+        }
+        if (out.size() == start) return;
+      }
+      // Only special words: every set.  
+      if (!any) {
+        for (uint32_t s = 0; s < sets_; ++s) out.push_back(s);
+      }
+    }
+
+  private:
+    typedef boost::unordered_map<uint64_t, std::vector<uint32_t> > Map;
+
+    void Insert(uint32_t set, uint64_t hash);
+
+    // &kAll for special words, NULL for words in no set.  
+    const std::vector<uint32_t> *Find(const StringPiece &word) const;
+
+    static void IntersectSorted(std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator first_end, std::vector<uint32_t>::const_iterator second, std::vector<uint32_t>::const_iterator second_end, std::vector<uint32_t> &out);
+
+    static const std::vector<uint32_t> kAll;
+
+    Map words_;
+
+    uint64_t specials_[3];
+
+    std::size_t sets_;
+};
+
+/* Read whitespace-separated words.  With per_sentence, line i is set i;
+ * otherwise everything goes into set 0.  
+ */
+void ReadVocab(util::FilePiece &in, bool per_sentence, VocabSets &out);
+
+} // namespace filter
+} // namespace lm
+
+#endif // LM_FILTER_VOCAB__
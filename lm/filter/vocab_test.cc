@@ -0,0 +1,70 @@
+#include "lm/filter/vocab.hh"
+
+#define BOOST_TEST_MODULE FilterVocabTest
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+namespace lm {
+namespace filter {
+namespace {
+
+std::vector<uint32_t> Sets(const VocabSets &vocab, const char *words) {
+  std::vector<StringPiece> split;
+  for (const char *i = words; *i; ) {
+    const char *end = i;
+    while (*end && *end != ' ') ++end;
+    split.push_back(StringPiece(i, end - i));
+    i = *end ? end + 1 : end;
+  }
+  std::vector<uint32_t> ret, temp;
+  vocab.Intersect(split.begin(), split.end(), ret, temp);
+  return ret;
+}
+
+BOOST_AUTO_TEST_CASE(Intersect) {
+  VocabSets vocab;
+  vocab.Insert(0, "a");
+  vocab.Insert(0, "b");
+  vocab.Insert(2, "b");
+  vocab.Insert(1, "a");
+  vocab.Insert(2, "c");
+  vocab.Insert(2, "a");
+  vocab.FinishInsertion();
+  BOOST_CHECK_EQUAL(3, vocab.Sets());
+
+  std::vector<uint32_t> got(Sets(vocab, "a"));
+  BOOST_REQUIRE_EQUAL(3, got.size());
+  BOOST_CHECK_EQUAL(0, got[0]);
+  BOOST_CHECK_EQUAL(1, got[1]);
+  BOOST_CHECK_EQUAL(2, got[2]);
+
+  got = Sets(vocab, "<s> a b");
+  BOOST_REQUIRE_EQUAL(2, got.size());
+  BOOST_CHECK_EQUAL(0, got[0]);
+  BOOST_CHECK_EQUAL(2, got[1]);
+
+  got = Sets(vocab, "c b a </s>");
+  BOOST_REQUIRE_EQUAL(1, got.size());
+  BOOST_CHECK_EQUAL(2, got[0]);
+
+  BOOST_CHECK(Sets(vocab, "a d").empty());
+  BOOST_CHECK(Sets(vocab, "c b a b a c").size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(Specials) {
+  VocabSets vocab;
+  vocab.Insert(1, "a");
+  vocab.ReserveSets(4);
+  vocab.FinishInsertion();
+  std::vector<uint32_t> got(Sets(vocab, "<s> <unk> </s>"));
+  BOOST_REQUIRE_EQUAL(4, got.size());
+  BOOST_CHECK_EQUAL(3, got[3]);
+  got = Sets(vocab, "<s> a");
+  BOOST_REQUIRE_EQUAL(1, got.size());
+  BOOST_CHECK_EQUAL(1, got[0]);
+}
+
+} // namespace
+} // namespace filter
+} // namespace lm
@@ -1,41 +1,108 @@
 #include "lm/ngram_query.hh"
+#include "util/getopt.hh"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+void Usage(const char *name) {
+  std::cerr << "Usage: " << name << " [-l load_method] [-b batch_file [-T threads]] lm_file [null]" << std::endl;
+  std::cerr << "Input is wrapped in <s> and </s> unless null is passed." << std::endl;
+  std::cerr << "load_method is lazy, populate, populate_or_read (default), read, huge,\n"
+    "huge_pool, or interleave.  huge reads into transparent huge pages, huge_pool\n"
+    "into pages reserved with vm.nr_hugepages, and interleave spreads huge pages\n"
+    "over all NUMA nodes.\n"
+    "-b scores batch_file, one sentence per line, instead of stdin.  The file is\n"
+    "mapped and split among threads (default 1).  Only sentence totals are\n"
+    "printed; throughput and lookup statistics go to stderr." << std::endl;
+}
+
+struct Options {
+  util::LoadMethod load_method;
+  const char *batch;
+  unsigned int threads;
+  bool sentence_context;
+};
+
+template <class Model> void Run(const char *file, const Options &options) {
+  if (options.batch) {
+    lm::ngram::BatchQuery<Model>(file, options.load_method, options.batch, options.threads, options.sentence_context, std::cout);
+  } else {
+    lm::ngram::Query<Model>(file, options.load_method, options.sentence_context, std::cin, std::cout);
+  }
+}
+
+} // namespace
 
 int main(int argc, char *argv[]) {
-  if (!(argc == 2 || (argc == 3 && !strcmp(argv[2], "null")))) {
-    std::cerr << "Usage: " << argv[0] << " lm_file [null]" << std::endl;
-    std::cerr << "Input is wrapped in <s> and </s> unless null is passed." << std::endl;
+  Options options;
+  options.load_method = util::POPULATE_OR_READ;
+  options.batch = NULL;
+  options.threads = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, "l:b:T:")) != -1) {
+    switch (opt) {
+      case 'l':
+        if (!util::ParseLoadMethod(optarg, options.load_method)) {
+          std::cerr << "Unknown load method " << optarg << std::endl;
+          Usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'b':
+        options.batch = optarg;
+        break;
+      case 'T':
+        {
+          char *end;
+          options.threads = strtoul(optarg, &end, 10);
+          if (*end || !options.threads) {
+            std::cerr << "Bad thread count " << optarg << std::endl;
+            return 1;
+          }
+        }
+        break;
+      default:
+        Usage(argv[0]);
+        return 1;
+    }
+  }
+  if (!(argc == optind + 1 || (argc == optind + 2 && !strcmp(argv[optind + 1], "null")))) {
+    Usage(argv[0]);
     return 1;
   }
+  const char *file = argv[optind];
+  options.sentence_context = (argc == optind + 1);
   try {
-    bool sentence_context = (argc == 2);
     using namespace lm::ngram;
     ModelType model_type;
-    if (RecognizeBinary(argv[1], model_type)) {
+    if (RecognizeBinary(file, model_type)) {
       switch(model_type) {
         case PROBING:
-          Query<lm::ngram::ProbingModel>(argv[1], sentence_context, std::cin, std::cout);
+          Run<lm::ngram::ProbingModel>(file, options);
           break;
         case REST_PROBING:
-          Query<lm::ngram::RestProbingModel>(argv[1], sentence_context, std::cin, std::cout);
+          Run<lm::ngram::RestProbingModel>(file, options);
           break;
         case TRIE:
-          Query<TrieModel>(argv[1], sentence_context, std::cin, std::cout);
+          Run<TrieModel>(file, options);
           break;
         case QUANT_TRIE:
-          Query<QuantTrieModel>(argv[1], sentence_context, std::cin, std::cout);
+          Run<QuantTrieModel>(file, options);
           break;
         case ARRAY_TRIE:
-          Query<ArrayTrieModel>(argv[1], sentence_context, std::cin, std::cout);
+          Run<ArrayTrieModel>(file, options);
           break;
         case QUANT_ARRAY_TRIE:
-          Query<QuantArrayTrieModel>(argv[1], sentence_context, std::cin, std::cout);
+          Run<QuantArrayTrieModel>(file, options);
           break;
         default:
           std::cerr << "Unrecognized kenlm model type " << model_type << std::endl;
           abort();
       }
     } else {
-      Query<ProbingModel>(argv[1], sentence_context, std::cin, std::cout);
+      Run<ProbingModel>(file, options);
     }
     std::cerr << "Total time including destruction:\n";
     util::PrintUsage(std::cerr);
@@ -3,13 +3,24 @@
 
 #include "lm/enumerate_vocab.hh"
 #include "lm/model.hh"
+#include "util/file.hh"
+#include "util/mmap.hh"
+#include "util/string_piece.hh"
+#include "util/tokenize_piece.hh"
 #include "util/usage.hh"
+#include "util/workers.hh"
 
 #include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <ostream>
 #include <istream>
+#include <sstream>
 #include <string>
+#include <vector>
+
+#include <stdint.h>
 
 namespace lm {
 namespace ngram {
@@ -20,6 +31,8 @@ template <class Model> void Query(const Model &model, bool sentence_context, std
   typename Model::State state, out;
   lm::FullScoreReturn ret;
   std::string word;
+  uint64_t queries = 0;
+  double start = util::WallTime();
 
   while (in_stream) {
     state = sentence_context ? model.BeginSentenceState() : model.NullContextState();
@@ -31,6 +44,7 @@ template <class Model> void Query(const Model &model, bool sentence_context, std
       lm::WordIndex vocab = model.GetVocabulary().Index(word);
       if (vocab == 0) ++oov;
       ret = model.FullScore(state, vocab, out);
+      ++queries;
       total += ret.prob;
       out_stream << word << '=' << vocab << ' ' << static_cast<unsigned int>(ret.ngram_length)  << ' ' << ret.prob << '\t';
       state = out;
@@ -49,21 +63,183 @@ template <class Model> void Query(const Model &model, bool sentence_context, std
     if (!got && !in_stream) break;
     if (sentence_context) {
       ret = model.FullScore(state, model.GetVocabulary().EndSentence(), out);
+      ++queries;
       total += ret.prob;
       out_stream << "</s>=" << model.GetVocabulary().EndSentence() << ' ' << static_cast<unsigned int>(ret.ngram_length)  << ' ' << ret.prob << '\t';
     }
     out_stream << "Total: " << total << " OOV: " << oov << '\n';
   }
+  double elapsed = util::WallTime() - start;
   std::cerr << "After queries:\n";
   util::PrintUsage(std::cerr);
+  std::cerr << "Queries:\t" << queries << "\nQueries per second:\t" << (elapsed > 0.0 ? static_cast<double>(queries) / elapsed : 0.0) << '\n';
 }
 
-template <class M> void Query(const char *file, bool sentence_context, std::istream &in_stream, std::ostream &out_stream) {
+template <class M> void Query(const char *file, util::LoadMethod load_method, bool sentence_context, std::istream &in_stream, std::ostream &out_stream) {
   Config config;
+  config.load_method = load_method;
   M model(file, config);
   Query(model, sentence_context, in_stream, out_stream);
 }
 
+// Counts from scoring part of a batch.  
+struct BatchStats {
+  BatchStats() : sentences(0), queries(0), oov(0), total(0.0) {}
+
+  void Add(const BatchStats &other) {
+    sentences += other.sentences;
+    queries += other.queries;
+    oov += other.oov;
+    total += other.total;
+    if (length.size() < other.length.size()) length.resize(other.length.size());
+    for (std::size_t i = 0; i < other.length.size(); ++i) length[i] += other.length[i];
+  }
+
+  uint64_t sentences, queries, oov;
+  double total;
+  // Queries by length of the matched n-gram.  Each order matched costs
+  // another probe into a different table, usually a cache miss.  
+  std::vector<uint64_t> length;
+};
+
+// Split text into about pieces parts ending at line boundaries.  
+inline void SplitLines(const StringPiece &text, unsigned int pieces, std::vector<StringPiece> &out) {
+  out.clear();
+  const char *begin = text.data(), *end = text.data() + text.size();
+  for (unsigned int i = 1; begin != end; ++i) {
+    const char *cut = (i >= pieces) ? end : text.data() + (text.size() * i) / pieces;
+    if (cut < begin) continue;
+    if (cut != end) {
+      const char *newline = static_cast<const char*>(memchr(cut, '\n', end - cut));
+      cut = newline ? newline + 1 : end;
+    }
+    out.push_back(StringPiece(begin, cut - begin));
+    begin = cut;
+  }
+}
+
+// Scores the sentences in one piece of a batch, writing a total per line.  
+template <class Model> class BatchShard {
+  public:
+    BatchShard(const Model &model, bool sentence_context, const StringPiece &text, std::string &out, BatchStats &stats)
+      : model_(&model), sentence_context_(sentence_context), text_(text), out_(&out), stats_(&stats) {}
+
+    void operator()() const {
+      const Model &model = *model_;
+      BatchStats &stats = *stats_;
+      stats.length.resize(model.Order() + 1);
+      std::ostringstream out;
+      typename Model::State state, next;
+      lm::FullScoreReturn ret;
+      for (util::TokenIter<util::SingleCharacter> line(text_, util::SingleCharacter('\n')); line; ++line) {
+        state = sentence_context_ ? model.BeginSentenceState() : model.NullContextState();
+        util::TokenIter<util::AnyCharacter, true> word(*line, util::AnyCharacter(" \t\r\f\v"));
+        // Blank lines are skipped, as in Query.  
+        if (!word) continue;
+        float total = 0.0;
+        unsigned int oov = 0;
+        for (; word; ++word) {
+          lm::WordIndex vocab = model.GetVocabulary().Index(*word);
+          if (vocab == 0) ++oov;
+          ret = model.FullScore(state, vocab, next);
+          total += ret.prob;
+          ++stats.length[ret.ngram_length];
+          ++stats.queries;
+          state = next;
+        }
+        if (sentence_context_) {
+          ret = model.FullScore(state, model.GetVocabulary().EndSentence(), next);
+          total += ret.prob;
+          ++stats.length[ret.ngram_length];
+          ++stats.queries;
+        }
+        out << "Total: " << total << " OOV: " << oov << '\n';
+        ++stats.sentences;
+        stats.oov += oov;
+        stats.total += total;
+      }
+      *out_ = out.str();
+    }
+
+  private:
+    const Model *model_;
+    bool sentence_context_;
+    StringPiece text_;
+    std::string *out_;
+    BatchStats *stats_;
+};
+
+// Score every line of the file input, one sentence per line, on threads
+// threads.  The input is mapped rather than streamed and split into shards up
+// front, so the time reported is nearly all model lookups.  Sentence totals
+// go to out_stream in input order; throughput and lookup statistics go to
+// stderr.  Useful as a benchmark of lookup speed across model types.  
+template <class Model> void BatchQuery(const Model &model, const char *input, unsigned int threads, bool sentence_context, std::ostream &out_stream) {
+  std::cerr << "Loading statistics:\n";
+  util::PrintUsage(std::cerr);
+
+  util::scoped_fd fd(util::OpenReadOrThrow(input));
+  uint64_t size = util::SizeFile(fd.get());
+  UTIL_THROW_IF(size == util::kBadSize, util::Exception, "Batch input " << input << " must be a regular file");
+  util::scoped_memory mem;
+  if (size) util::MapRead(util::POPULATE_OR_READ, fd.get(), 0, size, mem);
+  StringPiece text(static_cast<const char*>(mem.get()), size);
+
+  if (!threads) threads = 1;
+  std::vector<StringPiece> shards;
+  SplitLines(text, threads, shards);
+  std::vector<std::string> outputs(shards.size());
+  std::vector<BatchStats> stats(shards.size());
+
+  double start = util::WallTime();
+  {
+    util::Workers workers(threads);
+    for (std::size_t i = 0; i < shards.size(); ++i) {
+      workers.Run(BatchShard<Model>(model, sentence_context, shards[i], outputs[i], stats[i]));
+    }
+    workers.Join();
+  }
+  double elapsed = util::WallTime() - start;
+
+  BatchStats sum;
+  for (std::size_t i = 0; i < shards.size(); ++i) {
+    out_stream << outputs[i];
+    sum.Add(stats[i]);
+  }
+  out_stream.flush();
+
+  double qps = (elapsed > 0.0) ? static_cast<double>(sum.queries) / elapsed : 0.0;
+  std::cerr << "After queries:\n";
+  util::PrintUsage(std::cerr);
+  std::ios_base::fmtflags old_flags = std::cerr.flags();
+  std::streamsize old_precision = std::cerr.precision();
+  std::cerr << std::fixed << std::setprecision(2)
+    << "Threads:\t" << threads << '\n'
+    << "Sentences:\t" << sum.sentences << '\n'
+    << "Queries:\t" << sum.queries << '\n'
+    << "OOV:\t" << sum.oov << '\n'
+    << "Total:\t" << sum.total << '\n'
+    << "Seconds:\t" << elapsed << '\n'
+    << "Queries per second:\t" << qps << '\n'
+    << "Queries per second per thread:\t" << qps / threads << '\n';
+  // Longer matches touch more tables, so this predicts cache misses per query.  
+  uint64_t probes = 0;
+  for (std::size_t i = 1; i < sum.length.size(); ++i) {
+    probes += sum.length[i] * i;
+    std::cerr << "Matched length " << i << ":\t" << sum.length[i] << " (" << (sum.queries ? 100.0 * sum.length[i] / sum.queries : 0.0) << "%)\n";
+  }
+  std::cerr << "Mean matched length:\t" << (sum.queries ? static_cast<double>(probes) / sum.queries : 0.0) << std::endl;
+  std::cerr.flags(old_flags);
+  std::cerr.precision(old_precision);
+}
+
+template <class M> void BatchQuery(const char *file, util::LoadMethod load_method, const char *input, unsigned int threads, bool sentence_context, std::ostream &out_stream) {
+  Config config;
+  config.load_method = load_method;
+  M model(file, config);
+  BatchQuery(model, input, threads, sentence_context, out_stream);
+}
+
 } // namespace ngram
 } // namespace lm
 
@@ -10,13 +10,19 @@
 #include "util/mmap.hh"
 #include "util/proxy_iterator.hh"
 #include "util/sized_iterator.hh"
+#include "util/usage.hh"
+#include "util/workers.hh"
+
+#include <boost/shared_ptr.hpp>
 
 #include <algorithm>
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
 #include <deque>
+#include <iomanip>
 #include <limits>
+#include <sstream>
 #include <vector>
 
 namespace lm {
@@ -108,43 +114,210 @@ FILE *WriteContextFile(uint8_t *begin, uint8_t *end, const util::TempMaker &make
 }
 
 struct ThrowCombine {
-  void operator()(std::size_t /*entry_size*/, const void * /*first*/, const void * /*second*/, FILE * /*out*/) const {
+  void operator()(std::size_t /*entry_size*/, const void * /*previous*/) const {
     UTIL_THROW(FormatLoadException, "Duplicate n-gram detected.");
   }
 };
 
-// Useful for context files that just contain records with no value.  
+// Useful for context files that just contain records with no value.  The first
+// copy has already been written, so drop the rest.  
 struct FirstCombine {
-  void operator()(std::size_t entry_size, const void *first, const void * /*second*/, FILE *out) const {
-    WriteOrThrow(out, first, entry_size);
-  }
+  void operator()(std::size_t /*entry_size*/, const void * /*previous*/) const {}
 };
 
-template <class Combine> FILE *MergeSortedFiles(FILE *first_file, FILE *second_file, const util::TempMaker &maker, std::size_t weights_size, unsigned char order, const Combine &combine) {
+// Most files merged at once.  Each costs a read buffer and a file descriptor.  
+const std::size_t kMaxMergeFanIn = 64;
+
+class ReaderGreater : public std::binary_function<const RecordReader *, const RecordReader *, bool> {
+  public:
+    explicit ReaderGreater(unsigned char order) : less_(order) {}
+
+    bool operator()(const RecordReader *first, const RecordReader *second) const {
+      return less_(second->Data(), first->Data());
+    }
+
+  private:
+    EntryCompare less_;
+};
+
+// k-way merge of sorted files using a heap of readers.  Combine is called for
+// every record equal to the one written before it.  
+template <class Combine> FILE *MergeSortedFiles(FILE *const *files, std::size_t count, const util::TempMaker &maker, std::size_t weights_size, unsigned char order, const Combine &combine) {
   std::size_t entry_size = sizeof(WordIndex) * order + weights_size;
-  RecordReader first, second;
-  first.Init(first_file, entry_size);
-  second.Init(second_file, entry_size);
+  util::scoped_array<RecordReader> readers(new RecordReader[count]);
+  std::vector<RecordReader*> heap;
+  heap.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    readers[i].Init(files[i], entry_size);
+    if (readers[i]) heap.push_back(&readers[i]);
+  }
+  ReaderGreater greater(order);
+  std::make_heap(heap.begin(), heap.end(), greater);
+
   util::scoped_FILE out_file(maker.MakeFile());
+  util::scoped_malloc previous(malloc(entry_size));
+  UTIL_THROW_IF(!previous.get(), util::ErrnoException, "Failed to malloc merge buffer");
   EntryCompare less(order);
-  while (first && second) {
-    if (less(first.Data(), second.Data())) {
-      WriteOrThrow(out_file.get(), first.Data(), entry_size);
-      ++first;
-    } else if (less(second.Data(), first.Data())) {
-      WriteOrThrow(out_file.get(), second.Data(), entry_size);
-      ++second;
+  bool first = true;
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), greater);
+    RecordReader &top = *heap.back();
+    if (!first && !less(previous.get(), top.Data())) {
+      combine(entry_size, previous.get());
     } else {
-      combine(entry_size, first.Data(), second.Data(), out_file.get());
-      ++first; ++second;
+      WriteOrThrow(out_file.get(), top.Data(), entry_size);
+      memcpy(previous.get(), top.Data(), entry_size);
+      first = false;
+    }
+    if (++top) {
+      std::push_heap(heap.begin(), heap.end(), greater);
+    } else {
+      heap.pop_back();
     }
-  }
-  for (RecordReader &remains = (first ? first : second); remains; ++remains) {
-    WriteOrThrow(out_file.get(), remains.Data(), entry_size);
   }
   return out_file.release();
 }
 
+// Owns temporary files until they are merged.  
+class FileList {
+  public:
+    FileList() {}
+
+    ~FileList() {
+      for (std::deque<FILE*>::iterator i = files_.begin(); i != files_.end(); ++i) {
+        util::scoped_FILE deleter(*i);
+      }
+    }
+
+    void PushBack(FILE *file) { files_.push_back(file); }
+
+    std::size_t Size() const { return files_.size(); }
+
+    // Merge down to a single file, kMaxMergeFanIn files at a time.  
+    template <class Combine> FILE *Merge(const util::TempMaker &maker, std::size_t weights_size, unsigned char order, const Combine &combine) {
+      while (files_.size() > 1) {
+        std::size_t count = std::min(files_.size(), kMaxMergeFanIn);
+        std::vector<FILE*> batch(files_.begin(), files_.begin() + count);
+        files_.push_back(MergeSortedFiles(&batch[0], count, maker, weights_size, order, combine));
+        for (std::size_t i = 0; i < count; ++i) {
+          util::scoped_FILE deleter(files_.front());
+          files_.pop_front();
+        }
+      }
+      FILE *ret = files_.front();
+      files_.pop_front();
+      return ret;
+    }
+
+  private:
+    std::deque<FILE*> files_;
+};
+
+} // namespace
+
+// Seconds spent in each phase, reported per order.  Sorting and merging
+// happen in parallel with parsing if there are threads to do so.  
+struct PhaseTimes {
+  PhaseTimes() : runs(0), parse(0.0), sort(0.0), stall(0.0), merge_full(0.0), merge_context(0.0) {}
+  std::size_t runs;
+  double parse, sort, stall, merge_full, merge_context;
+};
+
+namespace {
+
+// One sorted run of n-grams and the unique contexts in it.  
+struct Run {
+  Run() : full(NULL), context(NULL), seconds(0.0) {}
+  FILE *full, *context;
+  double seconds;
+};
+
+class SortRun {
+  public:
+    SortRun(uint8_t *begin, uint8_t *end, const util::TempMaker &maker, std::size_t entry_size, unsigned char order, Run &run)
+      : begin_(begin), end_(end), maker_(maker), entry_size_(entry_size), order_(order), run_(run) {}
+
+    void operator()() const {
+      double start = util::WallTime();
+      // Sort full records by full n-gram.  
+      util::SizedProxy proxy_begin(begin_, entry_size_), proxy_end(end_, entry_size_);
+      // parallel_sort uses too much RAM.  TODO: figure out why windows sort doesn't like my proxies.  
+#if defined(_WIN32) || defined(_WIN64)
+      std::stable_sort
+#else
+      std::sort
+#endif
+          (NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order_)));
+      util::scoped_FILE full(DiskFlush(begin_, end_, maker_));
+      run_.context = WriteContextFile(begin_, end_, maker_, entry_size_, order_);
+      run_.full = full.release();
+      run_.seconds = util::WallTime() - start;
+    }
+
+  private:
+    uint8_t *const begin_, *const end_;
+    const util::TempMaker &maker_;
+    const std::size_t entry_size_;
+    const unsigned char order_;
+    Run &run_;
+};
+
+class RunList {
+  public:
+    ~RunList() {
+      for (std::deque<Run>::iterator i = runs_.begin(); i != runs_.end(); ++i) {
+        util::scoped_FILE full(i->full), context(i->context);
+      }
+    }
+
+    // The reference stays valid as runs are added.  
+    Run &Add() {
+      runs_.push_back(Run());
+      return runs_.back();
+    }
+
+    std::size_t Size() const { return runs_.size(); }
+
+    double Seconds() const {
+      double ret = 0.0;
+      for (std::deque<Run>::const_iterator i = runs_.begin(); i != runs_.end(); ++i) ret += i->seconds;
+      return ret;
+    }
+
+    // Move the files over so they can be merged separately.  
+    void Release(FileList &full, FileList &context) {
+      for (std::deque<Run>::iterator i = runs_.begin(); i != runs_.end(); ++i) {
+        full.PushBack(i->full);
+        i->full = NULL;
+        context.PushBack(i->context);
+        i->context = NULL;
+      }
+    }
+
+  private:
+    std::deque<Run> runs_;
+};
+
+template <class Combine> class MergeRuns {
+  public:
+    MergeRuns(const boost::shared_ptr<FileList> &files, const util::TempMaker &maker, std::size_t weights_size, unsigned char order, util::scoped_FILE &out, double &seconds)
+      : files_(files), maker_(maker), weights_size_(weights_size), order_(order), out_(out), seconds_(seconds) {}
+
+    void operator()() const {
+      double start = util::WallTime();
+      out_.reset(files_->Merge(maker_, weights_size_, order_, Combine()));
+      seconds_ = util::WallTime() - start;
+    }
+
+  private:
+    boost::shared_ptr<FileList> files_;
+    const util::TempMaker &maker_;
+    std::size_t weights_size_;
+    unsigned char order_;
+    util::scoped_FILE &out_;
+    double &seconds_;
+};
+
 } // namespace
 
 void RecordReader::Init(FILE *file, std::size_t entry_size) {
@@ -199,90 +372,101 @@ SortedFiles::SortedFiles(const Config &config, util::FilePiece &f, std::vector<u
   mem.reset(malloc(buffer));
   if (!mem.get()) UTIL_THROW(util::ErrnoException, "malloc failed for sort buffer size " << buffer);
 
-  for (unsigned char order = 2; order <= counts.size(); ++order) {
-    ConvertToSorted(f, vocab, counts, maker, order, warn, mem.get(), buffer);
-  }
-  ReadEnd(f);
-}
-
-namespace {
-class Closer {
-  public:
-    explicit Closer(std::deque<FILE*> &files) : files_(files) {}
-
-    ~Closer() {
-      for (std::deque<FILE*>::iterator i = files_.begin(); i != files_.end(); ++i) {
-        util::scoped_FILE deleter(*i);
-      }
+  unsigned int threads = std::max(1U, config.building_threads);
+#ifndef WITH_THREADS
+  threads = 1;
+#endif
+  std::vector<PhaseTimes> times(counts.size() + 1);
+  double merge_stall;
+  {
+    // Merges only need a read buffer per file, so they proceed while later orders are read.  
+    util::Workers merging(threads);
+    for (unsigned char order = 2; order <= counts.size(); ++order) {
+      ConvertToSorted(f, vocab, counts, maker, order, warn, mem.get(), buffer, threads, merging, times[order]);
     }
+    ReadEnd(f);
+    double start = util::WallTime();
+    merging.Join();
+    merge_stall = util::WallTime() - start;
+  }
 
-    void PopFront() {
-      util::scoped_FILE deleter(files_.front());
-      files_.pop_front();
+  if (config.messages) {
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(2);
+    for (unsigned char order = 2; order <= counts.size(); ++order) {
+      const PhaseTimes &t = times[order];
+      report << "Sorted " << static_cast<unsigned int>(order) << "-grams in " << t.runs << " runs: parse " << t.parse << "s, sort " << t.sort << "s, waited " << t.stall << "s for sorting, merge " << (t.merge_full + t.merge_context) << "s\n";
     }
-  private:
-    std::deque<FILE*> &files_;
-};
-} // namespace
+    report << "Waited " << merge_stall << "s for merging with " << threads << " thread" << (threads == 1 ? "" : "s") << '\n';
+    *config.messages << report.str() << std::flush;
+  }
+}
 
-void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const util::TempMaker &maker, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size) {
+void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const util::TempMaker &maker, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size, unsigned int threads, util::Workers &merging, PhaseTimes &times) {
   ReadNGramHeader(f, order);
   const size_t count = counts[order - 1];
   // Size of weights.  Does it include backoff?  
   const size_t words_size = sizeof(WordIndex) * order;
   const size_t weights_size = sizeof(float) + ((order == counts.size()) ? 0 : sizeof(float));
   const size_t entry_size = words_size + weights_size;
-  const size_t batch_size = std::min(count, mem_size / entry_size);
-  uint8_t *const begin = reinterpret_cast<uint8_t*>(mem);
-
-  std::deque<FILE*> files, contexts;
-  Closer files_closer(files), contexts_closer(contexts);
-
-  for (std::size_t batch = 0, done = 0; done < count; ++batch) {
-    uint8_t *out = begin;
-    uint8_t *out_end = out + std::min(count - done, batch_size) * entry_size;
-    if (order == counts.size()) {
-      for (; out != out_end; out += entry_size) {
-        ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<Prob*>(out + words_size), warn);
+  // With threads, one half of the memory is sorted while the other is filled.  
+  const size_t halves = (threads > 1) ? 2 : 1;
+  const size_t batch_size = std::min(count, std::max<size_t>(1, mem_size / halves / entry_size));
+  uint8_t *const mem_begin = reinterpret_cast<uint8_t*>(mem);
+
+  RunList runs;
+  {
+    util::Workers sorting(threads);
+    double start;
+    for (std::size_t batch = 0, done = 0; done < count; ++batch) {
+      uint8_t *const begin = mem_begin + (batch % halves) * batch_size * entry_size;
+      start = util::WallTime();
+      uint8_t *out = begin;
+      uint8_t *out_end = out + std::min(count - done, batch_size) * entry_size;
+      if (order == counts.size()) {
+        for (; out != out_end; out += entry_size) {
+          ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<Prob*>(out + words_size), warn);
+        }
+      } else {
+        for (; out != out_end; out += entry_size) {
+          ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<ProbBackoff*>(out + words_size), warn);
+        }
       }
-    } else {
-      for (; out != out_end; out += entry_size) {
-        ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<ProbBackoff*>(out + words_size), warn);
+      times.parse += util::WallTime() - start;
+
+      // The previous batch was sorted while this one was read.  Once it is
+      // done, its half is free for the next batch.  
+      start = util::WallTime();
+      sorting.Join();
+      times.stall += util::WallTime() - start;
+
+      // Each thread sorts and writes a slice of the batch as its own run.  
+      const std::size_t entries = (out_end - begin) / entry_size;
+      const std::size_t slice = (entries + threads - 1) / threads;
+      for (std::size_t from = 0; from < entries; from += slice) {
+        std::size_t to = std::min(entries, from + slice);
+        sorting.Run(SortRun(begin + from * entry_size, begin + to * entry_size, maker, entry_size, order, runs.Add()));
       }
+      done += entries;
     }
-    // Sort full records by full n-gram.  
-    util::SizedProxy proxy_begin(begin, entry_size), proxy_end(out_end, entry_size);
-    // parallel_sort uses too much RAM.  TODO: figure out why windows sort doesn't like my proxies.  
-#if defined(_WIN32) || defined(_WIN64)
-    std::stable_sort
-#else
-    std::sort
-#endif
-        (NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order)));
-    files.push_back(DiskFlush(begin, out_end, maker));
-    contexts.push_back(WriteContextFile(begin, out_end, maker, entry_size, order));
-
-    done += (out_end - begin) / entry_size;
+    start = util::WallTime();
+    sorting.Join();
+    times.stall += util::WallTime() - start;
   }
-
-  // All individual files created.  Merge them.  
-
-  while (files.size() > 1) {
-    files.push_back(MergeSortedFiles(files[0], files[1], maker, weights_size, order, ThrowCombine()));
-    files_closer.PopFront();
-    files_closer.PopFront();
-    contexts.push_back(MergeSortedFiles(contexts[0], contexts[1], maker, 0, order - 1, FirstCombine()));
-    contexts_closer.PopFront();
-    contexts_closer.PopFront();
+  times.runs = runs.Size();
+  times.sort = runs.Seconds();
+  if (!runs.Size()) {
+    // No n-grams of this order, e.g. in a filtered model.  
+    full_[order - 2].reset(maker.MakeFile());
+    context_[order - 2].reset(maker.MakeFile());
+    return;
   }
 
-  if (!files.empty()) {
-    // Steal from closers.
-    full_[order - 2].reset(files.front());
-    files.pop_front();
-    context_[order - 2].reset(contexts.front());
-    contexts.pop_front();
-  }
+  // All individual files created.  Merge them.  
+  boost::shared_ptr<FileList> full(new FileList()), context(new FileList());
+  runs.Release(*full, *context);
+  merging.Run(MergeRuns<ThrowCombine>(full, maker, weights_size, order, full_[order - 2], times.merge_full));
+  merging.Run(MergeRuns<FirstCombine>(context, maker, 0, order - 1, context_[order - 2], times.merge_context));
 }
 
 } // namespace trie
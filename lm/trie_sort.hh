@@ -19,6 +19,7 @@
 namespace util {
 class FilePiece;
 class TempMaker;
+class Workers;
 } // namespace util
 
 namespace lm {
@@ -29,6 +30,8 @@ struct Config;
 
 namespace trie {
 
+struct PhaseTimes;
+
 void WriteOrThrow(FILE *to, const void *data, size_t size);
 
 class EntryCompare : public std::binary_function<const void*, const void*, bool> {
@@ -103,7 +106,7 @@ class SortedFiles {
     }
 
   private:
-    void ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const util::TempMaker &maker, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size);
+    void ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const util::TempMaker &maker, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size, unsigned int threads, util::Workers &merging, PhaseTimes &times);
     
     util::scoped_fd unigram_;
 
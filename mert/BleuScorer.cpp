@@ -53,16 +53,16 @@ size_t BleuScorer::CountNgrams(const string& line, NgramCounts& counts,
   assert(n > 0);
   vector<int> encoded_tokens;
   TokenizeAndEncode(line, encoded_tokens);
+  // one key buffer for all n-grams; the map only copies keys it has not seen
+  NgramCounts::Key ngram;
+  ngram.reserve(n);
   for (size_t k = 1; k <= n; ++k) {
     //ngram order longer than sentence - no point
     if (k > encoded_tokens.size()) {
       continue;
     }
     for (size_t i = 0; i < encoded_tokens.size()-k+1; ++i) {
-      vector<int> ngram;
-      for (size_t j = i; j < i+k && j < encoded_tokens.size(); ++j) {
-        ngram.push_back(encoded_tokens[j]);
-      }
+      ngram.assign(encoded_tokens.begin() + i, encoded_tokens.begin() + i + k);
       counts.Add(ngram);
     }
   }
@@ -99,6 +99,7 @@ bool BleuScorer::OpenReferenceStream(istream* is, size_t file_id) {
 
   string line;
   size_t sid = 0;
+  NgramCounts counts;
   while (getline(*is, line)) {
     line = preprocessSentence(line);
     if (file_id == 0) {
@@ -109,7 +110,7 @@ bool BleuScorer::OpenReferenceStream(istream* is, size_t file_id) {
       cerr << "Reference " << file_id << "has too many sentences." << endl;
       return false;
     }
-    NgramCounts counts;
+    counts.clear();
     size_t length = CountNgrams(line, counts, kBleuNgramOrder);
 
     //for any counts larger than those already there, merge them in
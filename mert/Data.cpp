@@ -8,6 +8,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <deque>
 #include <fstream>
 
 #include "Data.h"
@@ -17,11 +18,148 @@
 #include "Util.h"
 #include "util/check.hh"
 
+#ifdef WITH_THREADS
+#include "../moses/src/ThreadPool.h"
+#endif
+
 using namespace std;
 
 namespace MosesTuning
 {
-  
+
+namespace {
+
+// Split an n-best line into its sentence index, the sentence to score
+// (with the alignment appended for scorers that use it) and the features.
+void SplitNBestLine(string& line, bool use_alignment, string& sentence_index,
+                    string& sentence, string& feature_str)
+{
+  getNextPound(line, sentence_index, "|||"); // first field
+  getNextPound(line, sentence, "|||");       // second field
+  getNextPound(line, feature_str, "|||");    // third field
+
+  string alignment;
+  if (line.length() > 0) {
+    string temp;
+    getNextPound(line, temp, "|||"); //fourth field sentence score
+    if (line.length() > 0) {
+      getNextPound(line, alignment, "|||"); //fourth field only there if alignment scorer
+    }
+  }
+  //TODO check alignment exists if scorers need it
+
+  if (use_alignment) {
+    sentence += "|||";
+    sentence += alignment;
+  }
+}
+
+// Parse the feature field of an n-best line.  Returns true if it
+// contained sparse features.
+bool ParseFeatures(const string& str, FeatureStats& feature_entry)
+{
+  string buf = str;
+  string substr;
+  bool sparse = false;
+  feature_entry.reset();
+
+  while (!buf.empty()) {
+    getNextPound(buf, substr);
+
+    // no ':' -> feature value that needs to be stored
+    if (!EndsWith(substr, ":")) {
+      feature_entry.add(ConvertStringToFeatureStatsType(substr));
+    } else if (substr.find("_") != string::npos) {
+      // sparse feature name? store as well
+      string name = substr;
+      getNextPound(buf, substr);
+      feature_entry.addSparse(name, atof(substr.c_str()));
+      sparse = true;
+    }
+  }
+  return sparse;
+}
+
+#ifdef WITH_THREADS
+
+// The consecutive n-best lines of one sentence, scored and parsed on a
+// worker thread.  The reading thread waits for the blocks in file order,
+// so the merged data is the same as when loading serially.
+class NBestBlock
+{
+public:
+  NBestBlock(Scorer* scorer, const string& key)
+      : m_scorer(scorer), m_key(key), m_sparse(false), m_done(false) {}
+
+  const string& GetKey() const { return m_key; }
+  void AddLine(const string& line) { m_lines.push_back(line); }
+
+  void Process() {
+    m_sentence_indices.resize(m_lines.size());
+    m_scores.resize(m_lines.size());
+    m_features.resize(m_lines.size());
+    try {
+      string sentence, feature_str;
+      for (size_t i = 0; i < m_lines.size(); ++i) {
+        SplitNBestLine(m_lines[i], m_scorer->useAlignment(),
+                       m_sentence_indices[i], sentence, feature_str);
+        m_scorer->prepareStats(m_sentence_indices[i], sentence, m_scores[i]);
+        if (i == 0) m_first_features = feature_str;
+        if (ParseFeatures(feature_str, m_features[i])) m_sparse = true;
+      }
+    } catch (const exception& e) {
+      m_error = e.what();
+    }
+    vector<string>().swap(m_lines);
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_finished.notify_all();
+  }
+
+  void Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_finished.wait(lock);
+  }
+
+  const string& GetError() const { return m_error; }
+  size_t size() const { return m_scores.size(); }
+  const string& GetSentenceIndex(size_t i) const { return m_sentence_indices[i]; }
+  const ScoreStats& GetScores(size_t i) const { return m_scores[i]; }
+  FeatureStats& GetFeatures(size_t i) { return m_features[i]; }
+  const string& GetFirstFeatures() const { return m_first_features; }
+  bool HasSparseFeatures() const { return m_sparse; }
+
+private:
+  Scorer* m_scorer;
+  string m_key;
+  vector<string> m_lines;
+  vector<string> m_sentence_indices;
+  vector<ScoreStats> m_scores;
+  vector<FeatureStats> m_features;
+  string m_first_features;
+  bool m_sparse;
+  string m_error;
+  bool m_done;
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+};
+
+// The pool deletes its tasks after running them, so the block, which the
+// reading thread frees once merged, is kept apart from the task.
+class NBestBlockTask : public Moses::Task
+{
+public:
+  explicit NBestBlockTask(NBestBlock* block) : m_block(block) {}
+  virtual void Run() { m_block->Process(); }
+
+private:
+  NBestBlock* m_block;
+};
+
+#endif // WITH_THREADS
+
+} // namespace
+
 
 Data::Data()
   : m_scorer(NULL),
@@ -132,38 +270,30 @@ void Data::load(const std::string &featfile, const std::string &scorefile) {
     m_sparse_flag = true;
 }
 
-void Data::loadNBest(const string &file)
+void Data::loadNBest(const string &file, size_t num_threads)
 {
   TRACE_ERR("loading nbest from " << file << endl);
   inputfilestream inp(file); // matches a stream with a file. Opens the file
   if (!inp.good())
     throw runtime_error("Unable to open: " + file);
 
+#ifdef WITH_THREADS
+  if (num_threads > 1 && m_scorer->threadSafeStats()) {
+    loadNBestThreaded(inp, num_threads);
+    inp.close();
+    return;
+  }
+#endif
+
   ScoreStats scoreentry;
-  string line, sentence_index, sentence, feature_str, alignment;
+  string line, sentence_index, sentence, feature_str;
 
   while (getline(inp, line, '\n')) {
     if (line.empty()) continue;
     // adding statistics for error measures
     scoreentry.clear();
 
-    getNextPound(line, sentence_index, "|||"); // first field
-    getNextPound(line, sentence, "|||");       // second field
-    getNextPound(line, feature_str, "|||");    // third field
-
-    if (line.length() > 0) {
-      string temp;
-      getNextPound(line, temp, "|||"); //fourth field sentence score
-      if (line.length() > 0) {
-        getNextPound(line, alignment, "|||"); //fourth field only there if alignment scorer
-      }
-    }
-    //TODO check alignment exists if scorers need it
-
-    if (m_scorer->useAlignment()) {
-      sentence += "|||";
-      sentence += alignment;
-    }
+    SplitNBestLine(line, m_scorer->useAlignment(), sentence_index, sentence, feature_str);
     m_scorer->prepareStats(sentence_index, sentence, scoreentry);
     
     m_score_data->add(scoreentry, sentence_index);
@@ -177,6 +307,57 @@ void Data::loadNBest(const string &file)
   inp.close();
 }
 
+#ifdef WITH_THREADS
+void Data::loadNBestThreaded(istream& inp, size_t num_threads)
+{
+  Moses::ThreadPool pool(num_threads);
+  // blocks submitted but not merged yet; bounds the lines held in memory
+  deque<NBestBlock*> pending;
+  const size_t max_pending = 4 * num_threads;
+  NBestBlock* block = NULL;
+  string line, error;
+
+  while (error.empty()) {
+    bool more = getline(inp, line, '\n');
+    if (more && line.empty()) continue;
+    // the n-best list of a sentence ends when the first field changes
+    const string key = more ? line.substr(0, line.find("|||")) : string();
+    if (block && (!more || key != block->GetKey())) {
+      pool.Submit(new NBestBlockTask(block));
+      pending.push_back(block);
+      block = NULL;
+    }
+    while (!pending.empty() && (!more || pending.size() > max_pending)) {
+      NBestBlock* done = pending.front();
+      pending.pop_front();
+      done->Wait();
+      if (done->GetError().empty()) {
+        for (size_t i = 0; i < done->size(); ++i) {
+          m_score_data->add(done->GetScores(i), done->GetSentenceIndex(i));
+          if (!existsFeatureNames()) {
+            InitFeatureMap(done->GetFirstFeatures());
+          }
+          m_feature_data->add(done->GetFeatures(i), done->GetSentenceIndex(i));
+        }
+        if (done->HasSparseFeatures()) m_sparse_flag = true;
+      } else if (error.empty()) {
+        error = done->GetError();
+      }
+      delete done;
+    }
+    if (!more) break;
+    if (!block) block = new NBestBlock(m_scorer, key);
+    block->AddLine(line);
+  }
+
+  // only left over after an error: let the workers finish before freeing
+  pool.Stop(true);
+  delete block;
+  for (size_t i = 0; i < pending.size(); ++i) delete pending[i];
+  if (!error.empty()) throw runtime_error(error);
+}
+#endif
+
 void Data::save(const std::string &featfile, const std::string &scorefile, bool bin) {
   if (bin)
     cerr << "Binary write mode is selected" << endl;
@@ -217,25 +398,9 @@ void Data::InitFeatureMap(const string& str) {
 
 void Data::AddFeatures(const string& str,
                        const string& sentence_index) {
-  string buf = str;
-  string substr;
   FeatureStats feature_entry;
-  feature_entry.reset();
-
-  while (!buf.empty()) {
-    getNextPound(buf, substr);
-
-    // no ':' -> feature value that needs to be stored
-    if (!EndsWith(substr, ":")) {
-      feature_entry.add(ConvertStringToFeatureStatsType(substr));
-    } else if (substr.find("_") != string::npos) {
-      // sparse feature name? store as well
-      string name = substr;
-      getNextPound(buf, substr);
-      feature_entry.addSparse(name, atof(substr.c_str()));
-      m_sparse_flag = true;
-    }
-  }
+  if (ParseFeatures(str, feature_entry))
+    m_sparse_flag = true;
   m_feature_data->add(feature_entry, sentence_index);
 }
 
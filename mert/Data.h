@@ -9,6 +9,7 @@
 #ifndef MERT_DATA_H_
 #define MERT_DATA_H_
 
+#include <istream>
 #include <vector>
 #include <boost/shared_ptr.hpp>
 
@@ -63,7 +64,12 @@ public:
   bool hasSparseFeatures() const { return m_sparse_flag; }
   void mergeSparseFeatures();
 
-  void loadNBest(const std::string &file);
+  /**
+   * Score and add the entries of an n-best file.  With num_threads > 1
+   * and a scorer that supports it, the sentences are scored on a pool of
+   * threads; the result does not depend on the number of threads.
+   */
+  void loadNBest(const std::string &file, std::size_t num_threads = 1);
 
   void load(const std::string &featfile, const std::string &scorefile);
 
@@ -98,6 +104,11 @@ public:
   void InitFeatureMap(const std::string& str);
   void AddFeatures(const std::string& str,
                    const std::string& sentence_index);
+
+private:
+#ifdef WITH_THREADS
+  void loadNBestThreaded(std::istream& inp, std::size_t num_threads);
+#endif
 };
 
 }
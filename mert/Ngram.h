@@ -2,41 +2,32 @@
 #define MERT_NGRAM_H_
 
 #include <vector>
-#include <map>
 #include <string>
 
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+
 namespace MosesTuning
 {
   
-/** A simple STL-std::map based n-gram counts. Basically, we provide
+/** A simple hash based n-gram counts. Basically, we provide
  * typical accessors and mutaors, but we intentionally does not allow
- * erasing elements.
+ * erasing elements. The iteration order is unspecified.
  */
 class NgramCounts {
  public:
   // Used to construct the ngram map
-  struct NgramComparator {
-    bool operator()(const std::vector<int>& a, const std::vector<int>& b) const {
-      std::size_t i;
-      const std::size_t as = a.size();
-      const std::size_t bs = b.size();
-      for (i = 0; i < as && i < bs; ++i) {
-        if (a[i] < b[i]) {
-          return true;
-        }
-        if (a[i] > b[i]) {
-          return false;
-        }
-      }
-      // entries are equal, shortest wins
-      return as < bs;
+  struct NgramHash {
+    std::size_t operator()(const std::vector<int>& ngram) const {
+      return boost::hash_range(ngram.begin(), ngram.end());
     }
   };
 
   typedef std::vector<int> Key;
   typedef int Value;
-  typedef std::map<Key, Value, NgramComparator>::iterator iterator;
-  typedef std::map<Key, Value, NgramComparator>::const_iterator const_iterator;
+  typedef boost::unordered_map<Key, Value, NgramHash> Map;
+  typedef Map::iterator iterator;
+  typedef Map::const_iterator const_iterator;
 
   NgramCounts() : kDefaultCount(1) { }
   virtual ~NgramCounts() { }
@@ -45,12 +36,9 @@ class NgramCounts {
    * If the specified "ngram" is found, we add counts.
    * If not, we insert the default count in the container. */
   void Add(const Key& ngram) {
-    const_iterator it = find(ngram);
-    if (it != end()) {
-      m_counts[ngram] = it->second + 1;
-    } else {
-      m_counts[ngram] = kDefaultCount;
-    }
+    std::pair<iterator, bool> ins =
+        m_counts.insert(std::make_pair(ngram, kDefaultCount));
+    if (!ins.second) ++ins.first->second;
   }
 
   /**
@@ -64,10 +52,16 @@ class NgramCounts {
   }
 
   /**
-   * Clear all elments in the container.
+   * Clear all elments in the container.  The buckets are kept, so a
+   * counter can be reused for the next sentence without reallocating.
    */
   void clear() { m_counts.clear(); }
 
+  /**
+   * Make room for "n" n-grams without rehashing.
+   */
+  void reserve(std::size_t n) { m_counts.rehash(n); }
+
   /**
    * Return true iff the container is empty.
    */
@@ -95,7 +89,7 @@ class NgramCounts {
 
  private:
   const int kDefaultCount;
-  std::map<Key, Value, NgramComparator> m_counts;
+  Map m_counts;
 };
 
 }
@@ -60,6 +60,14 @@ class Scorer
     this->prepareStats(static_cast<std::size_t>(atoi(sindex.c_str())), text, entry);
   }
 
+  /**
+   * Return true if prepareStats() may be called from several threads at
+   * once, after the references have been set.
+   */
+  virtual bool threadSafeStats() const {
+    return false;
+  }
+
   /**
    * Score using each of the candidate index, then go through the diffs
    * applying each in turn, and calculating a new score each time.
@@ -147,6 +155,12 @@ class Scorer
   ScoreData* m_score_data;
   bool m_enable_preserve_case;
 
+  /**
+   * The filter is an external process fed one sentence at a time, so
+   * scorers using it cannot prepare statistics concurrently.
+   */
+  bool hasFilter() const { return m_filter != NULL; }
+
   /**
    * Get value of config variable. If not provided, return default.
    */
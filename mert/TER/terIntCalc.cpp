@@ -0,0 +1,377 @@
+#include "terIntCalc.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+namespace TERCpp
+{
+
+namespace
+{
+// terCalc splits an empty sentence into one empty word, which only
+// matches itself; keep that for identical scores.
+const int kEmptyWord = -1;
+}
+
+terIntCalc::terIntCalc()
+{
+  MAX_SHIFT_SIZE = 50;
+  MAX_SHIFT_DIST = 50;
+  BEAM_WIDTH = 20;
+  INF = 999999;
+  shift_cost = 1;
+}
+
+terAlignment terIntCalc::TER ( const vector<int>& hypIn, const vector<int>& refIn )
+{
+  vector<int> hyp ( hypIn );
+  if ( hyp.empty() ) {
+    hyp.push_back ( kEmptyWord );
+  }
+  m_ref = refIn;
+  if ( m_ref.empty() ) {
+    m_ref.push_back ( kEmptyWord );
+  }
+  m_refPositions.clear();
+  for ( int i = 0; i < ( int ) m_ref.size(); i++ ) {
+    m_refPositions[m_ref[i]].push_back ( i );
+  }
+
+  vector<int> cur ( hyp );
+  int curerr = MinEditDist ( cur );
+  int edits = 0;
+  int bestEdits;
+  while ( CalcBestShift ( cur, curerr, m_shifted, bestEdits ) ) {
+    edits += shift_cost;
+    cur.swap ( m_shifted );
+    curerr = MinEditDist ( cur );
+    if ( curerr != bestEdits ) {
+      cerr << "ERROR : terIntCalc::TER : shifted alignment changed from " << bestEdits << " to " << curerr << endl;
+      exit ( -1 );
+    }
+  }
+
+  terAlignment to_return;
+  to_return.numWords = m_ref.size();
+  to_return.numEdits = curerr + edits;
+  return to_return;
+}
+
+// Full edit distance of the current hypothesis, keeping what a shifted
+// hypothesis needs to resume from any column.
+int terIntCalc::MinEditDist ( const vector<int>& hyp )
+{
+  const size_t rows = m_ref.size() + 1;
+  const size_t cells = rows * ( hyp.size() + 1 );
+  m_score.assign ( cells, -1 );
+  m_path.assign ( cells, '0' );
+  m_startScore.resize ( cells );
+  m_startPath.resize ( cells );
+  m_states.resize ( hyp.size() + 1 );
+  m_score[0] = 0;
+  columnState start;
+  start.current_best = INF;
+  start.current_first_good = 0;
+  start.cur_last_good = 0;
+  int edits = EditDist ( hyp, 0, start, &m_score[0], &m_path[0] );
+  FindAlignErr ( hyp.size() );
+  return edits;
+}
+
+// Edit distance of a hypothesis which agrees with the current one on the
+// words before first.
+int terIntCalc::ShiftedEditDist ( const vector<int>& hyp, size_t first )
+{
+  const size_t rows = m_ref.size() + 1;
+  m_shiftScore.resize ( m_score.size() );
+  copy ( m_score.begin(), m_score.begin() + first * rows, m_shiftScore.begin() );
+  copy ( m_startScore.begin() + first * rows, m_startScore.begin() + ( first + 1 ) * rows,
+         m_shiftScore.begin() + first * rows );
+  fill ( m_shiftScore.begin() + ( first + 1 ) * rows, m_shiftScore.end(), -1 );
+  return EditDist ( hyp, first, m_states[first], &m_shiftScore[0], NULL );
+}
+
+// The beam search of terCalc::MinEditDist, with all costs 1 except
+// matches, over column major matrices.  When P is given, the columns and
+// beam state met on the way are recorded for ShiftedEditDist.
+int terIntCalc::EditDist ( const vector<int>& hyp, size_t first, columnState state, int* S, char* P )
+{
+  const int refSize = m_ref.size();
+  const int hypSize = hyp.size();
+  const size_t rows = refSize + 1;
+  int current_best = state.current_best;
+  int current_first_good = state.current_first_good;
+  int cur_last_good = state.cur_last_good;
+
+  for ( int j = first; j <= hypSize; j++ ) {
+    int* col = S + j * rows;
+    int* next = ( j < hypSize ) ? col + rows : NULL;
+    char* pcol = NULL;
+    char* pnext = NULL;
+    if ( P ) {
+      pcol = P + j * rows;
+      pnext = ( j < hypSize ) ? pcol + rows : NULL;
+      m_states[j].current_best = current_best;
+      m_states[j].current_first_good = current_first_good;
+      m_states[j].cur_last_good = cur_last_good;
+      memcpy ( &m_startScore[j * rows], col, rows * sizeof ( int ) );
+      memcpy ( &m_startPath[j * rows], pcol, rows );
+    }
+    const int last_best = current_best;
+    current_best = INF;
+    const int first_good = max ( current_first_good, 0 );
+    current_first_good = -1;
+    int last_good = cur_last_good;
+    cur_last_good = -1;
+    const int word = ( j < hypSize ) ? hyp[j] : 0;
+
+    for ( int i = first_good; i <= refSize; i++ ) {
+      if ( i > last_good ) {
+        break;
+      }
+      const int score = col[i];
+      if ( score < 0 ) {
+        continue;
+      }
+      if ( ( j < hypSize ) && ( score > last_best + BEAM_WIDTH ) ) {
+        continue;
+      }
+      if ( current_first_good == -1 ) {
+        current_first_good = i;
+      }
+      if ( ( i < refSize ) && ( j < hypSize ) ) {
+        if ( m_ref[i] == word ) {
+          const int cost = score;
+          if ( ( next[i+1] == -1 ) || ( cost < next[i+1] ) ) {
+            next[i+1] = cost;
+            if ( pnext ) pnext[i+1] = ' ';
+          }
+          if ( cost < current_best ) {
+            current_best = cost;
+          }
+        } else {
+          const int cost = score + 1;
+          if ( ( next[i+1] < 0 ) || ( cost < next[i+1] ) ) {
+            next[i+1] = cost;
+            if ( pnext ) pnext[i+1] = 'S';
+            if ( cost < current_best ) {
+              current_best = cost;
+            }
+          }
+        }
+      }
+      cur_last_good = i + 1;
+      if ( j < hypSize ) {
+        const int icost = score + 1;
+        if ( ( next[i] < 0 ) || ( next[i] > icost ) ) {
+          next[i] = icost;
+          if ( pnext ) pnext[i] = 'I';
+        }
+      }
+      if ( i < refSize ) {
+        const int dcost = score + 1;
+        if ( ( col[i+1] < 0 ) || ( col[i+1] > dcost ) ) {
+          col[i+1] = dcost;
+          if ( pcol ) pcol[i+1] = 'D';
+          if ( i >= last_good ) {
+            last_good = i + 1;
+          }
+        }
+      }
+    }
+  }
+  return S[hypSize * rows + refSize];
+}
+
+// Marks the hypothesis and reference words with errors in the current
+// alignment, and where each reference word is aligned in the hypothesis.
+void terIntCalc::FindAlignErr ( size_t hypSize )
+{
+  const size_t rows = m_ref.size() + 1;
+  m_herr.assign ( hypSize, 0 );
+  m_rerr.assign ( m_ref.size(), 0 );
+  m_ralign.assign ( m_ref.size(), 0 );
+  int i = m_ref.size();
+  int j = hypSize;
+  while ( ( i > 0 ) || ( j > 0 ) ) {
+    const char sym = m_path[j * rows + i];
+    if ( sym == ' ' ) {
+      i--;
+      j--;
+      m_ralign[i] = j;
+    } else if ( sym == 'S' ) {
+      i--;
+      j--;
+      m_herr[j] = 1;
+      m_rerr[i] = 1;
+      m_ralign[i] = j;
+    } else if ( sym == 'D' ) {
+      i--;
+      m_rerr[i] = 1;
+      m_ralign[i] = j - 1;
+    } else if ( sym == 'I' ) {
+      j--;
+      m_herr[j] = 1;
+    } else {
+      cerr << "ERROR : terIntCalc::FindAlignErr : Invalid path : " << sym << endl;
+      exit ( -1 );
+    }
+  }
+}
+
+// terCalc::GatherAllPossShifts.  The reference positions of a candidate
+// are the positions of its first word, filtered as the candidate grows.
+void terIntCalc::GatherAllPossShifts ( const vector<int>& cur )
+{
+  m_allshifts.resize ( MAX_SHIFT_SIZE + 1 );
+  for ( size_t i = 0; i < m_allshifts.size(); i++ ) {
+    m_allshifts[i].clear();
+  }
+  if ( ( MAX_SHIFT_SIZE <= 0 ) || ( MAX_SHIFT_DIST <= 0 ) ) {
+    return;
+  }
+  const int hypSize = cur.size();
+  const int refSize = m_ref.size();
+
+  for ( int start = 0; start < hypSize; start++ ) {
+    boost::unordered_map<int, vector<int> >::const_iterator positions = m_refPositions.find ( cur[start] );
+    if ( positions == m_refPositions.end() ) {
+      continue;
+    }
+    bool ok = false;
+    for ( size_t m = 0; m < positions->second.size() && !ok; m++ ) {
+      const int aligned = m_ralign[positions->second[m]];
+      if ( ( start != aligned ) && ( ( aligned - start ) <= MAX_SHIFT_DIST ) && ( ( start - aligned - 1 ) <= MAX_SHIFT_DIST ) ) {
+        ok = true;
+      }
+    }
+    if ( !ok ) {
+      continue;
+    }
+    m_matches = positions->second;
+    for ( int end = start; ( ok && ( end < hypSize ) && ( end < start + MAX_SHIFT_SIZE ) ); end++ ) {
+      ok = false;
+      if ( end > start ) {
+        const int offset = end - start;
+        size_t kept = 0;
+        for ( size_t m = 0; m < m_matches.size(); m++ ) {
+          const int moveto = m_matches[m];
+          if ( ( moveto + offset < refSize ) && ( m_ref[moveto + offset] == cur[end] ) ) {
+            m_matches[kept++] = moveto;
+          }
+        }
+        m_matches.resize ( kept );
+      }
+      if ( m_matches.empty() ) {
+        continue;
+      }
+
+      bool any_herr = false;
+      for ( int i = start; i <= end && !any_herr; i++ ) {
+        any_herr = m_herr[i];
+      }
+      if ( !any_herr ) {
+        ok = true;
+        continue;
+      }
+
+      for ( size_t m = 0; m < m_matches.size(); m++ ) {
+        const int moveto = m_matches[m];
+        const int aligned = m_ralign[moveto];
+        if ( ! ( ( aligned != start ) && ( ( aligned < start ) || ( aligned > end ) ) && ( ( aligned - start ) <= MAX_SHIFT_DIST ) && ( ( start - aligned ) <= MAX_SHIFT_DIST ) ) ) {
+          continue;
+        }
+        ok = true;
+
+        bool any_rerr = false;
+        for ( int i = 0; ( i <= end - start ) && !any_rerr; i++ ) {
+          any_rerr = m_rerr[moveto + i];
+        }
+        if ( !any_rerr ) {
+          continue;
+        }
+        for ( int roff = -1; roff <= ( end - start ); roff++ ) {
+          if ( ( roff == -1 ) && ( moveto == 0 ) ) {
+            m_allshifts[end - start].push_back ( shift ( start, end, -1 ) );
+          } else if ( ( start != m_ralign[moveto + roff] ) && ( ( roff == 0 ) || ( m_ralign[moveto + roff] != aligned ) ) ) {
+            m_allshifts[end - start].push_back ( shift ( start, end, m_ralign[moveto + roff] ) );
+          }
+        }
+      }
+    }
+  }
+}
+
+// terCalc::CalcBestShift: on success best holds the shifted hypothesis
+// and bestEdits its edit distance without the shift.
+bool terIntCalc::CalcBestShift ( const vector<int>& cur, int curerr, vector<int>& best, int& bestEdits )
+{
+  GatherAllPossShifts ( cur );
+  bool anygain = false;
+  int cur_best_shift_cost = 0;
+  bestEdits = curerr;
+
+  for ( int i = ( int ) m_allshifts.size() - 1; i >= 0; i-- ) {
+    const int maxfix = 2 * ( 1 + i );
+    int curfix = curerr - ( cur_best_shift_cost + bestEdits );
+    if ( ( curfix > maxfix ) || ( ( cur_best_shift_cost != 0 ) && ( curfix == maxfix ) ) ) {
+      break;
+    }
+    const vector<shift>& shifts = m_allshifts[i];
+    for ( size_t s = 0; s < shifts.size(); s++ ) {
+      curfix = curerr - ( cur_best_shift_cost + bestEdits );
+      if ( ( curfix > maxfix ) || ( ( cur_best_shift_cost != 0 ) && ( curfix == maxfix ) ) ) {
+        break;
+      }
+      PerformShift ( cur, shifts[s], m_candidate );
+      size_t first = 0;
+      while ( first < cur.size() && cur[first] == m_candidate[first] ) {
+        first++;
+      }
+      const int edits = ShiftedEditDist ( m_candidate, first );
+      const int gain = ( bestEdits + cur_best_shift_cost ) - ( edits + shift_cost );
+      if ( ( gain > 0 ) || ( ( cur_best_shift_cost == 0 ) && ( gain == 0 ) ) ) {
+        anygain = true;
+        cur_best_shift_cost = shift_cost;
+        bestEdits = edits;
+        best = m_candidate;
+      }
+    }
+  }
+  return anygain;
+}
+
+void terIntCalc::PerformShift ( const vector<int>& words, const shift& s, vector<int>& nwords ) const
+{
+  const int start = s.start;
+  const int end = s.end;
+  const int newloc = s.newloc;
+  const int size = words.size();
+  int c = 0;
+  nwords = words;
+  if ( newloc == -1 ) {
+    for ( int i = start; i <= end; i++ ) nwords[c++] = words[i];
+    for ( int i = 0; i <= start - 1; i++ ) nwords[c++] = words[i];
+    for ( int i = end + 1; i < size; i++ ) nwords[c++] = words[i];
+  } else if ( newloc < start ) {
+    for ( int i = 0; i <= newloc; i++ ) nwords[c++] = words[i];
+    for ( int i = start; i <= end; i++ ) nwords[c++] = words[i];
+    for ( int i = newloc + 1; i <= start - 1; i++ ) nwords[c++] = words[i];
+    for ( int i = end + 1; i < size; i++ ) nwords[c++] = words[i];
+  } else if ( newloc > end ) {
+    for ( int i = 0; i <= start - 1; i++ ) nwords[c++] = words[i];
+    for ( int i = end + 1; i <= newloc; i++ ) nwords[c++] = words[i];
+    for ( int i = start; i <= end; i++ ) nwords[c++] = words[i];
+    for ( int i = newloc + 1; i < size; i++ ) nwords[c++] = words[i];
+  } else {
+    // we are moving inside of ourselves
+    for ( int i = 0; i <= start - 1; i++ ) nwords[c++] = words[i];
+    for ( int i = end + 1; ( i < size ) && ( i <= ( end + ( newloc - start ) ) ); i++ ) nwords[c++] = words[i];
+    for ( int i = start; i <= end; i++ ) nwords[c++] = words[i];
+    for ( int i = ( end + ( newloc - start ) + 1 ); i < size; i++ ) nwords[c++] = words[i];
+  }
+}
+
+}
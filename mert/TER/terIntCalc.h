@@ -0,0 +1,84 @@
+#ifndef MERT_TER_TER_INT_CALC_H_
+#define MERT_TER_TER_INT_CALC_H_
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include "terAlignment.h"
+
+namespace TERCpp
+{
+/**
+ * TER over integer encoded sentences, as used by the TER scorer.
+ *
+ * It computes the same number of edits as terCalc::TER (same beam,
+ * shift limits and tie breaking) without turning the words into strings:
+ * the reference n-grams a shift may match are found by extending the
+ * matches of the first word, and a shifted hypothesis only recomputes
+ * the edit distance from the first word that moved.  The buffers are
+ * kept between calls, so one object should be reused for many sentences;
+ * it is not safe to share one between threads.
+ */
+class terIntCalc
+{
+public:
+  terIntCalc();
+
+  /**
+   * Align hyp to ref.  Only numEdits and numWords of the result are set.
+   */
+  terAlignment TER ( const vector<int>& hyp, const vector<int>& ref );
+
+private:
+  struct shift {
+    shift ( int _start, int _end, int _newloc ) : start ( _start ), end ( _end ), newloc ( _newloc ) {}
+    int start;
+    int end;
+    int newloc;
+  };
+
+  // The beam state at the start of a hypothesis column.
+  struct columnState {
+    int current_best;
+    int current_first_good;
+    int cur_last_good;
+  };
+
+  int MinEditDist ( const vector<int>& hyp );
+  int ShiftedEditDist ( const vector<int>& hyp, size_t first );
+  int EditDist ( const vector<int>& hyp, size_t first, columnState state, int* S, char* P );
+  void FindAlignErr ( size_t hypSize );
+  void GatherAllPossShifts ( const vector<int>& cur );
+  bool CalcBestShift ( const vector<int>& cur, int curerr, vector<int>& best, int& bestEdits );
+  void PerformShift ( const vector<int>& words, const shift& s, vector<int>& nwords ) const;
+
+  int MAX_SHIFT_SIZE;
+  int MAX_SHIFT_DIST;
+  int BEAM_WIDTH;
+  int INF;
+  int shift_cost;
+
+  vector<int> m_ref;
+  boost::unordered_map<int, vector<int> > m_refPositions;
+
+  // Edit distance of the current hypothesis: final columns, the columns
+  // as they were when the search reached them and the beam state there.
+  vector<int> m_score;
+  vector<char> m_path;
+  vector<int> m_startScore;
+  vector<char> m_startPath;
+  vector<columnState> m_states;
+  // Edit distance of a shifted hypothesis.
+  vector<int> m_shiftScore;
+
+  vector<char> m_herr;
+  vector<char> m_rerr;
+  vector<int> m_ralign;
+  vector<vector<shift> > m_allshifts;
+  vector<int> m_matches;
+  vector<int> m_candidate;
+  vector<int> m_shifted;
+};
+
+}
+
+#endif  // MERT_TER_TER_INT_CALC_H_
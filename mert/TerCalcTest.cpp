@@ -0,0 +1,63 @@
+#include "TER/tercalc.h"
+#include "TER/terIntCalc.h"
+
+#include <cstdlib>
+
+#define BOOST_TEST_MODULE MertTerCalc
+#include <boost/test/unit_test.hpp>
+
+using namespace TERCpp;
+
+namespace {
+
+// terCalc holds its edit distance matrices inline, too large for the stack.
+double ReferenceEdits(const std::vector<int>& hyp, const std::vector<int>& ref) {
+  terCalc* calc = new terCalc();
+  // the integer overload of terCalc::TER takes the reference first
+  double edits = calc->TER(ref, hyp).numEdits;
+  delete calc;
+  return edits;
+}
+
+std::vector<int> RandomSentence(std::size_t max_length, int vocab) {
+  std::vector<int> sentence(rand() % (max_length + 1));
+  for (std::size_t i = 0; i < sentence.size(); ++i) {
+    sentence[i] = rand() % vocab;
+  }
+  return sentence;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ter_int_calc_empty) {
+  terIntCalc calc;
+  std::vector<int> empty, sentence;
+  sentence.push_back(3);
+  sentence.push_back(1);
+  BOOST_CHECK_EQUAL(calc.TER(empty, empty).numEdits, ReferenceEdits(empty, empty));
+  BOOST_CHECK_EQUAL(calc.TER(empty, sentence).numEdits, ReferenceEdits(empty, sentence));
+  BOOST_CHECK_EQUAL(calc.TER(sentence, empty).numEdits, ReferenceEdits(sentence, empty));
+}
+
+BOOST_AUTO_TEST_CASE(ter_int_calc_shift) {
+  terIntCalc calc;
+  int hyp_words[] = {4, 5, 6, 1, 2, 3};
+  int ref_words[] = {1, 2, 3, 4, 5, 6};
+  std::vector<int> hyp(hyp_words, hyp_words + 6);
+  std::vector<int> ref(ref_words, ref_words + 6);
+  terAlignment result = calc.TER(hyp, ref);
+  BOOST_CHECK_EQUAL(result.numEdits, 1);
+  BOOST_CHECK_EQUAL(result.numWords, 6);
+}
+
+// A small vocabulary makes for many repeated words and candidate shifts.
+BOOST_AUTO_TEST_CASE(ter_int_calc_matches_ter_calc) {
+  srand(1234);
+  terIntCalc calc;
+  for (int n = 0; n < 300; ++n) {
+    const int vocab = 2 + n % 8;
+    std::vector<int> ref = RandomSentence(40, vocab);
+    std::vector<int> hyp = RandomSentence(40, vocab);
+    BOOST_CHECK_EQUAL(calc.TER(hyp, ref).numEdits, ReferenceEdits(hyp, ref));
+  }
+}
@@ -1,12 +1,13 @@
 #include "TerScorer.h"
 
 #include <cmath>
+#include <fstream>
 #include <sstream>
 #include <stdexcept>
 
 #include "ScoreStats.h"
-#include "TER/tercalc.h"
 #include "TER/terAlignment.h"
+#include "TER/terIntCalc.h"
 #include "Util.h"
 
 using namespace std;
@@ -56,6 +57,15 @@ void TerScorer::prepareStats ( size_t sid, const string& text, ScoreStats& entry
 {
   string sentence = this->preprocessSentence(text);
 
+  vector<int> testtokens;
+  TokenizeAndEncode(sentence, testtokens);
+
+  terIntCalc* calc = m_calc.get();
+  if ( !calc ) {
+    calc = new terIntCalc();
+    m_calc.reset ( calc );
+  }
+
   terAlignment result;
   result.numEdits = 0.0 ;
   result.numWords = 0.0 ;
@@ -68,9 +78,7 @@ void TerScorer::prepareStats ( size_t sid, const string& text, ScoreStats& entry
       throw runtime_error ( msg.str() );
     }
 
-    vector<int> testtokens;
-    vector<int> reftokens;
-    reftokens = m_multi_references.at ( incRefs ).at ( sid );
+    const vector<int>& reftokens = m_multi_references.at ( incRefs ).at ( sid );
     double averageLength=0.0;
     for ( int incRefsBis = 0; incRefsBis < ( int ) m_multi_references.size(); incRefsBis++ ) {
       if ( sid >= m_multi_references.at(incRefsBis).size() ) {
@@ -81,17 +89,13 @@ void TerScorer::prepareStats ( size_t sid, const string& text, ScoreStats& entry
       averageLength+=(double)m_multi_references.at ( incRefsBis ).at ( sid ).size();
     }
     averageLength=averageLength/( double ) m_multi_references.size();
-    TokenizeAndEncode(sentence, testtokens);
-    terCalc * evaluation=new terCalc();
-    evaluation->setDebugMode ( false );
-    terAlignment tmp_result = evaluation->TER ( reftokens, testtokens );
+    terAlignment tmp_result = calc->TER ( testtokens, reftokens );
     tmp_result.averageWords=averageLength;
     if ( ( result.numEdits == 0.0 ) && ( result.averageWords == 0.0 ) ) {
       result = tmp_result;
     } else if ( result.scoreAv() > tmp_result.scoreAv() ) {
       result = tmp_result;
     }
-    delete evaluation;
   }
   ostringstream stats;
   // multiplication by 100 in order to keep the average precision
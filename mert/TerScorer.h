@@ -5,9 +5,20 @@
 #include <string>
 #include <vector>
 
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
+
 #include "Types.h"
 #include "StatisticsBasedScorer.h"
 
+namespace TERCpp
+{
+class terIntCalc;
+}
+
 namespace MosesTuning
 {
   
@@ -25,6 +36,7 @@ public:
 
   virtual void setReferenceFiles(const std::vector<std::string>& referenceFiles);
   virtual void prepareStats(std::size_t sid, const std::string& text, ScoreStats& entry);
+  virtual bool threadSafeStats() const { return !hasFilter(); }
 
   virtual std::size_t NumberOfScores() const {
     // cerr << "TerScorer: " << (LENGTH + 1) << endl;
@@ -46,6 +58,13 @@ private:
   std::vector<std::vector<std::vector<int> > > m_multi_references;
   std::string m_pid;
 
+  // TER buffers, one set per scoring thread
+#ifdef WITH_THREADS
+  boost::thread_specific_ptr<TERCpp::terIntCalc> m_calc;
+#else
+  boost::scoped_ptr<TERCpp::terIntCalc> m_calc;
+#endif
+
   // no copying allowed
   TerScorer(const TerScorer&);
   TerScorer& operator=(const TerScorer&);
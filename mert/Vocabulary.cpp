@@ -7,6 +7,15 @@ Vocabulary* g_vocab = NULL;
 } // namespace
 
 int Vocabulary::Encode(const std::string& token) {
+#ifdef WITH_THREADS
+	{
+		// most tokens are known already; only new ones take the lock exclusively
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		const_iterator it = m_vocab.find(token);
+		if (it != m_vocab.end()) return it->second;
+	}
+	boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+#endif
 	iterator it = m_vocab.find(token);
 	int encoded_token;
 	if (it == m_vocab.end()) {
@@ -21,6 +30,9 @@ int Vocabulary::Encode(const std::string& token) {
 }
 
 bool Vocabulary::Lookup(const std::string&str , int* v) const {
+#ifdef WITH_THREADS
+	boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+#endif
 
 	const_iterator it = m_vocab.find(str);
 	if (it == m_vocab.end()) return false;
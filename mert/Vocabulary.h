@@ -4,6 +4,10 @@
 #include <map>
 #include <string>
 
+#ifdef WITH_THREADS
+#include <boost/thread/shared_mutex.hpp>
+#endif
+
 namespace mert {
 
 /**
@@ -11,6 +15,9 @@ namespace mert {
  * various scores such as BLEU.
  *
  * TODO: replace this with more efficient data structure.
+ *
+ * Encode() and Lookup() may be called from several threads at once;
+ * the remaining accessors are not synchronised.
  */
 class Vocabulary {
  public:
@@ -46,7 +53,9 @@ class Vocabulary {
 
  private:
   std::map<std::string, int> m_vocab;
-  
+#ifdef WITH_THREADS
+  mutable boost::shared_mutex m_mutex;
+#endif
 };
 
 class VocabularyFactory {
@@ -38,6 +38,9 @@ void usage()
   cerr << "[--factors|-f] list of factors passed to the scorer (e.g. 0|2)" << endl;
   cerr << "[--filter|-l] filter command used to preprocess the sentences" << endl;
   cerr << "[--allow-duplicates|-d] omit the duplicate removal step" << endl;
+#ifdef WITH_THREADS
+  cerr << "[--threads|-T] score the nbest sentences with multiple threads (default 1)" << endl;
+#endif
   cerr << "[-v] verbose level" << endl;
   cerr << "[--help|-h] print this message and exit" << endl;
   exit(1);
@@ -58,6 +61,9 @@ static struct option long_options[] = {
   {"verbose", required_argument, 0, 'v'},
   {"help", no_argument, 0, 'h'},
   {"allow-duplicates", no_argument, 0, 'd'},
+#ifdef WITH_THREADS
+  {"threads", required_argument, 0, 'T'},
+#endif
   {0, 0, 0, 0}
 };
 
@@ -76,6 +82,7 @@ struct ProgramOption {
   bool binmode;
   bool allowDuplicates;
   int verbosity;
+  size_t numThreads;
 
   ProgramOption()
       : scorerType("BLEU"),
@@ -90,14 +97,15 @@ struct ProgramOption {
         prevFeatureDataFile(""),
         binmode(false),
         allowDuplicates(false),
-        verbosity(0) { }
+        verbosity(0),
+        numThreads(1) { }
 };
 
 void ParseCommandOptions(int argc, char** argv, ProgramOption* opt) {
   int c;
   int option_index;
 
-  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:hbd", long_options, &option_index)) != -1) {
+  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:hbdT:", long_options, &option_index)) != -1) {
     switch (c) {
       case 's':
         opt->scorerType = string(optarg);
@@ -138,6 +146,12 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt) {
       case 'd':
         opt->allowDuplicates = true;
         break;
+#ifdef WITH_THREADS
+      case 'T':
+        opt->numThreads = strtol(optarg, NULL, 10);
+        if (opt->numThreads < 1) opt->numThreads = 1;
+        break;
+#endif
       default:
         usage();
     }
@@ -225,7 +239,7 @@ int main(int argc, char** argv)
 
     // computing score statistics of each nbest file
     for (size_t i = 0; i < nbestFiles.size(); i++) {
-      data.loadNBest(nbestFiles.at(i));
+      data.loadNBest(nbestFiles.at(i), option.numThreads);
     }
 
     PrintUserTime("Nbest entries loaded and scored");
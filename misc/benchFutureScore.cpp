@@ -0,0 +1,163 @@
+// Microbenchmark for the future score matrix: compares filling the matrix
+// with the plain triple loop against SquareMatrix::CalcJoinedScores, and
+// rescanning the coverage bitmap against the incremental update used by
+// the search.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "SquareMatrix.h"
+#include "WordsBitmap.h"
+
+using namespace Moses;
+
+namespace
+{
+
+const size_t kMaxPhraseLength = 7;
+
+void FillPhraseSpans(SquareMatrix &matrix)
+{
+  const size_t size = matrix.GetSize();
+  for(size_t row=0; row<size; row++) {
+    for(size_t col=row; col<size; col++) {
+      float score = -std::numeric_limits<float>::infinity();
+      if (col - row < kMaxPhraseLength)
+        score = -1.0f - 5.0f * rand() / RAND_MAX * (col - row + 1);
+      matrix.SetScore(row, col, score);
+    }
+  }
+}
+
+void NaiveJoin(SquareMatrix &matrix)
+{
+  const size_t size = matrix.GetSize();
+  for(size_t colstart = 1; colstart < size ; colstart++) {
+    for(size_t diagshift = 0; diagshift < size-colstart ; diagshift++) {
+      size_t startPos = diagshift;
+      size_t endPos = colstart+diagshift;
+      for(size_t joinAt = startPos; joinAt < endPos ; joinAt++)  {
+        float joinedScore = matrix.GetScore(startPos, joinAt)
+                            + matrix.GetScore(joinAt+1, endPos);
+        if (joinedScore > matrix.GetScore(startPos, endPos))
+          matrix.SetScore(startPos, endPos, joinedScore);
+      }
+    }
+  }
+}
+
+double Seconds(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// Random decoding paths: each step covers a short phrase near the first
+// gap, as a distortion limited search would.
+std::vector<std::pair<size_t, size_t> > RandomPath(size_t size)
+{
+  std::vector<std::pair<size_t, size_t> > path;
+  WordsBitmap bitmap(size);
+  while (!bitmap.IsComplete()) {
+    size_t startPos = std::min(size - 1, bitmap.GetFirstGapPos() + rand() % 6);
+    while (bitmap.GetValue(startPos)) --startPos;
+    size_t endPos = startPos;
+    size_t length = 1 + rand() % 3;
+    while (endPos + 1 < size && endPos - startPos + 1 < length && !bitmap.GetValue(endPos + 1)) ++endPos;
+    bitmap.SetValue(startPos, endPos, true);
+    path.push_back(std::make_pair(startPos, endPos));
+  }
+  return path;
+}
+
+void BenchUpdate(const SquareMatrix &matrix, size_t paths)
+{
+  const size_t size = matrix.GetSize();
+  std::vector<std::vector<std::pair<size_t, size_t> > > all;
+  for (size_t p = 0; p < paths; ++p) all.push_back(RandomPath(size));
+
+  // every step is scored from the bitmap before the step is applied, in
+  // both variants, so the bitmap updates cost the same
+  std::vector<float> rescanned, updated;
+  clock_t start = clock();
+  for (size_t p = 0; p < paths; ++p) {
+    WordsBitmap bitmap(size);
+    for (size_t i = 0; i < all[p].size(); ++i) {
+      bitmap.SetValue(all[p][i].first, all[p][i].second, true);
+      rescanned.push_back(matrix.CalcFutureScore(bitmap));
+    }
+  }
+  double rescanTime = Seconds(start);
+
+  start = clock();
+  for (size_t p = 0; p < paths; ++p) {
+    WordsBitmap bitmap(size);
+    float future = matrix.CalcFutureScore(bitmap);
+    for (size_t i = 0; i < all[p].size(); ++i) {
+      future = matrix.UpdateFutureScore(future, bitmap, all[p][i].first, all[p][i].second);
+      bitmap.SetValue(all[p][i].first, all[p][i].second, true);
+      updated.push_back(future);
+    }
+  }
+  double updateTime = Seconds(start);
+
+  double maxDiff = 0.0;
+  for (size_t i = 0; i < updated.size(); ++i) {
+    if (rescanned[i] == 0.0f && updated[i] != 0.0f) {
+      std::cerr << "Complete coverage has future score " << updated[i] << std::endl;
+      exit(1);
+    }
+    maxDiff = std::max(maxDiff, (double)std::fabs(updated[i] - rescanned[i]));
+  }
+  std::cout << "  future score: rescan " << rescanTime << "s, update " << updateTime
+            << "s, max difference " << maxDiff << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t repeat = 20;
+  if (argc > 1) repeat = atoi(argv[1]);
+  srand(1);
+
+  const size_t sizes[] = {25, 50, 100, 200, 400};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    const size_t size = sizes[s];
+    SquareMatrix naive(size), joined(size);
+    clock_t start;
+    double naiveTime = 0.0, joinedTime = 0.0;
+    for (size_t r = 0; r < repeat; ++r) {
+      FillPhraseSpans(naive);
+      for(size_t row=0; row<size; row++)
+        for(size_t col=row; col<size; col++)
+          joined.SetScore(row, col, naive.GetScore(row, col));
+
+      start = clock();
+      NaiveJoin(naive);
+      naiveTime += Seconds(start);
+      start = clock();
+      joined.CalcJoinedScores();
+      joinedTime += Seconds(start);
+
+      for(size_t row=0; row<size; row++) {
+        for(size_t col=row; col<size; col++) {
+          if (naive.GetScore(row, col) != joined.GetScore(row, col)) {
+            std::cerr << "Mismatch at [" << row << "," << col << "]: "
+                      << naive.GetScore(row, col) << " != " << joined.GetScore(row, col) << std::endl;
+            return 1;
+          }
+        }
+      }
+    }
+    std::cout << "length " << size << ":" << std::endl
+              << "  matrix fill: triple loop " << naiveTime << "s, joined " << joinedTime << "s" << std::endl;
+    BenchUpdate(joined, 50 * repeat);
+  }
+  return 0;
+}
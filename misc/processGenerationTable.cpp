@@ -0,0 +1,53 @@
+#include <iostream>
+#include <string>
+
+#include "InputFileStream.h"
+#include "GenerationDictionary.h"
+
+using namespace Moses;
+
+void printHelp()
+{
+  std::cerr << "Usage:\n"
+            "options: \n"
+            "\t-in  string -- input table file name\n"
+            "\t-out string -- binary table file name\n"
+            "If -in is not specified reads from stdin\n"
+            "The binary table is used by giving its name in [generation-file]\n"
+            "\n";
+}
+
+int main(int argc, char** argv)
+{
+  std::string inFilePath;
+  std::string outFilePath("out");
+  if(1 >= argc) {
+    printHelp();
+    return 1;
+  }
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if("-in" == arg && i+1 < argc) {
+      ++i;
+      inFilePath = argv[i];
+    } else if("-out" == arg && i+1 < argc) {
+      ++i;
+      outFilePath = argv[i];
+    } else {
+      //somethings wrong... print help
+      printHelp();
+      return 1;
+    }
+  }
+
+  bool success;
+  if(inFilePath.empty()) {
+    std::cerr << "processing stdin to " << outFilePath << "\n";
+    success = GenerationDictionary::Create(std::cin, outFilePath);
+  } else {
+    std::cerr << "processing " << inFilePath<< " to " << outFilePath << "\n";
+    InputFileStream file(inFilePath);
+    success = GenerationDictionary::Create(file, outFilePath);
+  }
+  return (success ? 0 : 1);
+}
@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
@@ -15,6 +16,7 @@ void printHelp()
             "options: \n"
             "\t-in  string -- input table file name\n"
             "\t-out string -- prefix of binary table files\n"
+            "\t-threads int -- number of threads for parsing the table and building the trees\n"
             "If -in is not specified reads from stdin\n"
             "\n";
 }
@@ -24,6 +26,7 @@ int main(int argc, char** argv)
   std::cerr << "processLexicalTable v0.1 by Konrad Rawlik\n";
   std::string inFilePath;
   std::string outFilePath("out");
+  size_t threads = 1;
   if(1 >= argc) {
     printHelp();
     return 1;
@@ -36,6 +39,9 @@ int main(int argc, char** argv)
     } else if("-out" == arg && i+1 < argc) {
       ++i;
       outFilePath = argv[i];
+    } else if("-threads" == arg && i+1 < argc) {
+      ++i;
+      threads = atoi(argv[i]);
     } else {
       //somethings wrong... print help
       printHelp();
@@ -45,11 +51,11 @@ int main(int argc, char** argv)
 
   if(inFilePath.empty()) {
     std::cerr << "processing stdin to " << outFilePath << ".*\n";
-    return LexicalReorderingTableTree::Create(std::cin, outFilePath);
+    return LexicalReorderingTableTree::Create(std::cin, outFilePath, threads);
   } else {
     std::cerr << "processing " << inFilePath<< " to " << outFilePath << ".*\n";
     InputFileStream file(inFilePath);
-    bool success = LexicalReorderingTableTree::Create(file, outFilePath);
+    bool success = LexicalReorderingTableTree::Create(file, outFilePath, threads);
     return (success ? 0 : 1);
   }
 }
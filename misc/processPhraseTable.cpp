@@ -47,6 +47,7 @@ int main(int argc,char **argv)
   bool aligninfo=false;
   std::vector<std::pair<std::string,std::pair<char*,char*> > > ftts;
   int verb=0;
+  size_t threads=1;
   for(int i=1; i<argc; ++i) {
     std::string s(argv[i]);
     if(s=="-ttable") {
@@ -60,6 +61,7 @@ int main(int argc,char **argv)
     else if(s=="-irst") cn=2;
     else if(s=="-alignment-info") aligninfo=true;
     else if(s=="-v") verb=atoi(argv[++i]);
+    else if(s=="-threads") threads=atoi(argv[++i]);
     else if(s=="-h") {
       std::cerr<<"usage "<<argv[0]<<" :\n\n"
                "options:\n"
@@ -67,6 +69,7 @@ int main(int argc,char **argv)
                "\t-out string      -- output file name prefix for binary ttable\n"
                "\t-nscores int     -- number of scores in ttable\n"
                "\t-alignment-info  -- include alignment info in the binary ttable (suffix \".wa\")\n"
+               "\t-threads int     -- number of threads for parsing the ttable and building the trees\n"
                "\nfunctions:\n"
                "\t - convert ascii ttable in binary format\n"
                "\t - if ttable is not read from stdin:\n"
@@ -90,11 +93,11 @@ int main(int argc,char **argv)
 
       if (ftts[0].first=="-") {
         std::cerr<< "stdin\n";
-        pdt.Create(std::cin,fto);
+        pdt.Create(std::cin,fto,threads);
       } else {
         std::cerr<< ftts[0].first << "\n";
         InputFileStream in(ftts[0].first);
-        pdt.Create(in,fto);
+        pdt.Create(in,fto,threads);
       }
     } else {
 #if 0
@@ -169,7 +172,6 @@ int main(int argc,char **argv)
               std::cerr<<"ERROR: translation candidates mismatch '"<<iostA.str()<<"' and for prefix pointer: '"<<iostB.str()<<"'\n";
 
             std::cerr<<"translation candidates:\n"<<iostA.str()<<"\n";
-            pdt.FreeMemory();
 
           }
 
@@ -39,6 +39,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "TypeDef.h"
 #include "Sentence.h"
 #include "FactorTypeSet.h"
+#include "LineInput.h"
 #include "TranslationSystem.h"
 #include "ChartTrellisPathList.h"
 #include "OutputCollector.h"
@@ -84,6 +85,10 @@ public:
   ~IOWrapper();
 
   Moses::InputType* GetInput(Moses::InputType *inputType);
+  //! raw text of the next input, for types where Moses::IsLineInput holds
+  bool GetInputLine(std::string &line) {
+    return Moses::ReadInputLine(*m_inputStream, line);
+  }
   void OutputBestHypo(const Moses::ChartHypothesis *hypo, long translationId, bool reportSegmentation, bool reportAllFactors);
   void OutputBestHypo(const std::vector<const Moses::Factor*>&  mbrBestHypo, long translationId, bool reportSegmentation, bool reportAllFactors);
   void OutputNBestList(const Moses::ChartTrellisPathList &nBestList, const Moses::ChartHypothesis *bestHypo, const Moses::TranslationSystem* system, long translationId);
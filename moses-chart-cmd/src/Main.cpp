@@ -71,6 +71,16 @@ public:
   TranslationTask(InputType *source, IOWrapper &ioWrapper)
     : m_source(source)
     , m_ioWrapper(ioWrapper)
+    , m_translationIds(NULL)
+  {}
+
+  //! Parse line in Run, on the decoding thread.  It is input number index.
+  TranslationTask(const std::string &line, size_t index, TranslationIdSequencer &ids, IOWrapper &ioWrapper)
+    : m_source(NULL)
+    , m_ioWrapper(ioWrapper)
+    , m_line(line)
+    , m_index(index)
+    , m_translationIds(&ids)
   {}
 
   ~TranslationTask() {
@@ -79,6 +89,18 @@ public:
 
   void Run() {
     const StaticData &staticData = StaticData::Instance();
+    if (m_translationIds) {
+      try {
+        m_source = ParseInputLine(staticData.GetInputType(), m_line, staticData.GetInputFactorOrder());
+      } catch (const std::exception &e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      m_translationIds->Assign(m_index, m_source);
+      // the last line was incomplete, as ReadInput would have found
+      if (!m_source) return;
+    }
+
     const TranslationSystem &system = staticData.GetTranslationSystem(TranslationSystem::DEFAULT);
     const size_t lineNumber = m_source->GetTranslationId();
 
@@ -136,6 +158,9 @@ private:
 
   InputType *m_source;
   IOWrapper &m_ioWrapper;
+  std::string m_line;
+  size_t m_index;
+  TranslationIdSequencer *m_translationIds;
 };
 
 bool ReadInput(IOWrapper &ioWrapper, InputTypeEnum inputType, InputType*& source)
@@ -224,6 +249,12 @@ int main(int argc, char* argv[])
     }
   
     CHECK(staticData.GetSearchAlgorithm() == ChartDecoding);
+
+    // the binary format encodes phrase-based hypothesis stacks
+    if (staticData.GetOutputSearchGraphBinary()) {
+      TRACE_ERR("ERROR: -output-search-graph-binary is not supported for chart decoding, use -output-search-graph" << endl);
+      return EXIT_FAILURE;
+    }
   
     // set up read/writing class
     IOWrapper *ioWrapper = GetIOWrapper(staticData);
@@ -247,16 +278,26 @@ int main(int argc, char* argv[])
     if (ioWrapper == NULL)
       return EXIT_FAILURE;
   
+    // outlives the pool, whose tasks use it
+    TranslationIdSequencer translationIds(staticData.GetStartTranslationId());
+
 #ifdef WITH_THREADS
     ThreadPool pool(staticData.ThreadCount());
 #endif
   
     // read each sentence & decode
+    // inputs of one line each are only read here and parsed by the tasks,
+    // so markup processing and factor interning run on the decoding threads
     InputType *source=0;
-    while(ReadInput(*ioWrapper,staticData.GetInputType(),source)) {
+    const bool lineInput = IsLineInput(staticData.GetInputType());
+    std::string line;
+    size_t lineCount = 0;
+    while(lineInput ? ioWrapper->GetInputLine(line) : ReadInput(*ioWrapper,staticData.GetInputType(),source)) {
       IFVERBOSE(1)
       ResetUserTime();
-      TranslationTask *task = new TranslationTask(source, *ioWrapper);
+      TranslationTask *task = lineInput
+                              ? new TranslationTask(line, lineCount++, translationIds, *ioWrapper)
+                              : new TranslationTask(source, *ioWrapper);
       source = NULL;  // task will delete source
 #ifdef WITH_THREADS
       pool.Submit(task);  // pool will delete task
@@ -148,13 +148,17 @@ void IOWrapper::Initialization(const std::vector<FactorType>	&/*inputFactorOrder
 // search graph output
   if (staticData.GetOutputSearchGraph()) {
     string fileName;
+    std::ios_base::openmode mode = std::ios_base::out;
     if (staticData.GetOutputSearchGraphExtended())
       fileName = staticData.GetParam("output-search-graph-extended")[0];
-    else
+    else if (staticData.GetOutputSearchGraphBinary()) {
+      fileName = staticData.GetParam("output-search-graph-binary")[0];
+      mode |= std::ios_base::binary;
+    } else
       fileName = staticData.GetParam("output-search-graph")[0];
     std::ofstream *file = new std::ofstream;
     m_outputSearchGraphStream = file;
-    file->open(fileName.c_str());
+    file->open(fileName.c_str(), mode);
   }
 
   // detailed translation reporting
@@ -50,6 +50,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "TrellisPathList.h"
 #include "InputFileStream.h"
 #include "InputType.h"
+#include "LineInput.h"
 #include "WordLattice.h"
 #include "LatticeMBR.h"
 
@@ -97,6 +98,10 @@ public:
   ~IOWrapper();
 
   Moses::InputType* GetInput(Moses::InputType *inputType);
+  //! raw text of the next input, for types where Moses::IsLineInput holds
+  bool GetInputLine(std::string &line) {
+    return Moses::ReadInputLine(*m_inputStream, line);
+  }
 
   void OutputBestHypo(const Moses::Hypothesis *hypo, long translationId, bool reportSegmentation, bool reportAllFactors);
   void OutputLatticeMBRNBestList(const std::vector<LatticeMBRSolution>& solutions,long translationId);
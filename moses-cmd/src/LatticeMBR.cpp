@@ -10,7 +10,9 @@
 #include "LatticeMBR.h"
 #include "StaticData.h"
 #include <algorithm>
+#include <functional>
 #include <set>
+#include <boost/functional/hash.hpp>
 
 using namespace std;
 using namespace Moses;
@@ -36,47 +38,6 @@ void GetOutputWords(const TrellisPath &path, vector <Word> &translation)
 }
 
 
-void extract_ngrams(const vector<Word >& sentence, map < Phrase, int >  & allngrams)
-{
-  for (int k = 0; k < (int)bleu_order; k++) {
-    for(int i =0; i < max((int)sentence.size()-k,0); i++) {
-      Phrase ngram( k+1);
-      for ( int j = i; j<= i+k; j++) {
-        ngram.AddWord(sentence[j]);
-      }
-      ++allngrams[ngram];
-    }
-  }
-}
-
-
-
-void NgramScores::addScore(const Hypothesis* node, const Phrase& ngram, float score)
-{
-  set<Phrase>::const_iterator ngramIter = m_ngrams.find(ngram);
-  if (ngramIter == m_ngrams.end()) {
-    ngramIter = m_ngrams.insert(ngram).first;
-  }
-  map<const Phrase*,float>& ngramScores = m_scores[node];
-  map<const Phrase*,float>::iterator scoreIter = ngramScores.find(&(*ngramIter));
-  if (scoreIter == ngramScores.end()) {
-    ngramScores[&(*ngramIter)] = score;
-  } else {
-    ngramScores[&(*ngramIter)] = log_sum(score,scoreIter->second);
-  }
-}
-
-NgramScores::NodeScoreIterator NgramScores::nodeBegin(const Hypothesis* node)
-{
-  return m_scores[node].begin();
-}
-
-
-NgramScores::NodeScoreIterator NgramScores::nodeEnd(const Hypothesis* node)
-{
-  return m_scores[node].end();
-}
-
 LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
   m_score(0.0f)
 {
@@ -98,25 +59,22 @@ LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
 }
 
 
-void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const vector<float>& thetas, float mapWeight)
+void LatticeMBRSolution::CalcScore(FlatLattice& lattice, const vector<float>& thetas, float mapWeight)
 {
   m_ngramScores.assign(thetas.size()-1, -10000);
 
-  map < Phrase, int > counts;
-  extract_ngrams(m_words,counts);
+  vector<pair<size_t, size_t> > counts;
+  lattice.GetNgramCounts(m_words,counts);
 
   //Now score this translation
   m_score = thetas[0] * m_words.size();
 
   //Calculate the ngramScores, working in log space at first
-  for (map < Phrase, int >::iterator ngrams = counts.begin(); ngrams != counts.end(); ++ngrams) {
+  for (size_t i = 0; i < counts.size(); ++i) {
     float ngramPosterior = UNKNGRAMLOGPROB;
-    map<Phrase,float>::const_iterator ngramPosteriorIt = finalNgramScores.find(ngrams->first);
-    if (ngramPosteriorIt != finalNgramScores.end()) {
-      ngramPosterior = ngramPosteriorIt->second;
-    }
-    size_t ngramSize = ngrams->first.GetSize();
-    m_ngramScores[ngramSize-1] = log_sum(log((float)ngrams->second) + ngramPosterior,m_ngramScores[ngramSize-1]);
+    lattice.GetNgramScore(counts[i].first, ngramPosterior);
+    size_t ngramSize = lattice.GetNgramSize(counts[i].first);
+    m_ngramScores[ngramSize-1] = log_sum(log((float)counts[i].second) + ngramPosterior,m_ngramScores[ngramSize-1]);
   }
 
   //convert from log to probability and create weighted sum
@@ -125,394 +83,401 @@ void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const v
     m_score += thetas[i+1] * m_ngramScores[i];
   }
 
-
   //The map score
   m_score += m_mapScore*mapWeight;
 }
 
+namespace
+{
+/** Edge of the lattice while it is being pruned */
+struct RawEdge {
+  const Hypothesis* tail;
+  float score;
+  const TargetPhrase* phrase;
+};
+}
 
-void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const Hypothesis* > > & outgoingHyps, map<const Hypothesis*, vector<Edge> >& incomingEdges,
-                    const vector< float> & estimatedScores, const Hypothesis* bestHypo, size_t edgeDensity, float scale)
+size_t FlatLattice::WordHasher::operator()(const Word& word) const
 {
+  size_t seed = word.IsNonTerminal();
+  for (size_t factorType = 0; factorType < MAX_NUM_FACTORS; ++factorType) {
+    boost::hash_combine(seed, word.GetFactor(factorType));
+  }
+  return seed;
+}
+
+FlatLattice::FlatLattice(Manager& manager, size_t edgeDensity, float scale)
+{
+  // keep the best scoring hyps, by forward-backward estimate, until edgeDensity
+  // edges per word of the best translation have been added (as per Shankar)
+  std::map < int, bool > connected;
+  std::vector< const Hypothesis *> connectedList;
+  std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
+  vector< float> estimatedScores;
+  manager.GetForwardBackwardSearchGraph(&connected, &connectedList, &outgoingHyps, &estimatedScores);
+  const Hypothesis* bestHypo = manager.GetBestHypothesis();
 
-  //Need hyp 0 in connectedHyp - Find empty hypothesis
   VERBOSE(2,"Pruning lattice to edge density " << edgeDensity << endl);
-  const Hypothesis* emptyHyp = connectedHyp.at(0);
+  const Hypothesis* emptyHyp = connectedList.at(0);
   while (emptyHyp->GetId() != 0) {
     emptyHyp = emptyHyp->GetPrevHypo();
   }
-  connectedHyp.push_back(emptyHyp); //Add it to list of hyps
-
-  //Need hyp 0's outgoing Hyps
-  for (size_t i = 0; i < connectedHyp.size(); ++i) {
-    if (connectedHyp[i]->GetId() > 0 && connectedHyp[i]->GetPrevHypo()->GetId() == 0)
-      outgoingHyps[emptyHyp].insert(connectedHyp[i]);
+  int maxId = 0;
+  for (size_t i = 0; i < connectedList.size(); ++i) {
+    maxId = max(maxId, connectedList[i]->GetId());
   }
-
-  //sort hyps based on estimated scores - do so by copying to multimap
-  multimap<float, const Hypothesis*> sortHypsByVal;
-  for (size_t i =0; i < estimatedScores.size(); ++i) {
-    sortHypsByVal.insert(make_pair(estimatedScores[i], connectedHyp[i]));
+  for (size_t i = 0; i < connectedList.size(); ++i) {
+    if (connectedList[i]->GetId() > 0 && connectedList[i]->GetPrevHypo()->GetId() == 0)
+      outgoingHyps[emptyHyp].insert(connectedList[i]);
   }
 
-  multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end();
-  float bestScore = it->first;
-  //store best score as score of hyp 0
-  sortHypsByVal.insert(make_pair(bestScore, emptyHyp));
-
-
-  IFVERBOSE(3) {
-    for (multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end(); it != --sortHypsByVal.begin(); --it) {
-      const Hypothesis* currHyp =  it->second;
-      cerr << "Hyp " << currHyp->GetId() << ", estimated score: " << it->first << endl;
-    }
+  // visit hyps by decreasing estimated score; the empty hyp gets the best score.
+  // ties are visited in reverse order of insertion
+  vector<pair<float, int> > order;
+  float bestScore = *max_element(estimatedScores.begin(), estimatedScores.end());
+  connectedList.push_back(emptyHyp);
+  for (size_t i = 0; i < estimatedScores.size(); ++i) {
+    order.push_back(make_pair(estimatedScores[i], (int)i));
   }
+  order.push_back(make_pair(bestScore, (int)estimatedScores.size()));
+  sort(order.begin(), order.end(), greater<pair<float, int> >());
 
+  vector<int> survivor(maxId + 1, -1); //index into survivors, by hypothesis id
+  vector<const Hypothesis*> survivors;
+  vector<vector<RawEdge> > incoming;
 
-  set <const Hypothesis*> survivingHyps; //store hyps that make the cut in this
-
-  VERBOSE(2, "BEST HYPO TARGET LENGTH : " << bestHypo->GetSize() << endl)
-  size_t numEdgesTotal = edgeDensity * bestHypo->GetSize(); //as per Shankar, aim for (density * target length of MAP solution) arcs
+  size_t numEdgesTotal = edgeDensity * bestHypo->GetSize();
   size_t numEdgesCreated = 0;
-  VERBOSE(2, "Target edge count: " << numEdgesTotal << endl);
-
   float prevScore = -999999;
-
-  //now iterate over multimap
-  for (multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end(); it != --sortHypsByVal.begin(); --it) {
-    float currEstimatedScore = it->first;
-    const Hypothesis* currHyp =  it->second;
-
-    if (numEdgesCreated >= numEdgesTotal && prevScore > currEstimatedScore) //if this hyp has equal estimated score to previous, include its edges too
+  for (size_t o = 0; o < order.size(); ++o) {
+    float currEstimatedScore = order[o].first;
+    const Hypothesis* currHyp = connectedList[order[o].second];
+    if (numEdgesCreated >= numEdgesTotal && prevScore > currEstimatedScore)
       break;
-
     prevScore = currEstimatedScore;
-    VERBOSE(3, "Num edges created : "<< numEdgesCreated << ", numEdges wanted " << numEdgesTotal << endl)
-    VERBOSE(3, "Considering hyp " << currHyp->GetId() << ", estimated score: " << it->first << endl)
 
-    survivingHyps.insert(currHyp); //CurrHyp made the cut
+    if (survivor[currHyp->GetId()] < 0) {
+      survivor[currHyp->GetId()] = survivors.size();
+      survivors.push_back(currHyp);
+      incoming.push_back(vector<RawEdge>());
+    }
+    const int curr = survivor[currHyp->GetId()];
 
-    // is its best predecessor already included ?
-    if (survivingHyps.find(currHyp->GetPrevHypo()) != survivingHyps.end()) { //yes, then add an edge
-      vector <Edge>& edges = incomingEdges[currHyp];
-      Edge winningEdge(currHyp->GetPrevHypo(),currHyp,scale*(currHyp->GetScore() - currHyp->GetPrevHypo()->GetScore()),currHyp->GetCurrTargetPhrase());
-      edges.push_back(winningEdge);
+    const Hypothesis* prevHypo = currHyp->GetPrevHypo();
+    if (prevHypo && prevHypo->GetId() <= maxId && survivor[prevHypo->GetId()] >= 0) {
+      RawEdge edge = { prevHypo, scale*(currHyp->GetScore() - prevHypo->GetScore()), &currHyp->GetCurrTargetPhrase() };
+      incoming[curr].push_back(edge);
       ++numEdgesCreated;
     }
 
-    //let's try the arcs too
     const ArcList *arcList = currHyp->GetArcList();
     if (arcList != NULL) {
-      ArcList::const_iterator iterArcList;
-      for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
+      for (ArcList::const_iterator iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
         const Hypothesis *loserHypo = *iterArcList;
         const Hypothesis* loserPrevHypo = loserHypo->GetPrevHypo();
-        if (survivingHyps.find(loserPrevHypo) != survivingHyps.end()) { //found it, add edge
+        if (loserPrevHypo->GetId() <= maxId && survivor[loserPrevHypo->GetId()] >= 0) {
           double arcScore = loserHypo->GetScore() - loserPrevHypo->GetScore();
-          Edge losingEdge(loserPrevHypo, currHyp, arcScore*scale, loserHypo->GetCurrTargetPhrase());
-          vector <Edge>& edges = incomingEdges[currHyp];
-          edges.push_back(losingEdge);
+          RawEdge edge = { loserPrevHypo, static_cast<float>(arcScore*scale), &loserHypo->GetCurrTargetPhrase() };
+          incoming[curr].push_back(edge);
           ++numEdgesCreated;
         }
       }
     }
 
-    //Now if a successor node has already been visited, add an edge connecting the two
     map < const Hypothesis*, set < const Hypothesis* > >::const_iterator outgoingIt = outgoingHyps.find(currHyp);
-
-    if (outgoingIt != outgoingHyps.end()) {//currHyp does have successors
-      const set<const Hypothesis*> & outHyps = outgoingIt->second; //the successors
-      for (set<const Hypothesis*>::const_iterator outHypIts = outHyps.begin(); outHypIts != outHyps.end(); ++outHypIts) {
-        const Hypothesis* succHyp = *outHypIts;
-
-        if (survivingHyps.find(succHyp) == survivingHyps.end()) //Have we encountered the successor yet?
-          continue; //No, move on to next
-
-        //Curr Hyp can be : a) the best predecessor  of succ b) or an arc attached to succ
-        if (succHyp->GetPrevHypo() == currHyp) { //best predecessor
-          vector <Edge>& succEdges = incomingEdges[succHyp];
-          Edge succWinningEdge(currHyp, succHyp, scale*(succHyp->GetScore() - currHyp->GetScore()), succHyp->GetCurrTargetPhrase());
-          succEdges.push_back(succWinningEdge);
-          survivingHyps.insert(succHyp);
-          ++numEdgesCreated;
-        }
-
-        //now, let's find an arc
-        const ArcList *arcList = succHyp->GetArcList();
-        if (arcList != NULL) {
-          ArcList::const_iterator iterArcList;
-          //QUESTION: What happens if there's more than one loserPrevHypo?
-          for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
-            const Hypothesis *loserHypo = *iterArcList;
-            const Hypothesis* loserPrevHypo = loserHypo->GetPrevHypo();
-            if (loserPrevHypo == currHyp) { //found it
-              vector <Edge>& succEdges = incomingEdges[succHyp];
-              double arcScore = loserHypo->GetScore() - currHyp->GetScore();
-              Edge losingEdge(currHyp, succHyp,scale* arcScore, loserHypo->GetCurrTargetPhrase());
-              succEdges.push_back(losingEdge);
-              ++numEdgesCreated;
-            }
+    if (outgoingIt == outgoingHyps.end()) continue;
+    const set<const Hypothesis*> & outHyps = outgoingIt->second;
+    for (set<const Hypothesis*>::const_iterator outHypIts = outHyps.begin(); outHypIts != outHyps.end(); ++outHypIts) {
+      const Hypothesis* succHyp = *outHypIts;
+      if (succHyp->GetId() > maxId || survivor[succHyp->GetId()] < 0)
+        continue;
+      const int succ = survivor[succHyp->GetId()];
+      if (succHyp->GetPrevHypo() == currHyp) {
+        RawEdge edge = { currHyp, scale*(succHyp->GetScore() - currHyp->GetScore()), &succHyp->GetCurrTargetPhrase() };
+        incoming[succ].push_back(edge);
+        ++numEdgesCreated;
+      }
+      const ArcList *arcList = succHyp->GetArcList();
+      if (arcList != NULL) {
+        for (ArcList::const_iterator iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
+          const Hypothesis *loserHypo = *iterArcList;
+          if (loserHypo->GetPrevHypo() == currHyp) {
+            double arcScore = loserHypo->GetScore() - currHyp->GetScore();
+            RawEdge edge = { currHyp, static_cast<float>(scale* arcScore), &loserHypo->GetCurrTargetPhrase() };
+            incoming[succ].push_back(edge);
+            ++numEdgesCreated;
           }
         }
       }
     }
   }
+  VERBOSE(2, "Done! Num edges created : "<< numEdgesCreated << ", numEdges wanted " << numEdgesTotal << endl)
 
-  connectedHyp.clear();
-  for (set <const Hypothesis*>::iterator it =  survivingHyps.begin(); it != survivingHyps.end(); ++it) {
-    connectedHyp.push_back(*it);
+  // topological order is increasing source coverage
+  vector<pair<size_t, int> > topo;
+  for (size_t i = 0; i < survivors.size(); ++i) {
+    topo.push_back(make_pair(survivors[i]->GetWordsBitmap().GetNumWordsCovered(), (int)i));
+  }
+  sort(topo.begin(), topo.end());
+  vector<int> position(survivors.size());
+  for (size_t i = 0; i < topo.size(); ++i) {
+    position[topo[i].second] = i;
   }
 
-  VERBOSE(2, "Done! Num edges created : "<< numEdgesCreated << ", numEdges wanted " << numEdgesTotal << endl)
-
-  IFVERBOSE(3) {
-    cerr << "Surviving hyps: " ;
-    for (set <const Hypothesis*>::iterator it =  survivingHyps.begin(); it != survivingHyps.end(); ++it) {
-      cerr << (*it)->GetId() << " ";
+  m_nodes.reserve(topo.size());
+  m_edgesBegin.reserve(topo.size() + 1);
+  m_edges.reserve(numEdgesCreated);
+  for (size_t i = 0; i < topo.size(); ++i) {
+    m_nodes.push_back(survivors[topo[i].second]);
+    m_edgesBegin.push_back(m_edges.size());
+    const vector<RawEdge>& edges = incoming[topo[i].second];
+    for (size_t e = 0; e < edges.size(); ++e) {
+      FlatEdge edge;
+      edge.tail = position[survivor[edges[e].tail->GetId()]];
+      edge.score = edges[e].score;
+      edge.wordsBegin = m_edgeWords.size();
+      for (size_t pos = 0; pos < edges[e].phrase->GetSize(); ++pos) {
+        m_edgeWords.push_back(GetWordId(edges[e].phrase->GetWord(pos)));
+      }
+      edge.wordsEnd = m_edgeWords.size();
+      m_edges.push_back(edge);
     }
-    cerr << endl;
   }
+  m_edgesBegin.push_back(m_edges.size());
 
-
+  // ngram id 0 is the empty ngram
+  m_ngramSize.push_back(0);
+  m_ngramWords.resize(bleu_order);
 }
 
-void calcNgramExpectations(Lattice & connectedHyp, map<const Hypothesis*, vector<Edge> >& incomingEdges,
-                           map<Phrase, float>& finalNgramScores, bool posteriors)
+size_t FlatLattice::GetWordId(const Word& word)
 {
+  return m_wordIds.insert(make_pair(word, m_wordIds.size())).first->second;
+}
 
-  sort(connectedHyp.begin(),connectedHyp.end(),ascendingCoverageCmp); //sort by increasing source word cov
+size_t FlatLattice::ExtendNgram(size_t prefix, size_t word)
+{
+  pair<boost::unordered_map<IdPair, size_t>::iterator, bool> ins =
+    m_ngramIds.insert(make_pair(IdPair(prefix, word), m_ngramSize.size()));
+  if (ins.second) {
+    size_t size = m_ngramSize[prefix];
+    m_ngramSize.push_back(size + 1);
+    for (size_t i = 0; i < bleu_order; ++i) {
+      m_ngramWords.push_back(m_ngramWords[prefix * bleu_order + i]);
+    }
+    m_ngramWords[ins.first->second * bleu_order + size] = word;
+  }
+  return ins.first->second;
+}
 
-  /*cerr << "Lattice:" << endl;
-  for (Lattice::const_iterator i = connectedHyp.begin(); i != connectedHyp.end(); ++i) {
-      const Hypothesis* h = *i;
-      cerr << *h << endl;
-      const vector<Edge>& edges = incomingEdges[h];
-      for (size_t e = 0; e < edges.size(); ++e) {
-          cerr << edges[e];
-      }
-  }*/
+size_t FlatLattice::GetPathId(size_t prefix, size_t edge)
+{
+  return m_pathIds.insert(make_pair(IdPair(prefix, edge), m_pathIds.size() + 1)).first->second;
+}
 
-  map<const Hypothesis*, float> forwardScore;
-  forwardScore[connectedHyp[0]] = 0.0f; //forward score of hyp 0 is 1 (or 0 in logprob space)
-  set< const Hypothesis *> finalHyps; //store completed hyps
+bool FlatLattice::EndsWith(size_t ngram, size_t edge) const
+{
+  // compare the last min(ngram size, edge size) words
+  const FlatEdge& e = m_edges[edge];
+  size_t size = m_ngramSize[ngram];
+  size_t back = min(size, e.wordsEnd - e.wordsBegin);
+  for (size_t i = 1; i <= back; ++i) {
+    if (m_ngramWords[ngram * bleu_order + size - i] != m_edgeWords[e.wordsEnd - i])
+      return false;
+  }
+  return true;
+}
 
-  NgramScores ngramScores;//ngram scores for each hyp
+void FlatLattice::BuildHistory(size_t edge)
+{
+  const FlatEdge& e = m_edges[edge];
+  boost::unordered_map<IdPair, size_t> entries; // (ngram, path) -> position in m_history
+  NgramEntry entry;
+
+  // ngrams local to this edge
+  entry.path = GetPathId(0, edge);
+  entry.count = 1;
+  entry.score = m_alpha[e.tail] + e.score;
+  for (size_t start = e.wordsBegin; start < e.wordsEnd; ++start) {
+    size_t ngram = 0;
+    for (size_t end = start; end < start + bleu_order && end < e.wordsEnd; ++end) {
+      ngram = ExtendNgram(ngram, m_edgeWords[end]);
+      pair<boost::unordered_map<IdPair, size_t>::iterator, bool> ins =
+        entries.insert(make_pair(IdPair(ngram, entry.path), m_history.size()));
+      if (ins.second) {
+        entry.ngram = ngram;
+        entry.atEnd = EndsWith(ngram, edge);
+        m_history.push_back(entry);
+      } else {
+        ++m_history[ins.first->second].count;
+      }
+    }
+  }
 
-  for (size_t i = 1; i < connectedHyp.size(); ++i) {
-    const Hypothesis* currHyp = connectedHyp[i];
-    if (currHyp->GetWordsBitmap().IsComplete()) {
-      finalHyps.insert(currHyp);
+  // ngrams straddling the previous edge and this one
+  for (size_t prev = m_edgesBegin[e.tail]; prev < m_edgesBegin[e.tail + 1]; ++prev) {
+    for (size_t h = m_historyBegin[prev]; h < m_historyBegin[prev + 1]; ++h) {
+      const NgramEntry incoming = m_history[h];
+      if (!incoming.atEnd) continue;
+      entry.path = GetPathId(incoming.path, edge);
+      entry.score = incoming.score + e.score;
+      size_t ngram = incoming.ngram;
+      for (size_t i = 0; e.wordsBegin + i < e.wordsEnd && i + m_ngramSize[incoming.ngram] < bleu_order; ++i) {
+        ngram = ExtendNgram(ngram, m_edgeWords[e.wordsBegin + i]);
+        pair<boost::unordered_map<IdPair, size_t>::iterator, bool> ins =
+          entries.insert(make_pair(IdPair(ngram, entry.path), m_history.size()));
+        if (ins.second) {
+          entry.ngram = ngram;
+          entry.count = incoming.count;
+          entry.atEnd = EndsWith(ngram, edge);
+          m_history.push_back(entry);
+        } else {
+          m_history[ins.first->second].count += incoming.count;
+        }
+      }
     }
+  }
+  m_historyBegin.push_back(m_history.size());
+}
 
-    VERBOSE(3, "Processing hyp: " << currHyp->GetId() << ", num words cov= " << currHyp->GetWordsBitmap().GetNumWordsCovered() <<  endl)
+void FlatLattice::AddScore(size_t ngram, float score)
+{
+  if (m_slot.size() <= ngram) {
+    m_slot.resize(m_ngramSize.size(), -1);
+  }
+  int& slot = m_slot[ngram];
+  if (slot < 0) {
+    slot = m_nodeScores.size() - m_nodeScoresBegin.back();
+    m_nodeScores.push_back(make_pair(ngram, score));
+  } else {
+    float& current = m_nodeScores[m_nodeScoresBegin.back() + slot].second;
+    current = log_sum(score, current);
+  }
+}
 
-    vector <Edge> & edges = incomingEdges[currHyp];
-    for (size_t e = 0; e < edges.size(); ++e) {
-      const Edge& edge = edges[e];
-      if (forwardScore.find(currHyp) == forwardScore.end()) {
-        forwardScore[currHyp] = forwardScore[edge.GetTailNode()] + edge.GetScore();
-        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] = fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
+void FlatLattice::CalcNgramExpectations(bool posteriors)
+{
+  m_alpha.assign(m_nodes.size(), 0.0f);
+  m_historyBegin.assign(1, 0);
+  m_history.clear();
+  m_nodeScoresBegin.assign(1, 0);
+  m_nodeScores.clear();
+  vector<size_t> introduced; // stamp of the last edge that introduced each ngram, plus one
+  vector<size_t> finalNodes;
+
+  // hyp 0 has no incoming edges and no ngrams
+  m_nodeScoresBegin.push_back(0);
+  for (size_t node = 1; node < m_nodes.size(); ++node) {
+    if (m_nodes[node]->GetWordsBitmap().IsComplete()) {
+      finalNodes.push_back(node);
+    }
+    const size_t edgesBegin = m_edgesBegin[node], edgesEnd = m_edgesBegin[node + 1];
+    for (size_t edge = edgesBegin; edge < edgesEnd; ++edge) {
+      const FlatEdge& e = m_edges[edge];
+      if (edge == edgesBegin) {
+        m_alpha[node] = m_alpha[e.tail] + e.score;
       } else {
-        forwardScore[currHyp] = log_sum(forwardScore[currHyp], forwardScore[edge.GetTailNode()] + edge.GetScore());
-        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] += fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
+        m_alpha[node] = log_sum(m_alpha[node], m_alpha[e.tail] + e.score);
       }
     }
 
-    //Process ngrams now
-    for (size_t j =0 ; j < edges.size(); ++j) {
-      Edge& edge = edges[j];
-      const NgramHistory & incomingPhrases = edge.GetNgrams(incomingEdges);
+    for (size_t edge = edgesBegin; edge < edgesEnd; ++edge) {
+      const FlatEdge& e = m_edges[edge];
+      BuildHistory(edge);
 
       //let's first score ngrams introduced by this edge
-      for (NgramHistory::const_iterator it = incomingPhrases.begin(); it != incomingPhrases.end(); ++it) {
-        const Phrase& ngram = it->first;
-        const PathCounts& pathCounts = it->second;
-        VERBOSE(4, "Calculating score for: " << it->first << endl)
-
-        for (PathCounts::const_iterator pathCountIt = pathCounts.begin(); pathCountIt != pathCounts.end(); ++pathCountIt) {
-          //Score of an n-gram is forward score of head node of leftmost edge + all edge scores
-          const Path&  path = pathCountIt->first;
-          //cerr << "path count for " << ngram << " is " << pathCountIt->second << endl;
-          float score = forwardScore[path[0]->GetTailNode()];
-          for (size_t i = 0; i < path.size(); ++i) {
-            score += path[i]->GetScore();
-          }
-          //if we're doing expectations, then the number of times the ngram
-          //appears on the path is relevant.
-          size_t count = posteriors ? 1 : pathCountIt->second;
-          for (size_t k = 0; k < count; ++k) {
-            ngramScores.addScore(currHyp,ngram,score);
-          }
+      if (introduced.size() < m_ngramSize.size()) {
+        introduced.resize(m_ngramSize.size(), 0);
+      }
+      for (size_t h = m_historyBegin[edge]; h < m_historyBegin[edge + 1]; ++h) {
+        const NgramEntry& entry = m_history[h];
+        introduced[entry.ngram] = edge + 1;
+        size_t count = posteriors ? 1 : entry.count;
+        for (size_t k = 0; k < count; ++k) {
+          AddScore(entry.ngram, entry.score);
         }
       }
 
       //Now score ngrams that are just being propagated from the history
-      for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(edge.GetTailNode());
-           it != ngramScores.nodeEnd(edge.GetTailNode()); ++it) {
-        const Phrase & currNgram = *(it->first);
-        float currNgramScore = it->second;
-        VERBOSE(4, "Calculating score for: " << currNgram << endl)
-
+      for (size_t s = m_nodeScoresBegin[e.tail]; s < m_nodeScoresBegin[e.tail + 1]; ++s) {
+        const size_t ngram = m_nodeScores[s].first;
         // For posteriors, don't double count ngrams
-        if (!posteriors || incomingPhrases.find(currNgram) == incomingPhrases.end()) {
-          float score = edge.GetScore() + currNgramScore;
-          ngramScores.addScore(currHyp,currNgram,score);
+        if (!posteriors || introduced[ngram] != edge + 1) {
+          AddScore(ngram, e.score + m_nodeScores[s].second);
         }
       }
+    }
 
+    for (size_t s = m_nodeScoresBegin.back(); s < m_nodeScores.size(); ++s) {
+      m_slot[m_nodeScores[s].first] = -1;
     }
+    m_nodeScoresBegin.push_back(m_nodeScores.size());
   }
 
   float Z = 9999999; //the total score of the lattice
-
-  //Done - Print out ngram posteriors for final hyps
-  for (set< const Hypothesis *>::iterator finalHyp = finalHyps.begin(); finalHyp != finalHyps.end(); ++finalHyp) {
-    const Hypothesis* hyp = *finalHyp;
-
-    for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(hyp); it != ngramScores.nodeEnd(hyp); ++it) {
-      const Phrase& ngram = *(it->first);
-      if (finalNgramScores.find(ngram) == finalNgramScores.end()) {
-        finalNgramScores[ngram] = it->second;
+  m_ngramScores.assign(m_ngramSize.size(), 0.0f);
+  m_ngramKnown.assign(m_ngramSize.size(), false);
+  for (size_t f = 0; f < finalNodes.size(); ++f) {
+    const size_t node = finalNodes[f];
+    for (size_t s = m_nodeScoresBegin[node]; s < m_nodeScoresBegin[node + 1]; ++s) {
+      const size_t ngram = m_nodeScores[s].first;
+      if (!m_ngramKnown[ngram]) {
+        m_ngramScores[ngram] = m_nodeScores[s].second;
+        m_ngramKnown[ngram] = true;
       } else {
-        finalNgramScores[ngram] = log_sum(it->second,  finalNgramScores[ngram]);
+        m_ngramScores[ngram] = log_sum(m_nodeScores[s].second, m_ngramScores[ngram]);
       }
     }
-
     if (Z == 9999999) {
-      Z = forwardScore[hyp];
+      Z = m_alpha[node];
     } else {
-      Z = log_sum(Z, forwardScore[hyp]);
+      Z = log_sum(Z, m_alpha[node]);
     }
   }
-
-  //Z *= scale;  //scale the score
-
-  for (map<Phrase, float>::iterator finalScoresIt = finalNgramScores.begin();  finalScoresIt != finalNgramScores.end(); ++finalScoresIt) {
-    finalScoresIt->second =  finalScoresIt->second - Z;
-    IFVERBOSE(2) {
-      VERBOSE(2,finalScoresIt->first << " [" << finalScoresIt->second << "]" << endl);
-    }
+  for (size_t ngram = 0; ngram < m_ngramScores.size(); ++ngram) {
+    if (m_ngramKnown[ngram]) m_ngramScores[ngram] -= Z;
   }
-
+  VERBOSE(2, "Lattice: " << m_nodes.size() << " nodes, " << m_edges.size() << " edges, "
+          << m_ngramSize.size() - 1 << " ngrams, " << m_history.size() << " ngram paths" << endl);
 }
 
-const NgramHistory& Edge::GetNgrams(map<const Hypothesis*, vector<Edge> > & incomingEdges)
+void FlatLattice::GetNgramCounts(const vector<Word>& sentence, vector<pair<size_t, size_t> >& counts)
 {
-
-  if (m_ngrams.size() > 0)
-    return m_ngrams;
-
-  const Phrase& currPhrase = GetWords();
-  //Extract the n-grams local to this edge
-  for (size_t start = 0; start < currPhrase.GetSize(); ++start) {
-    for (size_t end = start; end < start + bleu_order; ++end) {
-      if (end < currPhrase.GetSize()) {
-        Phrase edgeNgram(end-start+1);
-        for (size_t index = start; index <= end; ++index) {
-          edgeNgram.AddWord(currPhrase.GetWord(index));
-        }
-        //cout << "Inserting Phrase : " << edgeNgram << endl;
-        vector<const Edge*> edgeHistory;
-        edgeHistory.push_back(this);
-        storeNgramHistory(edgeNgram, edgeHistory);
-      } else {
-        break;
-      }
+  vector<size_t> ngrams;
+  for (size_t start = 0; start < sentence.size(); ++start) {
+    size_t ngram = 0;
+    for (size_t end = start; end < start + bleu_order && end < sentence.size(); ++end) {
+      ngram = ExtendNgram(ngram, GetWordId(sentence[end]));
+      ngrams.push_back(ngram);
     }
   }
-
-  map<const Hypothesis*, vector<Edge> >::iterator it = incomingEdges.find(m_tailNode);
-  if (it != incomingEdges.end()) { //node has incoming edges
-    vector<Edge> & inEdges = it->second;
-
-    for (vector<Edge>::iterator edge = inEdges.begin(); edge != inEdges.end(); ++edge) {//add the ngrams straddling prev and curr edge
-      const NgramHistory & edgeIncomingNgrams = edge->GetNgrams(incomingEdges);
-      for (NgramHistory::const_iterator edgeInNgramHist = edgeIncomingNgrams.begin(); edgeInNgramHist != edgeIncomingNgrams.end(); ++edgeInNgramHist) {
-        const Phrase& edgeIncomingNgram = edgeInNgramHist->first;
-        const PathCounts &  edgeIncomingNgramPaths = edgeInNgramHist->second;
-        size_t back = min(edgeIncomingNgram.GetSize(), edge->GetWordsSize());
-        const Phrase&  edgeWords = edge->GetWords();
-        IFVERBOSE(3) {
-          cerr << "Edge: "<< *edge <<endl;
-          cerr << "edgeWords: " << edgeWords << endl;
-          cerr << "edgeInNgram: " << edgeIncomingNgram << endl;
-        }
-
-        Phrase edgeSuffix(ARRAY_SIZE_INCR);
-        Phrase ngramSuffix(ARRAY_SIZE_INCR);
-        GetPhraseSuffix(edgeWords,back,edgeSuffix);
-        GetPhraseSuffix(edgeIncomingNgram,back,ngramSuffix);
-
-        if (ngramSuffix == edgeSuffix) { //we've got the suffix of previous edge
-          size_t  edgeInNgramSize =  edgeIncomingNgram.GetSize();
-
-          for (size_t i = 0; i < GetWordsSize() && i + edgeInNgramSize < bleu_order ; ++i) {
-            Phrase newNgram(edgeIncomingNgram);
-            for (size_t j = 0; j <= i ; ++j) {
-              newNgram.AddWord(GetWords().GetWord(j));
-            }
-            VERBOSE(3, "Inserting New Phrase : " << newNgram << endl)
-
-            for (PathCounts::const_iterator pathIt = edgeIncomingNgramPaths.begin(); pathIt !=  edgeIncomingNgramPaths.end(); ++pathIt) {
-              Path newNgramPath = pathIt->first;
-              newNgramPath.push_back(this);
-              storeNgramHistory(newNgram, newNgramPath, pathIt->second);
-            }
-          }
-        }
-      }
+  sort(ngrams.begin(), ngrams.end());
+  counts.clear();
+  for (size_t i = 0; i < ngrams.size(); ++i) {
+    if (counts.empty() || counts.back().first != ngrams[i]) {
+      counts.push_back(make_pair(ngrams[i], 0));
     }
+    ++counts.back().second;
   }
-  return m_ngrams;
 }
 
-//Add the last lastN words of origPhrase to targetPhrase
-void Edge::GetPhraseSuffix(const Phrase&  origPhrase, size_t lastN, Phrase& targetPhrase) const
+float FlatLattice::GetExpectedLength() const
 {
-  size_t origSize = origPhrase.GetSize();
-  size_t startIndex = origSize - lastN;
-  for (size_t index = startIndex; index < origPhrase.GetSize(); ++index) {
-    targetPhrase.AddWord(origPhrase.GetWord(index));
+  float length = 0.0f;
+  for (size_t ngram = 0; ngram < m_ngramScores.size(); ++ngram) {
+    if (m_ngramKnown[ngram] && m_ngramSize[ngram] == 1) {
+      length += exp(m_ngramScores[ngram]);
+    }
   }
-}
-
-bool Edge::operator< (const Edge& compare ) const
-{
-  if (m_headNode->GetId() < compare.m_headNode->GetId())
-    return true;
-  if (compare.m_headNode->GetId() < m_headNode->GetId())
-    return false;
-  if (m_tailNode->GetId() < compare.m_tailNode->GetId())
-    return true;
-  if (compare.m_tailNode->GetId() < m_tailNode->GetId())
-    return false;
-  return GetScore() <  compare.GetScore();
-}
-
-ostream& operator<< (ostream& out, const Edge& edge)
-{
-  out << "Head: " << edge.m_headNode->GetId() << ", Tail: " << edge.m_tailNode->GetId() << ", Score: " << edge.m_score << ", Phrase: " << edge.m_targetPhrase << endl;
-  return out;
-}
-
-bool ascendingCoverageCmp(const Hypothesis* a, const Hypothesis* b)
-{
-  return a->GetWordsBitmap().GetNumWordsCovered() <  b->GetWordsBitmap().GetNumWordsCovered();
+  return length;
 }
 
 void getLatticeMBRNBest(Manager& manager, TrellisPathList& nBestList,
                         vector<LatticeMBRSolution>& solutions, size_t n)
 {
   const StaticData& staticData = StaticData::Instance();
-  std::map < int, bool > connected;
-  std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramPosteriors;
-  std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
-  map<const Hypothesis*, vector<Edge> > incomingEdges;
-  vector< float> estimatedScores;
-  manager.GetForwardBackwardSearchGraph(&connected, &connectedList, &outgoingHyps, &estimatedScores);
-  pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores, manager.GetBestHypothesis(), staticData.GetLatticeMBRPruningFactor(),staticData.GetMBRScale());
-  calcNgramExpectations(connectedList, incomingEdges, ngramPosteriors,true);
+  FlatLattice lattice(manager, staticData.GetLatticeMBRPruningFactor(), staticData.GetMBRScale());
+  lattice.CalcNgramExpectations(true);
 
   vector<float> mbrThetas = staticData.GetLatticeMBRThetas();
   float p = staticData.GetLatticeMBRPrecision();
@@ -538,7 +503,7 @@ void getLatticeMBRNBest(Manager& manager, TrellisPathList& nBestList,
   for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter, ++ctr) {
     const TrellisPath &path = **iter;
     solutions.push_back(LatticeMBRSolution(path,iter==nBestList.begin()));
-    solutions.back().CalcScore(ngramPosteriors,mbrThetas,mapWeight);
+    solutions.back().CalcScore(lattice,mbrThetas,mapWeight);
     sort(solutions.begin(), solutions.end(), comparator);
     while (solutions.size() > n) {
       solutions.pop_back();
@@ -562,28 +527,11 @@ const TrellisPath doConsensusDecoding(Manager& manager, TrellisPathList& nBestLi
 
   //calculate the ngram expectations
   const StaticData& staticData = StaticData::Instance();
-  std::map < int, bool > connected;
-  std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramExpectations;
-  std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
-  map<const Hypothesis*, vector<Edge> > incomingEdges;
-  vector< float> estimatedScores;
-  manager.GetForwardBackwardSearchGraph(&connected, &connectedList, &outgoingHyps, &estimatedScores);
-  pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores, manager.GetBestHypothesis(), staticData.GetLatticeMBRPruningFactor(),staticData.GetMBRScale());
-  calcNgramExpectations(connectedList, incomingEdges, ngramExpectations,false);
+  FlatLattice lattice(manager, staticData.GetLatticeMBRPruningFactor(), staticData.GetMBRScale());
+  lattice.CalcNgramExpectations(false);
 
   //expected length is sum of expected unigram counts
-  //cerr << "Thread " << pthread_self() <<  " Ngram expectations size: " << ngramExpectations.size() << endl;
-  float ref_length = 0.0f;
-  for (map<Phrase,float>::const_iterator ref_iter = ngramExpectations.begin();
-       ref_iter != ngramExpectations.end(); ++ref_iter) {
-    //cerr << "Ngram: " << ref_iter->first << " score: " <<
-    //    ref_iter->second << endl;
-    if (ref_iter->first.GetSize() == 1) {
-      ref_length += exp(ref_iter->second);
-      //    cerr << "Expected for " << ref_iter->first << " is " << exp(ref_iter->second) << endl;
-    }
-  }
+  float ref_length = lattice.GetExpectedLength();
 
   VERBOSE(2,"REF Length: " << ref_length << endl);
 
@@ -595,14 +543,9 @@ const TrellisPath doConsensusDecoding(Manager& manager, TrellisPathList& nBestLi
   for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
     const TrellisPath &path = **iter;
     vector<Word> words;
-    map<Phrase,int> ngrams;
+    vector<pair<size_t, size_t> > ngrams;
     GetOutputWords(path,words);
-    /*for (size_t i = 0; i < words.size(); ++i) {
-        cerr << words[i].GetFactor(0)->GetString() << " ";
-    }
-    cerr << endl;
-    */
-    extract_ngrams(words,ngrams);
+    lattice.GetNgramCounts(words,ngrams);
 
     vector<float> comps(2*BLEU_ORDER+1);
     float logbleu = 0.0;
@@ -613,13 +556,11 @@ const TrellisPath doConsensusDecoding(Manager& manager, TrellisPathList& nBestLi
       comps[2*i+1] = max(hyp_length-i,0);
     }
 
-    for (map<Phrase,int>::const_iterator hyp_iter = ngrams.begin();
-         hyp_iter != ngrams.end(); ++hyp_iter) {
-      map<Phrase,float>::const_iterator ref_iter = ngramExpectations.find(hyp_iter->first);
-      if (ref_iter != ngramExpectations.end()) {
-        comps[2*(hyp_iter->first.GetSize()-1)] += min(exp(ref_iter->second), (float)(hyp_iter->second));
+    for (size_t i = 0; i < ngrams.size(); ++i) {
+      float expectation;
+      if (lattice.GetNgramScore(ngrams[i].first, expectation)) {
+        comps[2*(lattice.GetNgramSize(ngrams[i].first)-1)] += min(exp(expectation), (float)(ngrams[i].second));
       }
-
     }
     comps[comps.size()-1] = ref_length;
     /*for (size_t i = 0; i < comps.size(); ++i) {
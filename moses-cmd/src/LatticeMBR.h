@@ -13,6 +13,8 @@
 #include <map>
 #include <vector>
 #include <set>
+#include <utility>
+#include <boost/unordered_map.hpp>
 #include "Hypothesis.h"
 #include "Manager.h"
 #include "TrellisPathList.h"
@@ -22,81 +24,7 @@
 namespace MosesCmd
 {
 
-class Edge;
-
-typedef std::vector< const Moses::Hypothesis *> Lattice;
-typedef std::vector<const Edge*> Path;
-typedef std::map<Path, size_t> PathCounts;
-typedef std::map<Moses::Phrase, PathCounts > NgramHistory;
-
-class Edge
-{
-  const Moses::Hypothesis* m_tailNode;
-  const Moses::Hypothesis* m_headNode;
-  float m_score;
-  Moses::TargetPhrase m_targetPhrase;
-  NgramHistory m_ngrams;
-
-public:
-  Edge(const Moses::Hypothesis* from, const Moses::Hypothesis* to, float score, const Moses::TargetPhrase& targetPhrase) : m_tailNode(from), m_headNode(to), m_score(score), m_targetPhrase(targetPhrase) {
-    //cout << "Creating new edge from Node " << from->GetId() << ", to Node : " << to->GetId() << ", score: " << score << " phrase: " << targetPhrase << endl;
-  }
-
-  const Moses::Hypothesis* GetHeadNode() const {
-    return m_headNode;
-  }
-
-  const Moses::Hypothesis* GetTailNode() const {
-    return m_tailNode;
-  }
-
-  float GetScore() const {
-    return m_score;
-  }
-
-  size_t GetWordsSize() const {
-    return m_targetPhrase.GetSize();
-  }
-
-  const Moses::Phrase& GetWords() const {
-    return m_targetPhrase;
-  }
-
-  friend std::ostream& operator<< (std::ostream& out, const Edge& edge);
-
-  const NgramHistory&  GetNgrams(  std::map<const Moses::Hypothesis*, std::vector<Edge> > & incomingEdges) ;
-
-  bool operator < (const Edge & compare) const;
-
-  void GetPhraseSuffix(const Moses::Phrase& origPhrase, size_t lastN, Moses::Phrase& targetPhrase) const;
-
-  void storeNgramHistory(const Moses::Phrase& phrase, Path & path, size_t count = 1) {
-    m_ngrams[phrase][path]+= count;
-  }
-
-};
-
-/**
-* Data structure to hold the ngram scores as we traverse the lattice. Maps (hypo,ngram) to score
-*/
-class NgramScores
-{
-public:
-  NgramScores() {}
-
-  /** logsum this score to the existing score */
-  void addScore(const Moses::Hypothesis* node, const Moses::Phrase& ngram, float score);
-
-  /** Iterate through ngrams for selected node */
-  typedef std::map<const Moses::Phrase*, float>::const_iterator NodeScoreIterator;
-  NodeScoreIterator nodeBegin(const Moses::Hypothesis* node);
-  NodeScoreIterator nodeEnd(const Moses::Hypothesis* node);
-
-private:
-  std::set<Moses::Phrase> m_ngrams;
-  std::map<const Moses::Hypothesis*, std::map<const Moses::Phrase*, float> > m_scores;
-};
-
+class FlatLattice;
 
 /** Holds a lattice mbr solution, and its scores */
 class LatticeMBRSolution
@@ -118,7 +46,7 @@ public:
   }
 
   /** Initialise ngram scores */
-  void CalcScore(std::map<Moses::Phrase, float>& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
+  void CalcScore(FlatLattice& lattice, const std::vector<float>& thetas, float mapWeight);
 
 private:
   std::vector<Moses::Word> m_words;
@@ -127,23 +55,109 @@ private:
   float m_score;
 };
 
+/**
+* Pruned lattice held in flat arrays, used for lattice MBR and consensus decoding.
+* Nodes are kept in topological order with their incoming edges stored
+* contiguously, and n-grams are interned to integer ids through a
+* (prefix id, word id) hash table, so no Phrase is ever copied or compared.
+*/
+class FlatLattice
+{
+public:
+  /** Prune the search graph of manager to edgeDensity edges per target word */
+  FlatLattice(Moses::Manager& manager, size_t edgeDensity, float scale);
+
+  /** Calculate expected ngram counts, clipping at 1 (ie calculating posteriors) if posteriors==true */
+  void CalcNgramExpectations(bool posteriors);
+
+  /** Count the distinct ngrams of sentence as (ngram id, count) pairs */
+  void GetNgramCounts(const std::vector<Moses::Word>& sentence, std::vector<std::pair<size_t, size_t> >& counts);
+
+  /** log posterior/expectation of ngram, false if it does not occur in the lattice */
+  bool GetNgramScore(size_t ngram, float& score) const {
+    if (ngram >= m_ngramKnown.size() || !m_ngramKnown[ngram]) return false;
+    score = m_ngramScores[ngram];
+    return true;
+  }
+  size_t GetNgramSize(size_t ngram) const {
+    return m_ngramSize[ngram];
+  }
+  /** expected length, ie. sum of the expected unigram counts */
+  float GetExpectedLength() const;
+
+  size_t GetNumNodes() const {
+    return m_nodes.size();
+  }
+  size_t GetNumEdges() const {
+    return m_edges.size();
+  }
+
+private:
+  struct FlatEdge {
+    size_t tail;
+    float score;
+    size_t wordsBegin, wordsEnd;
+  };
+  /** An ngram ending on an edge, together with the path of edges that produced it */
+  struct NgramEntry {
+    size_t ngram;
+    size_t path;
+    size_t count;
+    float score; //! forward score of the path's first node plus its edge scores
+    bool atEnd; //! ngram ends at the last word of the edge
+  };
+  struct WordHasher {
+    size_t operator()(const Moses::Word& word) const;
+  };
+  struct WordEqual {
+    bool operator()(const Moses::Word& a, const Moses::Word& b) const {
+      return a == b;
+    }
+  };
+  typedef std::pair<size_t, size_t> IdPair;
+
+  size_t GetWordId(const Moses::Word& word);
+  size_t ExtendNgram(size_t prefix, size_t word);
+  size_t GetPathId(size_t prefix, size_t edge);
+  bool EndsWith(size_t ngram, size_t edge) const;
+  void BuildHistory(size_t edge);
+  void AddScore(size_t ngram, float score);
+
+  // lattice
+  std::vector<const Moses::Hypothesis*> m_nodes;
+  std::vector<size_t> m_edgesBegin; //! incoming edges of node i are [m_edgesBegin[i], m_edgesBegin[i+1])
+  std::vector<FlatEdge> m_edges;
+  std::vector<size_t> m_edgeWords;
+
+  // interned words, ngrams and edge paths
+  boost::unordered_map<Moses::Word, size_t, WordHasher, WordEqual> m_wordIds;
+  boost::unordered_map<IdPair, size_t> m_ngramIds;
+  std::vector<size_t> m_ngramSize;
+  std::vector<size_t> m_ngramWords; //! bleu_order words per ngram
+  boost::unordered_map<IdPair, size_t> m_pathIds;
+
+  // forward pass
+  std::vector<float> m_alpha;
+  std::vector<size_t> m_historyBegin; //! ngrams introduced by edge i are [m_historyBegin[i], m_historyBegin[i+1])
+  std::vector<NgramEntry> m_history;
+  std::vector<size_t> m_nodeScoresBegin; //! ngram scores of node i are [m_nodeScoresBegin[i], m_nodeScoresBegin[i+1])
+  std::vector<std::pair<size_t, float> > m_nodeScores;
+  std::vector<int> m_slot; //! position of an ngram in the current node's scores, or -1
+
+  // result
+  std::vector<float> m_ngramScores;
+  std::vector<bool> m_ngramKnown;
+};
+
 struct LatticeMBRSolutionComparator {
   bool operator()(const LatticeMBRSolution& a, const LatticeMBRSolution& b) {
     return a.GetScore() > b.GetScore();
   }
 };
 
-void pruneLatticeFB(Lattice & connectedHyp, std::map < const Moses::Hypothesis*, std::set <const Moses::Hypothesis* > > & outgoingHyps, std::map<const Moses::Hypothesis*, std::vector<Edge> >& incomingEdges,
-                    const std::vector< float> & estimatedScores, const Moses::Hypothesis*, size_t edgeDensity,float scale);
-
 //Use the ngram scores to rerank the nbest list, return at most n solutions
 void getLatticeMBRNBest(Moses::Manager& manager, Moses::TrellisPathList& nBestList, std::vector<LatticeMBRSolution>& solutions, size_t n);
-//calculate expectated ngram counts, clipping at 1 (ie calculating posteriors) if posteriors==true.
-void calcNgramExpectations(Lattice & connectedHyp, std::map<const Moses::Hypothesis*, std::vector<Edge> >& incomingEdges, std::map<Moses::Phrase,
-                           float>& finalNgramScores, bool posteriors);
 void GetOutputFactors(const Moses::TrellisPath &path, std::vector <Moses::Word> &translation);
-void extract_ngrams(const std::vector<Moses::Word >& sentence, std::map < Moses::Phrase, int >  & allngrams);
-bool ascendingCoverageCmp(const Moses::Hypothesis* a, const Moses::Hypothesis* b);
 std::vector<Moses::Word> doLatticeMBR(Moses::Manager& manager, Moses::TrellisPathList& nBestList);
 const Moses::TrellisPath doConsensusDecoding(Moses::Manager& manager, Moses::TrellisPathList& nBestList);
 //std::vector<Moses::Word> doConsensusDecoding(Moses::Manager& manager, Moses::TrellisPathList& nBestList);
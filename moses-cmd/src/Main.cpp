@@ -64,6 +64,31 @@ void fix(std::ostream& stream, size_t size)
   stream.precision(size);
 }
 
+/** Writes binary search graphs (-osgb) straight to their stream.
+  * Records carry their translation id and are written in the order the
+  * sentences finish, so they never have to be held in memory as a whole.
+  **/
+class SearchGraphBinaryOutput
+{
+public:
+  explicit SearchGraphBinaryOutput(std::ostream *out) : m_out(out) {}
+
+  void Write(const Manager &manager, long translationId) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    manager.OutputSearchGraphBinary(translationId, *m_out);
+    // main exits without closing the stream
+    *m_out << std::flush;
+  }
+
+private:
+  std::ostream *m_out;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+};
+
 /** Translates a sentence.
   * - calls the search (Manager)
   * - applies the decision rule
@@ -79,25 +104,53 @@ public:
                   OutputCollector* latticeSamplesCollector,
                   OutputCollector* wordGraphCollector, OutputCollector* searchGraphCollector,
                   OutputCollector* detailedTranslationCollector,
-                  OutputCollector* alignmentInfoCollector ) :
+                  OutputCollector* alignmentInfoCollector,
+                  SearchGraphBinaryOutput* searchGraphBinary ) :
     m_source(source), m_lineNumber(lineNumber),
     m_outputCollector(outputCollector), m_nbestCollector(nbestCollector),
     m_latticeSamplesCollector(latticeSamplesCollector),
     m_wordGraphCollector(wordGraphCollector), m_searchGraphCollector(searchGraphCollector),
+    m_searchGraphBinary(searchGraphBinary),
     m_detailedTranslationCollector(detailedTranslationCollector),
-    m_alignmentInfoCollector(alignmentInfoCollector) {}
+    m_alignmentInfoCollector(alignmentInfoCollector), m_translationIds(NULL) {}
+
+  /** Parse the input from line in Run, on the decoding thread, instead of
+   * taking a parsed source.  ids numbers the inputs in input order. */
+  void SetInputLine(const std::string &line, TranslationIdSequencer *ids) {
+    m_line = line;
+    m_translationIds = ids;
+  }
 
 	/** Translate one sentence
    * gets called by main function implemented at end of this source file */
   void Run() {
 
+    // shorthand for "global data"
+    const StaticData &staticData = StaticData::Instance();
+
+    if (m_translationIds) {
+      try {
+        m_source = ParseInputLine(staticData.GetInputType(), m_line, staticData.GetInputFactorOrder());
+      } catch (const std::exception &e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      m_translationIds->Assign(m_lineNumber, m_source);
+      if (!m_source) {
+        // a complete line that does not parse still takes its place in the
+        // output; an incomplete last line is ignored, as ReadInput would
+        if (!m_line.empty() && m_line[m_line.size() - 1] == '\n') {
+          TRACE_ERR("WARNING: could not parse input line " << m_lineNumber << ", writing an empty translation" << std::endl);
+          WriteEmptyOutput();
+        }
+        return;
+      }
+    }
+
     // report thread number
 #ifdef BOOST_HAS_PTHREADS
     TRACE_ERR("Translating line " << m_lineNumber << "  in thread id " << pthread_self() << std::endl);
 #endif
-
-    // shorthand for "global data"
-    const StaticData &staticData = StaticData::Instance();
     // input sentence
     Sentence sentence();
     // set translation system
@@ -118,11 +171,16 @@ public:
     }
 
     // output search graph
+    if (m_searchGraphBinary) {
+      m_searchGraphBinary->Write(manager, m_lineNumber);
+    }
     if (m_searchGraphCollector) {
       ostringstream out;
       fix(out,PRECISION);
       manager.OutputSearchGraph(m_lineNumber, out);
       m_searchGraphCollector->Write(m_lineNumber, out.str());
+    }
+    if (m_searchGraphCollector || m_searchGraphBinary) {
 
 #ifdef HAVE_PROTOBUF
       if (staticData.GetOutputSearchGraphPB()) {
@@ -277,6 +335,18 @@ public:
   }
 
 private:
+  /** Write empty results for a line without a translation, so the
+   * collectors do not wait for it.  The binary search graph gets nothing. */
+  void WriteEmptyOutput() {
+    if (m_outputCollector) m_outputCollector->Write(m_lineNumber, "\n");
+    if (m_nbestCollector) m_nbestCollector->Write(m_lineNumber, "");
+    if (m_latticeSamplesCollector) m_latticeSamplesCollector->Write(m_lineNumber, "");
+    if (m_wordGraphCollector) m_wordGraphCollector->Write(m_lineNumber, "");
+    if (m_searchGraphCollector) m_searchGraphCollector->Write(m_lineNumber, "");
+    if (m_detailedTranslationCollector) m_detailedTranslationCollector->Write(m_lineNumber, "");
+    if (m_alignmentInfoCollector) m_alignmentInfoCollector->Write(m_lineNumber, "\n");
+  }
+
   InputType* m_source;
   size_t m_lineNumber;
   OutputCollector* m_outputCollector;
@@ -284,9 +354,12 @@ private:
   OutputCollector* m_latticeSamplesCollector;
   OutputCollector* m_wordGraphCollector;
   OutputCollector* m_searchGraphCollector;
+  SearchGraphBinaryOutput* m_searchGraphBinary;
   OutputCollector* m_detailedTranslationCollector;
   OutputCollector* m_alignmentInfoCollector;
   std::ofstream *m_alignmentStream;
+  std::string m_line;
+  TranslationIdSequencer *m_translationIds;
 
 
 };
@@ -402,6 +475,11 @@ int main(int argc, char** argv)
     // initialize output streams
     // note: we can't just write to STDOUT or files
     // because multithreading may return sentences in shuffled order
+    // finished sentences may run at most outputWindow ahead of the next one
+    // to be printed, so one slow sentence cannot make memory grow without
+    // bound.  The alignment collector is not limited because sentences
+    // without a translation never write to it.
+    const size_t outputWindow = 8 * staticData.ThreadCount();
     auto_ptr<OutputCollector> outputCollector; // for translations
     auto_ptr<OutputCollector> nbestCollector;  // for n-best lists
     auto_ptr<OutputCollector> latticeSamplesCollector; //for lattice samples
@@ -413,7 +491,7 @@ int main(int argc, char** argv)
     if (nbestSize) {
       if (nbestFile == "-" || nbestFile == "/dev/stdout") {
         // nbest to stdout, no 1-best
-        nbestCollector.reset(new OutputCollector());
+        nbestCollector.reset(new OutputCollector(&std::cout, &std::cerr, outputWindow));
         output1best = false;
       } else {
         // nbest to file, 1-best to stdout
@@ -422,14 +500,14 @@ int main(int argc, char** argv)
           TRACE_ERR("ERROR: Failed to open " << nbestFile << " for nbest lists" << endl);
           exit(1);
         }
-        nbestCollector.reset(new OutputCollector(nbestOut.get()));
+        nbestCollector.reset(new OutputCollector(nbestOut.get(), &std::cerr, outputWindow));
       }
     }
     size_t latticeSamplesSize = staticData.GetLatticeSamplesSize();
     string latticeSamplesFile = staticData.GetLatticeSamplesFilePath();
     if (latticeSamplesSize) {
       if (latticeSamplesFile == "-" || latticeSamplesFile == "/dev/stdout") {
-        latticeSamplesCollector.reset(new OutputCollector());
+        latticeSamplesCollector.reset(new OutputCollector(&std::cout, &std::cerr, outputWindow));
         output1best = false;
       } else {
         latticeSamplesOut.reset(new ofstream(latticeSamplesFile.c_str()));
@@ -437,30 +515,33 @@ int main(int argc, char** argv)
           TRACE_ERR("ERROR: Failed to open " << latticeSamplesFile << " for lattice samples" << endl);
           exit(1);
         }
-        latticeSamplesCollector.reset(new OutputCollector(latticeSamplesOut.get()));
+        latticeSamplesCollector.reset(new OutputCollector(latticeSamplesOut.get(), &std::cerr, outputWindow));
       }
     }
     if (output1best) {
-      outputCollector.reset(new OutputCollector());
+      outputCollector.reset(new OutputCollector(&std::cout, &std::cerr, outputWindow));
     }
   
     // initialize stream for word graph (aka: output lattice)
     auto_ptr<OutputCollector> wordGraphCollector;
     if (staticData.GetOutputWordGraph()) {
-      wordGraphCollector.reset(new OutputCollector(&(ioWrapper->GetOutputWordGraphStream())));
+      wordGraphCollector.reset(new OutputCollector(&(ioWrapper->GetOutputWordGraphStream()), &std::cerr, outputWindow));
     }
   
     // initialize stream for search graph
     // note: this is essentially the same as above, but in a different format
     auto_ptr<OutputCollector> searchGraphCollector;
-    if (staticData.GetOutputSearchGraph()) {
-      searchGraphCollector.reset(new OutputCollector(&(ioWrapper->GetOutputSearchGraphStream())));
+    auto_ptr<SearchGraphBinaryOutput> searchGraphBinary;
+    if (staticData.GetOutputSearchGraphBinary()) {
+      searchGraphBinary.reset(new SearchGraphBinaryOutput(&(ioWrapper->GetOutputSearchGraphStream())));
+    } else if (staticData.GetOutputSearchGraph()) {
+      searchGraphCollector.reset(new OutputCollector(&(ioWrapper->GetOutputSearchGraphStream()), &std::cerr, outputWindow));
     }
   
     // initialize stram for details about the decoder run
     auto_ptr<OutputCollector> detailedTranslationCollector;
     if (staticData.IsDetailedTranslationReportingEnabled()) {
-      detailedTranslationCollector.reset(new OutputCollector(&(ioWrapper->GetDetailedTranslationReportingStream())));
+      detailedTranslationCollector.reset(new OutputCollector(&(ioWrapper->GetDetailedTranslationReportingStream()), &std::cerr, outputWindow));
     }
   
     // initialize stram for word alignment between input and output
@@ -469,14 +550,23 @@ int main(int argc, char** argv)
       alignmentInfoCollector.reset(new OutputCollector(ioWrapper->GetAlignmentOutputStream()));
     }
   
+    // outlives the pool, whose tasks use it
+    TranslationIdSequencer translationIds(0);
+
 #ifdef WITH_THREADS
     ThreadPool pool(staticData.ThreadCount());
+    // stop reading input while enough sentences wait for a thread
+    pool.SetQueueLimit(2 * staticData.ThreadCount());
 #endif
   
     // main loop over set of input sentences
+    // inputs of one line each are only read here and parsed by the tasks,
+    // so markup processing and factor interning run on the decoding threads
     InputType* source = NULL;
     size_t lineCount = 0;
-    while(ReadInput(*ioWrapper,staticData.GetInputType(),source)) {
+    const bool lineInput = IsLineInput(staticData.GetInputType());
+    string line;
+    while(lineInput ? ioWrapper->GetInputLine(line) : ReadInput(*ioWrapper,staticData.GetInputType(),source)) {
       IFVERBOSE(1) {
         ResetUserTime();
       }
@@ -488,7 +578,9 @@ int main(int argc, char** argv)
                             wordGraphCollector.get(),
                             searchGraphCollector.get(),
                             detailedTranslationCollector.get(),
-                            alignmentInfoCollector.get() );
+                            alignmentInfoCollector.get(),
+                            searchGraphBinary.get() );
+      if (lineInput) task->SetInputLine(line, &translationIds);
       // execute task
 #ifdef WITH_THREADS
     pool.Submit(task);
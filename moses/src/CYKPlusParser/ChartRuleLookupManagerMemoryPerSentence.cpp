@@ -31,6 +31,20 @@
 namespace Moses
 {
 
+namespace
+{
+//! whether the (usually tiny) label set contains the label with this factor id
+bool ContainsLabel(const NonTerminalSet &labels, UINT64 key)
+{
+  for (NonTerminalSet::const_iterator p = labels.begin(); p != labels.end(); ++p) {
+    if (NonTerminalKey(*p) == key) {
+      return true;
+    }
+  }
+  return false;
+}
+}
+
 ChartRuleLookupManagerMemoryPerSentence::ChartRuleLookupManagerMemoryPerSentence(
   const InputType &src,
   const ChartCellCollection &cellColl,
@@ -222,7 +236,7 @@ void ChartRuleLookupManagerMemoryPerSentence::ExtendPartialRuleApplication(
       ChartCellLabelSet::const_iterator q = targetNonTerms.begin();
       ChartCellLabelSet::const_iterator tEnd = targetNonTerms.end();
       for (; q != tEnd; ++q) {
-        const ChartCellLabel &cellLabel = q->second;
+        const ChartCellLabel &cellLabel = *q;
 
         // try to match both source and target non-terminal
         const PhraseDictionaryNodeSCFG * child =
@@ -253,19 +267,18 @@ void ChartRuleLookupManagerMemoryPerSentence::ExtendPartialRuleApplication(
       nonTermMap.end();
     for (p = nonTermMap.begin(); p != end; ++p) {
       // does it match possible source and target non-terminals?
-      const PhraseDictionaryNodeSCFG::NonTerminalMapKey &key = p->first;
-      const Word &sourceNonTerm = key.first;
-      if (sourceNonTerms.find(sourceNonTerm) == sourceNonTerms.end()) {
+      // (the key holds the factor ids of both labels)
+      const UINT64 key = p->first;
+      const ChartCellLabel *cellLabel = targetNonTerms.FindByKey(key & 0xffffffff);
+      if (!cellLabel) {
         continue;
       }
-      const Word &targetNonTerm = key.second;
-      const ChartCellLabel *cellLabel = targetNonTerms.Find(targetNonTerm);
-      if (!cellLabel) {
+      if (!ContainsLabel(sourceNonTerms, key >> 32)) {
         continue;
       }
 
       // create new rule
-      const PhraseDictionaryNodeSCFG &child = p->second;
+      const PhraseDictionaryNodeSCFG &child = *p->second;
 #ifdef USE_BOOST_POOL
       DottedRuleInMemory *rule = m_dottedRulePool.malloc();
       new (rule) DottedRuleInMemory(child, *cellLabel, prevDottedRule);
@@ -31,6 +31,7 @@
 #include "ChartTranslationOption.h"
 #include "ChartTranslationOptionList.h"
 #include "ChartManager.h"
+#include "util/usage.hh"
 
 using namespace std;
 
@@ -47,6 +48,9 @@ ChartCell::ChartCell(size_t startPos, size_t endPos, ChartManager &manager)
   ,m_sourceWordLabel(NULL)
   ,m_targetLabelSet(m_coverage)
   ,m_manager(manager)
+  ,m_numPops(0)
+  ,m_decodingTime(0)
+  ,m_outOfTime(false)
 {
   const StaticData &staticData = StaticData::Instance();
   m_nBestIsEnabled = staticData.IsNBestEnabled();
@@ -86,11 +90,16 @@ void ChartCell::PruneToSize()
  *  (implementation of cube pruning)
  * \param transOptList list of applicable rules to create hypotheses for the cell
  * \param allChartCells entire chart - needed to look up underlying hypotheses
+ * \param deadline util::WallTime() at which to stop popping, or 0 for no deadline.
+ *        The clock is only read every few pops, so a few hypotheses are
+ *        always created
  */
 void ChartCell::ProcessSentence(const ChartTranslationOptionList &transOptList
-                                , const ChartCellCollection &allChartCells)
+                                , const ChartCellCollection &allChartCells
+                                , double deadline)
 {
   const StaticData &staticData = StaticData::Instance();
+  const double start = util::WallTime();
 
   // priority queue for applicable rules with selected hypotheses
   RuleCubeQueue queue(m_manager);
@@ -104,11 +113,18 @@ void ChartCell::ProcessSentence(const ChartTranslationOptionList &transOptList
 
   // pluck things out of queue and add to hypo collection
   const size_t popLimit = staticData.GetCubePruningPopLimit();
-  for (size_t numPops = 0; numPops < popLimit && !queue.IsEmpty(); ++numPops) 
+  const size_t timeCheckInterval = 16;
+  for (m_numPops = 0; m_numPops < popLimit && !queue.IsEmpty(); ++m_numPops)
   {
+    if (deadline && m_numPops && m_numPops % timeCheckInterval == 0 && util::WallTime() > deadline) {
+      m_outOfTime = true;
+      break;
+    }
     ChartHypothesis *hypo = queue.Pop();
     AddHypothesis(hypo);
   }
+
+  m_decodingTime = util::WallTime() - start;
 }
 
 //! call SortHypotheses() in each hypo collection in this cell
@@ -71,12 +71,30 @@ protected:
   bool m_nBestIsEnabled; /**< flag to determine whether to keep track of old arcs */
   ChartManager &m_manager;
 
+  size_t m_numPops; /**< cube pruning statistics */
+  float m_decodingTime;
+  bool m_outOfTime;
+
 public:
   ChartCell(size_t startPos, size_t endPos, ChartManager &manager);
   ~ChartCell();
 
   void ProcessSentence(const ChartTranslationOptionList &transOptList
-                       ,const ChartCellCollection &allChartCells);
+                       ,const ChartCellCollection &allChartCells
+                       ,double deadline = 0);
+
+  //! number of hypotheses popped from the cube pruning queue
+  size_t GetNumPops() const {
+    return m_numPops;
+  }
+  //! wall-clock seconds spent in cube pruning
+  float GetDecodingTime() const {
+    return m_decodingTime;
+  }
+  //! whether cube pruning stopped at the deadline rather than the pop limit
+  bool IsOutOfTime() const {
+    return m_outOfTime;
+  }
 
   //! Get all hypotheses in the cell that have the specified constituent label
   const HypoList *GetSortedHypotheses(const Word &constituentLabel) const
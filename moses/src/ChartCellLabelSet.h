@@ -20,62 +20,68 @@
 #pragma once
 
 #include "ChartCellLabel.h"
+#include "FactorIdMap.h"
 #include "NonTerminal.h"
 
-#include <boost/functional/hash.hpp>
-#include <boost/unordered_map.hpp>
-#include <boost/version.hpp>
+#include <deque>
 
 namespace Moses
 {
 
 class ChartHypothesisCollection;
 
-/** @todo I have no idea what's in here
+/** The set of constituent labels of one chart cell, each with its stack of
+ * hypotheses.  Labels are kept in insertion order and indexed by the factor
+ * id of their label (factor 0, as for NonTerminalHasher).
  */
 class ChartCellLabelSet
 {
  private:
-#if defined(BOOST_VERSION) && (BOOST_VERSION >= 104200)
-  typedef boost::unordered_map<Word, ChartCellLabel,
-                               NonTerminalHasher, NonTerminalEqualityPred
-                              > MapType;
-#else
-  typedef std::map<Word, ChartCellLabel> MapType;
-#endif
+  typedef std::deque<ChartCellLabel> LabelList;
 
  public:
-  typedef MapType::const_iterator const_iterator;
+  typedef LabelList::const_iterator const_iterator;
 
   ChartCellLabelSet(const WordsRange &coverage) : m_coverage(coverage) {}
 
-  const_iterator begin() const { return m_map.begin(); }
-  const_iterator end() const { return m_map.end(); }
+  const_iterator begin() const { return m_labels.begin(); }
+  const_iterator end() const { return m_labels.end(); }
 
   void AddWord(const Word &w)
   {
-    m_map.insert(std::make_pair(w, ChartCellLabel(m_coverage, w)));
+    if (m_index.Insert(NonTerminalKey(w), m_labels.size()).second) {
+      m_labels.push_back(ChartCellLabel(m_coverage, w));
+    }
   }
 
   void AddConstituent(const Word &w, const ChartHypothesisCollection &coll)
   {
-    const HypoList *stack = &(coll.GetSortedHypotheses());
-    m_map.insert(std::make_pair(w, ChartCellLabel(m_coverage, w, stack)));
+    if (m_index.Insert(NonTerminalKey(w), m_labels.size()).second) {
+      const HypoList *stack = &(coll.GetSortedHypotheses());
+      m_labels.push_back(ChartCellLabel(m_coverage, w, stack));
+    }
   }
 
-  bool Empty() const { return m_map.empty(); }
+  bool Empty() const { return m_labels.empty(); }
 
-  size_t GetSize() const { return m_map.size(); }
+  size_t GetSize() const { return m_labels.size(); }
 
   const ChartCellLabel *Find(const Word &w) const
   {
-    MapType::const_iterator p = m_map.find(w);
-    return p == m_map.end() ? 0 : &(p->second);
+    return FindByKey(NonTerminalKey(w));
+  }
+
+  //! \param key NonTerminalKey() of the label
+  const ChartCellLabel *FindByKey(UINT64 key) const
+  {
+    const size_t *index = m_index.Find(key);
+    return index == NULL ? 0 : &m_labels[*index];
   }
 
  private:
   const WordsRange &m_coverage;
-  MapType m_map;
+  LabelList m_labels;
+  FactorIdMap<size_t> m_index;
 };
 
 }
@@ -20,6 +20,7 @@
  ***********************************************************************/
 
 #include <stdio.h>
+#include <algorithm>
 #include "ChartManager.h"
 #include "ChartCell.h"
 #include "ChartHypothesis.h"
@@ -30,6 +31,7 @@
 #include "StaticData.h"
 #include "DecodeStep.h"
 #include "TreeInput.h"
+#include "util/usage.hh"
 
 using namespace std;
 using namespace Moses;
@@ -87,21 +89,40 @@ void ChartManager::ProcessSentence()
 
   AddXmlChartOptions();
 
+  // optional time budget for cube pruning. The time left is shared equally
+  // among the cells left, so cells that finish early leave more time for the
+  // (wider, more expensive) cells that follow
+  const size_t timeBudget = StaticData::Instance().GetCubePruningTimeBudget();
+  const double sentenceDeadline = timeBudget ? util::WallTime() + timeBudget / 1000.0 : 0;
+
   // MAIN LOOP
   size_t size = m_source.GetSize();
+  size_t cellsLeft = size * (size + 1) / 2;
   for (size_t width = 1; width <= size; ++width) {
     for (size_t startPos = 0; startPos <= size-width; ++startPos) {
       size_t endPos = startPos + width - 1;
       WordsRange range(startPos, endPos);
 
       // create trans opt
+      clock_t collectStart = clock();
       m_transOptColl.CreateTranslationOptionsForRange(range);
+      IFVERBOSE(2) {
+        GetSentenceStats().AddTimeCollectOpts(clock() - collectStart);
+      }
 
       // decode
       ChartCell &cell = m_hypoStackColl.Get(range);
 
+      double cellDeadline = 0;
+      if (timeBudget) {
+        const double now = util::WallTime();
+        cellDeadline = now + std::max(0.0, sentenceDeadline - now) / cellsLeft;
+      }
+      --cellsLeft;
+
       cell.ProcessSentence(m_transOptColl.GetTranslationOptionList()
-                           ,m_hypoStackColl);
+                           ,m_hypoStackColl
+                           ,cellDeadline);
       m_transOptColl.Clear();
       cell.PruneToSize();
       cell.CleanupArcList();
@@ -109,6 +130,8 @@ void ChartManager::ProcessSentence()
     }
   }
 
+  VERBOSE(2, "Rule lookup took " << GetSentenceStats().GetTimeCollectOpts() << " seconds" << endl);
+
   IFVERBOSE(1) {
 
     for (size_t startPos = 0; startPos < size; ++startPos) {
@@ -127,6 +150,49 @@ void ChartManager::ProcessSentence()
       }
       cerr << endl;
     }
+
+    OutputCubePruningStats(cerr);
+  }
+}
+
+/** report the number of pops and the time spent in cube pruning, in total
+ *  and (at verbosity 2) for each cell, laid out like the chart above
+ */
+void ChartManager::OutputCubePruningStats(std::ostream &out) const
+{
+  const size_t size = m_source.GetSize();
+  size_t totalPops = 0, cellsOutOfTime = 0;
+  float totalTime = 0;
+  for (size_t width = 1; width <= size; width++) {
+    for (size_t startPos = 0; startPos <= size-width; ++startPos) {
+      const ChartCell &cell = m_hypoStackColl.Get(WordsRange(startPos, startPos+width-1));
+      totalPops += cell.GetNumPops();
+      totalTime += cell.GetDecodingTime();
+      cellsOutOfTime += cell.IsOutOfTime();
+    }
+  }
+  out << "Cube pruning: " << totalPops << " pops in " << totalTime << " seconds, "
+      << cellsOutOfTime << " cells stopped by the time budget" << endl;
+
+  IFVERBOSE(2) {
+    for (size_t pass = 0; pass < 2; ++pass) {
+      out << (pass == 0 ? "pops per cell" : "milliseconds per cell") << endl;
+      for (size_t width = 1; width <= size; width++) {
+        for (size_t space = 0; space < width-1; space++) {
+          out << "  ";
+        }
+        for (size_t startPos = 0; startPos <= size-width; ++startPos) {
+          const ChartCell &cell = m_hypoStackColl.Get(WordsRange(startPos, startPos+width-1));
+          out.width(3);
+          if (pass == 0) {
+            out << cell.GetNumPops() << (cell.IsOutOfTime() ? "*" : " ");
+          } else {
+            out << static_cast<size_t>(cell.GetDecodingTime() * 1000 + 0.5) << " ";
+          }
+        }
+        out << endl;
+      }
+    }
   }
 }
 
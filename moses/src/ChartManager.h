@@ -67,6 +67,7 @@ public:
   ChartManager(InputType const& source, const TranslationSystem* system);
   ~ChartManager();
   void ProcessSentence();
+  void OutputCubePruningStats(std::ostream &out) const;
   void AddXmlChartOptions();
   const ChartHypothesis *GetBestHypothesis() const;
   void CalcNBest(size_t count, ChartTrellisPathList &ret, bool onlyDistinct=0) const;
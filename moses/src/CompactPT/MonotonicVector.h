@@ -37,10 +37,20 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "ListCoders.h"
 #include "MmapAllocator.h"
+#include "util/mmap.hh"
 
 namespace Moses
 {
 
+// Arrays read into memory are looked up at random, so large ones are advised
+// for huge pages. Small ones already fit the TLB and are left alone.
+inline void AdviseHugePagesIfLarge(void* start, size_t size)
+{
+  static const size_t minSize = 64 * 1024 * 1024;
+  if(size >= minSize)
+    util::AdviseHugePages(start, size);
+}
+
 template<typename PosT = size_t, typename NumT = size_t, PosT stepSize = 32,
 template <typename> class Allocator = std::allocator>
 class MonotonicVector
@@ -173,6 +183,8 @@ class MonotonicVector
       
       v.resize(valSize, 0);
       byteSize += std::fread(&v[0], sizeof(ValueT), valSize, in) * sizeof(ValueT);
+      if(valSize)
+        AdviseHugePagesIfLarge(&v[0], valSize * sizeof(ValueT));
     
       return byteSize;
     }
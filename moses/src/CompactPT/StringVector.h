@@ -217,6 +217,8 @@ class StringVector
       
       c.resize(valSize, 0);
       byteSize += std::fread(&c[0], sizeof(ValueT), valSize, in) * sizeof(ValueT);
+      if(valSize)
+        AdviseHugePagesIfLarge(&c[0], valSize * sizeof(ValueT));
     
       return byteSize;
     }
@@ -50,10 +50,10 @@ TranslationOption *DecodeStepGeneration::MergeGeneration(const TranslationOption
 }
 
 // helpers
-typedef pair<Word, ScoreComponentCollection> WordPair;
+typedef pair<const Word*, const float*> WordPair;
 typedef list< WordPair > WordList;
 // 1st = word
-// 2nd = score
+// 2nd = scores, one for each component of the generation dictionary
 typedef list< WordPair >::const_iterator WordListIterator;
 
 /** used in generation: increases iterators when looping through the exponential number of generation expansions */
@@ -107,20 +107,17 @@ void DecodeStepGeneration::Process(const TranslationSystem* system
     const Word &word = targetPhrase.GetWord(currPos);
 
     // consult dictionary for possible generations for this word
-    const OutputWordCollection *wordColl = generationDictionary->FindWord(word);
+    OutputWordCollection wordColl;
 
-    if (wordColl == NULL) {
+    if (!generationDictionary->FindWord(word, wordColl)) {
       // word not found in generation dictionary
       //toc->ProcessUnknownWord(sourceWordsRange.GetStartPos(), factorCollection);
       return; // can't be part of a phrase, special handling
     } else {
       // sort(*wordColl, CompareWordCollScore);
-      OutputWordCollection::const_iterator iterWordColl;
-      for (iterWordColl = wordColl->begin() ; iterWordColl != wordColl->end(); ++iterWordColl) {
-        const Word &outputWord = (*iterWordColl).first;
-        const ScoreComponentCollection& score = (*iterWordColl).second;
+      for (size_t i = 0 ; i < wordColl.size(); ++i) {
         // enter into word list generated factor(s) and its(their) score(s)
-        wordList.push_back(WordPair(outputWord, score));
+        wordList.push_back(WordPair(&wordColl.GetWord(i), wordColl.GetScores(i)));
       }
 
       wordListVectorPos++; // done, next word
@@ -138,14 +135,17 @@ void DecodeStepGeneration::Process(const TranslationSystem* system
   }
 
   // go thru each possible factor for each word & create hypothesis
+  const size_t numScores = generationDictionary->GetNumScoreComponents();
   for (size_t currIter = 0 ; currIter < numIteration ; currIter++) {
     ScoreComponentCollection generationScore; // total score for this string of words
 
     // create vector of words with new factors for last phrase
     for (size_t currPos = 0 ; currPos < targetLength ; currPos++) {
       const WordPair &wordPair = *wordListIterVector[currPos];
-      mergeWords[currPos] = &(wordPair.first);
-      generationScore.PlusEquals(wordPair.second);
+      mergeWords[currPos] = wordPair.first;
+      for (size_t i = 0 ; i < numScores ; i++) {
+        generationScore.PlusEquals(generationDictionary, i, wordPair.second[i]);
+      }
     }
 
     // merge with existing trans opt
@@ -0,0 +1,226 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2012 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include "util/check.hh"
+#include "TypeDef.h"
+#include "Factor.h"
+#include "Word.h"
+
+namespace Moses
+{
+
+/** Key made of one or two 32-bit factor ids.  Factors are interned, so the id
+ * identifies the factor string just like the Factor pointer does.
+ */
+inline UINT64 FactorIdKey(const Factor *factor)
+{
+  return static_cast<UINT32>(factor->GetId());
+}
+
+inline UINT64 FactorIdKey(const Factor *first, const Factor *second)
+{
+  return (FactorIdKey(first) << 32) | FactorIdKey(second);
+}
+
+//! key of a non-terminal: only factor 0 is relevant (cf. NonTerminalHasher)
+inline UINT64 NonTerminalKey(const Word &word)
+{
+  return FactorIdKey(word[0]);
+}
+
+/** key of a terminal from its active factors (cf. TerminalHasher). It's
+ * assumed that the same subset of factors is active for all words compared,
+ * and at most two of them are: StaticData rejects chart decoding with more
+ * than two input factors.
+ */
+inline UINT64 TerminalKey(const Word &word)
+{
+  UINT64 key = 0;
+  size_t numFactors = 0;
+  for (size_t i = 0; i < MAX_NUM_FACTORS; ++i) {
+    const Factor *factor = word[i];
+    if (factor) {
+      CHECK(numFactors < 2);
+      key |= (FactorIdKey(factor) + numFactors) << (32 * numFactors);
+      ++numFactors;
+    }
+  }
+  return key;
+}
+
+/** Open-addressing hash table from factor-id keys to small values (pointers,
+ * indices).  Linear probing in a single power-of-two array, so a lookup is a
+ * multiplication and usually one cache line, and an empty map costs nothing.
+ * Entries are pair-like: iterate and use ->first (key) and ->second (value).
+ */
+template <class T>
+class FactorIdMap
+{
+public:
+  struct Entry {
+    UINT64 first;
+    T second;
+  };
+
+  class const_iterator
+  {
+  public:
+    const_iterator() : m_curr(NULL), m_end(NULL) {}
+    const_iterator(const Entry *curr, const Entry *end) : m_curr(curr), m_end(end) {
+      Skip();
+    }
+    const Entry &operator*() const {
+      return *m_curr;
+    }
+    const Entry *operator->() const {
+      return m_curr;
+    }
+    const_iterator &operator++() {
+      ++m_curr;
+      Skip();
+      return *this;
+    }
+    bool operator==(const const_iterator &other) const {
+      return m_curr == other.m_curr;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return m_curr != other.m_curr;
+    }
+  private:
+    void Skip() {
+      while (m_curr != m_end && m_curr->first == EMPTY) ++m_curr;
+    }
+    const Entry *m_curr, *m_end;
+  };
+
+  FactorIdMap() : m_entries(NULL), m_size(0), m_capacity(0), m_shift(64) {}
+
+  FactorIdMap(const FactorIdMap &copy) : m_entries(NULL), m_size(0), m_capacity(0), m_shift(64) {
+    *this = copy;
+  }
+
+  ~FactorIdMap() {
+    delete [] m_entries;
+  }
+
+  FactorIdMap &operator=(const FactorIdMap &copy) {
+    if (this != &copy) {
+      delete [] m_entries;
+      m_entries = copy.m_capacity ? new Entry[copy.m_capacity] : NULL;
+      std::copy(copy.m_entries, copy.m_entries + copy.m_capacity, m_entries);
+      m_size = copy.m_size;
+      m_capacity = copy.m_capacity;
+      m_shift = copy.m_shift;
+    }
+    return *this;
+  }
+
+  const_iterator begin() const {
+    return const_iterator(m_entries, m_entries + m_capacity);
+  }
+  const_iterator end() const {
+    return const_iterator(m_entries + m_capacity, m_entries + m_capacity);
+  }
+
+  size_t size() const {
+    return m_size;
+  }
+  bool empty() const {
+    return m_size == 0;
+  }
+
+  void clear() {
+    delete [] m_entries;
+    m_entries = NULL;
+    m_size = m_capacity = 0;
+    m_shift = 64;
+  }
+
+  //! pointer to the value stored under key, or NULL
+  const T *Find(UINT64 key) const {
+    if (m_size == 0) return NULL;
+    for (size_t i = Bucket(key); ; i = (i + 1) & (m_capacity - 1)) {
+      const Entry &entry = m_entries[i];
+      if (entry.first == key) return &entry.second;
+      if (entry.first == EMPTY) return NULL;
+    }
+  }
+
+  /** insert value under key unless the key is present already.
+   * \return the stored value and whether it was inserted. The pointer is
+   * invalidated by the next insertion
+   */
+  std::pair<T*, bool> Insert(UINT64 key, const T &value) {
+    CHECK(key != EMPTY);
+    if ((m_size + 1) * 4 > m_capacity * 3) {
+      Grow();
+    }
+    for (size_t i = Bucket(key); ; i = (i + 1) & (m_capacity - 1)) {
+      Entry &entry = m_entries[i];
+      if (entry.first == key) {
+        return std::make_pair(&entry.second, false);
+      }
+      if (entry.first == EMPTY) {
+        entry.first = key;
+        entry.second = value;
+        ++m_size;
+        return std::make_pair(&entry.second, true);
+      }
+    }
+  }
+
+private:
+  static const UINT64 EMPTY = ~static_cast<UINT64>(0);
+
+  size_t Bucket(UINT64 key) const {
+    // Fibonacci hashing: top bits of the product
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> m_shift);
+  }
+
+  void Grow() {
+    Entry *old = m_entries;
+    size_t oldCapacity = m_capacity;
+
+    m_capacity = oldCapacity ? oldCapacity * 2 : 2;
+    m_shift = 64;
+    for (size_t c = m_capacity; c > 1; c >>= 1) --m_shift;
+    m_entries = new Entry[m_capacity];
+    for (size_t i = 0; i < m_capacity; ++i) {
+      m_entries[i].first = EMPTY;
+    }
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+      if (old[i].first == EMPTY) continue;
+      size_t j = Bucket(old[i].first);
+      while (m_entries[j].first != EMPTY) j = (j + 1) & (m_capacity - 1);
+      m_entries[j] = old[i];
+    }
+    delete [] old;
+  }
+
+  Entry *m_entries;
+  size_t m_size, m_capacity;
+  unsigned int m_shift; //! 64 - log2(m_capacity)
+};
+
+}
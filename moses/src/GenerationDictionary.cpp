@@ -19,8 +19,10 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <cstring>
 #include <fstream>
 #include <string>
+#include <boost/functional/hash.hpp>
 #include "GenerationDictionary.h"
 #include "FactorCollection.h"
 #include "Word.h"
@@ -28,94 +30,347 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "InputFileStream.h"
 #include "StaticData.h"
 #include "UserMessage.h"
+#include "util/check.hh"
+#include "util/file.hh"
 
 using namespace std;
 
 namespace Moses
 {
-GenerationDictionary::GenerationDictionary(size_t numFeatures, ScoreIndexManager &scoreIndexManager,
-    const std::vector<FactorType> &input,
-    const std::vector<FactorType> &output)
-  : Dictionary(numFeatures), DecodeFeature(input,output)
+
+namespace
 {
-  scoreIndexManager.AddScoreProducer(this);
+
+const char kMagic[8] = {'m', 'o', 's', 'e', 's', 'g', 'e', 'n'};
+
+/* The binary table is the header followed by
+ *   uint64_t string offsets      [numStrings + 1]
+ *   uint64_t candidate start     [numInputWords + 1]
+ *   uint32_t input words         [numInputWords * numInputFactors]   (string ids)
+ *   uint32_t output words        [numOutputWords * numOutputFactors] (string ids)
+ *   uint32_t candidate word      [numCandidates]                     (output word)
+ *   float    candidate scores    [numCandidates * numScores]         (log space)
+ *   char     strings
+ * in host byte order.  The candidates of input word i are
+ * candidate start[i] to candidate start[i + 1].
+ */
+struct Header {
+  char magic[8];
+  uint32_t numScores;
+  uint32_t numInputFactors;
+  uint32_t numOutputFactors;
+  uint32_t unused;
+  uint64_t numStrings;
+  uint64_t numInputWords;
+  uint64_t numOutputWords;
+  uint64_t numCandidates;
+};
+
+size_t TableSize(const Header &header, uint64_t stringBytes)
+{
+  return sizeof(Header)
+         + sizeof(uint64_t) * (header.numStrings + 1 + header.numInputWords + 1)
+         + sizeof(uint32_t) * (header.numInputWords * header.numInputFactors
+                               + header.numOutputWords * header.numOutputFactors
+                               + header.numCandidates)
+         + sizeof(float) * header.numCandidates * header.numScores
+         + stringBytes;
 }
 
-bool GenerationDictionary::Load(const std::string &filePath, FactorDirection direction)
+template <class T> void Append(char *&to, const std::vector<T> &from)
 {
-  FactorCollection &factorCollection = FactorCollection::Instance();
+  if (!from.empty()) {
+    memcpy(to, &from[0], sizeof(T) * from.size());
+    to += sizeof(T) * from.size();
+  }
+}
 
-  const size_t numFeatureValuesInConfig = this->GetNumScoreComponents();
+template <class T> const T *Skip(const char *&from, size_t count)
+{
+  const T *ret = reinterpret_cast<const T*>(from);
+  from += sizeof(T) * count;
+  return ret;
+}
 
+/** Reads a text generation table into the binary layout.  Factors and
+ * scores beyond the requested numbers are ignored; 0 takes the numbers
+ * from the first line.  The last line for an input and output word counts.
+ */
+class TableBuilder
+{
+public:
+  TableBuilder(const std::string &filePath, size_t numInputFactors, size_t numOutputFactors, size_t numScores)
+    : m_filePath(filePath) {
+    memcpy(m_header.magic, kMagic, sizeof(kMagic));
+    m_header.numInputFactors = numInputFactors;
+    m_header.numOutputFactors = numOutputFactors;
+    m_header.numScores = numScores;
+    m_header.unused = 0;
+  }
 
-  // data from file
-  InputFileStream inFile(filePath);
-  if (!inFile.good()) {
-    UserMessage::Add(string("Couldn't read ") + filePath);
+  bool Read(std::istream &in);
+  void Write(std::vector<char> &table) const;
+
+private:
+  bool AddWord(const std::string &str, size_t lineNum, uint32_t &numFactors, std::vector<uint32_t> &word);
+  bool Error(size_t lineNum, const std::string &message) const {
+    stringstream strme;
+    strme << m_filePath << ":" << lineNum << ": " << message << std::endl;
+    UserMessage::Add(strme.str());
     return false;
   }
 
-  m_filePath = filePath;
+  std::string m_filePath;
+  Header m_header;
+  std::vector<std::string> m_strings;
+  boost::unordered_map<std::string, uint32_t> m_stringIds;
+  boost::unordered_map<std::vector<uint32_t>, uint32_t> m_inputIds, m_outputIds;
+  std::vector<uint32_t> m_inputWords, m_outputWords;
+  std::vector<std::vector<uint32_t> > m_candidates; // per input word
+  boost::unordered_map<std::pair<uint32_t, uint32_t>, uint32_t> m_candidateIds;
+  std::vector<uint32_t> m_candidateWord;
+  std::vector<float> m_candidateScores;
+};
+
+bool TableBuilder::AddWord(const std::string &str, size_t lineNum, uint32_t &numFactors, std::vector<uint32_t> &word)
+{
+  vector<string> factorString = Tokenize( str, "|" );
+  if (numFactors == 0) {
+    numFactors = factorString.size();
+  }
+  if (factorString.size() < numFactors) {
+    stringstream strme;
+    strme << "expected " << numFactors << " factors in " << str;
+    return Error(lineNum, strme.str());
+  }
+  word.clear();
+  for (size_t i = 0; i < numFactors; ++i) {
+    pair<boost::unordered_map<std::string, uint32_t>::iterator, bool> added =
+      m_stringIds.insert(make_pair(factorString[i], (uint32_t) m_strings.size()));
+    if (added.second) {
+      m_strings.push_back(factorString[i]);
+    }
+    word.push_back(added.first->second);
+  }
+  return true;
+}
+
+bool TableBuilder::Read(std::istream &in)
+{
   string line;
   size_t lineNum = 0;
-  while(getline(inFile, line)) {
+  std::vector<uint32_t> inputWord, outputWord;
+  while(getline(in, line)) {
     ++lineNum;
     vector<string> token = Tokenize( line );
+    if (token.empty()) {
+      continue;
+    }
+    if (token.size() < 2) {
+      return Error(lineNum, "expected input word, output word and scores");
+    }
+    if (!AddWord(token[0], lineNum, m_header.numInputFactors, inputWord)
+        || !AddWord(token[1], lineNum, m_header.numOutputFactors, outputWord)) {
+      return false;
+    }
 
-    // add each line in generation file into class
-    Word *inputWord = new Word();  // deleted in destructor
-    Word outputWord;
+    size_t numFeaturesInFile = token.size() - 2;
+    if (m_header.numScores == 0) {
+      m_header.numScores = numFeaturesInFile;
+    }
+    if (numFeaturesInFile < m_header.numScores) {
+      stringstream strme;
+      strme << "expected " << m_header.numScores
+            << " feature values, but found " << numFeaturesInFile;
+      return Error(lineNum, strme.str());
+    }
 
-    // create word with certain factors filled out
+    uint32_t input = m_inputIds.insert(make_pair(inputWord, (uint32_t) m_inputIds.size())).first->second;
+    if (input == m_candidates.size()) {
+      m_inputWords.insert(m_inputWords.end(), inputWord.begin(), inputWord.end());
+      m_candidates.push_back(std::vector<uint32_t>());
+    }
+    uint32_t output = m_outputIds.insert(make_pair(outputWord, (uint32_t) m_outputIds.size())).first->second;
+    if (output * m_header.numOutputFactors == m_outputWords.size()) {
+      m_outputWords.insert(m_outputWords.end(), outputWord.begin(), outputWord.end());
+    }
 
-    // inputs
-    vector<string> factorString = Tokenize( token[0], "|" );
-    for (size_t i = 0 ; i < GetInput().size() ; i++) {
-      FactorType factorType = GetInput()[i];
-      const Factor *factor = factorCollection.AddFactor( direction, factorType, factorString[i]);
-      inputWord->SetFactor(factorType, factor);
+    pair<boost::unordered_map<std::pair<uint32_t, uint32_t>, uint32_t>::iterator, bool> added =
+      m_candidateIds.insert(make_pair(make_pair(input, output), (uint32_t) m_candidateWord.size()));
+    size_t candidate = added.first->second;
+    if (added.second) {
+      m_candidates[input].push_back(candidate);
+      m_candidateWord.push_back(output);
+      m_candidateScores.resize(m_candidateScores.size() + m_header.numScores);
     }
+    for (size_t i = 0; i < m_header.numScores; i++)
+      m_candidateScores[candidate * m_header.numScores + i] = FloorScore(TransformScore(Scan<float>(token[2+i])));
+  }
+  return true;
+}
 
-    factorString = Tokenize( token[1], "|" );
-    for (size_t i = 0 ; i < GetOutput().size() ; i++) {
-      FactorType factorType = GetOutput()[i];
+void TableBuilder::Write(std::vector<char> &table) const
+{
+  Header header = m_header;
+  header.numStrings = m_strings.size();
+  header.numInputWords = m_candidates.size();
+  header.numOutputWords = m_outputIds.size();
+  header.numCandidates = m_candidateWord.size();
 
-      const Factor *factor = factorCollection.AddFactor( direction, factorType, factorString[i]);
-      outputWord.SetFactor(factorType, factor);
+  // candidates grouped by input word
+  std::vector<uint64_t> stringOffsets(1, 0), candidateStart(1, 0);
+  for (size_t i = 0; i < m_strings.size(); ++i) {
+    stringOffsets.push_back(stringOffsets.back() + m_strings[i].size());
+  }
+  std::vector<uint32_t> candidateWord;
+  std::vector<float> candidateScores;
+  candidateWord.reserve(m_candidateWord.size());
+  candidateScores.reserve(m_candidateScores.size());
+  for (size_t i = 0; i < m_candidates.size(); ++i) {
+    for (size_t j = 0; j < m_candidates[i].size(); ++j) {
+      size_t candidate = m_candidates[i][j];
+      candidateWord.push_back(m_candidateWord[candidate]);
+      candidateScores.insert(candidateScores.end(),
+                             m_candidateScores.begin() + candidate * header.numScores,
+                             m_candidateScores.begin() + (candidate + 1) * header.numScores);
     }
+    candidateStart.push_back(candidateWord.size());
+  }
 
-    size_t numFeaturesInFile = token.size() - 2;
-    if (numFeaturesInFile < numFeatureValuesInConfig) {
-      stringstream strme;
-      strme << filePath << ":" << lineNum << ": expected " << numFeatureValuesInConfig
-            << " feature values, but found " << numFeaturesInFile << std::endl;
-      UserMessage::Add(strme.str());
-      return false;
+  table.resize(TableSize(header, stringOffsets.back()));
+  char *to = &table[0];
+  memcpy(to, &header, sizeof(Header));
+  to += sizeof(Header);
+  Append(to, stringOffsets);
+  Append(to, candidateStart);
+  Append(to, m_inputWords);
+  Append(to, m_outputWords);
+  Append(to, candidateWord);
+  Append(to, candidateScores);
+  for (size_t i = 0; i < m_strings.size(); ++i) {
+    memcpy(to, m_strings[i].data(), m_strings[i].size());
+    to += m_strings[i].size();
+  }
+}
+
+bool IsBinaryTable(const std::string &filePath)
+{
+  std::ifstream in(filePath.c_str(), std::ios::binary);
+  char magic[sizeof(kMagic)];
+  return in.read(magic, sizeof(magic)) && memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+}
+
+GenerationDictionary::GenerationDictionary(size_t numFeatures, ScoreIndexManager &scoreIndexManager,
+    const std::vector<FactorType> &input,
+    const std::vector<FactorType> &output)
+  : Dictionary(numFeatures), DecodeFeature(input,output)
+  , m_inputWords(0, WordFactorHash(input), WordFactorHash(input))
+  , m_candidateStart(NULL), m_candidateWord(NULL), m_candidateScores(NULL), m_numScoresInFile(0)
+{
+  scoreIndexManager.AddScoreProducer(this);
+}
+
+bool GenerationDictionary::Load(const std::string &filePath, FactorDirection direction)
+{
+  m_filePath = filePath;
+
+  if (IsBinaryTable(filePath)) {
+    util::scoped_fd fd(util::OpenReadOrThrow(filePath.c_str()));
+    uint64_t size = util::SizeFile(fd.get());
+    CHECK(size != util::kBadSize);
+    util::MapRead(util::LAZY, fd.get(), 0, size, m_file);
+    return ReadTable(static_cast<const char*>(m_file.get()), m_file.size(), direction);
+  }
+
+  // data from file
+  InputFileStream inFile(filePath);
+  if (!inFile.good()) {
+    UserMessage::Add(string("Couldn't read ") + filePath);
+    return false;
+  }
+  TableBuilder builder(filePath, GetInput().size(), GetOutput().size(), GetNumScoreComponents());
+  if (!builder.Read(inFile)) {
+    return false;
+  }
+  inFile.Close();
+  builder.Write(m_text);
+  return ReadTable(&m_text[0], m_text.size(), direction);
+}
+
+bool GenerationDictionary::ReadTable(const char *data, size_t size, FactorDirection direction)
+{
+  FactorCollection &factorCollection = FactorCollection::Instance();
+
+  Header header;
+  if (size < sizeof(Header)) {
+    UserMessage::Add(m_filePath + " is not a generation table");
+    return false;
+  }
+  memcpy(&header, data, sizeof(Header));
+  if (header.numInputFactors < GetInput().size() || header.numOutputFactors < GetOutput().size()
+      || header.numScores < GetNumScoreComponents()) {
+    stringstream strme;
+    strme << m_filePath << " has " << header.numInputFactors << " input factors, "
+          << header.numOutputFactors << " output factors and " << header.numScores
+          << " feature values, which is fewer than the configuration asks for" << std::endl;
+    UserMessage::Add(strme.str());
+    return false;
+  }
+
+  const char *from = data + sizeof(Header);
+  const uint64_t *stringOffsets = Skip<uint64_t>(from, header.numStrings + 1);
+  if (size < TableSize(header, 0) || size != TableSize(header, stringOffsets[header.numStrings])) {
+    UserMessage::Add(m_filePath + " is truncated");
+    return false;
+  }
+  m_candidateStart = Skip<uint64_t>(from, header.numInputWords + 1);
+  const uint32_t *inputWords = Skip<uint32_t>(from, header.numInputWords * header.numInputFactors);
+  const uint32_t *outputWords = Skip<uint32_t>(from, header.numOutputWords * header.numOutputFactors);
+  m_candidateWord = Skip<uint32_t>(from, header.numCandidates);
+  m_candidateScores = Skip<float>(from, header.numCandidates * header.numScores);
+  const char *strings = from;
+  m_numScoresInFile = header.numScores;
+
+  // create words with certain factors filled out
+  for (size_t i = 0; i < header.numInputWords; ++i) {
+    Word inputWord;
+    const uint32_t *factors = inputWords + i * header.numInputFactors;
+    for (size_t f = 0; f < GetInput().size(); ++f) {
+      FactorType factorType = GetInput()[f];
+      string str(strings + stringOffsets[factors[f]], strings + stringOffsets[factors[f] + 1]);
+      inputWord.SetFactor(factorType, factorCollection.AddFactor(direction, factorType, str));
     }
-    std::vector<float> scores(numFeatureValuesInConfig, 0.0f);
-    for (size_t i = 0; i < numFeatureValuesInConfig; i++)
-      scores[i] = FloorScore(TransformScore(Scan<float>(token[2+i])));
-
-    Collection::iterator iterWord = m_collection.find(inputWord);
-    if (iterWord == m_collection.end()) {
-      m_collection[inputWord][outputWord].Assign(this, scores);
-    } else {
-      // source word already in there. delete input word to avoid mem leak
-      (iterWord->second)[outputWord].Assign(this, scores);
-      delete inputWord;
+    m_inputWords.insert(make_pair(inputWord, i));
+  }
+  m_outputWords.resize(header.numOutputWords);
+  for (size_t i = 0; i < header.numOutputWords; ++i) {
+    const uint32_t *factors = outputWords + i * header.numOutputFactors;
+    for (size_t f = 0; f < GetOutput().size(); ++f) {
+      FactorType factorType = GetOutput()[f];
+      string str(strings + stringOffsets[factors[f]], strings + stringOffsets[factors[f] + 1]);
+      m_outputWords[i].SetFactor(factorType, factorCollection.AddFactor(direction, factorType, str));
     }
   }
+  return true;
+}
 
-  inFile.Close();
+bool GenerationDictionary::Create(std::istream &in, const std::string &outFilePath)
+{
+  TableBuilder builder(outFilePath, 0, 0, 0);
+  if (!builder.Read(in)) {
+    return false;
+  }
+  std::vector<char> table;
+  builder.Write(table);
+  util::scoped_fd fd(util::CreateOrThrow(outFilePath.c_str()));
+  util::WriteOrThrow(fd.get(), &table[0], table.size());
   return true;
 }
 
 GenerationDictionary::~GenerationDictionary()
 {
-  Collection::const_iterator iter;
-  for (iter = m_collection.begin() ; iter != m_collection.end() ; ++iter) {
-    delete iter->first;
-  }
 }
 
 size_t GenerationDictionary::GetNumScoreComponents() const
@@ -134,18 +389,20 @@ std::string GenerationDictionary::GetScoreProducerWeightShortName(unsigned) cons
 }
 
 
-const OutputWordCollection *GenerationDictionary::FindWord(const Word &word) const
+bool GenerationDictionary::FindWord(const Word &word, OutputWordCollection &words) const
 {
-  const OutputWordCollection *ret;
-
-  Collection::const_iterator iter = m_collection.find(&word);
-  if (iter == m_collection.end()) {
+  InputWords::const_iterator iter = m_inputWords.find(word);
+  if (iter == m_inputWords.end()) {
     // can't find source phrase
-    ret = NULL;
-  } else {
-    ret = &iter->second;
+    return false;
   }
-  return ret;
+  const uint64_t begin = m_candidateStart[iter->second];
+  words.m_size = m_candidateStart[iter->second + 1] - begin;
+  words.m_words = m_outputWords.empty() ? NULL : &m_outputWords[0];
+  words.m_wordIds = m_candidateWord + begin;
+  words.m_scores = m_candidateScores + begin * m_numScoresInFile;
+  words.m_stride = m_numScoresInFile;
+  return true;
 }
 
 bool GenerationDictionary::ComputeValueInTranslationOption() const
@@ -155,4 +412,3 @@ bool GenerationDictionary::ComputeValueInTranslationOption() const
 
 
 }
-
@@ -22,35 +22,73 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_GenerationDictionary_h
 #define moses_GenerationDictionary_h
 
-#include <list>
-#include <map>
+#include <istream>
+#include <string>
 #include <vector>
+#include <boost/unordered_map.hpp>
 #include "ScoreComponentCollection.h"
 #include "Phrase.h"
 #include "TypeDef.h"
 #include "Dictionary.h"
 #include "DecodeFeature.h"
+#include "util/mmap.hh"
 
 namespace Moses
 {
 
 class FactorCollection;
+class GenerationDictionary;
 
-typedef std::map < Word , ScoreComponentCollection > OutputWordCollection;
-// 1st = output phrase
-// 2nd = log probability (score)
+/** The output words of a generation table for one input word, with their
+ * scores.  It points into the table, so it is only valid while the table is.
+ */
+class OutputWordCollection
+{
+  friend class GenerationDictionary;
+public:
+  OutputWordCollection() : m_size(0) {}
+
+  size_t size() const {
+    return m_size;
+  }
+  const Word &GetWord(size_t i) const {
+    return m_words[m_wordIds[i]];
+  }
+  //! the score components of output word i, in log space
+  const float *GetScores(size_t i) const {
+    return m_scores + i * m_stride;
+  }
+
+private:
+  size_t m_size;
+  const Word *m_words;
+  const uint32_t *m_wordIds;
+  const float *m_scores;
+  size_t m_stride;
+};
 
-/** Implementation of a generation table in a trie.
+/** Implementation of a generation table.
+ *
+ * The table is kept in one flat layout, which is also the binary format
+ * written by Create().  A binary table is mapped into memory; a text table
+ * is converted into the same layout on the heap when it is loaded.
  */
 class GenerationDictionary : public Dictionary, public DecodeFeature
 {
-  typedef std::map<const Word* , OutputWordCollection, WordComparer> Collection;
+  typedef boost::unordered_map<Word, size_t, WordFactorHash, WordFactorHash> InputWords;
 protected:
-  Collection m_collection;
-  // 1st = source
-  // 2nd = target
+  util::scoped_memory m_file; // binary table
+  std::vector<char> m_text;   // text table converted to the binary layout
+  InputWords m_inputWords;    // input word -> index
+  std::vector<Word> m_outputWords;
+  const uint64_t *m_candidateStart;
+  const uint32_t *m_candidateWord;
+  const float *m_candidateScores;
+  size_t m_numScoresInFile;
   std::string						m_filePath;
 
+  bool ReadTable(const char *data, size_t size, FactorDirection direction);
+
 public:
   /** constructor.
   * \param numFeatures number of score components, as specified in ini file
@@ -67,9 +105,14 @@ public:
     return Generate;
   }
 
-  //! load data file
+  //! load data file, either a text table or a binary one written by Create()
   bool Load(const std::string &filePath, FactorDirection direction);
 
+  /** convert a text generation table to the binary format.
+  * Scores are stored in log space, so Load() does no work per entry.
+  */
+  static bool Create(std::istream &in, const std::string &outFilePath);
+
   size_t GetNumScoreComponents() const;
   std::string GetScoreProducerDescription(unsigned) const;
   std::string GetScoreProducerWeightShortName(unsigned) const;
@@ -78,12 +121,13 @@ public:
   * NOT the number of lines in the generation table
   */
   size_t GetSize() const {
-    return m_collection.size();
+    return m_inputWords.size();
   }
-  /** returns a bag of output words, OutputWordCollection, for a particular input word.
-  *	Or NULL if the input word isn't found. The search function used is the WordComparer functor
+  /** fills words with the output words for a particular input word, without
+  *	allocating.  Returns false if the input word isn't found. Only the input
+  * factors of word are compared.
   */
-  const OutputWordCollection *FindWord(const Word &word) const;
+  bool FindWord(const Word &word, OutputWordCollection &words) const;
   virtual bool ComputeValueInTranslationOption() const;
 };
 
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <fstream>
+#include <map>
 #include "GlobalLexicalModel.h"
 #include "StaticData.h"
 #include "InputFileStream.h"
@@ -12,6 +14,8 @@ GlobalLexicalModel::GlobalLexicalModel(const string &filePath,
                                        const float weight,
                                        const vector< FactorType >& inFactors,
                                        const vector< FactorType >& outFactors)
+  : m_inputVocab(0, WordFactorHash(inFactors), WordFactorHash(inFactors))
+  , m_outputVocab(0, WordFactorHash(outFactors), WordFactorHash(outFactors))
 {
   std::cerr << "Creating global lexical model...\n";
 
@@ -23,25 +27,29 @@ GlobalLexicalModel::GlobalLexicalModel(const string &filePath,
 
   // load model
   LoadData( filePath, inFactors, outFactors );
-
-  // define bias word
-  FactorCollection &factorCollection = FactorCollection::Instance();
-  m_bias = new Word();
-  const Factor* factor = factorCollection.AddFactor( Input, inFactors[0], "**BIAS**" );
-  m_bias->SetFactor( inFactors[0], factor );
 }
 
 GlobalLexicalModel::~GlobalLexicalModel()
 {
-  // delete words in the hash data structure
-  DoubleHash::const_iterator iter;
-  for(iter = m_hash.begin(); iter != m_hash.end(); iter++ ) {
-    map< const Word*, float, WordComparer >::const_iterator iter2;
-    for(iter2 = iter->second.begin(); iter2 != iter->second.end(); iter2++ ) {
-      delete iter2->first; // delete input word
-    }
-    delete iter->first; // delete output word
-  }
+}
+
+namespace
+{
+struct Feature {
+  size_t input, output;
+  float weight;
+};
+
+bool FeatureOrder(const Feature &a, const Feature &b)
+{
+  return a.input < b.input || (a.input == b.input && a.output < b.output);
+}
+
+float Sigmoid(float sum)
+{
+  // Hal Daume says: 1/( 1 + exp [ - sum_i w_i * f_i ] )
+  return FloorScore( log(1/(1+exp(-sum))) );
+}
 }
 
 void GlobalLexicalModel::LoadData(const string &filePath,
@@ -57,6 +65,12 @@ void GlobalLexicalModel::LoadData(const string &filePath,
   m_outputFactors = FactorMask(outFactors);
   InputFileStream inFile(filePath);
 
+  // the bias feature is an input word that occurs in every sentence
+  const Factor* bias = factorCollection.AddFactor( Input, inFactors[0], "**BIAS**" );
+
+  std::vector<Feature> features;
+  std::map<size_t, float> biasWeights;
+
   // reading in data one line at a time
   size_t lineNum = 0;
   string line;
@@ -72,100 +86,115 @@ void GlobalLexicalModel::LoadData(const string &filePath,
     }
 
     // create the output word
-    Word *outWord = new Word();
+    Word outWord;
     vector<string> factorString = Tokenize( token[0], factorDelimiter );
     for (size_t i=0 ; i < outFactors.size() ; i++) {
       const FactorDirection& direction = Output;
       const FactorType& factorType = outFactors[i];
       const Factor* factor = factorCollection.AddFactor( direction, factorType, factorString[i] );
-      outWord->SetFactor( factorType, factor );
+      outWord.SetFactor( factorType, factor );
     }
 
     // create the input word
-    Word *inWord = new Word();
+    Word inWord;
     factorString = Tokenize( token[1], factorDelimiter );
     for (size_t i=0 ; i < inFactors.size() ; i++) {
       const FactorDirection& direction = Input;
       const FactorType& factorType = inFactors[i];
       const Factor* factor = factorCollection.AddFactor( direction, factorType, factorString[i] );
-      inWord->SetFactor( factorType, factor );
+      inWord.SetFactor( factorType, factor );
     }
 
     // maximum entropy feature score
     float score = Scan<float>(token[2]);
 
-    // std::cerr << "storing word " << *outWord << " " << *inWord << " " << score << endl;
+    // store feature
+    size_t outId = m_outputVocab.insert(make_pair(outWord, m_outputVocab.size())).first->second;
+    if (inWord[inFactors[0]] == bias) {
+      biasWeights[outId] = score;
+    } else {
+      Feature feature;
+      feature.input = m_inputVocab.insert(make_pair(inWord, m_inputVocab.size())).first->second;
+      feature.output = outId;
+      feature.weight = score;
+      features.push_back(feature);
+    }
+  }
 
-    // store feature in hash
-    DoubleHash::iterator keyOutWord = m_hash.find( outWord );
-    if( keyOutWord == m_hash.end() ) {
-      m_hash[outWord][inWord] = score;
-    } else { // already have hash for outword, delete the word to avoid leaks
-      (keyOutWord->second)[inWord] = score;
-      delete outWord;
+  // lay out the features by input word, the last weight read for a pair counts
+  std::stable_sort(features.begin(), features.end(), FeatureOrder);
+  m_featureStart.assign(m_inputVocab.size() + 1, 0);
+  m_features.clear();
+  for (size_t i = 0; i < features.size(); ++i) {
+    if (i + 1 < features.size() && !FeatureOrder(features[i], features[i + 1])) {
+      continue;
     }
+    ++m_featureStart[features[i].input + 1];
+    m_features.push_back(make_pair(features[i].output, features[i].weight));
+  }
+  for (size_t i = 1; i < m_featureStart.size(); ++i) {
+    m_featureStart[i] += m_featureStart[i - 1];
   }
+
+  m_biasSums.assign(m_outputVocab.size(), 0.0f);
+  for (std::map<size_t, float>::const_iterator i = biasWeights.begin(); i != biasWeights.end(); ++i) {
+    m_biasSums[i->first] = i->second;
+  }
+  m_biasScores.resize(m_biasSums.size());
+  for (size_t i = 0; i < m_biasSums.size(); ++i) {
+    m_biasScores[i] = Sigmoid(m_biasSums[i]);
+  }
+  m_unknownScore = Sigmoid(0.0f);
 }
 
 void GlobalLexicalModel::InitializeForInput( Sentence const& in )
 {
-  m_local.reset(new ThreadLocalStorage);
-  m_local->input = &in;
-}
+  if (m_local.get() == NULL) {
+    m_local.reset(new ThreadLocalStorage);
+  }
 
-float GlobalLexicalModel::ScorePhrase( const TargetPhrase& targetPhrase ) const
-{
-  const Sentence& input = *(m_local->input);
-  float score = 0;
-  for(size_t targetIndex = 0; targetIndex < targetPhrase.GetSize(); targetIndex++ ) {
-    float sum = 0;
-    const Word& targetWord = targetPhrase.GetWord( targetIndex );
-    VERBOSE(2,"glm " << targetWord << ": ");
-    const DoubleHash::const_iterator targetWordHash = m_hash.find( &targetWord );
-    if( targetWordHash != m_hash.end() ) {
-      SingleHash::const_iterator inputWordHash = targetWordHash->second.find( m_bias );
-      if( inputWordHash != targetWordHash->second.end() ) {
-        VERBOSE(2,"*BIAS* " << inputWordHash->second);
-        sum += inputWordHash->second;
-      }
-
-      set< const Word*, WordComparer > alreadyScored; // do not score a word twice
-      for(size_t inputIndex = 0; inputIndex < input.GetSize(); inputIndex++ ) {
-        const Word& inputWord = input.GetWord( inputIndex );
-        if ( alreadyScored.find( &inputWord ) == alreadyScored.end() ) {
-          SingleHash::const_iterator inputWordHash = targetWordHash->second.find( &inputWord );
-          if( inputWordHash != targetWordHash->second.end() ) {
-            VERBOSE(2," " << inputWord << " " << inputWordHash->second);
-            sum += inputWordHash->second;
-          }
-          alreadyScored.insert( &inputWord );
-        }
-      }
+  // add the features of each distinct input word to the bias of the output
+  // words, in input order, then score the output words that changed
+  std::vector<float> &sums = m_local->sums;
+  std::vector<float> &scores = m_local->scores;
+  sums = m_biasSums;
+  scores = m_biasScores;
+  std::vector<size_t> alreadyScored; // do not score a word twice
+  for(size_t inputIndex = 0; inputIndex < in.GetSize(); inputIndex++ ) {
+    Vocabulary::const_iterator inputWord = m_inputVocab.find( in.GetWord( inputIndex ) );
+    if ( inputWord == m_inputVocab.end() ||
+         std::find(alreadyScored.begin(), alreadyScored.end(), inputWord->second) != alreadyScored.end() ) {
+      continue;
+    }
+    alreadyScored.push_back( inputWord->second );
+    for (size_t i = m_featureStart[inputWord->second]; i < m_featureStart[inputWord->second + 1]; ++i) {
+      sums[m_features[i].first] += m_features[i].second;
+    }
+  }
+  for (size_t i = 0; i < alreadyScored.size(); ++i) {
+    for (size_t j = m_featureStart[alreadyScored[i]]; j < m_featureStart[alreadyScored[i] + 1]; ++j) {
+      size_t outId = m_features[j].first;
+      scores[outId] = Sigmoid(sums[outId]);
     }
-    // Hal Daume says: 1/( 1 + exp [ - sum_i w_i * f_i ] )
-    VERBOSE(2," p=" << FloorScore( log(1/(1+exp(-sum))) ) << endl);
-    score += FloorScore( log(1/(1+exp(-sum))) );
   }
-  return score;
 }
 
-float GlobalLexicalModel::GetFromCacheOrScorePhrase( const TargetPhrase& targetPhrase ) const
+float GlobalLexicalModel::ScorePhrase( const TargetPhrase& targetPhrase ) const
 {
-  LexiconCache& m_cache = m_local->cache;
-  const LexiconCache::const_iterator query = m_cache.find( &targetPhrase );
-  if ( query != m_cache.end() ) {
-    return query->second;
+  const std::vector<float> &scores = m_local->scores;
+  float score = 0;
+  for(size_t targetIndex = 0; targetIndex < targetPhrase.GetSize(); targetIndex++ ) {
+    const Vocabulary::const_iterator targetWord = m_outputVocab.find( targetPhrase.GetWord( targetIndex ) );
+    float wordScore = targetWord == m_outputVocab.end() ? m_unknownScore : scores[targetWord->second];
+    VERBOSE(2,"glm " << targetPhrase.GetWord( targetIndex ) << ": p=" << wordScore << endl);
+    score += wordScore;
   }
-
-  float score = ScorePhrase( targetPhrase );
-  m_cache.insert( pair<const TargetPhrase*, float>(&targetPhrase, score) );
-  //VERBOSE(2, "add to cache " << targetPhrase << ": " << score << endl);
   return score;
 }
 
 void GlobalLexicalModel::Evaluate(const TargetPhrase& targetPhrase, ScoreComponentCollection* accumulator) const
 {
-  accumulator->PlusEquals( this, GetFromCacheOrScorePhrase( targetPhrase ) );
+  accumulator->PlusEquals( this, ScorePhrase( targetPhrase ) );
 }
 
 }
@@ -4,10 +4,12 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <boost/unordered_map.hpp>
 #include "Factor.h"
 #include "Phrase.h"
 #include "TypeDef.h"
 #include "Util.h"
+#include "Word.h"
 #include "WordsRange.h"
 #include "ScoreProducer.h"
 #include "FeatureFunction.h"
@@ -33,26 +35,32 @@ class InputType;
  */
 class GlobalLexicalModel : public StatelessFeatureFunction
 {
-  typedef std::map< const Word*, std::map< const Word*, float, WordComparer >, WordComparer > DoubleHash;
-  typedef std::map< const Word*, float, WordComparer > SingleHash;
-  typedef std::map< const TargetPhrase*, float > LexiconCache;
+  typedef boost::unordered_map<Word, size_t, WordFactorHash, WordFactorHash> Vocabulary;
 
+  //! scores of all output words given the current input sentence
   struct ThreadLocalStorage
   {
-    LexiconCache cache;
-    const Sentence *input;
+    std::vector<float> sums;
+    std::vector<float> scores;
   };
 
 private:
-  DoubleHash m_hash;
+  Vocabulary m_inputVocab;
+  Vocabulary m_outputVocab;
+
+  // features of input word i are m_features[m_featureStart[i] .. m_featureStart[i+1])
+  std::vector<size_t> m_featureStart;
+  std::vector<std::pair<size_t, float> > m_features; // output word, weight
+  std::vector<float> m_biasSums; // per output word
+  std::vector<float> m_biasScores;
+  float m_unknownScore;
+
 #ifdef WITH_THREADS
   boost::thread_specific_ptr<ThreadLocalStorage> m_local;
 #else
   std::auto_ptr<ThreadLocalStorage> m_local;
 #endif
 
-  Word *m_bias;
-
   FactorMask m_inputFactors;
   FactorMask m_outputFactors;
 
@@ -61,7 +69,6 @@ private:
                 const std::vector< FactorType >& outFactors);
 
   float ScorePhrase( const TargetPhrase& targetPhrase ) const;
-  float GetFromCacheOrScorePhrase( const TargetPhrase& targetPhrase ) const;
 
 public:
   GlobalLexicalModel(const std::string &filePath,
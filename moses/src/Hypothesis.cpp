@@ -276,7 +276,16 @@ void Hypothesis::EvaluateWith(const StatelessFeatureFunction* slff) {
 }
 
 void Hypothesis::CalculateFutureScore(const SquareMatrix& futureScore) {
-  m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
+  // the initial hypothesis carries no future score, so its successors
+  // have nothing to update from
+  if (m_prevHypo != NULL && m_prevHypo->m_prevHypo != NULL) {
+    m_futureScore = futureScore.UpdateFutureScore( m_prevHypo->m_futureScore
+                    , m_prevHypo->m_sourceCompleted
+                    , m_currSourceWordsRange.GetStartPos()
+                    , m_currSourceWordsRange.GetEndPos() );
+  } else {
+    m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
+  }
 }
 
 void Hypothesis::CalculateFinalScore() {
@@ -320,7 +329,7 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
   }
 
   // FUTURE COST
-  m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
+  CalculateFutureScore( futureScore );
 
   // TOTAL
   m_totalScore = m_scoreBreakdown.InnerProduct(staticData.GetAllWeights()) + m_futureScore;
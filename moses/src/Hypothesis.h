@@ -236,6 +236,9 @@ public:
   float GetScore() const {
     return m_totalScore-m_futureScore;
   }
+  float GetFutureScore() const {
+    return m_futureScore;
+  }
   const FFState* GetFFState(int idx) const {
     return m_ffStates[idx];
   }
@@ -66,10 +66,11 @@ LanguageModel* CreateLanguageModel(LMImplementation lmImplementation
                                    , size_t nGramOrder
                                    , const std::string &languageModelFile
                                    , ScoreIndexManager &scoreIndexManager
-                                   , int dub )
+                                   , int dub
+                                   , util::LoadMethod kenLoadMethod)
 {
   if (lmImplementation == Ken || lmImplementation == LazyKen) {
-    return ConstructKenLM(languageModelFile, scoreIndexManager, factorTypes[0], lmImplementation == LazyKen);
+    return ConstructKenLM(languageModelFile, scoreIndexManager, factorTypes[0], kenLoadMethod);
   }
   LanguageModelImplementation *lm = NULL;
   switch (lmImplementation) {
@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 #include "TypeDef.h"
+#include "util/mmap.hh"
 
 namespace Moses
 {
@@ -18,14 +19,16 @@ namespace LanguageModelFactory
 
 /**
  * creates a language model that will use the appropriate
- * language model toolkit as its underlying implementation
+ * language model toolkit as its underlying implementation.
+ * kenLoadMethod is only used by KenLM.
  */
 LanguageModel* CreateLanguageModel(LMImplementation lmImplementation
                                    , const std::vector<FactorType> &factorTypes
                                    , size_t nGramOrder
                                    , const std::string &languageModelFile
                                    , ScoreIndexManager &scoreIndexManager
-                                   , int dub);
+                                   , int dub
+                                   , util::LoadMethod kenLoadMethod = util::POPULATE_OR_READ);
 
 };
 
@@ -100,6 +100,9 @@ bool LanguageModelIRST::Load(const std::string &filePath,
 
   if (m_lmtb_dub > 0) m_lmtb->setlogOOVpenalty(m_lmtb_dub);
 
+  // states point into the loaded tables, not into the caches reset above
+  EnableProbeCache(StaticData::Instance().GetLMProbeCacheSize());
+
   return true;
 }
 
@@ -263,6 +266,8 @@ void LanguageModelIRST::CleanUpAfterSentenceProcessing(const InputType& source)
     TRACE_ERR( "reset caches\n");
     m_lmtb->reset_caches();
   }
+
+  LanguageModelPointerState::CleanUpAfterSentenceProcessing(source);
 }
 
 void LanguageModelIRST::InitializeBeforeSentenceProcessing()
@@ -61,7 +61,7 @@ struct KenLMState : public FFState {
  */
 template <class Model> class LanguageModelKen : public LanguageModel {
   public:
-    LanguageModelKen(const std::string &file, ScoreIndexManager &manager, FactorType factorType, bool lazy);
+    LanguageModelKen(const std::string &file, ScoreIndexManager &manager, FactorType factorType, util::LoadMethod loadMethod);
 
     LanguageModel *Duplicate(ScoreIndexManager &scoreIndexManager) const;
 
@@ -138,7 +138,7 @@ private:
   std::vector<lm::WordIndex> &m_mapping;
 };
 
-template <class Model> LanguageModelKen<Model>::LanguageModelKen(const std::string &file, ScoreIndexManager &manager, FactorType factorType, bool lazy) : m_factorType(factorType) {
+template <class Model> LanguageModelKen<Model>::LanguageModelKen(const std::string &file, ScoreIndexManager &manager, FactorType factorType, util::LoadMethod loadMethod) : m_factorType(factorType) {
   lm::ngram::Config config;
   IFVERBOSE(1) {
     config.messages = &std::cerr;
@@ -148,7 +148,7 @@ template <class Model> LanguageModelKen<Model>::LanguageModelKen(const std::stri
   FactorCollection &collection = FactorCollection::Instance();
   MappingBuilder builder(collection, m_lmIdLookup);
   config.enumerate_vocab = &builder;
-  config.load_method = lazy ? util::LAZY : util::POPULATE_OR_READ;
+  config.load_method = loadMethod;
 
   m_ngram.reset(new Model(file.c_str(), config));
 
@@ -323,29 +323,29 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateChart(const Cha
 
 } // namespace
 
-LanguageModel *ConstructKenLM(const std::string &file, ScoreIndexManager &manager, FactorType factorType, bool lazy) {
+LanguageModel *ConstructKenLM(const std::string &file, ScoreIndexManager &manager, FactorType factorType, util::LoadMethod loadMethod) {
   try {
     lm::ngram::ModelType model_type;
     if (lm::ngram::RecognizeBinary(file.c_str(), model_type)) {
       switch(model_type) {
         case lm::ngram::PROBING:
-          return new LanguageModelKen<lm::ngram::ProbingModel>(file, manager, factorType, lazy);
+          return new LanguageModelKen<lm::ngram::ProbingModel>(file, manager, factorType, loadMethod);
         case lm::ngram::REST_PROBING:
-          return new LanguageModelKen<lm::ngram::RestProbingModel>(file, manager, factorType, lazy);
+          return new LanguageModelKen<lm::ngram::RestProbingModel>(file, manager, factorType, loadMethod);
         case lm::ngram::TRIE:
-          return new LanguageModelKen<lm::ngram::TrieModel>(file, manager, factorType, lazy);
+          return new LanguageModelKen<lm::ngram::TrieModel>(file, manager, factorType, loadMethod);
         case lm::ngram::QUANT_TRIE:
-          return new LanguageModelKen<lm::ngram::QuantTrieModel>(file, manager, factorType, lazy);
+          return new LanguageModelKen<lm::ngram::QuantTrieModel>(file, manager, factorType, loadMethod);
         case lm::ngram::ARRAY_TRIE:
-          return new LanguageModelKen<lm::ngram::ArrayTrieModel>(file, manager, factorType, lazy);
+          return new LanguageModelKen<lm::ngram::ArrayTrieModel>(file, manager, factorType, loadMethod);
         case lm::ngram::QUANT_ARRAY_TRIE:
-          return new LanguageModelKen<lm::ngram::QuantArrayTrieModel>(file, manager, factorType, lazy);
+          return new LanguageModelKen<lm::ngram::QuantArrayTrieModel>(file, manager, factorType, loadMethod);
         default:
           std::cerr << "Unrecognized kenlm model type " << model_type << std::endl;
           abort();
       }
     } else {
-      return new LanguageModelKen<lm::ngram::ProbingModel>(file, manager, factorType, lazy);
+      return new LanguageModelKen<lm::ngram::ProbingModel>(file, manager, factorType, loadMethod);
     }
   } catch (std::exception &e) {
     std::cerr << e.what() << std::endl;
@@ -25,14 +25,16 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <string>
 
 #include "TypeDef.h"
+#include "util/mmap.hh"
 
 namespace Moses {
 
 class ScoreIndexManager;
 class LanguageModel;
 
-//! This will also load. Returns a templated KenLM class
-LanguageModel *ConstructKenLM(const std::string &file, ScoreIndexManager &manager, FactorType factorType, bool lazy);
+//! This will also load. Returns a templated KenLM class.  loadMethod says how
+//! the binary file gets into memory, e.g. lazy mmap or huge pages.
+LanguageModel *ConstructKenLM(const std::string &file, ScoreIndexManager &manager, FactorType factorType, util::LoadMethod loadMethod);
 
 } // namespace Moses
 
@@ -0,0 +1,110 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+
+#include "LM/ProbeCache.h"
+#include "Word.h"
+#include "util/check.hh"
+#include "util/murmur_hash.hh"
+
+namespace Moses
+{
+
+LMProbeCache::LMProbeCache(size_t entries, size_t order)
+  : m_order(order)
+{
+  if (entries < kStripes) entries = kStripes;
+  entries = (entries + kStripes - 1) / kStripes * kStripes;
+  Entry empty;
+  empty.hash = 0;
+  empty.size = 0;
+  empty.result.score = 0.0;
+  empty.result.unknown = false;
+  empty.state = NULL;
+  m_entries.resize(entries, empty);
+  m_factors.resize(entries * m_order, NULL);
+}
+
+void LMProbeCache::MakeNgram(const std::vector<const Word*> &contextFactor, FactorType factorType, Ngram &ngram)
+{
+  // Factors are unique and never freed, so their addresses identify words.
+  ngram.size = contextFactor.size();
+  CHECK(ngram.size <= MAX_NGRAM_SIZE);
+  for (size_t i = 0; i < ngram.size; ++i) {
+    ngram.factors[i] = (*contextFactor[i])[factorType];
+  }
+  ngram.hash = util::MurmurHashNative(ngram.factors, ngram.size * sizeof(const Factor*), ngram.size);
+}
+
+bool LMProbeCache::Matches(size_t slot, const Ngram &ngram) const
+{
+  const Entry &entry = m_entries[slot];
+  if (entry.size != ngram.size || entry.hash != ngram.hash) return false;
+  return std::equal(ngram.factors, ngram.factors + ngram.size, m_factors.begin() + slot * m_order);
+}
+
+bool LMProbeCache::Find(const Ngram &ngram, LMResult &result, const void *&state) const
+{
+  if (ngram.size == 0 || ngram.size > m_order) return false;
+  size_t slot = ngram.hash % m_entries.size();
+  Stripe &stripe = m_stripes[slot % kStripes];
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(stripe.lock);
+#endif
+  ++stripe.lookups;
+  if (!Matches(slot, ngram)) return false;
+  ++stripe.hits;
+  const Entry &entry = m_entries[slot];
+  result = entry.result;
+  state = entry.state;
+  return true;
+}
+
+void LMProbeCache::Insert(const Ngram &ngram, const LMResult &result, const void *state)
+{
+  if (ngram.size == 0 || ngram.size > m_order) return;
+  size_t slot = ngram.hash % m_entries.size();
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_stripes[slot % kStripes].lock);
+#endif
+  Entry &entry = m_entries[slot];
+  entry.hash = ngram.hash;
+  entry.size = ngram.size;
+  entry.result = result;
+  entry.state = state;
+  std::copy(ngram.factors, ngram.factors + ngram.size, m_factors.begin() + slot * m_order);
+}
+
+void LMProbeCache::GetStatistics(uint64_t &lookups, uint64_t &hits) const
+{
+  lookups = 0;
+  hits = 0;
+  for (size_t i = 0; i < kStripes; ++i) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_stripes[i].lock);
+#endif
+    lookups += m_stripes[i].lookups;
+    hits += m_stripes[i].hits;
+  }
+}
+
+}
@@ -0,0 +1,106 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_LanguageModelProbeCache_h
+#define moses_LanguageModelProbeCache_h
+
+#include <vector>
+#include <stdint.h>
+
+#include <boost/noncopyable.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "LM/Implementation.h"
+#include "TypeDef.h"
+
+namespace Moses
+{
+
+class Factor;
+class Word;
+
+/** Bounded cache of n-gram probes, shared by all sentences and threads.
+ * Entries are direct mapped by a 64-bit hash of the factor pointers, so a new
+ * n-gram evicts whatever was in its slot.  Each entry keeps the factors it was
+ * stored for and a hit must match them all, so hash collisions only cost a
+ * miss.  Locks are striped over the slots so threads rarely wait on each other.
+ */
+class LMProbeCache : boost::noncopyable
+{
+public:
+  //! n-gram as seen by one factor type, with its hash
+  struct Ngram {
+    const Factor *factors[MAX_NGRAM_SIZE];
+    size_t size;
+    uint64_t hash;
+  };
+
+  /** entries is rounded up to a multiple of the number of lock stripes.
+   * N-grams longer than order are never cached.
+   */
+  LMProbeCache(size_t entries, size_t order);
+
+  static void MakeNgram(const std::vector<const Word*> &contextFactor, FactorType factorType, Ngram &ngram);
+
+  //! on a hit, fill result and state and return true
+  bool Find(const Ngram &ngram, LMResult &result, const void *&state) const;
+
+  void Insert(const Ngram &ngram, const LMResult &result, const void *state);
+
+  size_t GetSize() const {
+    return m_entries.size();
+  }
+
+  //! totals since construction, summed over stripes
+  void GetStatistics(uint64_t &lookups, uint64_t &hits) const;
+
+private:
+  static const size_t kStripes = 64;
+
+  struct Entry {
+    uint64_t hash;
+    size_t size; // 0 for an empty slot
+    LMResult result;
+    const void *state;
+  };
+
+  struct Stripe {
+    Stripe() : lookups(0), hits(0) {}
+#ifdef WITH_THREADS
+    boost::mutex lock;
+#endif
+    uint64_t lookups, hits;
+  };
+
+  bool Matches(size_t slot, const Ngram &ngram) const;
+
+  const size_t m_order;
+  std::vector<Entry> m_entries;
+  // factors of entry i are m_factors[i * m_order, i * m_order + size)
+  std::vector<const Factor*> m_factors;
+  mutable Stripe m_stripes[kStripes];
+};
+
+}
+
+#endif
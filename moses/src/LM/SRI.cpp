@@ -69,6 +69,9 @@ bool LanguageModelSRI::Load(const std::string &filePath
   CreateFactors();
   m_unknownId = m_srilmVocab->unkIndex();
 
+  // context ids stay valid as long as the model is loaded
+  EnableProbeCache(StaticData::Instance().GetLMProbeCacheSize());
+
   return true;
 }
 
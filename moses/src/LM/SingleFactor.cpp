@@ -83,9 +83,36 @@ FFState *LanguageModelPointerState::NewState(const FFState *from) const
   return new PointerState(from ? static_cast<const PointerState*>(from)->lmstate : NULL);
 }
 
+void LanguageModelPointerState::EnableProbeCache(size_t entries)
+{
+  if (entries == 0) return;
+  m_probeCache.reset(new LMProbeCache(entries, m_nGramOrder));
+  VERBOSE(1, "LM probe cache for " << m_filePath << ": " << m_probeCache->GetSize() << " entries" << endl);
+}
+
+void LanguageModelPointerState::CleanUpAfterSentenceProcessing(const InputType& /*source*/)
+{
+  if (!m_probeCache.get()) return;
+  IFVERBOSE(1) {
+    uint64_t lookups, hits;
+    m_probeCache->GetStatistics(lookups, hits);
+    TRACE_ERR("LM probe cache for " << m_filePath << ": " << hits << " hits of " << lookups << " lookups ("
+              << (lookups ? 100.0 * hits / lookups : 0.0) << "%)" << endl);
+  }
+}
+
 LMResult LanguageModelPointerState::GetValueForgotState(const std::vector<const Word*> &contextFactor, FFState &outState) const
 {
-  return GetValue(contextFactor, &static_cast<PointerState&>(outState).lmstate);
+  State &state = static_cast<PointerState&>(outState).lmstate;
+  if (!m_probeCache.get()) return GetValue(contextFactor, &state);
+
+  LMProbeCache::Ngram ngram;
+  LMProbeCache::MakeNgram(contextFactor, m_factorType, ngram);
+  LMResult result;
+  if (m_probeCache->Find(ngram, result, state)) return result;
+  result = GetValue(contextFactor, &state);
+  m_probeCache->Insert(ngram, result, state);
+  return result;
 }
 
 }
@@ -22,7 +22,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_LanguageModelSingleFactor_h
 #define moses_LanguageModelSingleFactor_h
 
+#include <boost/scoped_ptr.hpp>
+
 #include "LM/Implementation.h"
+#include "LM/ProbeCache.h"
 #include "Phrase.h"
 
 namespace Moses
@@ -65,11 +68,14 @@ public:
 };
 
 // Single factor LM that uses a null pointer state.
+// Backends whose states stay valid for the life of the model may call
+// EnableProbeCache to keep probes in a cache shared by all sentences and threads.
 class LanguageModelPointerState : public LanguageModelSingleFactor
 {
 private:
   FFState *m_nullContextState;
   FFState *m_beginSentenceState;
+  boost::scoped_ptr<LMProbeCache> m_probeCache;
 protected:
   typedef const void *State;
 
@@ -77,6 +83,14 @@ protected:
 
   virtual ~LanguageModelPointerState();
 
+  //! cache up to entries probes.  0 leaves caching off.
+  void EnableProbeCache(size_t entries);
+
+public:
+  //! reports the probe cache hit rate
+  virtual void CleanUpAfterSentenceProcessing(const InputType& source);
+protected:
+
   virtual const FFState *GetNullContextState() const;
   virtual const FFState *GetBeginSentenceState() const;
   virtual FFState *NewState(const FFState *from = NULL) const;
@@ -76,13 +76,8 @@ FFState* LexicalReordering::Evaluate(const Hypothesis& hypo,
                                      const FFState* prev_state,
                                      ScoreComponentCollection* out) const
 {
-  Scores score(GetNumScoreComponents(), 0);
-  const LexicalReorderingState *prev = dynamic_cast<const LexicalReorderingState *>(prev_state);
-  LexicalReorderingState *next_state = prev->Expand(hypo.GetTranslationOption(), score);
-
-  out->PlusEquals(this, score);
-
-  return next_state;
+  const LexicalReorderingState *prev = static_cast<const LexicalReorderingState *>(prev_state);
+  return prev->Expand(hypo.GetTranslationOption(), out);
 }
 
 const FFState* LexicalReordering::EmptyHypothesisState(const InputType &input) const
@@ -65,6 +65,16 @@ public:
 
   Scores GetProb(const Phrase& f, const Phrase& e) const;
 
+  size_t GetCacheModel() const {
+    return m_configuration.GetCacheModel();
+  }
+  size_t GetCacheOffset() const {
+    return m_configuration.GetCacheOffset();
+  }
+  size_t GetCacheSize() const {
+    return m_configuration.GetCacheSize();
+  }
+
 private:
   bool DecodeCondition(std::string s);
   bool DecodeDirection(std::string s);
@@ -1,4 +1,7 @@
 
+#include <algorithm>
+#include <climits>
+#include <sstream>
 #include <vector>
 #include <string>
 #include "util/check.hh"
@@ -15,6 +18,9 @@
 namespace Moses
 {
 
+size_t LexicalReorderingConfiguration::s_numCacheModels = 0;
+size_t LexicalReorderingConfiguration::s_numCacheScores = 0;
+
 size_t LexicalReorderingConfiguration::GetNumberOfTypes() const
 {
   switch (m_modelType) {
@@ -86,6 +92,21 @@ LexicalReorderingConfiguration::LexicalReorderingConfiguration(ScoreProducer *sc
     UserMessage::Add("You need to specify the type of the reordering model (msd, monotonicity,...)");
     exit(1);
   }
+
+  // reserve room for our scores in the translation options.  Collapsed
+  // scores are still looked up by orientation, so they need more room.
+  const size_t score_per_dir = m_collapseScores ? 1 : GetNumberOfTypes();
+  m_cacheModel = s_numCacheModels++;
+  m_cacheOffset = s_numCacheScores;
+  m_cacheSize = std::max(GetNumScoreComponents(), (m_direction == Bidirectional ? score_per_dir : 0) + GetNumberOfTypes());
+  s_numCacheScores += m_cacheSize;
+  // translation options mark the models they have scores for in one word
+  if (s_numCacheModels > sizeof(unsigned int) * CHAR_BIT) {
+    std::ostringstream os;
+    os << "More than " << sizeof(unsigned int) * CHAR_BIT << " lexical reordering models";
+    UserMessage::Add(os.str());
+    exit(1);
+  }
 }
 
 LexicalReorderingState *LexicalReorderingConfiguration::CreateLexicalReorderingState(const InputType &input) const
@@ -118,35 +139,24 @@ LexicalReorderingState *LexicalReorderingConfiguration::CreateLexicalReorderingS
   return new BidirectionalReorderingState(*this, bwd, fwd, 0);
 }
 
-void LexicalReorderingState::CopyScores(Scores& scores, const TranslationOption &topt, ReorderingType reoType) const
+void LexicalReorderingState::CopyScores(ScoreComponentCollection* accumulator, const TranslationOption &topt, ReorderingType reoType) const
 {
   // don't call this on a bidirectional object
   CHECK(m_direction == LexicalReorderingConfiguration::Backward || m_direction == LexicalReorderingConfiguration::Forward);
-  const Scores *cachedScores = (m_direction == LexicalReorderingConfiguration::Backward) ?
-                               topt.GetCachedScores(m_configuration.GetScoreProducer()) : m_prevScore;
+  const float *cachedScores = (m_direction == LexicalReorderingConfiguration::Backward) ?
+                              topt.GetLexReorderingScores(m_configuration.GetCacheModel(), m_configuration.GetCacheOffset()) : m_prevScore;
 
   // No scores available. TODO: Using a good prior distribution would be nicer.
   if(cachedScores == NULL)
     return;
 
-  const Scores &scoreSet = *cachedScores;
-  if(m_configuration.CollapseScores())
-    scores[m_offset] = scoreSet[m_offset + reoType];
-  else {
-    std::fill(scores.begin() + m_offset, scores.begin() + m_offset + m_configuration.GetNumberOfTypes(), 0);
-    scores[m_offset + reoType] = scoreSet[m_offset + reoType];
-  }
-}
-
-void LexicalReorderingState::ClearScores(Scores& scores) const
-{
   if(m_configuration.CollapseScores())
-    scores[m_offset] = 0;
+    accumulator->PlusEquals(m_configuration.GetScoreProducer(), m_offset, cachedScores[m_offset + reoType]);
   else
-    std::fill(scores.begin() + m_offset, scores.begin() + m_offset + m_configuration.GetNumberOfTypes(), 0);
+    accumulator->PlusEquals(m_configuration.GetScoreProducer(), m_offset + reoType, cachedScores[m_offset + reoType]);
 }
 
-int LexicalReorderingState::ComparePrevScores(const Scores *other) const
+int LexicalReorderingState::ComparePrevScores(const float *other) const
 {
   if(m_prevScore == other)
     return 0;
@@ -157,12 +167,10 @@ int LexicalReorderingState::ComparePrevScores(const Scores *other) const
   if(m_prevScore == NULL)
     return 1;
 
-  const Scores &my = *m_prevScore;
-  const Scores &their = *other;
   for(size_t i = m_offset; i < m_offset + m_configuration.GetNumberOfTypes(); i++)
-    if(my[i] < their[i])
+    if(m_prevScore[i] < other[i])
       return -1;
-    else if(my[i] > their[i])
+    else if(m_prevScore[i] > other[i])
       return 1;
 
   return 0;
@@ -196,15 +204,14 @@ int PhraseBasedReorderingState::Compare(const FFState& o) const
   return 1;
 }
 
-LexicalReorderingState* PhraseBasedReorderingState::Expand(const TranslationOption& topt, Scores& scores) const
+LexicalReorderingState* PhraseBasedReorderingState::Expand(const TranslationOption& topt, ScoreComponentCollection* accumulator) const
 {
   ReorderingType reoType;
   const WordsRange currWordsRange = topt.GetSourceWordsRange();
   const LexicalReorderingConfiguration::ModelType modelType = m_configuration.GetModelType();
 
-  if (m_direction == LexicalReorderingConfiguration::Forward && m_first) {
-    ClearScores(scores);
-  } else {
+  // the forward model scores the previous phrase, so there is nothing to score yet
+  if (m_direction != LexicalReorderingConfiguration::Forward || !m_first) {
     if (modelType == LexicalReorderingConfiguration::MSD) {
       reoType = GetOrientationTypeMSD(currWordsRange);
     } else if (modelType == LexicalReorderingConfiguration::MSLR) {
@@ -215,7 +222,7 @@ LexicalReorderingState* PhraseBasedReorderingState::Expand(const TranslationOpti
       reoType = GetOrientationTypeLeftRight(currWordsRange);
     }
 
-    CopyScores(scores, topt, reoType);
+    CopyScores(accumulator, topt, reoType);
   }
 
   return new PhraseBasedReorderingState(this, topt);
@@ -293,10 +300,10 @@ int BidirectionalReorderingState::Compare(const FFState& o) const
     return m_forward->Compare(*other.m_forward);
 }
 
-LexicalReorderingState* BidirectionalReorderingState::Expand(const TranslationOption& topt, Scores& scores) const
+LexicalReorderingState* BidirectionalReorderingState::Expand(const TranslationOption& topt, ScoreComponentCollection* accumulator) const
 {
-  LexicalReorderingState *newbwd = m_backward->Expand(topt, scores);
-  LexicalReorderingState *newfwd = m_forward->Expand(topt, scores);
+  LexicalReorderingState *newbwd = m_backward->Expand(topt, accumulator);
+  LexicalReorderingState *newfwd = m_forward->Expand(topt, accumulator);
   return new BidirectionalReorderingState(m_configuration, newbwd, newfwd, m_offset);
 }
 
@@ -317,7 +324,7 @@ int HierarchicalReorderingBackwardState::Compare(const FFState& o) const
   return m_reoStack.Compare(other.m_reoStack);
 }
 
-LexicalReorderingState* HierarchicalReorderingBackwardState::Expand(const TranslationOption& topt, Scores& scores) const
+LexicalReorderingState* HierarchicalReorderingBackwardState::Expand(const TranslationOption& topt, ScoreComponentCollection* accumulator) const
 {
 
   HierarchicalReorderingBackwardState* nextState = new HierarchicalReorderingBackwardState(this, topt, m_reoStack);
@@ -336,7 +343,7 @@ LexicalReorderingState* HierarchicalReorderingBackwardState::Expand(const Transl
     reoType = GetOrientationTypeMonotonic(reoDistance);
   }
 
-  CopyScores(scores, topt, reoType);
+  CopyScores(accumulator, topt, reoType);
   return nextState;
 }
 
@@ -420,36 +427,34 @@ int HierarchicalReorderingForwardState::Compare(const FFState& o) const
 //  dright: if the next phrase follows the conditioning phrase and other stuff comes in between
 //  dleft:  if the next phrase precedes the conditioning phrase and other stuff comes in between
 
-LexicalReorderingState* HierarchicalReorderingForwardState::Expand(const TranslationOption& topt, Scores& scores) const
+LexicalReorderingState* HierarchicalReorderingForwardState::Expand(const TranslationOption& topt, ScoreComponentCollection* accumulator) const
 {
   const LexicalReorderingConfiguration::ModelType modelType = m_configuration.GetModelType();
   const WordsRange currWordsRange = topt.GetSourceWordsRange();
-  // keep track of the current coverage ourselves so we don't need the hypothesis
-  WordsBitmap coverage = m_coverage;
-  coverage.SetValue(currWordsRange.GetStartPos(), currWordsRange.GetEndPos(), true);
+  // we keep track of the coverage ourselves so we don't need the hypothesis.
+  // The orientation tests give the same answer whether or not the current
+  // phrase has been added to it, so it is used as it is.
 
   ReorderingType reoType;
 
-  if (m_first) {
-    ClearScores(scores);
-  } else {
+  if (!m_first) {
     if (modelType == LexicalReorderingConfiguration::MSD) {
-      reoType = GetOrientationTypeMSD(currWordsRange, coverage);
+      reoType = GetOrientationTypeMSD(currWordsRange, m_coverage);
     } else if (modelType == LexicalReorderingConfiguration::MSLR) {
-      reoType = GetOrientationTypeMSLR(currWordsRange, coverage);
+      reoType = GetOrientationTypeMSLR(currWordsRange, m_coverage);
     } else if (modelType == LexicalReorderingConfiguration::Monotonic) {
-      reoType = GetOrientationTypeMonotonic(currWordsRange, coverage);
+      reoType = GetOrientationTypeMonotonic(currWordsRange, m_coverage);
     } else {
-      reoType = GetOrientationTypeLeftRight(currWordsRange, coverage);
+      reoType = GetOrientationTypeLeftRight(currWordsRange, m_coverage);
     }
 
-    CopyScores(scores, topt, reoType);
+    CopyScores(accumulator, topt, reoType);
   }
 
   return new HierarchicalReorderingForwardState(this, topt);
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSD(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSD(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -461,7 +466,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return D;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSLR(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSLR(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -475,7 +480,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return DL;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMonotonic(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMonotonic(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -484,7 +489,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return NM;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeLeftRight(WordsRange currRange, WordsBitmap /* coverage */) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeLeftRight(WordsRange currRange, const WordsBitmap & /* coverage */) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos()) {
     return R;
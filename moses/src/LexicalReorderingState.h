@@ -58,6 +58,17 @@ public:
     return m_collapseScores;
   }
 
+  //! where the scores of this model are kept in each TranslationOption
+  size_t GetCacheModel() const {
+    return m_cacheModel;
+  }
+  size_t GetCacheOffset() const {
+    return m_cacheOffset;
+  }
+  size_t GetCacheSize() const {
+    return m_cacheSize;
+  }
+
 private:
   ScoreProducer *m_scoreProducer;
   ModelType m_modelType;
@@ -65,6 +76,12 @@ private:
   bool m_collapseScores;
   Direction m_direction;
   Condition m_condition;
+  size_t m_cacheModel;
+  size_t m_cacheOffset;
+  size_t m_cacheSize;
+
+  static size_t s_numCacheModels;
+  static size_t s_numCacheScores;
 };
 
 //! Abstract class for lexical reordering model states
@@ -73,7 +90,7 @@ class LexicalReorderingState : public FFState
 public:
 
   virtual int Compare(const FFState& o) const = 0;
-  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, Scores& scores) const = 0;
+  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, ScoreComponentCollection* accumulator) const = 0;
 
   static LexicalReorderingState* CreateLexicalReorderingState(const std::vector<std::string>& config,
       LexicalReorderingConfiguration::Direction dir, const InputType &input);
@@ -85,19 +102,18 @@ protected:
   // The following is the true direction of the object, which can be Backward or Forward even if the Configuration has Bidirectional.
   LexicalReorderingConfiguration::Direction m_direction;
   size_t m_offset;
-  const Scores *m_prevScore;
+  const float *m_prevScore;
 
   inline LexicalReorderingState(const LexicalReorderingState *prev, const TranslationOption &topt) :
     m_configuration(prev->m_configuration), m_direction(prev->m_direction), m_offset(prev->m_offset),
-    m_prevScore(topt.GetCachedScores(m_configuration.GetScoreProducer())) {}
+    m_prevScore(topt.GetLexReorderingScores(m_configuration.GetCacheModel(), m_configuration.GetCacheOffset())) {}
 
   inline LexicalReorderingState(const LexicalReorderingConfiguration &config, LexicalReorderingConfiguration::Direction dir, size_t offset)
     : m_configuration(config), m_direction(dir), m_offset(offset), m_prevScore(NULL) {}
 
-  // copy the right scores in the right places, taking into account forward/backward, offset, collapse
-  void CopyScores(Scores& scores, const TranslationOption& topt, ReorderingType reoType) const;
-  void ClearScores(Scores& scores) const;
-  int ComparePrevScores(const Scores *other) const;
+  // add the right score in the right place, taking into account forward/backward, offset, collapse
+  void CopyScores(ScoreComponentCollection* accumulator, const TranslationOption& topt, ReorderingType reoType) const;
+  int ComparePrevScores(const float *other) const;
 
   //constants for the different type of reorderings (corresponding to indexes in the table file)
   static const ReorderingType M = 0;  // monotonic
@@ -126,7 +142,7 @@ public:
   }
 
   virtual int Compare(const FFState& o) const;
-  virtual LexicalReorderingState* Expand(const TranslationOption& topt, Scores& scores) const;
+  virtual LexicalReorderingState* Expand(const TranslationOption& topt, ScoreComponentCollection* accumulator) const;
 };
 
 //! State for the standard Moses implementation of lexical reordering models
@@ -141,7 +157,7 @@ public:
   PhraseBasedReorderingState(const PhraseBasedReorderingState *prev, const TranslationOption &topt);
 
   virtual int Compare(const FFState& o) const;
-  virtual LexicalReorderingState* Expand(const TranslationOption& topt, Scores& scores) const;
+  virtual LexicalReorderingState* Expand(const TranslationOption& topt, ScoreComponentCollection* accumulator) const;
 
   ReorderingType GetOrientationTypeMSD(WordsRange currRange) const;
   ReorderingType GetOrientationTypeMSLR(WordsRange currRange) const;
@@ -162,7 +178,7 @@ public:
                                       const TranslationOption &topt, ReorderingStack reoStack);
 
   virtual int Compare(const FFState& o) const;
-  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, Scores& scores) const;
+  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, ScoreComponentCollection* accumulator) const;
 
 private:
   ReorderingType GetOrientationTypeMSD(int reoDistance) const;
@@ -185,13 +201,13 @@ public:
   HierarchicalReorderingForwardState(const HierarchicalReorderingForwardState *prev, const TranslationOption &topt);
 
   virtual int Compare(const FFState& o) const;
-  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, Scores& scores) const;
+  virtual LexicalReorderingState* Expand(const TranslationOption& hypo, ScoreComponentCollection* accumulator) const;
 
 private:
-  ReorderingType GetOrientationTypeMSD(WordsRange currRange, WordsBitmap coverage) const;
-  ReorderingType GetOrientationTypeMSLR(WordsRange currRange, WordsBitmap coverage) const;
-  ReorderingType GetOrientationTypeMonotonic(WordsRange currRange, WordsBitmap coverage) const;
-  ReorderingType GetOrientationTypeLeftRight(WordsRange currRange, WordsBitmap coverage) const;
+  ReorderingType GetOrientationTypeMSD(WordsRange currRange, const WordsBitmap &coverage) const;
+  ReorderingType GetOrientationTypeMSLR(WordsRange currRange, const WordsBitmap &coverage) const;
+  ReorderingType GetOrientationTypeMonotonic(WordsRange currRange, const WordsBitmap &coverage) const;
+  ReorderingType GetOrientationTypeLeftRight(WordsRange currRange, const WordsBitmap &coverage) const;
 };
 
 }
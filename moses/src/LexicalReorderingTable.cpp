@@ -7,6 +7,7 @@
 #include "GenerationDictionary.h"
 #include "TargetPhrase.h"
 #include "TargetPhraseCollection.h"
+#include "PrefixTreeCreator.h"
 
 #ifndef WIN32
 #include "CompactPT/LexicalReorderingTableCompact.h"  
@@ -334,191 +335,141 @@ void LexicalReorderingTableTree::InitializeForInput(const InputType& input)
   }
 };
 
-bool LexicalReorderingTableTree::Create(std::istream& inFile,
-                                        const std::string& outFileName)
+namespace
 {
-  std::string line;
-  //TRACE_ERR("Entering Create...\n");
-  std::string
-  ofn(outFileName+".binlexr.srctree"),
-      oft(outFileName+".binlexr.tgtdata"),
-      ofi(outFileName+".binlexr.idx"),
-      ofsv(outFileName+".binlexr.voc0"),
-      oftv(outFileName+".binlexr.voc1");
-
 
-  FILE *os = fOpen(ofn.c_str(),"wb");
-  FILE *ot = fOpen(oft.c_str(),"wb");
-
-  //TRACE_ERR("opend files....\n");
+// the lines of a text lexical reordering table, for PrefixTreeCreator:
+// f ||| score, f ||| e ||| score or f ||| e ||| c ||| score, where e and c
+// share a vocabulary
+class LexicalTableLines
+{
+public:
+  struct Entry {
+    IPhrase key;
+    std::vector<IPhrase> phrases;
+    Scores score;
+  };
+  typedef Candidates Cands;
 
-  typedef PrefixTreeSA<LabelId,OFF_T> PSA;
-  PSA *psa = new PSA;
-  PSA::setDefault(InvalidOffT);
-  WordVoc* voc[3];
+  LexicalTableLines() : m_numTokens(0), m_numKeyTokens(0) {}
 
-  LabelId currFirstWord = InvalidLabelId;
-  IPhrase currKey;
+  void Init(const std::string& line) {
+    m_numTokens = TokenizeMultiCharSeparator(line, "|||").size();
+    CHECK(m_numTokens >= 2 && m_numTokens <= 4);
+    m_numKeyTokens = (m_numTokens == 2) ? 1 : 2;
+  }
 
-  Candidates         cands;
-  std::vector<OFF_T> vo;
-  size_t lnc = 0;
-  size_t numTokens    = 0;
-  size_t numKeyTokens = 0;
-  while(getline(inFile, line)) {
-    ++lnc;
-    if(0 == lnc % 10000) {
-      TRACE_ERR(".");
-    }
-    IPhrase key;
-    Scores   score;
+  size_t NumVocs() const {
+    return m_numKeyTokens;
+  }
 
+  bool Parse(const std::string& line, size_t, std::vector<WordVoc>& vocs, Entry& entry) const {
     std::vector<std::string> tokens = TokenizeMultiCharSeparator(line, "|||");
+    //sanity check ALL lines must have same number of tokens
+    CHECK(m_numTokens == tokens.size());
     std::string w;
-    if(1 == lnc) {
-      //do some init stuff in the first line
-      numTokens = tokens.size();
-      if(tokens.size() == 2) { //f ||| score
-        numKeyTokens = 1;
-        voc[0] = new WordVoc();
-        voc[1] = 0;
-      } else if(3 == tokens.size() || 4 == tokens.size()) { //either f ||| e ||| score or f ||| e ||| c ||| score
-        numKeyTokens = 2;
-        voc[0] = new WordVoc(); //f voc
-        voc[1] = new WordVoc(); //e voc
-        voc[2] = voc[1];        //c & e share voc
-      }
-    } else {
-      //sanity check ALL lines must have same number of tokens
-      CHECK(numTokens == tokens.size());
-    }
-    size_t phrase = 0;
-    for(; phrase < numKeyTokens; ++phrase) {
+    for(size_t phrase = 0; phrase < m_numKeyTokens; ++phrase) {
       //conditioned on more than just f... need |||
-      if(phrase >=1) {
-        key.push_back(PrefixTreeMap::MagicWord);
+      if(phrase >= 1) {
+        entry.key.push_back(PrefixTreeMap::MagicWord);
       }
       std::istringstream is(tokens[phrase]);
       while(is >> w) {
-        key.push_back(voc[phrase]->add(w));
+        entry.key.push_back(vocs[phrase].add(w));
       }
     }
     //collect all non key phrases, i.e. c
-    std::vector<IPhrase> tgt_phrases;
-    tgt_phrases.resize(numTokens - numKeyTokens - 1);
-    for(size_t j = 0; j < tgt_phrases.size(); ++j, ++phrase) {
-      std::istringstream is(tokens[numKeyTokens + j]);
+    entry.phrases.resize(m_numTokens - m_numKeyTokens - 1);
+    for(size_t j = 0; j < entry.phrases.size(); ++j) {
+      std::istringstream is(tokens[m_numKeyTokens + j]);
       while(is >> w) {
-        tgt_phrases[j].push_back(voc[phrase]->add(w));
+        entry.phrases[j].push_back(vocs[1].add(w));
       }
     }
     //last token is score
-    std::istringstream is(tokens[numTokens-1]);
+    std::istringstream is(tokens[m_numTokens-1]);
     while(is >> w) {
-      score.push_back(atof(w.c_str()));
+      entry.score.push_back(atof(w.c_str()));
     }
     //transform score now...
-    std::transform(score.begin(),score.end(),score.begin(),TransformScore);
-    std::transform(score.begin(),score.end(),score.begin(),FloorScore);
-    std::vector<Scores> scores;
-    scores.push_back(score);
-
-    if(key.empty()) {
-      TRACE_ERR("WARNING: empty source phrase in line '"<<line<<"'\n");
-      continue;
-    }
-    //first time inits
-    if(currFirstWord == InvalidLabelId) {
-      currFirstWord = key[0];
-    }
-    if(currKey.empty()) {
-      currKey = key;
-      //insert key into tree
-      CHECK(psa);
-      PSA::Data& d = psa->insert(key);
-      if(d == InvalidOffT) {
-        d = fTell(ot);
+    std::transform(entry.score.begin(),entry.score.end(),entry.score.begin(),TransformScore);
+    std::transform(entry.score.begin(),entry.score.end(),entry.score.begin(),FloorScore);
+    return !entry.key.empty();
+  }
+
+  void Remap(Entry& entry, const std::vector<std::vector<LabelId> >& ids) const {
+    size_t voc = 0;
+    for(size_t i = 0; i < entry.key.size(); ++i) {
+      if(entry.key[i] == PrefixTreeMap::MagicWord) {
+        voc = 1;
       } else {
-        TRACE_ERR("ERROR: source phrase already inserted (A)!\nline(" << lnc << "): '" << line << "\n");
-        return false;
+        entry.key[i] = ids[voc][entry.key[i]];
       }
     }
-    if(currKey != key) {
-      //ok new key
-      currKey = key;
-      //a) write cands for old key
-      cands.writeBin(ot);
-      cands.clear();
-      //b) check if we need to move on to new tree root
-      if(key[0] != currFirstWord) {
-        // write key prefix tree to file and clear
-        PTF pf;
-        if(currFirstWord >= vo.size()) {
-          vo.resize(currFirstWord+1,InvalidOffT);
-        }
-        vo[currFirstWord] = fTell(os);
-        pf.create(*psa, os);
-        // clear
-        delete psa;
-        psa = new PSA;
-        currFirstWord = key[0];
-      }
-      //c) insert key into tree
-      CHECK(psa);
-      PSA::Data& d = psa->insert(key);
-      if(d == InvalidOffT) {
-        d = fTell(ot);
-      } else {
-        TRACE_ERR("ERROR: source phrase already inserted (A)!\nline(" << lnc << "): '" << line << "\n");
-        return false;
+    for(size_t j = 0; j < entry.phrases.size(); ++j) {
+      for(size_t i = 0; i < entry.phrases[j].size(); ++i) {
+        entry.phrases[j][i] = ids[1][entry.phrases[j][i]];
       }
     }
-    cands.push_back(GenericCandidate(tgt_phrases, scores));
   }
-  if (lnc == 0) {
-    TRACE_ERR("ERROR: empty lexicalised reordering file\n" << std::endl);
-    return false;
+
+  void Add(Cands& cands, const Entry& entry) const {
+    cands.push_back(GenericCandidate(entry.phrases, std::vector<Scores>(1, entry.score)));
   }
-  //flush remainders
-  cands.writeBin(ot);
-  cands.clear();
-  //process last currFirstWord
-  PTF pf;
-  if(currFirstWord >= vo.size()) {
-    vo.resize(currFirstWord+1,InvalidOffT);
+
+  void Write(const Cands& cands, FILE* f) const {
+    cands.writeBin(f);
   }
-  vo[currFirstWord] = fTell(os);
-  pf.create(*psa,os);
-  delete psa;
-  psa=0;
+
+private:
+  size_t m_numTokens;
+  size_t m_numKeyTokens;
+};
+
+}
+
+bool LexicalReorderingTableTree::Create(std::istream& inFile,
+                                        const std::string& outFileName,
+                                        size_t threads)
+{
+  std::string
+  ofn(outFileName+".binlexr.srctree"),
+      oft(outFileName+".binlexr.tgtdata"),
+      ofi(outFileName+".binlexr.idx"),
+      ofsv(outFileName+".binlexr.voc0"),
+      oftv(outFileName+".binlexr.voc1");
+
+
+  FILE *os = fOpen(ofn.c_str(),"wb");
+  FILE *ot = fOpen(oft.c_str(),"wb");
+
+  WordVoc voc0, voc1;
+  std::vector<WordVoc*> vocs;
+  vocs.push_back(&voc0);
+  vocs.push_back(&voc1);
+  std::vector<OFF_T> vo;
+
+  LexicalTableLines lines;
+  PrefixTreeCreator<LexicalTableLines> creator(lines, threads);
+  bool ok = creator.Create(inFile, os, ot, vo, vocs);
 
   fClose(os);
   fClose(ot);
-  /*
-  std::vector<size_t> inv;
-  for(size_t i = 0; i < vo.size(); ++i){
-    if(vo[i] == InvalidOffT){
-      inv.push_back(i);
-    }
+  if(!ok) {
+    return false;
   }
-  if(inv.size()) {
-    TRACE_ERR("WARNING: there are src voc entries with no phrase "
-        "translation: count "<<inv.size()<<"\n"
-        "There exists phrase translations for "<<vo.size()-inv.size()
-        <<" entries\n");
+  if (creator.GetNumLines() == 0) {
+    TRACE_ERR("ERROR: empty lexicalised reordering file\n" << std::endl);
+    return false;
   }
-  */
+
   FILE *oi = fOpen(ofi.c_str(),"wb");
   fWriteVector(oi,vo);
   fClose(oi);
 
-  if(voc[0]) {
-    voc[0]->Write(ofsv);
-    delete voc[0];
-  }
-  if(voc[1]) {
-    voc[1]->Write(oftv);
-    delete voc[1];
+  voc0.Write(ofsv);
+  if(lines.NumVocs() > 1) {
+    voc1.Write(oftv);
   }
   return true;
 }
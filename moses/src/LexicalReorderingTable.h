@@ -125,7 +125,8 @@ public:
     auxCacheForSrcPhrase(f);
   }
 public:
-  static bool Create(std::istream& inFile, const std::string& outFileName);
+  // threads parse the input and build the trees; the files do not depend on it
+  static bool Create(std::istream& inFile, const std::string& outFileName, size_t threads = 1);
 private:
   std::string MakeCacheKey(const Phrase& f, const Phrase& e) const;
   IPhrase     MakeTableKey(const Phrase& f, const Phrase& e) const;
@@ -0,0 +1,86 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2009 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <sstream>
+
+#include "LineInput.h"
+#include "Sentence.h"
+#include "TreeInput.h"
+#include "WordLattice.h"
+
+namespace Moses
+{
+
+bool IsLineInput(InputTypeEnum inputType)
+{
+  return inputType == SentenceInput || inputType == WordLatticeInput || inputType == TreeInputType;
+}
+
+bool ReadInputLine(std::istream &in, std::string &line)
+{
+  if (!getline(in, line, '\n')) return false;
+  // Sentence::Read tells a last line without newline apart, so keep it.
+  if (!in.eof()) line += '\n';
+  return true;
+}
+
+InputType *ParseInputLine(InputTypeEnum inputType, const std::string &line, const std::vector<FactorType> &factorOrder)
+{
+  InputType *input;
+  switch (inputType) {
+  case SentenceInput:
+    input = new Sentence;
+    break;
+  case WordLatticeInput:
+    input = new WordLattice;
+    break;
+  case TreeInputType:
+    input = new TreeInput;
+    break;
+  default:
+    return NULL;
+  }
+  std::istringstream in(line);
+  if (!input->Read(in, factorOrder)) {
+    delete input;
+    return NULL;
+  }
+  return input;
+}
+
+void TranslationIdSequencer::Assign(size_t index, InputType *input)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+  while (index != m_nextIndex) m_turn.wait(lock);
+#endif
+  if (input) {
+    if (long x = input->GetTranslationId()) {
+      if (x >= m_nextId) m_nextId = x + 1;
+    } else input->SetTranslationId(m_nextId++);
+  }
+  ++m_nextIndex;
+#ifdef WITH_THREADS
+  m_turn.notify_all();
+#endif
+}
+
+}
@@ -0,0 +1,77 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2009 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_LineInput_h
+#define moses_LineInput_h
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "TypeDef.h"
+
+namespace Moses
+{
+
+class InputType;
+
+/** Input types that hold one input per line.  These can be read as raw lines
+ * on the reading thread and parsed (markup, factors, interning) later, on the
+ * thread that translates them.
+ */
+bool IsLineInput(InputTypeEnum inputType);
+
+//! read one line, keeping its newline.  False at the end of input.
+bool ReadInputLine(std::istream &in, std::string &line);
+
+//! parse a line from ReadInputLine.  NULL where InputType::Read would fail.
+InputType *ParseInputLine(InputTypeEnum inputType, const std::string &line, const std::vector<FactorType> &factorOrder);
+
+/** Gives inputs that were parsed out of order their translation ids in input
+ * order, as IOWrapper::GetInput does: an input with an id of its own (e.g.
+ * <seg id="7">) keeps it and moves the counter past it, the others take the
+ * next id.  Assign for index i waits until all indices before i are assigned.
+ */
+class TranslationIdSequencer
+{
+public:
+  explicit TranslationIdSequencer(long firstId) : m_nextIndex(0), m_nextId(firstId) {}
+
+  //! input may be NULL if the line did not parse
+  void Assign(size_t index, InputType *input);
+
+private:
+  size_t m_nextIndex;
+  long m_nextId;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+  boost::condition_variable m_turn;
+#endif
+};
+
+}
+
+#endif
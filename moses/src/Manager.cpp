@@ -28,17 +28,19 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <boost/unordered_set.hpp>
 #include "Manager.h"
 #include "TypeDef.h"
 #include "Util.h"
 #include "TargetPhrase.h"
 #include "TrellisPath.h"
-#include "TrellisPathCollection.h"
+#include "TrellisPathEnumerator.h"
 #include "TranslationOption.h"
 #include "LexicalReordering.h"
 #include "LMList.h"
 #include "TranslationOptionCollection.h"
 #include "DummyScoreProducers.h"
+#include "SearchGraphBinary.h"
 #ifdef HAVE_PROTOBUF
 #include "hypergraph.pb.h"
 #include "rule.pb.h"
@@ -191,11 +193,12 @@ void Manager::printThisHypothesis(long translationId, const Hypothesis* hypo, co
 /**
  * After decoding, the hypotheses in the stacks and additional arcs
  * form a search graph that can be mined for n-best lists.
- * The heavy lifting is done in the TrellisPath and TrellisPathCollection
+ * Paths are enumerated best first by TrellisPathEnumerator;
  * this function controls this for one sentence.
  *
  * \param count the number of n-best translations to produce
  * \param ret holds the n-best list that was calculated
+ * \param onlyDistinct skip paths whose surface string has been output already
  */
 void Manager::CalcNBest(size_t count, TrellisPathList &ret,bool onlyDistinct) const
 {
@@ -209,49 +212,29 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret,bool onlyDistinct) co
   if (sortedPureHypo.size() == 0)
     return;
 
-  TrellisPathCollection contenders;
+  TrellisPathEnumerator contenders(sortedPureHypo);
 
-  set<Phrase> distinctHyps;
-
-  // add all pure paths
-  vector<const Hypothesis*>::const_iterator iterBestHypo;
-  for (iterBestHypo = sortedPureHypo.begin()
-                      ; iterBestHypo != sortedPureHypo.end()
-       ; ++iterBestHypo) {
-    contenders.Add(new TrellisPath(*iterBestHypo));
-  }
+  // surface strings are compared by hash only
+  const std::vector<FactorType> &outputFactors = StaticData::Instance().GetOutputFactorOrder();
+  boost::unordered_set<size_t> distinctHyps;
 
   // factor defines stopping point for distinct n-best list if too many candidates identical
   size_t nBestFactor = StaticData::Instance().GetNBestFactor();
   if (nBestFactor < 1) nBestFactor = 1000; // 0 = unlimited
 
   // MAIN loop
-  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && contenders.GetSize() > 0 && (iteration < count * nBestFactor) ; iteration++) {
-    // get next best from list of contenders
-    TrellisPath *path = contenders.pop();
-    CHECK(path);
-    // create deviations from current best
-    path->CreateDeviantPaths(contenders);
-    if(onlyDistinct) {
-      Phrase tgtPhrase = path->GetSurfacePhrase();
-      if (distinctHyps.insert(tgtPhrase).second) {
-        ret.Add(path);
-      } else {
-        delete path;
-        path = NULL;
-      }
-    } else {
-      ret.Add(path);
+  vector<const Hypothesis*> edges;
+  float score;
+  for (size_t iteration = 0 ; ret.GetSize() < count && (iteration < count * nBestFactor) && contenders.Next(edges, score) ; iteration++) {
+    if (onlyDistinct && !distinctHyps.insert(HashSurface(edges, outputFactors)).second) {
+      continue;
     }
+    // TrellisPath wants the edges in forward order
+    ret.Add(new TrellisPath(vector<const Hypothesis*>(edges.rbegin(), edges.rend())));
+  }
 
-
-    if(onlyDistinct) {
-      const size_t nBestFactor = StaticData::Instance().GetNBestFactor();
-      if (nBestFactor > 0)
-        contenders.Prune(count * nBestFactor);
-    } else {
-      contenders.Prune(count);
-    }
+  IFVERBOSE(2) {
+    TRACE_ERR("n-best: " << ret.GetSize() << " paths, " << contenders.GetNumCandidates() << " candidates" << endl);
   }
 }
 
@@ -887,6 +870,20 @@ void Manager::SerializeSearchGraphPB(
 }
 #endif
 
+void WriteSearchGraphBinaryNode(SearchGraphBinaryWriter &writer, SearchGraphBinaryNode &node,
+                                const Hypothesis *hypo, const vector<FactorType> &outputFactorOrder)
+{
+  const Hypothesis *prevHypo = hypo->GetPrevHypo();
+  const WordsRange &range = hypo->GetCurrSourceWordsRange();
+  node.id = hypo->GetId();
+  node.back = prevHypo ? prevHypo->GetId() : -1;
+  node.startPos = range.GetStartPos();
+  node.endPos = range.GetEndPos();
+  node.score = hypo->GetScore();
+  node.transition = prevHypo ? hypo->GetScore() - prevHypo->GetScore() : 0.0f;
+  writer.AddNode(node, hypo->GetCurrTargetPhrase().GetStringRep(outputFactorOrder));
+}
+
 void Manager::OutputSearchGraph(long translationId, std::ostream &outputSearchGraphStream) const
 {
   vector<SearchGraphNode> searchGraph;
@@ -896,6 +893,66 @@ void Manager::OutputSearchGraph(long translationId, std::ostream &outputSearchGr
   }
 }
 
+void Manager::OutputSearchGraphBinary(long translationId, std::ostream &outputSearchGraphStream) const
+{
+  const vector<FactorType> &outputFactorOrder = StaticData::Instance().GetOutputFactorOrder();
+  const std::vector < HypothesisStack* > &hypoStackColl = m_search->GetHypothesisStacks();
+
+  // *** find connected hypotheses, indexed by id rather than through a map ***
+  std::vector< bool > connected(m_hypoId, false);
+  std::vector< const Hypothesis *> connectedList;
+  const HypothesisStack &finalStack = *hypoStackColl.back();
+  HypothesisStack::const_iterator iterHypo;
+  for (iterHypo = finalStack.begin() ; iterHypo != finalStack.end() ; ++iterHypo) {
+    connected[ (*iterHypo)->GetId() ] = true;
+    connectedList.push_back( *iterHypo );
+  }
+  for(size_t i=0; i<connectedList.size(); i++) {
+    const Hypothesis *hypo = connectedList[i];
+    const Hypothesis *prevHypo = hypo->GetPrevHypo();
+    if (prevHypo && !connected[ prevHypo->GetId() ]) {
+      connected[ prevHypo->GetId() ] = true;
+      connectedList.push_back( prevHypo );
+    }
+    const ArcList *arcList = hypo->GetArcList();
+    if (arcList != NULL) {
+      ArcList::const_iterator iterArcList;
+      for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
+        const Hypothesis *loserHypo = *iterArcList;
+        if (!connected[ loserHypo->GetId() ]) {
+          connected[ loserHypo->GetId() ] = true;
+          connectedList.push_back( loserHypo );
+        }
+      }
+    }
+  }
+  std::vector< const Hypothesis *>().swap(connectedList);
+
+  // *** write one stack at a time ***
+  SearchGraphBinaryWriter writer(outputSearchGraphStream, translationId, hypoStackColl.size());
+  SearchGraphBinaryNode node;
+  std::vector < HypothesisStack* >::const_iterator iterStack;
+  for (iterStack = hypoStackColl.begin() ; iterStack != hypoStackColl.end() ; ++iterStack) {
+    const HypothesisStack &stack = **iterStack;
+    for (iterHypo = stack.begin() ; iterHypo != stack.end() ; ++iterHypo) {
+      const Hypothesis *hypo = *iterHypo;
+      if (!connected[ hypo->GetId() ]) continue;
+      node.recombined = -1;
+      WriteSearchGraphBinaryNode(writer, node, hypo, outputFactorOrder);
+
+      const ArcList *arcList = hypo->GetArcList();
+      if (arcList != NULL) {
+        ArcList::const_iterator iterArcList;
+        for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
+          node.recombined = hypo->GetId();
+          WriteSearchGraphBinaryNode(writer, node, *iterArcList, outputFactorOrder);
+        }
+      }
+    }
+    writer.EndStack();
+  }
+}
+
 void Manager::GetForwardBackwardSearchGraph(std::map< int, bool >* pConnected,
     std::vector< const Hypothesis* >* pConnectedList, std::map < const Hypothesis*, set< const Hypothesis* > >* pOutgoingHyps, vector< float>* pFwdBwdScores) const
 {
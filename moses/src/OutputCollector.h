@@ -22,7 +22,11 @@
 #define moses_OutputCollector_h
 
 #ifdef WITH_THREADS
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #endif
 
 #ifdef BOOST_HAS_PTHREADS
@@ -30,21 +34,59 @@
 #endif
 
 #include <iostream>
-#include <map>
 #include <ostream>
 #include <string>
+#include <vector>
 
 namespace Moses
 {
 /**
-* Makes sure output goes in the correct order when multi-threading
+* Makes sure output goes in the correct order when multi-threading.
+*
+* Results wait in a ring of slots indexed by source id.  With threads, a
+* dedicated writer thread moves every finished run of consecutive results to
+* the streams and flushes once per run, so workers never wait on I/O.  If
+* capacity is non-zero, a worker writing a source id that far ahead of the
+* next one to print blocks until the writer catches up; through the task
+* queue this holds back the input reader.  With capacity 0 the ring grows as
+* needed.  Every source id must be written, even with an empty string:
+* with a capacity a missing id stalls everything behind it, so blocked
+* writers keep warning on stderr which id they are waiting for, and results
+* still held back by a missing id at destruction are reported as dropped.
 **/
 class OutputCollector
 {
 public:
-  OutputCollector(std::ostream* outStream= &std::cout, std::ostream* debugStream=&std::cerr) :
-    m_nextOutput(0),m_outStream(outStream),m_debugStream(debugStream)  {}
+  OutputCollector(std::ostream* outStream= &std::cout, std::ostream* debugStream=&std::cerr, size_t capacity = 0) :
+    m_slots(capacity ? capacity : 64),m_capacity(capacity),m_nextOutput(0),m_outStream(outStream),m_debugStream(debugStream) {
+#ifdef WITH_THREADS
+    m_stopping = false;
+    m_writer.reset(new boost::thread(&OutputCollector::WriteLoop, this));
+#endif
+  }
 
+  /**
+    * Write whatever is ready.  Results still missing a predecessor are
+    * dropped with an error on stderr.
+    **/
+  ~OutputCollector() {
+#ifdef WITH_THREADS
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_stopping = true;
+    }
+    m_ready.notify_one();
+    m_writer->join();
+#endif
+    size_t dropped = 0;
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+      if (m_slots[i].ready) ++dropped;
+    }
+    if (dropped) {
+      std::cerr << "ERROR: no output was written for source id " << m_nextOutput
+                << ", dropping " << dropped << " later results" << std::endl;
+    }
+  }
 
   /**
     * Write or cache the output, as appropriate.
@@ -52,38 +94,108 @@ public:
   void Write(int sourceId,const std::string& output,const std::string& debug="") {
 #ifdef WITH_THREADS
     boost::mutex::scoped_lock lock(m_mutex);
-#endif
-    if (sourceId == m_nextOutput) {
-      //This is the one we were expecting
-      *m_outStream << output << std::flush;
-      *m_debugStream << debug << std::flush;
-      ++m_nextOutput;
-      //see if there's any more
-      std::map<int,std::string>::iterator iter;
-      while ((iter = m_outputs.find(m_nextOutput)) != m_outputs.end()) {
-        *m_outStream << iter->second << std::flush;
-        ++m_nextOutput;
-        std::map<int,std::string>::iterator debugIter = m_debugs.find(iter->first);
-		m_outputs.erase(iter);
-        if (debugIter != m_debugs.end()) {
-          *m_debugStream << debugIter->second << std::flush;
-          m_debugs.erase(debugIter);
+    if (m_capacity) {
+      const long warnSeconds = 60;
+      while (sourceId >= m_nextOutput + static_cast<int>(m_slots.size())) {
+        if (!m_space.timed_wait(lock, boost::posix_time::seconds(warnSeconds))
+            && sourceId >= m_nextOutput + static_cast<int>(m_slots.size())) {
+          std::cerr << "WARNING: output of source id " << sourceId << " has waited "
+                    << warnSeconds << "s for source id " << m_nextOutput
+                    << ", which may never be written" << std::endl;
         }
       }
-    } else {
-      //save for later
-      m_outputs[sourceId] = output;
-      m_debugs[sourceId] = debug;
     }
+#endif
+    // The first result for an id wins; later ones are ignored.
+    if (sourceId < m_nextOutput) return;
+    while (sourceId >= m_nextOutput + static_cast<int>(m_slots.size())) Grow();
+    Slot &slot = m_slots[sourceId % m_slots.size()];
+    if (slot.ready) return;
+    slot.ready = true;
+    slot.output = output;
+    slot.debug = debug;
+#ifdef WITH_THREADS
+    if (sourceId == m_nextOutput) m_ready.notify_one();
+#else
+    std::string outputs, debugs;
+    TakeReady(outputs, debugs);
+    Flush(outputs, debugs);
+#endif
   }
+
 private:
-  std::map<int,std::string> m_outputs;
-  std::map<int,std::string> m_debugs;
+  struct Slot {
+    Slot() : ready(false) {}
+    bool ready;
+    std::string output;
+    std::string debug;
+  };
+
+  // Double the ring, keeping each pending slot at its id modulo the new size.
+  void Grow() {
+    std::vector<Slot> bigger(m_slots.size() * 2);
+    for (int id = m_nextOutput; id < m_nextOutput + static_cast<int>(m_slots.size()); ++id) {
+      Slot &from = m_slots[id % m_slots.size()];
+      Slot &to = bigger[id % bigger.size()];
+      to.ready = from.ready;
+      to.output.swap(from.output);
+      to.debug.swap(from.debug);
+    }
+    m_slots.swap(bigger);
+  }
+
+  // Append the run of ready slots starting at m_nextOutput and free them.
+  // Returns whether there was any.
+  bool TakeReady(std::string &outputs, std::string &debugs) {
+    bool any = false;
+    while (true) {
+      Slot &slot = m_slots[m_nextOutput % m_slots.size()];
+      if (!slot.ready) break;
+      if (outputs.empty()) outputs.swap(slot.output); else outputs += slot.output;
+      if (debugs.empty()) debugs.swap(slot.debug); else debugs += slot.debug;
+      slot.ready = false;
+      slot.output.clear();
+      slot.debug.clear();
+      ++m_nextOutput;
+      any = true;
+    }
+    return any;
+  }
+
+  void Flush(const std::string &outputs, const std::string &debugs) {
+    if (!outputs.empty()) *m_outStream << outputs << std::flush;
+    if (!debugs.empty()) *m_debugStream << debugs << std::flush;
+  }
+
+#ifdef WITH_THREADS
+  void WriteLoop() {
+    std::string outputs, debugs;
+    while (true) {
+      {
+        boost::mutex::scoped_lock lock(m_mutex);
+        bool any;
+        while (!(any = TakeReady(outputs, debugs)) && !m_stopping) m_ready.wait(lock);
+        if (!any) return;
+      }
+      m_space.notify_all();
+      Flush(outputs, debugs);
+      outputs.clear();
+      debugs.clear();
+    }
+  }
+#endif
+
+  std::vector<Slot> m_slots;
+  size_t m_capacity;
   int m_nextOutput;
   std::ostream* m_outStream;
   std::ostream* m_debugStream;
 #ifdef WITH_THREADS
   boost::mutex m_mutex;
+  boost::condition_variable m_ready;
+  boost::condition_variable m_space;
+  bool m_stopping;
+  boost::scoped_ptr<boost::thread> m_writer;
 #endif
 };
 
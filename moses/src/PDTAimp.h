@@ -4,6 +4,14 @@
 #ifndef moses_PDTAimp_h
 #define moses_PDTAimp_h
 
+#include <boost/unordered_map.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
+
 #include "StaticData.h"  // needed for factor splitter
 #include "PhraseDictionaryTree.h"
 #include "UniqueObject.h"
@@ -26,6 +34,8 @@ inline double Exp(double x)
 }
 
 /** implementation of the binary phrase table for the phrase-based decoder. Used by PhraseDictionaryTreeAdaptor
+ *  The table itself is shared by all threads; what is built for the current
+ *  sentence lives in a SentenceCache owned by the translating thread.
  */
 class PDTAimp
 {
@@ -44,18 +54,44 @@ public:
   std::vector<FactorType> m_input,m_output;
   PhraseDictionaryTree *m_dict;
   typedef std::vector<TargetPhraseCollection const*> vTPC;
-  mutable vTPC m_tgtColls;
 
-  typedef std::map<Phrase,TargetPhraseCollection const*> MapSrc2Tgt;
-  mutable MapSrc2Tgt m_cache;
+  // the input factors of a source phrase, which determine its lookup
+  typedef std::vector<const Factor*> SrcKey;
+  typedef boost::unordered_map<SrcKey,TargetPhraseCollection const*> MapSrc2Tgt;
+
+  struct SentenceCache {
+    vTPC tgtColls;
+    MapSrc2Tgt cache;
+    std::vector<vTPC> rangeCache;
+    UniqueObjectManager<Phrase> uniqSrcPhr;
+
+    ~SentenceCache() {
+      Clear();
+    }
+    void Clear() {
+      for(size_t i=0; i<tgtColls.size(); ++i) delete tgtColls[i];
+      tgtColls.clear();
+      cache.clear();
+      rangeCache.clear();
+      uniqSrcPhr.clear();
+    }
+  };
+
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<SentenceCache> m_sentenceCache;
+#else
+  mutable boost::scoped_ptr<SentenceCache> m_sentenceCache;
+#endif
+
   PhraseDictionaryTreeAdaptor *m_obj;
   int useCache;
 
-  std::vector<vTPC> m_rangeCache;
   unsigned m_numInputScores;
 
-  UniqueObjectManager<Phrase> uniqSrcPhr;
-
+  // statistics over all confusion networks, updated by all threads
+#ifdef WITH_THREADS
+  boost::mutex m_statsMutex;
+#endif
   size_t totalE,distinctE;
   std::vector<size_t> path1Best,pathExplored;
   std::vector<double> pathCN;
@@ -101,14 +137,15 @@ public:
     s=w.GetString(m_input,false);
   }
 
+  SentenceCache& GetSentenceCache() const {
+    if(!m_sentenceCache.get()) m_sentenceCache.reset(new SentenceCache);
+    return *m_sentenceCache;
+  }
+
+  // release what was built for the current thread's last sentence
   void CleanUp() {
     CHECK(m_dict);
-    m_dict->FreeMemory();
-    for(size_t i=0; i<m_tgtColls.size(); ++i) delete m_tgtColls[i];
-    m_tgtColls.clear();
-    m_cache.clear();
-    m_rangeCache.clear();
-    uniqSrcPhr.clear();
+    if(m_sentenceCache.get()) m_sentenceCache->Clear();
   }
 
   TargetPhraseCollection const*
@@ -117,13 +154,20 @@ public:
     CHECK(m_dict);
     if(src.GetSize()==0) return 0;
 
+    SentenceCache& sc=GetSentenceCache();
+    SrcKey key;
+    key.reserve(src.GetSize()*m_input.size());
+    for(size_t i=0; i<src.GetSize(); ++i)
+      for(size_t j=0; j<m_input.size(); ++j)
+        key.push_back(src.GetWord(i).GetFactor(m_input[j]));
+
     std::pair<MapSrc2Tgt::iterator,bool> piter;
     if(useCache) {
-      piter=m_cache.insert(std::make_pair(src,static_cast<TargetPhraseCollection const*>(0)));
+      piter=sc.cache.insert(std::make_pair(key,static_cast<TargetPhraseCollection const*>(0)));
       if(!piter.second) return piter.first->second;
-    } else if (m_cache.size()) {
-      MapSrc2Tgt::const_iterator i=m_cache.find(src);
-      return (i!=m_cache.end() ? i->second : 0);
+    } else if (sc.cache.size()) {
+      MapSrc2Tgt::const_iterator i=sc.cache.find(key);
+      return (i!=sc.cache.end() ? i->second : 0);
     }
 
     std::vector<std::string> srcString(src.GetSize());
@@ -170,7 +214,7 @@ public:
       return 0;
     } else {
       if(useCache) piter.first->second=rv;
-      m_tgtColls.push_back(rv);
+      sc.tgtColls.push_back(rv);
       return rv;
     }
 
@@ -332,13 +376,7 @@ public:
         exPathsD[len]=(exPathsD[len]>=0.0 ? addLogScale(pd,exPathsD[len]) : pd);
       }
 
-    // update global statistics
-    if(pathCN.size()<=srcSize) pathCN.resize(srcSize+1,-1.0);
-    for(size_t len=1; len<=srcSize; ++len)
-      pathCN[len]=pathCN[len]>=0.0 ? addLogScale(pathCN[len],exPathsD[len]) : exPathsD[len];
-
-    if(path1Best.size()<=srcSize) path1Best.resize(srcSize+1,0);
-    for(size_t len=1; len<=srcSize; ++len) path1Best[len]+=srcSize-len+1;
+    size_t sentenceE=0,sentenceDistinctE=0;
 
 
     if (StaticData::Instance().GetVerboseLevel() >= 2 && exPathsD.size()) {
@@ -351,9 +389,12 @@ public:
     }
 
     typedef StringTgtCand::first_type sPhrase;
+    // ordered, so equally scored candidates reach the pruning in a fixed order
     typedef std::map<StringTgtCand::first_type,TScores> E2Costs;
+    typedef boost::unordered_map<Range,E2Costs> Cov2Cand;
 
-    std::map<Range,E2Costs> cov2cand;
+    SentenceCache& sc=GetSentenceCache();
+    Cov2Cand cov2cand;
     std::vector<State> stack;
     for(Position i=0 ; i < srcSize ; ++i)
       stack.push_back(State(i, i, m_dict->GetRoot(), std::vector<float>(m_numInputScores,0.0)));
@@ -418,11 +459,11 @@ public:
             exploredPaths.resize(newRange.second-newRange.first+1,0);
           ++exploredPaths[newRange.second-newRange.first];
 
-          totalE+=tcands.size();
+          sentenceE+=tcands.size();
 
           if(tcands.size()) {
             E2Costs& e2costs=cov2cand[newRange];
-            Phrase const* srcPtr=uniqSrcPhr(newSrc);
+            Phrase const* srcPtr=sc.uniqSrcPhr(newSrc);
             for(size_t i=0; i<tcands.size(); ++i) {
               //put input scores in first - already logged, just drop in directly
               std::vector<float> nscores(newInputScores);
@@ -443,7 +484,7 @@ public:
 
               std::pair<E2Costs::iterator,bool> p=e2costs.insert(std::make_pair(tcands[i].first,TScores()));
 
-              if(p.second) ++distinctE;
+              if(p.second) ++sentenceDistinctE;
 
               TScores & scores=p.first->second;
               if(p.second || scores.total<score) {
@@ -465,19 +506,35 @@ public:
       TRACE_ERR("\n");
     }
 
-    if(pathExplored.size()<exploredPaths.size())
-      pathExplored.resize(exploredPaths.size(),0);
-    for(size_t len=1; len<=srcSize; ++len)
-      pathExplored[len]+=exploredPaths[len];
+    {
+      // update global statistics
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(m_statsMutex);
+#endif
+      totalE+=sentenceE;
+      distinctE+=sentenceDistinctE;
+
+      if(pathCN.size()<=srcSize) pathCN.resize(srcSize+1,-1.0);
+      for(size_t len=1; len<=srcSize; ++len)
+        pathCN[len]=pathCN[len]>=0.0 ? addLogScale(pathCN[len],exPathsD[len]) : exPathsD[len];
 
+      if(path1Best.size()<=srcSize) path1Best.resize(srcSize+1,0);
+      for(size_t len=1; len<=srcSize; ++len) path1Best[len]+=srcSize-len+1;
+
+      if(pathExplored.size()<exploredPaths.size())
+        pathExplored.resize(exploredPaths.size(),0);
+      for(size_t len=1; len<=srcSize; ++len)
+        pathExplored[len]+=exploredPaths[len];
+    }
 
-    m_rangeCache.resize(src.GetSize(),vTPC(src.GetSize(),0));
+    std::vector<vTPC>& rangeCache=sc.rangeCache;
+    rangeCache.resize(src.GetSize(),vTPC(src.GetSize(),0));
 
-    for(std::map<Range,E2Costs>::const_iterator i=cov2cand.begin(); i!=cov2cand.end(); ++i) {
-      CHECK(i->first.first<m_rangeCache.size());
+    for(Cov2Cand::const_iterator i=cov2cand.begin(); i!=cov2cand.end(); ++i) {
+      CHECK(i->first.first<rangeCache.size());
       CHECK(i->first.second>0);
-      CHECK(static_cast<size_t>(i->first.second-1)<m_rangeCache[i->first.first].size());
-      CHECK(m_rangeCache[i->first.first][i->first.second-1]==0);
+      CHECK(static_cast<size_t>(i->first.second-1)<rangeCache[i->first.first].size());
+      CHECK(rangeCache[i->first.first][i->first.second-1]==0);
 
       std::vector<TargetPhrase> tCands;
       tCands.reserve(i->second.size());
@@ -498,12 +555,10 @@ public:
       if(rv->IsEmpty())
         delete rv;
       else {
-        m_rangeCache[i->first.first][i->first.second-1]=rv;
-        m_tgtColls.push_back(rv);
+        rangeCache[i->first.first][i->first.second-1]=rv;
+        sc.tgtColls.push_back(rv);
       }
     }
-    // free memory
-    m_dict->FreeMemory();
   }
 
 
@@ -112,6 +112,7 @@ Parameter::Parameter()
   AddParam("lmbr-map-weight", "weight given to map solution when doing lattice MBR (default 0)");
   AddParam("lattice-hypo-set", "to use lattice as hypo set during lattice MBR");
   AddParam("clean-lm-cache", "clean language model caches after N translations (default N=1)");
+  AddParam("lmodel-probe-cache", "number of SRILM/IRSTLM probes to cache, shared by all sentences and threads (default 0 = no cache)");
   AddParam("use-persistent-cache", "cache translation options across sentences (default true)");
   AddParam("persistent-cache-size", "maximum size of cache for translation options (default 10,000 input phrases)");
   AddParam("recover-input-path", "r", "(conf net/word lattice only) - recover input path corresponding to the best translation");
@@ -119,6 +120,7 @@ Parameter::Parameter()
   AddParam("time-out", "seconds after which is interrupted (-1=no time-out, default is -1)");
   AddParam("output-search-graph", "osg", "Output connected hypotheses of search into specified filename");
   AddParam("output-search-graph-extended", "osgx", "Output connected hypotheses of search into specified filename, in extended format");
+  AddParam("output-search-graph-binary", "osgb", "Output connected hypotheses of search into specified filename, in compact binary format (phrase-based decoding only)");
   AddParam("unpruned-search-graph", "usg", "When outputting chart search graph, do not exclude dead ends. Note: stack pruning may have eliminated some hypotheses");
 #ifdef HAVE_PROTOBUF
   AddParam("output-search-graph-pb", "pb", "Write phrase lattice to protocol buffer objects in the specified path.");
@@ -126,6 +128,7 @@ Parameter::Parameter()
   AddParam("cube-pruning-pop-limit", "cbp", "How many hypotheses should be popped for each stack. (default = 1000)");
   AddParam("cube-pruning-diversity", "cbd", "How many hypotheses should be created for each coverage. (default = 0)");
   AddParam("cube-pruning-lazy-scoring", "cbls", "Don't fully score a hypothesis until it is popped");
+  AddParam("cube-pruning-time-budget", "cbtb", "Chart decoding only. Wall-clock time in milliseconds for the cube pruning of each sentence, shared out among the chart cells. Time a cell does not use is carried forward to the remaining cells. The pop limit still applies. (default = 0 = no budget)");
   AddParam("parsing-algorithm", "Which parsing algorithm to use. 0=CYK+, 1=scope-3. (default = 0)");
   AddParam("search-algorithm", "Which search algorithm to use. 0=normal stack, 1=cube pruning, 2=cube growing, 4=stack with batched lm requests (default = 0)");
   AddParam("constraint", "Location of the file with target sentences to produce constraining the search");
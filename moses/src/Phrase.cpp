@@ -140,6 +140,13 @@ void Phrase::CreateFromString(const std::vector<FactorType> &factorOrder, const
 {
   FactorCollection &factorCollection = FactorCollection::Instance();
 
+  // phrases loaded into tables live long, so don't let the vector overallocate
+  size_t numWords = 0;
+  for (util::TokenIter<util::AnyCharacter, true> word_it(phraseString, util::AnyCharacter(" \t")); word_it; ++word_it) {
+    ++numWords;
+  }
+  m_words.reserve(m_words.size() + numWords);
+
   for (util::TokenIter<util::AnyCharacter, true> word_it(phraseString, util::AnyCharacter(" \t")); word_it; ++word_it) {
     Word &word = AddWord();
     size_t index = 0;
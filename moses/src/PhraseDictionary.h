@@ -138,7 +138,7 @@ private:
   size_t m_tableLimit;
   //We instantiate either the the thread-safe or non-thread-safe dictionary,
   //but not both. The thread-safe one can be instantiated in the constructor and shared
-  //between threads, however the non-thread-safe one (eg PhraseDictionaryTree) must be instantiated
+  //between threads, however the non-thread-safe one (eg PhraseDictionaryOnDisk) must be instantiated
   //on demand, and stored in thread-specific storage.
   std::auto_ptr<PhraseDictionary> m_threadSafePhraseDictionary;
 #ifdef WITH_THREADS
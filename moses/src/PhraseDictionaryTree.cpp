@@ -1,14 +1,23 @@
 // $Id$
 // vim:tabstop=2
 #include "PhraseDictionaryTree.h"
+#include "PrefixTreeCreator.h"
 #include <map>
+#include <algorithm>
+#include <cstring>
 #include "util/check.hh"
+#include "util/file.hh"
+#include "util/mmap.hh"
 #include <sstream>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 namespace Moses
 {
 
@@ -22,6 +31,31 @@ std::ostream& operator<<(std::ostream& out,const std::vector<T>& x)
   return out;
 }
 
+// readers for the fWrite/fWriteVector/fWriteString formats of File.h from
+// a mapped file; p is advanced past the value
+template<typename T> inline void mRead(const char*& p,T& t)
+{
+  std::memcpy(&t,p,sizeof(t));
+  p+=sizeof(t);
+}
+
+template<typename C> inline void mReadVector(const char*& p,C& v)
+{
+  UINT32 s;
+  mRead(p,s);
+  v.resize(s);
+  if(s) std::memcpy(&v[0],p,s*sizeof(typename C::value_type));
+  p+=s*sizeof(typename C::value_type);
+}
+
+inline void mReadString(const char*& p,std::string& e)
+{
+  UINT32 s;
+  mRead(p,s);
+  e.assign(p,s);
+  p+=s;
+}
+
 
 class TgtCand
 {
@@ -39,19 +73,15 @@ public:
 
   TgtCand(const IPhrase& a,const Scores& b) : e(a),sc(b) {}
 
-  TgtCand(FILE* f) {
-    readBin(f);
-  }
-
 
   void writeBin(FILE* f) const {
     fWriteVector(f,e);
     fWriteVector(f,sc);
   }
 
-  void readBin(FILE* f) {
-    fReadVector(f,e);
-    fReadVector(f,sc);
+  void readBin(const char*& p) {
+    mReadVector(p,e);
+    mReadVector(p,sc);
   }
 
   void writeBinWithAlignment(FILE* f) const {
@@ -60,10 +90,10 @@ public:
     fWriteString(f, m_alignment.c_str(), m_alignment.size());
   }
 
-  void readBinWithAlignment(FILE* f) {
-    fReadVector(f,e);
-    fReadVector(f,sc);
-    fReadString(f, m_alignment);
+  void readBinWithAlignment(const char*& p) {
+    mReadVector(p,e);
+    mReadVector(p,sc);
+    mReadString(p, m_alignment);
   }
 
   const IPhrase& GetPhrase() const {
@@ -96,25 +126,25 @@ public:
     for(size_t i=0; i<s; ++i) MyBase::operator[](i).writeBinWithAlignment(f);
   }
 
-  void readBin(FILE* f) {
+  void readBin(const char* p) {
     unsigned s;
-    fRead(f,s);
+    mRead(p,s);
     resize(s);
-    for(size_t i=0; i<s; ++i) MyBase::operator[](i).readBin(f);
+    for(size_t i=0; i<s; ++i) MyBase::operator[](i).readBin(p);
   }
 
-  void readBinWithAlignment(FILE* f) {
+  void readBinWithAlignment(const char* p) {
     unsigned s;
-    fRead(f,s);
+    mRead(p,s);
     resize(s);
-    for(size_t i=0; i<s; ++i) MyBase::operator[](i).readBinWithAlignment(f);
+    for(size_t i=0; i<s; ++i) MyBase::operator[](i).readBinWithAlignment(p);
   }
 };
 
 
 PhraseDictionaryTree::PrefixPtr::operator bool() const
 {
-  return imp && imp->isValid();
+  return root || node!=InvalidOffT;
 }
 
 typedef LVoc<std::string> WordVoc;
@@ -123,7 +153,7 @@ static WordVoc* ReadVoc(const std::string& filename)
 {
   static std::map<std::string,WordVoc*> vocs;
 #ifdef WITH_THREADS
-  boost::mutex mutex;
+  static boost::mutex mutex;
   boost::mutex::scoped_lock lock(mutex);
 #endif
   std::map<std::string,WordVoc*>::iterator vi = vocs.find(filename);
@@ -136,34 +166,51 @@ static WordVoc* ReadVoc(const std::string& filename)
 }
 
 
+/** Read-only view of the binary phrase table.  The source prefix tree and
+ *  the target candidates are mapped into memory and decoded in place, and
+ *  prefix pointers are plain values, so one object serves all threads.
+ */
 class PDTimp {
 public:
-  typedef PrefixTreeF<LabelId,OFF_T> PTF;
-  typedef FilePtr<PTF> CPT;
-  typedef std::vector<CPT> Data;
-
+  // a node of the source prefix tree as written by PrefixTreeF::create:
+  // keys, the target data offset of each key and the offset of the child
+  // node of each key (0 if there is none)
+  struct Node {
+    const LabelId* keys;
+    UINT32 size;
+    const char* data;
+    const char* ptrs;
+
+    unsigned findKey(LabelId k) const {
+      return std::lower_bound(keys,keys+size,k)-keys;
+    }
+    bool hasKey(unsigned i,LabelId k) const {
+      return i<size && keys[i]==k;
+    }
+    OFF_T getData(unsigned i) const {
+      OFF_T d;
+      std::memcpy(&d,data+i*sizeof(OFF_T),sizeof(OFF_T));
+      return d;
+    }
+    OFF_T getPtr(unsigned i) const {
+      OFF_T d;
+      std::memcpy(&d,ptrs+i*sizeof(OFF_T),sizeof(OFF_T));
+      return d;
+    }
+  };
 
-  Data data;
   std::vector<OFF_T> srcOffsets;
 
-  FILE *os,*ot;
+  util::scoped_memory srcTree,tgtData;
   WordVoc* sv;
   WordVoc* tv;
 
-  ObjectPool<PPimp> pPool;
-  // a comparison with the Boost MemPools might be useful
-
   bool usewordalign;
   bool printwordalign;
 
-  PDTimp() : os(0),ot(0), usewordalign(false), printwordalign(false) {
+  PDTimp() : usewordalign(false), printwordalign(false) {
     PTF::setDefault(InvalidOffT);
   }
-  ~PDTimp() {
-    if(os) fClose(os);
-    if(ot) fClose(ot);
-    FreeMemory();
-  }
 
   inline void UseWordAlignment(bool a) {
     usewordalign=a;
@@ -179,36 +226,58 @@ public:
     return printwordalign;
   };
 
-  void FreeMemory() {
-    for(Data::iterator i=data.begin(); i!=data.end(); ++i) (*i).free();
-    pPool.reset();
+  int Read(const std::string& fn);
+
+  Node GetNode(OFF_T off) const {
+    CHECK(off>=0 && static_cast<size_t>(off)<srcTree.size());
+    const char* p=srcTree.begin()+off;
+    Node n;
+    mRead(p,n.size);
+    n.keys=reinterpret_cast<const LabelId*>(p);
+    p+=n.size*sizeof(LabelId);
+    UINT32 dataSize;
+    mRead(p,dataSize);
+    CHECK(dataSize==n.size);
+    n.data=p;
+    n.ptrs=p+n.size*sizeof(OFF_T);
+    return n;
   }
 
-  int Read(const std::string& fn);
+  OFF_T GetRootNode(LabelId w) const {
+    return w<srcOffsets.size() ? srcOffsets[w] : InvalidOffT;
+  }
 
-  void GetTargetCandidates(const IPhrase& f,TgtCands& tgtCands) {
-    if(f.empty()) return;
-    if(f[0]>=data.size()) return;
-    if(!data[f[0]]) return;
-    CHECK(data[f[0]]->findKey(f[0])<data[f[0]]->size());
-    OFF_T tCandOffset=data[f[0]]->find(f);
-    if(tCandOffset==InvalidOffT) return;
-    fSeek(ot,tCandOffset);
+  void ReadTgtCands(OFF_T off,TgtCands& tgtCands) const {
+    CHECK(off>=0 && static_cast<size_t>(off)<tgtData.size());
+    if (usewordalign) tgtCands.readBinWithAlignment(tgtData.begin()+off);
+    else tgtCands.readBin(tgtData.begin()+off);
+  }
 
-    if (UseWordAlignment())    	tgtCands.readBinWithAlignment(ot);
-    else tgtCands.readBin(ot);
+  void GetTargetCandidates(const IPhrase& f,TgtCands& tgtCands) const {
+    if(f.empty()) return;
+    OFF_T off=GetRootNode(f[0]);
+    for(size_t i=0; off!=InvalidOffT; ++i) {
+      Node n=GetNode(off);
+      unsigned k=n.findKey(f[i]);
+      if(!n.hasKey(k,f[i])) return;
+      if(i+1==f.size()) {
+        OFF_T tCandOffset=n.getData(k);
+        if(tCandOffset!=InvalidOffT) ReadTgtCands(tCandOffset,tgtCands);
+        return;
+      }
+      off=n.getPtr(k);
+      if(!off) return;
+    }
   }
 
   typedef PhraseDictionaryTree::PrefixPtr PPtr;
 
-  void GetTargetCandidates(PPtr p,TgtCands& tgtCands) {
+  void GetTargetCandidates(PPtr p,TgtCands& tgtCands) const {
     CHECK(p);
-    if(p.imp->isRoot()) return;
-    OFF_T tCandOffset=p.imp->ptr()->getData(p.imp->idx);
+    if(p.root) return;
+    OFF_T tCandOffset=GetNode(p.node).getData(p.idx);
     if(tCandOffset==InvalidOffT) return;
-    fSeek(ot,tCandOffset);
-    if (UseWordAlignment())    	tgtCands.readBinWithAlignment(ot);
-    else tgtCands.readBin(ot);
+    ReadTgtCands(tCandOffset,tgtCands);
   }
 
   void PrintTgtCand(const TgtCands& tcands,std::ostream& out) const;
@@ -240,28 +309,25 @@ public:
     }
   }
 
-  PPtr GetRoot() {
-    return PPtr(pPool.get(PPimp(0,0,1)));
+  PPtr GetRoot() const {
+    return PPtr(InvalidOffT,0,true);
   }
 
-  PPtr Extend(PPtr p,const std::string& w) {
+  PPtr Extend(PPtr p,const std::string& w) const {
     CHECK(p);
     if(w.empty() || w==EPSILON) return p;
 
     LabelId wi=sv->index(w);
 
     if(wi==InvalidLabelId) return PPtr(); // unknown word
-    else if(p.imp->isRoot()) {
-      if(wi<data.size() && data[wi]) {
-        const void* ptr = data[wi]->findKeyPtr(wi);
-        CHECK(ptr);
-        return PPtr(pPool.get(PPimp(data[wi],data[wi]->findKey(wi),0)));
-      }
-    } else if(PTF const* nextP=p.imp->ptr()->getPtr(p.imp->idx)) {
-      return PPtr(pPool.get(PPimp(nextP,nextP->findKey(wi),0)));
-    }
 
-    return PPtr();
+    OFF_T next=p.root ? GetRootNode(wi) : GetNode(p.node).getPtr(p.idx);
+    if(next==InvalidOffT || (!p.root && !next)) return PPtr();
+    Node n=GetNode(next);
+    unsigned k=n.findKey(wi);
+    CHECK(!p.root || n.hasKey(k,wi));
+    if(!n.hasKey(k,wi)) return PPtr();
+    return PPtr(next,k,false);
   }
 };
 
@@ -272,6 +338,14 @@ public:
 //
 ////////////////////////////////////////////////////////////
 
+static void MapFile(const std::string& fn,util::scoped_memory& mem)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(fn.c_str()));
+  uint64_t size=util::SizeFile(fd.get());
+  CHECK(size!=util::kBadSize);
+  if(size) util::MapRead(util::LAZY,fd.get(),0,size,mem);
+}
+
 int PDTimp::Read(const std::string& fn)
 {
   std::string ifs, ift, ifi, ifsv, iftv;
@@ -309,12 +383,8 @@ int PDTimp::Read(const std::string& fn)
   fReadVector(ii,srcOffsets);
   fClose(ii);
 
-  os=fOpen(ifs.c_str(),"rb");
-  ot=fOpen(ift.c_str(),"rb");
-
-  data.resize(srcOffsets.size());
-  for(size_t i=0; i<data.size(); ++i)
-    data[i]=CPT(os,srcOffsets[i]);
+  MapFile(ifs,srcTree);
+  MapFile(ift,tgtData);
 
   sv = ReadVoc(ifsv);
   tv = ReadVoc(iftv);
@@ -382,11 +452,6 @@ bool PhraseDictionaryTree::PrintWordAlignment()
   return imp->PrintWordAlignment();
 };
 
-void PhraseDictionaryTree::FreeMemory() const
-{
-  imp->FreeMemory();
-}
-
 void PhraseDictionaryTree::
 GetTargetCandidates(const std::vector<std::string>& src,
                     std::vector<StringTgtCand>& rv) const
@@ -438,156 +503,106 @@ PrintTargetCandidates(const std::vector<std::string>& src,
   imp->PrintTgtCand(tcand,out);
 }
 
-int PhraseDictionaryTree::Create(std::istream& inFile,const std::string& out)
+// the lines of a text phrase table, for PrefixTreeCreator
+class PhraseTableLines
 {
-  std::string line;
-  size_t count = 0;
+public:
+  struct Entry {
+    IPhrase key,e;
+    Scores sc;
+    std::string alignment;
+  };
+  typedef TgtCands Cands;
 
-  std::string ofn(out+".binphr.srctree"),
-      oft(out+".binphr.tgtdata"),
-      ofi(out+".binphr.idx"),
-      ofsv(out+".binphr.srcvoc"),
-      oftv(out+".binphr.tgtvoc");
+  PhraseTableLines(bool alignment) : m_alignment(alignment), m_numElement(0) {}
 
-  if (PrintWordAlignment()) {
-    ofn+=".wa";
-    oft+=".wa";
+  void Init(const std::string& line) {
+    m_numElement = TokenizeMultiCharSeparator( line , "|||" ).size();
+    CHECK(m_numElement >= 3);
   }
 
-  FILE *os=fOpen(ofn.c_str(),"wb"),
-        *ot=fOpen(oft.c_str(),"wb");
-
-  typedef PrefixTreeSA<LabelId,OFF_T> PSA;
-  PSA *psa=new PSA;
-  PSA::setDefault(InvalidOffT);
-
-  LabelId currFirstWord=InvalidLabelId;
-  IPhrase currF;
-  TgtCands tgtCands;
-  std::vector<OFF_T> vo;
-  size_t lnc=0;
-  size_t numElement = NOT_FOUND; // 3=old format, 5=async format which include word alignment info
-  imp->sv = new WordVoc();
-  imp->tv = new WordVoc();
-
-  while(getline(inFile, line)) {
-    ++lnc;
+  size_t NumVocs() const {
+    return 2;
+  }
 
+  bool Parse(const std::string& line,size_t lnc,std::vector<WordVoc>& vocs,Entry& entry) const {
     std::vector<std::string> tokens = TokenizeMultiCharSeparator( line , "|||" );
 
-    if (numElement == NOT_FOUND) {
-      // init numElement
-      numElement = tokens.size();
-      CHECK(numElement >= 3);
-    }
-
-    if (tokens.size() != numElement) {
+    if (tokens.size() != m_numElement) {
       std::stringstream strme;
       strme << "Syntax error at line " << lnc  << " : " << line;
       UserMessage::Add(strme.str());
       abort();
     }
 
-    const std::string &sourcePhraseString	=tokens[0]
-                                           ,&targetPhraseString=tokens[1]
-                                               ,&scoreString				= tokens[2];
-    const std::string empty;
-    const std::string &alignmentString = PrintWordAlignment() ? tokens[3] : empty;
-    IPhrase f,e;
-    Scores sc;
-
-    std::vector<std::string> wordVec = Tokenize(sourcePhraseString);
+    std::vector<std::string> wordVec = Tokenize(tokens[0]);
     for (size_t i = 0 ; i < wordVec.size() ; ++i)
-      f.push_back(imp->sv->add(wordVec[i]));
+      entry.key.push_back(vocs[0].add(wordVec[i]));
 
-    wordVec = Tokenize(targetPhraseString);
+    wordVec = Tokenize(tokens[1]);
     for (size_t i = 0 ; i < wordVec.size() ; ++i)
-      e.push_back(imp->tv->add(wordVec[i]));
+      entry.e.push_back(vocs[1].add(wordVec[i]));
 
-    //			while(is>>w && w!="|||") sc.push_back(atof(w.c_str()));
     // Mauro: to handle 0 probs in phrase tables
-    std::vector<float> scoreVector = Tokenize<float>(scoreString);
+    std::vector<float> scoreVector = Tokenize<float>(tokens[2]);
     for (size_t i = 0 ; i < scoreVector.size() ; ++i) {
       float tmp = scoreVector[i];
-      sc.push_back(((tmp>0.0)?tmp:(float)1.0e-38));
+      entry.sc.push_back(((tmp>0.0)?tmp:(float)1.0e-38));
     }
 
-    if(f.empty()) {
-      TRACE_ERR("WARNING: empty source phrase in line '"<<line<<"'\n");
-      continue;
-    }
+    if (m_alignment) entry.alignment = tokens[3];
+    return !entry.key.empty();
+  }
 
-    if(currFirstWord==InvalidLabelId) currFirstWord=f[0];
-    if(currF.empty()) {
-      ++count;
-      currF=f;
-      // insert src phrase in prefix tree
-      CHECK(psa);
-      PSA::Data& d=psa->insert(f);
-      if(d==InvalidOffT) d=fTell(ot);
-      else {
-        TRACE_ERR("ERROR: source phrase already inserted (A)!\nline(" << lnc << "): '"
-                  <<line<<"'\nf: "<<f<<"\n");
-        abort();
-      }
-    }
+  void Remap(Entry& entry,const std::vector<std::vector<LabelId> >& ids) const {
+    for(size_t i=0; i<entry.key.size(); ++i) entry.key[i]=ids[0][entry.key[i]];
+    for(size_t i=0; i<entry.e.size(); ++i) entry.e[i]=ids[1][entry.e[i]];
+  }
 
-    if(currF!=f) {
-      // new src phrase
-      currF=f;
-      if (PrintWordAlignment())
-        tgtCands.writeBinWithAlignment(ot);
-      else
-        tgtCands.writeBin(ot);
-      tgtCands.clear();
-
-      if(++count%10000==0) {
-        TRACE_ERR(".");
-        if(count%500000==0) TRACE_ERR("[phrase:"<<count<<"]\n");
-      }
+  void Add(Cands& cands,const Entry& entry) const {
+    cands.push_back(TgtCand(entry.e,entry.sc,entry.alignment));
+  }
 
-      if(f[0]!=currFirstWord) {
-        // write src prefix tree to file and clear
-        PTF pf;
-        if(currFirstWord>=vo.size())
-          vo.resize(currFirstWord+1,InvalidOffT);
-        vo[currFirstWord]=fTell(os);
-        pf.create(*psa,os);
-        // clear
-        delete psa;
-        psa=new PSA;
-        currFirstWord=f[0];
-      }
+  void Write(const Cands& cands,FILE* f) const {
+    if (m_alignment) cands.writeBinWithAlignment(f);
+    else cands.writeBin(f);
+  }
 
-      // insert src phrase in prefix tree
-      CHECK(psa);
-      PSA::Data& d=psa->insert(f);
-      if(d==InvalidOffT) d=fTell(ot);
-      else {
-        TRACE_ERR("ERROR: xsource phrase already inserted (B)!\nline(" << lnc << "): '"
-                  <<line<<"'\nf: "<<f<<"\n");
-        abort();
-      }
-    }
-    tgtCands.push_back(TgtCand(e,sc, alignmentString));
-    CHECK(currFirstWord!=InvalidLabelId);
-  }
-  if (PrintWordAlignment())
-    tgtCands.writeBinWithAlignment(ot);
-  else
-    tgtCands.writeBin(ot);
-  tgtCands.clear();
-
-  PTF pf;
-  if(currFirstWord>=vo.size()) vo.resize(currFirstWord+1,InvalidOffT);
-  vo[currFirstWord]=fTell(os);
-  pf.create(*psa,os);
-  delete psa;
-  psa=0;
-
-  TRACE_ERR("distinct source phrases: "<<count
+private:
+  bool m_alignment;
+  size_t m_numElement;
+};
+
+int PhraseDictionaryTree::Create(std::istream& inFile,const std::string& out,size_t threads)
+{
+  std::string ofn(out+".binphr.srctree"),
+      oft(out+".binphr.tgtdata"),
+      ofi(out+".binphr.idx"),
+      ofsv(out+".binphr.srcvoc"),
+      oftv(out+".binphr.tgtvoc");
+
+  if (PrintWordAlignment()) {
+    ofn+=".wa";
+    oft+=".wa";
+  }
+
+  FILE *os=fOpen(ofn.c_str(),"wb"),
+        *ot=fOpen(oft.c_str(),"wb");
+
+  std::vector<OFF_T> vo;
+  imp->sv = new WordVoc();
+  imp->tv = new WordVoc();
+  std::vector<WordVoc*> vocs;
+  vocs.push_back(imp->sv);
+  vocs.push_back(imp->tv);
+
+  PhraseTableLines lines(PrintWordAlignment());
+  PrefixTreeCreator<PhraseTableLines> creator(lines,threads);
+  if(!creator.Create(inFile,os,ot,vo,vocs)) abort();
+
+  TRACE_ERR("distinct source phrases: "<<creator.GetNumKeys()
             <<" distinct first words of source phrases: "<<vo.size()
-            <<" number of phrase pairs (line count): "<<lnc
+            <<" number of phrase pairs (line count): "<<creator.GetNumLines()
             <<"\n");
 
   fClose(os);
@@ -7,10 +7,6 @@
 #include <vector>
 #include <iostream>
 
-#ifdef WITH_THREADS
-#include <boost/thread/mutex.hpp>
-#endif
-
 #include "TypeDef.h"
 #include "Dictionary.h"
 
@@ -65,13 +61,12 @@ public:
   // convert from ascii phrase table format
   // note: only creates table, does not keep it in memory
   //        -> use Read(outFileNamePrefix);
-  int Create(std::istream& in,const std::string& outFileNamePrefix);
+  // the input is parsed and the trees built on the given number of threads;
+  // the files do not depend on it
+  int Create(std::istream& in,const std::string& outFileNamePrefix,size_t threads=1);
 
   int Read(const std::string& fileNamePrefix);
 
-  // free memory used by the prefix tree etc.
-  void FreeMemory() const;
-
 
   /**************************************
    *   access with full source phrase   *
@@ -97,13 +92,18 @@ public:
   // the only permitted direct operation is a check for NULL,
   // e.g. PrefixPtr p; if(p) ...
   // other usage only through PhraseDictionaryTree-functions below
+  // It is a plain value (node offset and key index in the mapped source
+  // tree), so any number of threads may walk the tree at the same time.
 
   class PrefixPtr
   {
-    PPimp* imp;
+    OFF_T node;
+    unsigned idx;
+    bool root;
     friend class PDTimp;
+    PrefixPtr(OFF_T n,unsigned i,bool r) : node(n),idx(i),root(r) {}
   public:
-    PrefixPtr(PPimp* x=0) : imp(x) {}
+    PrefixPtr() : node(InvalidOffT),idx(0),root(false) {}
     operator bool() const;
   };
 
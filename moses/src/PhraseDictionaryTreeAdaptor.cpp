@@ -77,10 +77,11 @@ PhraseDictionaryTreeAdaptor::GetTargetPhraseCollection(Phrase const &src) const
 TargetPhraseCollection const*
 PhraseDictionaryTreeAdaptor::GetTargetPhraseCollection(InputType const& src,WordsRange const &range) const
 {
-  if(imp->m_rangeCache.empty()) {
+  const std::vector<PDTAimp::vTPC>& rangeCache=imp->GetSentenceCache().rangeCache;
+  if(rangeCache.empty()) {
     return imp->GetTargetPhraseCollection(src.GetSubString(range));
   } else {
-    return imp->m_rangeCache[range.GetStartPos()][range.GetEndPos()];
+    return rangeCache[range.GetStartPos()][range.GetEndPos()];
   }
 }
 
@@ -221,7 +221,7 @@ public:
   }
 
   void create(const PrefixTreeSA<Key,Data>& psa,FILE* f,int verbose=0) {
-    setDefault(psa.getDefault());
+    if(def!=psa.getDefault()) setDefault(psa.getDefault());
 
     typedef std::pair<const PrefixTreeSA<Key,Data>*,OFF_T> P;
     typedef std::deque<P> Queue;
@@ -0,0 +1,417 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_PrefixTreeCreator_h
+#define moses_PrefixTreeCreator_h
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include "ThreadPool.h"
+#endif
+
+#include "File.h"
+#include "LVoc.h"
+#include "PrefixTree.h"
+#include "Util.h"
+#include "util/check.hh"
+
+namespace Moses
+{
+
+/** Writes the source prefix tree (.srctree), the candidates (.tgtdata) and
+ *  the tree roots (.idx) of the binary phrase table and of the binary
+ *  lexical reordering table from their sorted text form.
+ *
+ *  The input is cut into blocks that never separate two lines with the same
+ *  first key word.  A block is parsed with vocabularies of its own, its
+ *  words are added to the table vocabularies in input order, and its
+ *  sub-tries and candidates are written to memory.  The blocks are then
+ *  appended in order with their file offsets moved, so the files are the
+ *  same for any number of threads.  Parsing and building run on a thread
+ *  pool; reading, the vocabularies and writing stay on the calling thread.
+ *
+ *  Table provides
+ *    Entry   a parsed line, with the key in member IPhrase key
+ *    Cands   the candidates of one key, with push_back and clear
+ *    void Init(const std::string& firstLine)
+ *    size_t NumVocs() const
+ *    bool Parse(const std::string& line, size_t lineNo,
+ *               std::vector<WordVoc>& vocs, Entry& entry) const
+ *      words are numbered in vocs; false if the key is empty
+ *    void Remap(Entry& entry, const std::vector<std::vector<LabelId> >& ids) const
+ *      replaces block word ids by table word ids
+ *    void Add(Cands& cands, const Entry& entry) const
+ *    void Write(const Cands& cands, FILE* f) const
+ *  Parse, Remap, Add and Write are called from several threads at once.
+ */
+template<class Table>
+class PrefixTreeCreator
+{
+public:
+  typedef LVoc<std::string> WordVoc;
+
+  PrefixTreeCreator(Table& table, size_t threads)
+    : m_table(table), m_threads(threads ? threads : 1),
+      m_numLines(0), m_numKeys(0), m_haveNext(false) {}
+
+  // Writes the trees to os, the candidates to ot and the offset of the tree
+  // of each first key word to vo; vocs receive the words in order of first
+  // use.  Returns false if a key is repeated after other keys.
+  bool Create(std::istream& in, FILE* os, FILE* ot, std::vector<OFF_T>& vo,
+              const std::vector<WordVoc*>& vocs);
+
+  size_t GetNumLines() const {
+    return m_numLines;
+  }
+  size_t GetNumKeys() const {
+    return m_numKeys;
+  }
+
+private:
+  typedef typename Table::Entry Entry;
+  typedef typename Table::Cands Cands;
+  typedef PrefixTreeSA<LabelId,OFF_T> PSA;
+  typedef PrefixTreeF<LabelId,OFF_T> PTF;
+
+  static const size_t kBlockLines = 20000;
+
+  struct Block {
+    size_t firstLine, numLines;
+    std::vector<std::string> lines;
+    std::vector<WordVoc> vocs;
+    std::vector<std::vector<LabelId> > ids;  // table id of each block word
+    std::vector<Entry> entries;
+    std::vector<size_t> entryLines;
+
+    // the built block: trees and candidates with offsets from their start
+    char *srcTree, *tgtData;
+    size_t srcSize, tgtSize;
+    std::vector<std::pair<LabelId,OFF_T> > roots;
+    size_t numKeys;
+    std::string error;
+
+#ifdef WITH_THREADS
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    bool ready;
+
+    void SetReady() {
+      boost::mutex::scoped_lock lock(mutex);
+      ready = true;
+      cond.notify_all();
+    }
+    void WaitReady() {
+      boost::mutex::scoped_lock lock(mutex);
+      while (!ready) cond.wait(lock);
+    }
+#endif
+
+    Block() : firstLine(0), numLines(0), srcTree(0), tgtData(0),
+      srcSize(0), tgtSize(0), numKeys(0) {}
+    ~Block() {
+      free(srcTree);
+      free(tgtData);
+    }
+  };
+
+#ifdef WITH_THREADS
+  class StageTask : public Task
+  {
+  public:
+    StageTask(PrefixTreeCreator& creator, Block& block, bool build)
+      : m_creator(creator), m_block(block), m_build(build) {}
+    void Run() {
+      if (m_build) m_creator.Build(m_block);
+      else m_creator.Parse(m_block);
+      m_block.SetReady();
+    }
+  private:
+    PrefixTreeCreator& m_creator;
+    Block& m_block;
+    bool m_build;
+  };
+
+  void Submit(ThreadPool& pool, Block& block, bool build) {
+    block.ready = false;
+    pool.Submit(new StageTask(*this, block, build));
+  }
+#endif
+
+  static std::string FirstKeyWord(const std::string& line);
+  bool ReadBlock(std::istream& in, Block& block);
+  void Parse(Block& block) const;
+  void Merge(Block& block, const std::vector<WordVoc*>& vocs) const;
+  void Build(Block& block) const;
+  bool Write(Block& block, FILE* os, FILE* ot, std::vector<OFF_T>& vo);
+  static void Relocate(char* tree, size_t size, OFF_T srcBase, OFF_T tgtBase);
+
+  Table& m_table;
+  size_t m_threads;
+  size_t m_numLines, m_numKeys;
+  std::string m_next, m_lastWord;
+  bool m_haveNext;
+};
+
+// first word of the part of the line before the first |||
+template<class Table>
+std::string PrefixTreeCreator<Table>::FirstKeyWord(const std::string& line)
+{
+  size_t end = line.find("|||");
+  if (end == std::string::npos) end = line.size();
+  size_t b = 0;
+  while (b < end && std::isspace(static_cast<unsigned char>(line[b]))) ++b;
+  size_t e = b;
+  while (e < end && !std::isspace(static_cast<unsigned char>(line[e]))) ++e;
+  return line.substr(b, e - b);
+}
+
+template<class Table>
+bool PrefixTreeCreator<Table>::ReadBlock(std::istream& in, Block& block)
+{
+  block.firstLine = m_numLines + 1;
+  while (m_haveNext) {
+    std::string word = FirstKeyWord(m_next);
+    if (block.lines.size() >= kBlockLines && word != m_lastWord) break;
+    m_lastWord.swap(word);
+    block.lines.push_back(std::string());
+    block.lines.back().swap(m_next);
+    m_haveNext = getline(in, m_next);
+  }
+  block.numLines = block.lines.size();
+  m_numLines += block.numLines;
+  return !block.lines.empty();
+}
+
+template<class Table>
+void PrefixTreeCreator<Table>::Parse(Block& block) const
+{
+  block.vocs.resize(m_table.NumVocs());
+  block.entries.reserve(block.lines.size());
+  for (size_t i = 0; i < block.lines.size(); ++i) {
+    block.entries.push_back(Entry());
+    if (m_table.Parse(block.lines[i], block.firstLine + i, block.vocs, block.entries.back())) {
+      block.entryLines.push_back(i);
+    } else {
+      TRACE_ERR("WARNING: empty source phrase in line '"<<block.lines[i]<<"'\n");
+      block.entries.pop_back();
+    }
+  }
+}
+
+template<class Table>
+void PrefixTreeCreator<Table>::Merge(Block& block, const std::vector<WordVoc*>& vocs) const
+{
+  block.ids.resize(block.vocs.size());
+  for (size_t v = 0; v < block.vocs.size(); ++v) {
+    for (typename WordVoc::const_iterator w = block.vocs[v].begin(); w != block.vocs[v].end(); ++w)
+      block.ids[v].push_back(vocs[v]->add(*w));
+  }
+  std::vector<WordVoc>().swap(block.vocs);
+}
+
+template<class Table>
+void PrefixTreeCreator<Table>::Build(Block& block) const
+{
+  for (size_t i = 0; i < block.entries.size(); ++i)
+    m_table.Remap(block.entries[i], block.ids);
+
+  FILE *os = open_memstream(&block.srcTree, &block.srcSize);
+  FILE *ot = open_memstream(&block.tgtData, &block.tgtSize);
+  CHECK(os && ot);
+
+  PSA *psa = 0;
+  LabelId currFirstWord = InvalidLabelId;
+  const IPhrase *currKey = 0;
+  Cands cands;
+  for (size_t i = 0; i < block.entries.size(); ++i) {
+    const IPhrase &key = block.entries[i].key;
+    if (!currKey || *currKey != key) {
+      if (currKey) {
+        m_table.Write(cands, ot);
+        cands.clear();
+      }
+      if (key[0] != currFirstWord) {
+        if (psa) {
+          block.roots.push_back(std::make_pair(currFirstWord, fTell(os)));
+          PTF pf;
+          pf.create(*psa, os);
+          delete psa;
+        }
+        psa = new PSA;
+        currFirstWord = key[0];
+      }
+      PSA::Data &d = psa->insert(key);
+      if (d != InvalidOffT) {
+        const size_t line = block.entryLines[i];
+        std::ostringstream err;
+        err << "ERROR: source phrase already inserted!\nline(" << block.firstLine + line
+            << "): '" << block.lines[line] << "'\n";
+        block.error = err.str();
+        break;
+      }
+      d = fTell(ot);
+      currKey = &key;
+      ++block.numKeys;
+    }
+    m_table.Add(cands, block.entries[i]);
+  }
+  if (block.error.empty() && currKey) {
+    m_table.Write(cands, ot);
+    block.roots.push_back(std::make_pair(currFirstWord, fTell(os)));
+    PTF pf;
+    pf.create(*psa, os);
+  }
+  delete psa;
+  fclose(os);
+  fclose(ot);
+
+  std::vector<std::string>().swap(block.lines);
+  std::vector<Entry>().swap(block.entries);
+  std::vector<size_t>().swap(block.entryLines);
+}
+
+// move the offsets of the nodes written by PrefixTreeF::create: a node is
+// its keys, the candidate offset of each key and the offset of the child
+// of each key (0 for none)
+template<class Table>
+void PrefixTreeCreator<Table>::Relocate(char* tree, size_t size, OFF_T srcBase, OFF_T tgtBase)
+{
+  for (size_t pos = 0; pos < size; ) {
+    UINT32 n, nd;
+    std::memcpy(&n, tree + pos, sizeof(n));
+    pos += sizeof(n) + n * sizeof(LabelId);
+    std::memcpy(&nd, tree + pos, sizeof(nd));
+    pos += sizeof(nd);
+    CHECK(n == nd);
+    for (UINT32 i = 0; i < 2 * n; ++i, pos += sizeof(OFF_T)) {
+      OFF_T off;
+      std::memcpy(&off, tree + pos, sizeof(off));
+      if (i < n && off != InvalidOffT) off += tgtBase;
+      else if (i >= n && off) off += srcBase;
+      std::memcpy(tree + pos, &off, sizeof(off));
+    }
+  }
+}
+
+template<class Table>
+bool PrefixTreeCreator<Table>::Write(Block& block, FILE* os, FILE* ot, std::vector<OFF_T>& vo)
+{
+  if (!block.error.empty()) {
+    TRACE_ERR(block.error);
+    return false;
+  }
+  const OFF_T srcBase = fTell(os), tgtBase = fTell(ot);
+  Relocate(block.srcTree, block.srcSize, srcBase, tgtBase);
+  if (fwrite(block.srcTree, 1, block.srcSize, os) != block.srcSize ||
+      fwrite(block.tgtData, 1, block.tgtSize, ot) != block.tgtSize) {
+    TRACE_ERR("ERROR: fwrite!\n");
+    abort();
+  }
+  for (size_t i = 0; i < block.roots.size(); ++i) {
+    const LabelId w = block.roots[i].first;
+    if (w >= vo.size()) vo.resize(w + 1, InvalidOffT);
+    vo[w] = srcBase + block.roots[i].second;
+  }
+  for (size_t k = m_numKeys / 10000; k < (m_numKeys + block.numKeys) / 10000; ++k) {
+    TRACE_ERR(".");
+    if ((k + 1) % 50 == 0) TRACE_ERR("[phrase:" << (k + 1) * 10000 << "]\n");
+  }
+  m_numKeys += block.numKeys;
+  return true;
+}
+
+template<class Table>
+bool PrefixTreeCreator<Table>::Create(std::istream& in, FILE* os, FILE* ot,
+                                      std::vector<OFF_T>& vo,
+                                      const std::vector<WordVoc*>& vocs)
+{
+  PSA::setDefault(InvalidOffT);
+  PTF::setDefault(InvalidOffT);
+  m_haveNext = getline(in, m_next);
+  if (!m_haveNext) return true;
+  m_table.Init(m_next);
+  CHECK(vocs.size() >= m_table.NumVocs());
+
+#ifdef WITH_THREADS
+  if (m_threads > 1) {
+    // blocks waiting for their words to be numbered, and to be written
+    std::deque<Block*> parsing, building;
+    const size_t window = 2 * m_threads;
+    ThreadPool pool(m_threads);
+    bool ok = true, eof = false;
+    while (!eof || !parsing.empty() || !building.empty()) {
+      if (!eof) {
+        Block *block = new Block;
+        if (ReadBlock(in, *block)) {
+          parsing.push_back(block);
+          Submit(pool, *block, false);
+        } else {
+          delete block;
+          eof = true;
+        }
+      }
+      while (parsing.size() > window || (eof && !parsing.empty())) {
+        Block *block = parsing.front();
+        parsing.pop_front();
+        block->WaitReady();
+        Merge(*block, vocs);
+        building.push_back(block);
+        Submit(pool, *block, true);
+      }
+      while (building.size() > window || (eof && !building.empty())) {
+        Block *block = building.front();
+        building.pop_front();
+        block->WaitReady();
+        if (ok) ok = Write(*block, os, ot, vo);
+        if (!ok) eof = true;
+        delete block;
+      }
+    }
+    pool.Stop(true);
+    return ok;
+  }
+#endif
+
+  for (;;) {
+    std::auto_ptr<Block> block(new Block);
+    if (!ReadBlock(in, *block)) break;
+    Parse(*block);
+    Merge(*block, vocs);
+    Build(*block);
+    if (!Write(*block, os, ot, vo)) return false;
+  }
+  return true;
+}
+
+}
+
+#endif
@@ -28,17 +28,17 @@ namespace Moses
 
 PhraseDictionaryNodeSCFG::~PhraseDictionaryNodeSCFG()
 {
-  delete m_targetPhraseCollection;
+  Clear();
 }
 
 void PhraseDictionaryNodeSCFG::Prune(size_t tableLimit)
 {
   // recusively prune
-  for (TerminalMap::iterator p = m_sourceTermMap.begin(); p != m_sourceTermMap.end(); ++p) {
-    p->second.Prune(tableLimit);
+  for (TerminalMap::const_iterator p = m_sourceTermMap.begin(); p != m_sourceTermMap.end(); ++p) {
+    p->second->Prune(tableLimit);
   }
-  for (NonTerminalMap::iterator p = m_nonTermMap.begin(); p != m_nonTermMap.end(); ++p) {
-    p->second.Prune(tableLimit);
+  for (NonTerminalMap::const_iterator p = m_nonTermMap.begin(); p != m_nonTermMap.end(); ++p) {
+    p->second->Prune(tableLimit);
   }
 
   // prune TargetPhraseCollection in this node
@@ -49,11 +49,11 @@ void PhraseDictionaryNodeSCFG::Prune(size_t tableLimit)
 void PhraseDictionaryNodeSCFG::Sort(size_t tableLimit)
 {
   // recusively sort
-  for (TerminalMap::iterator p = m_sourceTermMap.begin(); p != m_sourceTermMap.end(); ++p) {
-    p->second.Sort(tableLimit);
+  for (TerminalMap::const_iterator p = m_sourceTermMap.begin(); p != m_sourceTermMap.end(); ++p) {
+    p->second->Sort(tableLimit);
   }
-  for (NonTerminalMap::iterator p = m_nonTermMap.begin(); p != m_nonTermMap.end(); ++p) {
-    p->second.Sort(tableLimit);
+  for (NonTerminalMap::const_iterator p = m_nonTermMap.begin(); p != m_nonTermMap.end(); ++p) {
+    p->second->Sort(tableLimit);
   }
 
   // prune TargetPhraseCollection in this node
@@ -66,11 +66,12 @@ PhraseDictionaryNodeSCFG *PhraseDictionaryNodeSCFG::GetOrCreateChild(const Word
 {
   //CHECK(!sourceTerm.IsNonTerminal());
 
-  std::pair <TerminalMap::iterator,bool> insResult;
-  insResult = m_sourceTermMap.insert( std::make_pair(sourceTerm, PhraseDictionaryNodeSCFG()) );
-  const TerminalMap::iterator &iter = insResult.first;
-  PhraseDictionaryNodeSCFG &ret = iter->second;
-  return &ret;
+  std::pair<PhraseDictionaryNodeSCFG**, bool> insResult;
+  insResult = m_sourceTermMap.Insert(TerminalKey(sourceTerm), NULL);
+  if (insResult.second) {
+    *insResult.first = new PhraseDictionaryNodeSCFG();
+  }
+  return *insResult.first;
 }
 
 PhraseDictionaryNodeSCFG *PhraseDictionaryNodeSCFG::GetOrCreateChild(const Word &sourceNonTerm, const Word &targetNonTerm)
@@ -78,20 +79,21 @@ PhraseDictionaryNodeSCFG *PhraseDictionaryNodeSCFG::GetOrCreateChild(const Word
   CHECK(sourceNonTerm.IsNonTerminal());
   CHECK(targetNonTerm.IsNonTerminal());
 
-  NonTerminalMapKey key(sourceNonTerm, targetNonTerm);
-  std::pair <NonTerminalMap::iterator,bool> insResult;
-  insResult = m_nonTermMap.insert( std::make_pair(key, PhraseDictionaryNodeSCFG()) );
-  const NonTerminalMap::iterator &iter = insResult.first;
-  PhraseDictionaryNodeSCFG &ret = iter->second;
-  return &ret;
+  UINT64 key = FactorIdKey(sourceNonTerm[0], targetNonTerm[0]);
+  std::pair<PhraseDictionaryNodeSCFG**, bool> insResult;
+  insResult = m_nonTermMap.Insert(key, NULL);
+  if (insResult.second) {
+    *insResult.first = new PhraseDictionaryNodeSCFG();
+  }
+  return *insResult.first;
 }
 
 const PhraseDictionaryNodeSCFG *PhraseDictionaryNodeSCFG::GetChild(const Word &sourceTerm) const
 {
   CHECK(!sourceTerm.IsNonTerminal());
 
-  TerminalMap::const_iterator p = m_sourceTermMap.find(sourceTerm);
-  return (p == m_sourceTermMap.end()) ? NULL : &p->second;
+  PhraseDictionaryNodeSCFG * const *p = m_sourceTermMap.Find(TerminalKey(sourceTerm));
+  return (p == NULL) ? NULL : *p;
 }
 
 const PhraseDictionaryNodeSCFG *PhraseDictionaryNodeSCFG::GetChild(const Word &sourceNonTerm, const Word &targetNonTerm) const
@@ -99,17 +101,22 @@ const PhraseDictionaryNodeSCFG *PhraseDictionaryNodeSCFG::GetChild(const Word &s
   CHECK(sourceNonTerm.IsNonTerminal());
   CHECK(targetNonTerm.IsNonTerminal());
 
-  NonTerminalMapKey key(sourceNonTerm, targetNonTerm);
-  NonTerminalMap::const_iterator p = m_nonTermMap.find(key);
-  return (p == m_nonTermMap.end()) ? NULL : &p->second;
+  PhraseDictionaryNodeSCFG * const *p = m_nonTermMap.Find(FactorIdKey(sourceNonTerm[0], targetNonTerm[0]));
+  return (p == NULL) ? NULL : *p;
 }
 
 void PhraseDictionaryNodeSCFG::Clear()
 {
+  for (TerminalMap::const_iterator p = m_sourceTermMap.begin(); p != m_sourceTermMap.end(); ++p) {
+    delete p->second;
+  }
+  for (NonTerminalMap::const_iterator p = m_nonTermMap.begin(); p != m_nonTermMap.end(); ++p) {
+    delete p->second;
+  }
   m_sourceTermMap.clear();
   m_nonTermMap.clear();
   delete m_targetPhraseCollection;
-  
+  m_targetPhraseCollection = NULL;
 }
   
 std::ostream& operator<<(std::ostream &out, const PhraseDictionaryNodeSCFG &node)
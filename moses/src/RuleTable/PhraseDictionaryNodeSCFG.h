@@ -28,11 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <ostream>
 #include "Word.h"
 #include "TargetPhraseCollection.h"
-#include "Terminal.h"
-
-#include <boost/functional/hash.hpp>
-#include <boost/unordered_map.hpp>
-#include <boost/version.hpp>
+#include "FactorIdMap.h"
 
 namespace Moses
 {
@@ -40,75 +36,15 @@ namespace Moses
 class PhraseDictionarySCFG;
 class PhraseDictionaryTMExtract;
   
-  //! @todo why?
-class NonTerminalMapKeyHasher
-{
-public:
-  size_t operator()(const std::pair<Word, Word> & k) const {
-    // Assumes that only the first factor of each Word is relevant.
-    const Word & w1 = k.first;
-    const Word & w2 = k.second;
-    const Factor * f1 = w1[0];
-    const Factor * f2 = w2[0];
-    size_t seed = 0;
-    boost::hash_combine(seed, *f1);
-    boost::hash_combine(seed, *f2);
-    return seed;
-  }
-};
-
-//! @todo why?
-class NonTerminalMapKeyEqualityPred
-{
-public:
-  bool operator()(const std::pair<Word, Word> & k1,
-                  const std::pair<Word, Word> & k2) const {
-    // Compare first non-terminal of each key.  Assumes that for Words
-    // representing non-terminals only the first factor is relevant.
-    {
-      const Word & w1 = k1.first;
-      const Word & w2 = k2.first;
-      const Factor * f1 = w1[0];
-      const Factor * f2 = w2[0];
-      if (f1->Compare(*f2)) {
-        return false;
-      }
-    }
-    // Compare second non-terminal of each key.
-    {
-      const Word & w1 = k1.second;
-      const Word & w2 = k2.second;
-      const Factor * f1 = w1[0];
-      const Factor * f2 = w2[0];
-      if (f1->Compare(*f2)) {
-        return false;
-      }
-    }
-    return true;
-  }
-};
-
 /** One node of the PhraseDictionarySCFG structure
 */
 class PhraseDictionaryNodeSCFG
 {
 public:
-  typedef std::pair<Word, Word> NonTerminalMapKey;
-
-#if defined(BOOST_VERSION) && (BOOST_VERSION >= 104200)
-  typedef boost::unordered_map<Word,
-          PhraseDictionaryNodeSCFG,
-          TerminalHasher,
-          TerminalEqualityPred> TerminalMap;
-
-  typedef boost::unordered_map<NonTerminalMapKey,
-          PhraseDictionaryNodeSCFG,
-          NonTerminalMapKeyHasher,
-          NonTerminalMapKeyEqualityPred> NonTerminalMap;
-#else
-  typedef std::map<Word, PhraseDictionaryNodeSCFG> TerminalMap;
-  typedef std::map<NonTerminalMapKey, PhraseDictionaryNodeSCFG> NonTerminalMap;
-#endif
+  /** children are keyed by factor ids: TerminalKey() of the source word, and
+   * FactorIdKey() of the source and target non-terminal labels */
+  typedef FactorIdMap<PhraseDictionaryNodeSCFG*> TerminalMap;
+  typedef FactorIdMap<PhraseDictionaryNodeSCFG*> NonTerminalMap;
 
 private:
   friend std::ostream& operator<<(std::ostream&, const PhraseDictionarySCFG&);
@@ -128,7 +64,15 @@ protected:
   PhraseDictionaryNodeSCFG()
     :m_targetPhraseCollection(NULL)
   {}
+private:
+  // not implemented: a node owns its children and target phrases
+  PhraseDictionaryNodeSCFG &operator=(const PhraseDictionaryNodeSCFG &);
 public:
+  //! only copied while empty, when inserted into a std::map
+  PhraseDictionaryNodeSCFG(const PhraseDictionaryNodeSCFG &copy)
+    :m_targetPhraseCollection(NULL) {
+    CHECK(copy.IsLeaf() && copy.m_targetPhraseCollection == NULL);
+  }
   virtual ~PhraseDictionaryNodeSCFG();
 
   bool IsLeaf() const {
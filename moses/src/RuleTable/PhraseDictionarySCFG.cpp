@@ -112,13 +112,12 @@ ostream& operator<<(ostream& out, const PhraseDictionarySCFG& phraseDict)
   typedef PhraseDictionaryNodeSCFG::NonTerminalMap NonTermMap;
 
   const PhraseDictionaryNodeSCFG &coll = phraseDict.m_collection;
+  // children are only known by their factor ids
   for (NonTermMap::const_iterator p = coll.m_nonTermMap.begin(); p != coll.m_nonTermMap.end(); ++p) {
-    const Word &sourceNonTerm = p->first.first;
-    out << sourceNonTerm;
+    out << "[" << (p->first >> 32) << "," << (p->first & 0xffffffff) << "] ";
   }
   for (TermMap::const_iterator p = coll.m_sourceTermMap.begin(); p != coll.m_sourceTermMap.end(); ++p) {
-    const Word &sourceTerm = p->first;
-    out << sourceTerm;
+    out << p->first << " ";
   }
   return out;
 }
@@ -44,10 +44,12 @@ void Scope3Parser::GetChartRuleCollection(
   const size_t start = range.GetStartPos();
   const size_t end = range.GetEndPos();
 
-  std::vector<std::pair<const UTrieNode *, const VarSpanNode *> > &pairVec = m_ruleApplications[start][end-start+1];
+  const size_t cell = GetCellIndex(start, end-start+1);
+  const RuleApplication *begin = &m_ruleApplications[0] + m_ruleApplicationIndex[cell];
+  const RuleApplication *last = &m_ruleApplications[0] + m_ruleApplicationIndex[cell+1];
 
   MatchCallback matchCB(range, outColl);
-  for (std::vector<std::pair<const UTrieNode *, const VarSpanNode *> >::const_iterator p = pairVec.begin(); p != pairVec.end(); ++p) {
+  for (const RuleApplication *p = begin; p != last; ++p) {
     const UTrieNode &ruleNode = *(p->first);
     const VarSpanNode &varSpanNode = *(p->second);
 
@@ -88,8 +90,6 @@ void Scope3Parser::GetChartRuleCollection(
 
 void Scope3Parser::Init()
 {
-  InitRuleApplicationVector();
-
   const Sentence &sentence = dynamic_cast<const Sentence &>(GetSentence());
 
   // Build a map from Words to index-sets.
@@ -108,16 +108,32 @@ void Scope3Parser::Init()
   m_varSpanTrie = vstBuilder.Build(*art);
 
   // Fill each cell with a list of pointers to relevant ART nodes.
-  AddRulesToCells(*art, std::make_pair<int, int>(-1, -1), sentence.GetSize()-1, 0);
+  CellRuleApplications cellRuleApplications;
+  AddRulesToCells(*art, std::make_pair<int, int>(-1, -1), sentence.GetSize()-1, 0,
+                  cellRuleApplications);
+  InitRuleApplicationTable(cellRuleApplications);
 }
 
-void Scope3Parser::InitRuleApplicationVector()
+void Scope3Parser::InitRuleApplicationTable(
+    const CellRuleApplications &cellRuleApplications)
 {
-  const size_t sourceSize = GetSentence().GetSize();
-  m_ruleApplications.resize(sourceSize);
-  for (size_t start = 0; start < sourceSize; ++start) {
-    size_t maxSpan = sourceSize-start+1;
-    m_ruleApplications[start].resize(maxSpan+1);
+  // Counting sort by cell, keeping the order within each cell.
+  const size_t numCells = GetCellIndex(GetSentence().GetSize(), 0) + 1;
+  m_ruleApplicationIndex.assign(numCells+1, 0);
+  CellRuleApplications::const_iterator p;
+  for (p = cellRuleApplications.begin(); p != cellRuleApplications.end(); ++p) {
+    ++m_ruleApplicationIndex[p->first+1];
+  }
+  for (size_t i = 1; i <= numCells; ++i) {
+    m_ruleApplicationIndex[i] += m_ruleApplicationIndex[i-1];
+  }
+
+  // Leave one spare element so that &m_ruleApplications[0] is always valid.
+  m_ruleApplications.resize(cellRuleApplications.size() + 1);
+  std::vector<size_t> next(m_ruleApplicationIndex.begin(),
+                           m_ruleApplicationIndex.end()-1);
+  for (p = cellRuleApplications.begin(); p != cellRuleApplications.end(); ++p) {
+    m_ruleApplications[next[p->first]++] = p->second;
   }
 }
 
@@ -133,7 +149,8 @@ void Scope3Parser::AddRulesToCells(
     const ApplicableRuleTrie &node,
     std::pair<int, int> start,
     int maxPos,
-    int depth)
+    int depth,
+    CellRuleApplications &cellRuleApplications) const
 {
   if (depth > 0) {
     // Determine the start range for this path if not already known.
@@ -182,14 +199,14 @@ void Scope3Parser::AddRulesToCells(
         if (m_maxChartSpan && span > m_maxChartSpan) {
           break;
         }
-        m_ruleApplications[i][span].push_back(std::make_pair(node.m_node,
-                                                             node.m_vstNode));
+        cellRuleApplications.push_back(std::make_pair(
+            GetCellIndex(i, span), RuleApplication(node.m_node, node.m_vstNode)));
       }
     }
   }
 
   for (std::vector<ApplicableRuleTrie*>::const_iterator p = node.m_children.begin(); p != node.m_children.end(); ++p) {
-    AddRulesToCells(**p, start, maxPos, depth+1);
+    AddRulesToCells(**p, start, maxPos, depth+1, cellRuleApplications);
   }
 }
 
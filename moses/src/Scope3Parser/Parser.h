@@ -81,15 +81,25 @@ class Scope3Parser : public ChartRuleLookupManager
       const TargetPhraseCollection *m_tpc;
   };
 
+  typedef std::pair<const UTrieNode *, const VarSpanNode *> RuleApplication;
+  typedef std::vector<std::pair<size_t, RuleApplication> > CellRuleApplications;
+
   void Init();
-  void InitRuleApplicationVector();
+  void InitRuleApplicationTable(const CellRuleApplications &);
   void FillSentenceMap(const Sentence &, SentenceMap &);
   void AddRulesToCells(const ApplicableRuleTrie &, std::pair<int, int>, int,
-                       int);
+                       int, CellRuleApplications &) const;
+
+  //! index of the cell for start position and span in m_ruleApplicationIndex
+  size_t GetCellIndex(size_t start, size_t span) const {
+    return start * (GetSentence().GetSize() + 1) + span;
+  }
 
   const RuleTableUTrie &m_ruleTable;
-  std::vector<std::vector<std::vector<
-    std::pair<const UTrieNode *, const VarSpanNode *> > > > m_ruleApplications;
+  // rule applications of all cells in one array, those of cell i being
+  // m_ruleApplications[m_ruleApplicationIndex[i]..m_ruleApplicationIndex[i+1])
+  std::vector<RuleApplication> m_ruleApplications;
+  std::vector<size_t> m_ruleApplicationIndex;
   std::auto_ptr<VarSpanNode> m_varSpanTrie;
   StackVec m_emptyStackVec;
   const size_t m_maxChartSpan;
@@ -133,6 +133,13 @@ public:
     m_scores[i] += score;
   }
 
+  //! Add a score to a single component of a ScoreProducer
+  void PlusEquals(const ScoreProducer* sp, size_t component, float score) {
+    CHECK(component < sp->GetNumScoreComponents());
+    const size_t i = m_sim->GetBeginIndex(sp->GetScoreBookkeepingID()) + component;
+    m_scores[i] += score;
+  }
+
   void Assign(const ScoreProducer* sp, const std::vector<float>& scores) {
     CHECK(scores.size() == sp->GetNumScoreComponents());
     size_t i = m_sim->GetBeginIndex(sp->GetScoreBookkeepingID());
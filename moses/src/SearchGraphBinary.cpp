@@ -0,0 +1,180 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include "util/check.hh"
+#include "SearchGraphBinary.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+const char MAGIC[4] = { 'M', 'S', 'G', 'B' };
+const size_t NO_POS = std::numeric_limits<size_t>::max();
+
+void WriteFloat(ostream &out, float value)
+{
+  char buf[sizeof(float)];
+  memcpy(buf, &value, sizeof(float));
+  out.write(buf, sizeof(float));
+}
+
+float ReadFloat(istream &in)
+{
+  char buf[sizeof(float)];
+  in.read(buf, sizeof(float));
+  CHECK(in.gcount() == sizeof(float));
+  float value;
+  memcpy(&value, buf, sizeof(float));
+  return value;
+}
+}
+
+void WriteVarint(ostream &out, unsigned long long value)
+{
+  char buf[10];
+  size_t len = 0;
+  while (value >= 0x80) {
+    buf[len++] = static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  buf[len++] = static_cast<char>(value);
+  out.write(buf, len);
+}
+
+unsigned long long ReadVarint(istream &in)
+{
+  unsigned long long value = 0;
+  for (unsigned int shift = 0; ; shift += 7) {
+    int c = in.get();
+    CHECK(c != EOF && shift < 64);
+    value |= static_cast<unsigned long long>(c & 0x7f) << shift;
+    if (!(c & 0x80)) return value;
+  }
+}
+
+SearchGraphBinaryWriter::SearchGraphBinaryWriter(ostream &out, long translationId, size_t numStacks)
+  :m_out(out)
+{
+  m_out.write(MAGIC, sizeof(MAGIC));
+  m_out.put(static_cast<char>(VERSION));
+  WriteVarint(m_out, translationId);
+  WriteVarint(m_out, numStacks);
+}
+
+void SearchGraphBinaryWriter::AddNode(const SearchGraphBinaryNode &node, const string &phrase)
+{
+  WriteVarint(m_out, node.id + 1);
+  WriteVarint(m_out, node.back + 1);
+  WriteVarint(m_out, node.recombined + 1);
+  if (node.startPos == NO_POS) {
+    WriteVarint(m_out, 0);
+    WriteVarint(m_out, 0);
+  } else {
+    WriteVarint(m_out, node.startPos);
+    WriteVarint(m_out, node.endPos + 1 - node.startPos);
+  }
+
+  boost::unordered_map<string, size_t>::const_iterator iter = m_phraseIds.find(phrase);
+  if (iter != m_phraseIds.end()) {
+    WriteVarint(m_out, iter->second);
+  } else {
+    size_t phraseId = m_phraseIds.size();
+    m_phraseIds[phrase] = phraseId;
+    WriteVarint(m_out, phraseId);
+    WriteVarint(m_out, phrase.size());
+    m_out.write(phrase.data(), phrase.size());
+  }
+
+  WriteFloat(m_out, node.score);
+  WriteFloat(m_out, node.transition);
+}
+
+void SearchGraphBinaryWriter::EndStack()
+{
+  WriteVarint(m_out, 0);
+}
+
+SearchGraphBinaryReader::SearchGraphBinaryReader(istream &in)
+  :m_in(in)
+  ,m_numStacks(0)
+  ,m_stack(0)
+{}
+
+bool SearchGraphBinaryReader::NextLattice(long &translationId)
+{
+  char magic[sizeof(MAGIC)];
+  m_in.read(magic, sizeof(MAGIC));
+  if (m_in.gcount() == 0) return false;
+  CHECK(m_in.gcount() == sizeof(MAGIC) && !memcmp(magic, MAGIC, sizeof(MAGIC)));
+  CHECK(m_in.get() == SearchGraphBinaryWriter::VERSION);
+
+  translationId = static_cast<long>(ReadVarint(m_in));
+  m_numStacks = ReadVarint(m_in);
+  m_stack = 0;
+  m_phrases.clear();
+  return true;
+}
+
+bool SearchGraphBinaryReader::NextNode(SearchGraphBinaryNode &node)
+{
+  unsigned long long id;
+  for (;;) {
+    if (m_stack == m_numStacks) return false;
+    id = ReadVarint(m_in);
+    if (id) break;
+    ++m_stack;
+  }
+
+  node.stack = m_stack;
+  node.id = static_cast<int>(id) - 1;
+  node.back = static_cast<int>(ReadVarint(m_in)) - 1;
+  node.recombined = static_cast<int>(ReadVarint(m_in)) - 1;
+  node.startPos = ReadVarint(m_in);
+  size_t length = ReadVarint(m_in);
+  if (length) {
+    node.endPos = node.startPos + length - 1;
+  } else {
+    node.startPos = node.endPos = NO_POS;
+  }
+
+  node.phraseId = ReadVarint(m_in);
+  CHECK(node.phraseId <= m_phrases.size());
+  if (node.phraseId == m_phrases.size()) {
+    size_t size = ReadVarint(m_in);
+    m_phrases.push_back(string(size, '\0'));
+    if (size) {
+      m_in.read(&m_phrases.back()[0], size);
+      CHECK(static_cast<size_t>(m_in.gcount()) == size);
+    }
+  }
+
+  node.score = ReadFloat(m_in);
+  node.transition = ReadFloat(m_in);
+  return true;
+}
+
+}
@@ -0,0 +1,111 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_SearchGraphBinary_h
+#define moses_SearchGraphBinary_h
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+namespace Moses
+{
+
+/** Compact binary encoding of the phrase-based search graph (-osgb).
+ *
+ * Each sentence is one self-contained record:
+ *   "MSGB" version:byte translationId:varint numStacks:varint
+ *   then for every stack a list of nodes terminated by varint 0.
+ * A node is
+ *   id+1 back+1 recombined+1 startPos length phraseRef :varint
+ *   score transition :float32
+ * where phraseRef either names a phrase seen earlier in the same record, or
+ * equals the number of phrases seen so far and is followed by the new
+ * phrase as varint length + bytes. The record can therefore be written one
+ * stack at a time and read back without ever holding the whole graph.
+ *
+ * This header has no dependencies on the decoder so that rescoring tools
+ * can read lattices by linking SearchGraphBinary.o alone.
+ */
+struct SearchGraphBinaryNode {
+  size_t stack; //! number of source words covered
+  int id; //! hypothesis id, unique within the sentence
+  int back; //! id of the previous hypothesis, -1 for the initial one
+  int recombined; //! id of the hypothesis this one was recombined into, or -1
+  size_t startPos, endPos; //! source span of the last phrase, both NOT_FOUND for the initial hypothesis
+  float score; //! total model score
+  float transition; //! score - score of back
+  size_t phraseId; //! index into the record's phrase table
+};
+
+class SearchGraphBinaryWriter
+{
+public:
+  static const unsigned char VERSION = 1;
+
+  /** starts a record; numStacks stacks must follow */
+  SearchGraphBinaryWriter(std::ostream &out, long translationId, size_t numStacks);
+
+  /** append a node to the current stack */
+  void AddNode(const SearchGraphBinaryNode &node, const std::string &phrase);
+  /** close the current stack and start the next one */
+  void EndStack();
+
+  size_t GetNumPhrases() const {
+    return m_phraseIds.size();
+  }
+
+protected:
+  std::ostream &m_out;
+  boost::unordered_map<std::string, size_t> m_phraseIds;
+};
+
+class SearchGraphBinaryReader
+{
+public:
+  explicit SearchGraphBinaryReader(std::istream &in);
+
+  /** start the next record. false at end of input */
+  bool NextLattice(long &translationId);
+  /** read the next node of the current record, moving across stack boundaries.
+   * false once all stacks of the record have been read */
+  bool NextNode(SearchGraphBinaryNode &node);
+
+  const std::string &GetPhrase(size_t phraseId) const {
+    return m_phrases[phraseId];
+  }
+  size_t GetNumStacks() const {
+    return m_numStacks;
+  }
+
+protected:
+  std::istream &m_in;
+  std::vector<std::string> m_phrases;
+  size_t m_numStacks, m_stack;
+};
+
+void WriteVarint(std::ostream &out, unsigned long long value);
+unsigned long long ReadVarint(std::istream &in);
+
+}
+
+#endif
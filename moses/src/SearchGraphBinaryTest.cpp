@@ -0,0 +1,104 @@
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SearchGraphBinary.h"
+
+#define BOOST_TEST_MODULE SearchGraphBinaryTest
+#include <boost/test/unit_test.hpp>
+
+namespace Moses { namespace {
+
+const size_t NO_POS = std::numeric_limits<size_t>::max();
+
+struct Written {
+  SearchGraphBinaryNode node;
+  size_t stack;
+  std::string phrase;
+};
+
+Written Node(size_t stack, int id, int back, int recombined, size_t startPos, size_t endPos, float score, float transition, const std::string &phrase) {
+  Written ret;
+  ret.stack = stack;
+  ret.node.id = id;
+  ret.node.back = back;
+  ret.node.recombined = recombined;
+  ret.node.startPos = startPos;
+  ret.node.endPos = endPos;
+  ret.node.score = score;
+  ret.node.transition = transition;
+  ret.phrase = phrase;
+  return ret;
+}
+
+void WriteLattice(std::ostream &out, long translationId, size_t numStacks, const std::vector<Written> &nodes) {
+  SearchGraphBinaryWriter writer(out, translationId, numStacks);
+  std::vector<Written>::const_iterator i = nodes.begin();
+  for (size_t stack = 0; stack < numStacks; ++stack) {
+    for (; i != nodes.end() && i->stack == stack; ++i) {
+      writer.AddNode(i->node, i->phrase);
+    }
+    writer.EndStack();
+  }
+  BOOST_REQUIRE(i == nodes.end());
+}
+
+void CheckLattice(SearchGraphBinaryReader &reader, long translationId, size_t numStacks, const std::vector<Written> &nodes) {
+  long readId;
+  BOOST_REQUIRE(reader.NextLattice(readId));
+  BOOST_CHECK_EQUAL(translationId, readId);
+  BOOST_CHECK_EQUAL(numStacks, reader.GetNumStacks());
+  SearchGraphBinaryNode node;
+  for (std::vector<Written>::const_iterator i = nodes.begin(); i != nodes.end(); ++i) {
+    BOOST_REQUIRE(reader.NextNode(node));
+    BOOST_CHECK_EQUAL(i->stack, node.stack);
+    BOOST_CHECK_EQUAL(i->node.id, node.id);
+    BOOST_CHECK_EQUAL(i->node.back, node.back);
+    BOOST_CHECK_EQUAL(i->node.recombined, node.recombined);
+    BOOST_CHECK_EQUAL(i->node.startPos, node.startPos);
+    BOOST_CHECK_EQUAL(i->node.endPos, node.endPos);
+    BOOST_CHECK_EQUAL(i->node.score, node.score);
+    BOOST_CHECK_EQUAL(i->node.transition, node.transition);
+    BOOST_CHECK_EQUAL(i->phrase, reader.GetPhrase(node.phraseId));
+  }
+  BOOST_CHECK(!reader.NextNode(node));
+}
+
+BOOST_AUTO_TEST_CASE(round_trip) {
+  std::vector<Written> first;
+  first.push_back(Node(0, 0, -1, -1, NO_POS, NO_POS, 0.0f, 0.0f, ""));
+  first.push_back(Node(1, 1, 0, -1, 0, 0, -1.5f, -1.5f, "das"));
+  first.push_back(Node(1, 2, 0, -1, 1, 1, -2.25f, -2.25f, "haus"));
+  first.push_back(Node(2, 3, 1, -1, 1, 1, -3.0f, -1.5f, "haus"));
+  first.push_back(Node(2, 4, 2, 3, 0, 0, -4.125f, -1.875f, "das"));
+  // stack 3 is empty
+  first.push_back(Node(4, 300, 3, -1, 2, 130, -1e6f, -0.001f, "ein sehr langer satz"));
+
+  std::vector<Written> second;
+  second.push_back(Node(0, 0, -1, -1, NO_POS, NO_POS, 0.0f, 0.0f, ""));
+  second.push_back(Node(1, 1, 0, -1, 0, 0, -0.5f, -0.5f, "haus"));
+
+  std::stringstream stream;
+  WriteLattice(stream, 0, 5, first);
+  WriteLattice(stream, 1234567, 2, second);
+  WriteLattice(stream, 7, 3, std::vector<Written>());
+
+  SearchGraphBinaryReader reader(stream);
+  CheckLattice(reader, 0, 5, first);
+  // phrase ids start over in every record
+  CheckLattice(reader, 1234567, 2, second);
+  CheckLattice(reader, 7, 3, std::vector<Written>());
+  long translationId;
+  BOOST_CHECK(!reader.NextLattice(translationId));
+}
+
+BOOST_AUTO_TEST_CASE(varint) {
+  const unsigned long long values[] = { 0, 1, 127, 128, 16383, 16384, std::numeric_limits<unsigned long long>::max() };
+  const size_t count = sizeof(values) / sizeof(values[0]);
+  std::stringstream stream;
+  for (size_t i = 0; i < count; ++i) WriteVarint(stream, values[i]);
+  for (size_t i = 0; i < count; ++i) BOOST_CHECK_EQUAL(values[i], ReadVarint(stream));
+}
+
+}} // namespaces
@@ -265,7 +265,12 @@ void SearchNormal::ExpandAllHypotheses(const Hypothesis &hypothesis, size_t star
     expectedScore = hypothesis.GetScore();
 
     // add new future score estimate
-    expectedScore += m_transOptColl.GetFutureScore().CalcFutureScore( hypothesis.GetWordsBitmap(), startPos, endPos );
+    const SquareMatrix &futureScore = m_transOptColl.GetFutureScore();
+    if (hypothesis.GetPrevHypo() != NULL) {
+      expectedScore += futureScore.UpdateFutureScore( hypothesis.GetFutureScore(), hypothesis.GetWordsBitmap(), startPos, endPos );
+    } else {
+      expectedScore += futureScore.CalcFutureScore( hypothesis.GetWordsBitmap(), startPos, endPos );
+    }
   }
 
   // loop through all translation options
@@ -20,8 +20,10 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <algorithm>
 #include <string>
 #include <iostream>
+#include <limits>
 #include "SquareMatrix.h"
 #include "TypeDef.h"
 #include "Util.h"
@@ -112,6 +114,85 @@ float SquareMatrix::CalcFutureScore( WordsBitmap const &bitmap, size_t startPos,
   return futureScore;
 }
 
+/**
+ * Update the future score estimate of a hypothesis for an extension
+ * that covers an additional span. Only the gap that contains the span
+ * changes, so the new estimate is the old one minus the cost of that
+ * gap plus the cost of what is left of it on either side. This avoids
+ * rescanning the whole coverage bitmap for every expansion.
+ *
+ * When the span closes its gap, or the estimate is not finite, the
+ * estimate is recomputed from scratch so that complete hypotheses get
+ * an exact zero.
+ *
+ * /param prevFutureScore future score estimate for prevBitmap
+ * /param prevBitmap coverage bitmap before the extension
+ * /param startPos start of the span that is added to the coverage
+ * /param endPos end of the span that is added to the coverage
+ */
+
+float SquareMatrix::UpdateFutureScore( float prevFutureScore, WordsBitmap const &prevBitmap, size_t startPos, size_t endPos ) const
+{
+  const size_t gapStart = prevBitmap.GetEdgeToTheLeftOf(startPos);
+  const size_t gapEnd = prevBitmap.GetEdgeToTheRightOf(endPos);
+  const float gapScore = GetScore(gapStart, gapEnd);
+  if ((gapStart == startPos && gapEnd == endPos)
+      || gapScore == -numeric_limits<float>::infinity()
+      || prevFutureScore == -numeric_limits<float>::infinity()) {
+    return CalcFutureScore(prevBitmap, startPos, endPos);
+  }
+
+  float futureScore = prevFutureScore - gapScore;
+  if (gapStart < startPos) {
+    futureScore += GetScore(gapStart, startPos - 1);
+  }
+  if (endPos < gapEnd) {
+    futureScore += GetScore(endPos + 1, gapEnd);
+  }
+  return futureScore;
+}
+
+/**
+ * Fill each span with the best score of joining two adjacent smaller
+ * spans, if that beats the score already in the cell.
+ *
+ * Spans are processed by increasing length. Every finished cell is
+ * mirrored into the otherwise unused lower triangle, so that the
+ * scores of all spans ending at endPos lie contiguously in row endPos.
+ * The inner loop then streams two contiguous rows instead of walking a
+ * column with a stride of the sentence length, and keeps four
+ * independent maxima so that the compiler can overlap the additions.
+ */
+
+void SquareMatrix::CalcJoinedScores()
+{
+  for(size_t length = 2; length <= m_size ; length++) {
+    for(size_t startPos = 0; startPos + length <= m_size ; startPos++) {
+      const size_t endPos = startPos + length - 1;
+      // left part [startPos, joinAt], right part [joinAt+1, endPos]
+      const float *left = m_array + startPos * m_size;
+      const float *right = m_array + endPos * m_size + 1;
+
+      float best0 = GetScore(startPos, endPos);
+      float best1 = best0, best2 = best0, best3 = best0;
+      size_t joinAt = startPos;
+      for(; joinAt + 4 <= endPos ; joinAt += 4) {
+        best0 = std::max(best0, left[joinAt] + right[joinAt]);
+        best1 = std::max(best1, left[joinAt+1] + right[joinAt+1]);
+        best2 = std::max(best2, left[joinAt+2] + right[joinAt+2]);
+        best3 = std::max(best3, left[joinAt+3] + right[joinAt+3]);
+      }
+      for(; joinAt < endPos ; joinAt++) {
+        best0 = std::max(best0, left[joinAt] + right[joinAt]);
+      }
+      const float best = std::max(std::max(best0, best1), std::max(best2, best3));
+
+      SetScore(startPos, endPos, best);
+      m_array[endPos * m_size + startPos] = best;
+    }
+  }
+}
+
 TO_STRING_BODY(SquareMatrix);
 
 }
@@ -63,6 +63,9 @@ public:
   }
   float CalcFutureScore( WordsBitmap const& ) const;
   float CalcFutureScore( WordsBitmap const&, size_t startPos, size_t endPos ) const;
+  float UpdateFutureScore( float prevFutureScore, WordsBitmap const &prevBitmap, size_t startPos, size_t endPos ) const;
+
+  void CalcJoinedScores();
 
   TO_STRING();
 };
@@ -56,6 +56,21 @@ using namespace std;
 
 namespace Moses
 {
+//! Words only have room for MAX_NUM_FACTORS factors (set with --max-factors)
+static bool CheckFactorTypes(const vector<FactorType> &factorTypes, const string &where)
+{
+  for (size_t i = 0; i < factorTypes.size(); ++i) {
+    if (factorTypes[i] >= MAX_NUM_FACTORS) {
+      stringstream strme;
+      strme << where << " uses factor " << factorTypes[i] << ", but moses was compiled with support for "
+            << MAX_NUM_FACTORS << " factors only. Recompile with --max-factors=" << factorTypes[i] + 1;
+      UserMessage::Add(strme.str());
+      return false;
+    }
+  }
+  return true;
+}
+
 static size_t CalcMax(size_t x, const vector<size_t>& y)
 {
   size_t max = x;
@@ -87,6 +102,8 @@ StaticData::StaticData()
   ,m_factorDelimiter("|") // default delimiter between factors
   ,m_lmEnableOOVFeature(false)
   ,m_isAlwaysCreateDirectTranslationOption(false)
+  ,m_outputSearchGraphExtended(false)
+  ,m_outputSearchGraphBinary(false)
 {
   m_maxFactorIdx[0] = 0;  // source side
   m_maxFactorIdx[1] = 0;  // target side
@@ -227,6 +244,15 @@ bool StaticData::LoadData(Parameter *parameter)
     }
     m_outputSearchGraph = true;
     m_outputSearchGraphExtended = true;
+  }
+  // ... in binary format
+  else if (m_parameter->GetParam("output-search-graph-binary").size() > 0) {
+    if (m_parameter->GetParam("output-search-graph-binary").size() != 1) {
+      UserMessage::Add(string("ERROR: wrong format for switch -output-search-graph-binary file"));
+      return false;
+    }
+    m_outputSearchGraph = true;
+    m_outputSearchGraphBinary = true;
   } else
     m_outputSearchGraph = false;
 #ifdef HAVE_PROTOBUF
@@ -275,6 +301,12 @@ bool StaticData::LoadData(Parameter *parameter)
     UserMessage::Add(string("no input factor specified in config file"));
     return false;
   }
+  if (!CheckFactorTypes(m_inputFactorOrder, "[input-factors]")) return false;
+  // chart rule tables key terminals by the ids of at most two factors
+  if (m_searchAlgorithm == ChartDecoding && m_inputFactorOrder.size() > 2) {
+    UserMessage::Add(string("chart decoding supports at most 2 input factors"));
+    return false;
+  }
 
   //output factors
   const vector<string> &outputFactorVector = m_parameter->GetParam("output-factors");
@@ -285,6 +317,7 @@ bool StaticData::LoadData(Parameter *parameter)
     // default. output factor 0
     m_outputFactorOrder.push_back(0);
   }
+  if (!CheckFactorTypes(m_outputFactorOrder, "[output-factors]")) return false;
 
   //source word deletion
   SetBooleanParameter( &m_wordDeletionEnabled, "phrase-drop-allowed", false );
@@ -367,6 +400,9 @@ bool StaticData::LoadData(Parameter *parameter)
 
   SetBooleanParameter(&m_cubePruningLazyScoring, "cube-pruning-lazy-scoring", false);
 
+  m_cubePruningTimeBudget = (m_parameter->GetParam("cube-pruning-time-budget").size() > 0)
+                            ? Scan<size_t>(m_parameter->GetParam("cube-pruning-time-budget")[0]) : 0;
+
   // unknown word processing
   SetBooleanParameter( &m_dropUnknown, "drop-unknown", false );
 
@@ -418,6 +454,8 @@ bool StaticData::LoadData(Parameter *parameter)
 
   m_lmcache_cleanup_threshold = (m_parameter->GetParam("clean-lm-cache").size() > 0) ?
                                 Scan<size_t>(m_parameter->GetParam("clean-lm-cache")[0]) : 1;
+  m_lmProbeCacheSize = (m_parameter->GetParam("lmodel-probe-cache").size() > 0) ?
+                       Scan<size_t>(m_parameter->GetParam("lmodel-probe-cache")[0]) : 0;
 
   m_threadCount = 1;
   const std::vector<std::string> &threadInfo = m_parameter->GetParam("threads");
@@ -769,6 +807,8 @@ bool StaticData::LoadLexicalReorderingModel()
       //format error
       return false;
     }
+    if (!CheckFactorTypes(input, "[distortion-file]") || !CheckFactorTypes(output, "[distortion-file]"))
+      return false;
 
     string modelType = spec[1];
 
@@ -814,6 +854,8 @@ bool StaticData::LoadGlobalLexicalModel()
     }
     vector<FactorType> inputFactors = Tokenize<FactorType>(factors[0],",");
     vector<FactorType> outputFactors = Tokenize<FactorType>(factors[1],",");
+    if (!CheckFactorTypes(inputFactors, "[global-lexical-file]") || !CheckFactorTypes(outputFactors, "[global-lexical-file]"))
+      return false;
     m_globalLexicalModels.push_back( new GlobalLexicalModel( spec[1], weight[i], inputFactors, outputFactors ) );
   }
   return true;
@@ -848,7 +890,7 @@ bool StaticData::LoadLanguageModels()
       } else {
         vector<string>	token		= Tokenize(lmVector[i]);
         if (token.size() != 4 && token.size() != 5 ) {
-          UserMessage::Add("Expected format 'LM-TYPE FACTOR-TYPE NGRAM-ORDER filePath [mapFilePath (only for IRSTLM)]'");
+          UserMessage::Add("Expected format 'LM-TYPE FACTOR-TYPE NGRAM-ORDER filePath [mapFilePath (only for IRSTLM) | load=METHOD (only for KenLM)]'");
           return false;
         }
         // type = implementation, SRI, IRST etc
@@ -856,16 +898,23 @@ bool StaticData::LoadLanguageModels()
 
         // factorType = 0 = Surface, 1 = POS, 2 = Stem, 3 = Morphology, etc
         vector<FactorType> 	factorTypes		= Tokenize<FactorType>(token[1], ",");
+        if (!CheckFactorTypes(factorTypes, "[lmodel-file]")) return false;
 
         // nGramOrder = 2 = bigram, 3 = trigram, etc
         size_t nGramOrder = Scan<int>(token[2]);
 
         string &languageModelFile = token[3];
+        util::LoadMethod kenLoadMethod = (lmImplementation == LazyKen) ? util::LAZY : util::POPULATE_OR_READ;
         if (token.size() == 5) {
           if (lmImplementation==IRST)
             languageModelFile += " " + token[4];
-          else {
-            UserMessage::Add("Expected format 'LM-TYPE FACTOR-TYPE NGRAM-ORDER filePath [mapFilePath (only for IRSTLM)]'");
+          else if ((lmImplementation == Ken || lmImplementation == LazyKen) && token[4].compare(0, 5, "load=") == 0) {
+            if (!util::ParseLoadMethod(token[4].c_str() + 5, kenLoadMethod)) {
+              UserMessage::Add("Unknown KenLM load method in '" + token[4] + "'.  Use lazy, populate, populate_or_read, read, huge, huge_pool or interleave");
+              return false;
+            }
+          } else {
+            UserMessage::Add("Expected format 'LM-TYPE FACTOR-TYPE NGRAM-ORDER filePath [mapFilePath (only for IRSTLM) | load=METHOD (only for KenLM)]'");
             return false;
           }
         }
@@ -878,7 +927,8 @@ bool StaticData::LoadLanguageModels()
                , nGramOrder
                , languageModelFile
                , m_scoreIndexManager
-               , LMdub[i]);
+               , LMdub[i]
+               , kenLoadMethod);
         if (lm == NULL) {
           UserMessage::Add("no LM created. We probably don't have it compiled");
           return false;
@@ -916,6 +966,8 @@ bool StaticData::LoadGenerationTables()
       vector<string>			token		= Tokenize(generationVector[currDict]);
       vector<FactorType> 	input		= Tokenize<FactorType>(token[0], ",")
                                     ,output	= Tokenize<FactorType>(token[1], ",");
+      if (!CheckFactorTypes(input, "[generation-file]") || !CheckFactorTypes(output, "[generation-file]"))
+        return false;
       m_maxFactorIdx[1] = CalcMax(m_maxFactorIdx[1], input, output);
       string							filePath;
       size_t							numFeatures;
@@ -1006,6 +1058,8 @@ bool StaticData::LoadPhraseTables()
 
       vector<FactorType>  input		= Tokenize<FactorType>(token[1], ",")
                                     ,output = Tokenize<FactorType>(token[2], ",");
+      if (!CheckFactorTypes(input, "[ttable-file]") || !CheckFactorTypes(output, "[ttable-file]"))
+        return false;
       m_maxFactorIdx[0] = CalcMax(m_maxFactorIdx[0], input);
       m_maxFactorIdx[1] = CalcMax(m_maxFactorIdx[1], output);
       m_maxNumFactors = std::max(m_maxFactorIdx[0], m_maxFactorIdx[1]) + 1;
@@ -172,6 +172,7 @@ protected:
   float m_lmbrMapWeight; //! Weight given to the map solution. See Kumar et al 09 for details
 
   size_t m_lmcache_cleanup_threshold; //! number of translations after which LM claenup is performed (0=never, N=after N translations; default is 1)
+  size_t m_lmProbeCacheSize; //! entries in the LM probe cache shared by sentences and threads (0=off)
   bool m_lmEnableOOVFeature;
 
   bool m_timeout; //! use timeout
@@ -191,6 +192,7 @@ protected:
   bool m_outputWordGraph; //! whether to output word graph
   bool m_outputSearchGraph; //! whether to output search graph
   bool m_outputSearchGraphExtended; //! ... in extended format
+  bool m_outputSearchGraphBinary; //! ... in compact binary format
 #ifdef HAVE_PROTOBUF
   bool m_outputSearchGraphPB; //! whether to output search graph as a protobuf
 #endif
@@ -198,6 +200,7 @@ protected:
 
   size_t m_cubePruningPopLimit;
   size_t m_cubePruningDiversity;
+  size_t m_cubePruningTimeBudget; //! milliseconds per sentence, 0 = none
   bool m_cubePruningLazyScoring;
   size_t m_ruleLimit;
 
@@ -314,6 +317,9 @@ public:
   size_t GetCubePruningDiversity() const {
     return m_cubePruningDiversity;
   }
+  size_t GetCubePruningTimeBudget() const {
+    return m_cubePruningTimeBudget;
+  }
   bool GetCubePruningLazyScoring() const {
     return m_cubePruningLazyScoring;
   }
@@ -539,6 +545,9 @@ public:
   size_t GetLMCacheCleanupThreshold() const {
     return m_lmcache_cleanup_threshold;
   }
+  size_t GetLMProbeCacheSize() const {
+    return m_lmProbeCacheSize;
+  }
 
   bool GetLMEnableOOVFeature() const {
     return m_lmEnableOOVFeature;
@@ -553,6 +562,9 @@ public:
   bool GetOutputSearchGraphExtended() const {
     return m_outputSearchGraphExtended;
   }
+  bool GetOutputSearchGraphBinary() const {
+    return m_outputSearchGraphBinary;
+  }
 #ifdef HAVE_PROTOBUF
   bool GetOutputSearchGraphPB() const {
     return m_outputSearchGraphPB;
@@ -86,9 +86,10 @@ namespace Moses
 
     VERBOSE(3,"Evaluating SyntacticLanguageModel for a hypothesis" << endl);
 
-    SyntacticLanguageModelState<YModel,XModel,S,R>*  tmpState = NULL;
-    SyntacticLanguageModelState<YModel,XModel,S,R>* nextState = NULL;
-  
+    // The new state shares the beam of the previous one until it is extended
+    SyntacticLanguageModelState<YModel,XModel,S,R>* nextState =
+      new SyntacticLanguageModelState<YModel,XModel,S,R>(*static_cast<const SyntacticLanguageModelState<YModel,XModel,S,R>*>(prev_state));
+    nextState->countHypothesis();
 
     const TargetPhrase& targetPhrase = cur_hypo.GetCurrTargetPhrase();
 
@@ -97,22 +98,12 @@ namespace Moses
       const Word& word = targetPhrase.GetWord(i);
       const Factor* factor = word.GetFactor(m_factorType);
       
-      const std::string& string = factor->GetString();
-      
-      if (i==0) {
-	nextState = new SyntacticLanguageModelState<YModel,XModel,S,R>((const SyntacticLanguageModelState<YModel,XModel,S,R>*)prev_state, string);
-      } else {
-	tmpState = nextState;
-	nextState = new SyntacticLanguageModelState<YModel,XModel,S,R>(tmpState, string);
-	delete tmpState;
-      }
-      
-      double score = nextState->getScore();
-      VERBOSE(3,"SynLM evaluated a score of " << score << endl);
-      accumulator->Assign( this, score );
+      nextState->extend(factor);
     }
 
-  
+    if (targetPhrase.GetSize() > 0) {
+      accumulator->Assign( this, nextState->getScore() );
+    }
 
     return nextState;
 
@@ -9,11 +9,40 @@
 
 #include "SyntacticLanguageModelFiles.h"
 #include "FFState.h"
+#include "Factor.h"
+#include <ctime>
 #include <string>
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/weak_ptr.hpp>
 
 namespace Moses
 {
 
+// Work done by the syntactic LM for one sentence, reported when the
+// sentence's states are released.
+struct SyntacticLanguageModelStats {
+  size_t hypotheses;
+  size_t words;
+  size_t steps;   // HHMM steps actually run, the other words were cached
+  clock_t stepTime;
+  size_t nodes;   // beams currently held by some state
+  size_t peakNodes;
+
+  SyntacticLanguageModelStats() : hypotheses(0), words(0), steps(0), stepTime(0), nodes(0), peakNodes(0) {}
+
+  ~SyntacticLanguageModelStats() {
+    IFVERBOSE(2) {
+      double seconds = double(stepTime) / CLOCKS_PER_SEC;
+      VERBOSE(2, "SynLM: " << hypotheses << " hypotheses, " << words << " words, "
+              << steps << " HHMM steps, " << seconds << " s in HHMM steps, "
+              << (hypotheses ? 1e6 * seconds / hypotheses : 0.0) << " us per hypothesis, "
+              << peakNodes << " beams at most in memory" << std::endl);
+    }
+  }
+};
+
 template <class MY, class MX, class YS=typename MY::RandVarType, class B=NullBackDat<typename MY::RandVarType> >
   class SyntacticLanguageModelState : public FFState {
  public:
@@ -21,33 +50,56 @@ template <class MY, class MX, class YS=typename MY::RandVarType, class B=NullBac
   // Initialize an empty LM state
   SyntacticLanguageModelState( SyntacticLanguageModelFiles<MY,MX>* modelData, int beamSize );
 
-  // Get the next LM state from an existing LM state and the next word
-  SyntacticLanguageModelState( const SyntacticLanguageModelState* prev, std::string word );
-
-
- ~SyntacticLanguageModelState() {
-   VERBOSE(3,"Destructing SyntacticLanguageModelState" << std::endl);
-   delete randomVariableStore;
- }
+  // Get the next LM state from this LM state and the next word
+  void extend( const Factor* word );
 
  virtual int Compare(const FFState& other) const;
 
   // Get the LM score from this LM state
-  double getScore() const;
+  double getScore() const {
+    return node->score;
+  }
+
+ double getProb() const {
+   return node->prob;
+ }
 
- double getProb() const;
+ // Count a hypothesis for the statistics
+ void countHypothesis() const {
+   ++node->stats->hypotheses;
+ }
 
  private:
 
- void setScore(double score);
- void printRV();
+ // The HHMM beam after some words.  A node is shared by all states that
+ // reach it and remembers its successors, so the HHMM step from one beam
+ // with one word runs once however many live hypotheses make it.  The
+ // successors are weak: a beam is freed with the last state holding it, as
+ // it would be without sharing, and is only recomputed if a later
+ // hypothesis reaches it again.  All nodes of a sentence belong to the
+ // thread decoding it.
+ struct Node {
+   SafeArray1D<Id<int>,pair<YS,LogProb> > randomVariableStore;
+   double prob;
+   double score;
+   bool sentenceStart;
+   int beamSize;
+   SyntacticLanguageModelFiles<MY,MX>* modelData;
+   boost::shared_ptr<SyntacticLanguageModelStats> stats;
+   boost::unordered_map<const Factor*, boost::weak_ptr<Node> > successors;
+
+   explicit Node(const boost::shared_ptr<SyntacticLanguageModelStats>& stats) : stats(stats) {
+     if (++stats->nodes > stats->peakNodes) stats->peakNodes = stats->nodes;
+   }
+   ~Node() {
+     --stats->nodes;
+   }
+
+   void setScore(double score);
+   void printRV();
+ };
 
- SafeArray1D<Id<int>,pair<YS,LogProb> >* randomVariableStore;
- double prob;
- double score;
- int beamSize;
- SyntacticLanguageModelFiles<MY,MX>* modelData;
- bool sentenceStart;
+ boost::shared_ptr<Node> node;
 };
 
 
@@ -55,16 +107,16 @@ template <class MY, class MX, class YS=typename MY::RandVarType, class B=NullBac
 
  
  template <class MY, class MX, class YS, class B>
-   void SyntacticLanguageModelState<MY,MX,YS,B>::printRV() {
+   void SyntacticLanguageModelState<MY,MX,YS,B>::Node::printRV() {
 
    cerr << "*********** BEGIN printRV() ******************" << endl;
-   int size=randomVariableStore->getSize();
-   cerr << "randomVariableStore->getSize() == " << size << endl;
+   int size=randomVariableStore.getSize();
+   cerr << "randomVariableStore.getSize() == " << size << endl;
 
    for (int depth=0; depth<size; depth+=1) {
 
      
-     const pair<YS,LogProb> *data = &(randomVariableStore->get(depth));
+     const pair<YS,LogProb> *data = &(randomVariableStore.get(depth));
      std::cerr << "randomVariableStore[" << depth << "]\t" << data->first << "\tprob = " << data->second.toProb() << "\tlogProb = " << double(data->second.toInt())/100 << std::endl;
 
    }
@@ -78,38 +130,30 @@ template <class MY, class MX, class YS=typename MY::RandVarType, class B=NullBac
 //    argv is the list of model file names
 //
 template <class MY, class MX, class YS, class B>
-  SyntacticLanguageModelState<MY,MX,YS,B>::SyntacticLanguageModelState( SyntacticLanguageModelFiles<MY,MX>* modelData, int beamSize ) {
+  SyntacticLanguageModelState<MY,MX,YS,B>::SyntacticLanguageModelState( SyntacticLanguageModelFiles<MY,MX>* modelData, int beamSize )
+  : node(boost::make_shared<Node>(boost::make_shared<SyntacticLanguageModelStats>())) {
 
-  this->randomVariableStore = new SafeArray1D<Id<int>,pair<YS,LogProb> >();
-  this->modelData = modelData;
-  this->beamSize = beamSize;
+  node->modelData = modelData;
+  node->beamSize = beamSize;
 
   // Initialize an empty random variable value
   YS xBEG;
   StringInput(String(BEG_STATE).c_array())>>xBEG>>"\0";
   cerr<<xBEG<<"\n";
 
-  //  cout << "Examining RV store just before RV init" << endl;   
-  //printRV();
-
   // Initialize the random variable store
-  this->randomVariableStore->init(1,pair<YS,LogProb>(xBEG,0));
+  node->randomVariableStore.init(1,pair<YS,LogProb>(xBEG,0));
 
-  this->sentenceStart = true;
+  node->sentenceStart = true;
 
   IFVERBOSE(3) {
     VERBOSE(3,"Examining RV store just after RV init" << endl);
-    printRV();
+    node->printRV();
   }
 
   // Get score of final frame in HHMM
   LogProb l(1.0);
-  //score = l.toDouble();
-  setScore(l.toDouble());
-  //  MY::F_ROOT_OBS = true;
- // this->modelData->getHiddenModel()->setRootObs(true);
-  
-  
+  node->setScore(l.toDouble());
 }
 
 
@@ -128,140 +172,56 @@ template <class MY, class MX, class YS, class B>
 
 
 template <class MY, class MX, class YS, class B>
-  SyntacticLanguageModelState<MY,MX,YS,B>::SyntacticLanguageModelState( const SyntacticLanguageModelState* prev, std::string word ) {
+  void SyntacticLanguageModelState<MY,MX,YS,B>::extend( const Factor* word ) {
+
+  Node& prev = *node;
+  ++prev.stats->words;
+  boost::weak_ptr<Node>& cached = prev.successors[word];
+  if (boost::shared_ptr<Node> found = cached.lock()) {
+    node = found;
+    VERBOSE(3,"SynLM found a cached score of " << node->score << endl);
+    return;
+  }
 
-  // Initialize member variables 
-  this->randomVariableStore = new SafeArray1D<Id<int>,pair<YS,LogProb> >();
-  this->modelData = prev->modelData;
-  this->beamSize = prev->beamSize;
-  this->randomVariableStore->init(this->beamSize);
-  this->sentenceStart=false;
+  clock_t start = clock();
 
-  YS ysEND;
-  StringInput(String(END_STATE).c_array())>>ysEND>>"\0";
+  // Initialize member variables 
+  boost::shared_ptr<Node> next = boost::make_shared<Node>(prev.stats);
+  cached = next;
+  next->modelData = prev.modelData;
+  next->beamSize = prev.beamSize;
+  next->randomVariableStore.init(next->beamSize);
+  next->sentenceStart=false;
 
   // Get HHMM model files
-  MY& mH = *(modelData->getHiddenModel());
-  MX& mO = *(modelData->getObservedModel());
+  MY& mH = *(prev.modelData->getHiddenModel());
+  MX& mO = *(prev.modelData->getObservedModel());
   
   // Initialize HHMM
   HMM<MY,MX,YS,B> hmm(mH,mO);  
   int MAX_WORDS  = 2;
-  hmm.init(MAX_WORDS,this->beamSize,prev->randomVariableStore);
-  typename MX::RandVarType x(word.c_str()); 
-  //  cout << "Examining HHMM just after hmm.init" << endl;   
-  //  hmm.debugPrint();
-
-
-  /*  cerr << "*********** BEGIN writeCurr() ******************" << endl;
-  hmm.writeCurr(cout,0);
-  hmm.writeCurr(cout,1);
-  cerr << "*********** END writeCurr() ******************" << endl;
-  */
-/*
-  {
-    
-  int wnum=1;
-  list<TrellNode<YS,B> > lys = hmm.getMLSnodes(ysEND);                                           // get mls list
-      for ( typename list<TrellNode<YS,B> >::iterator i=lys.begin(); i!=lys.end(); i++, wnum++ ) {   // for each frame
-        cout << "HYPOTH " << wnum
-             << " " << i->getBackData()
-             << " " << x
-             << " " << i->getId() 
-             << " (" << i->getLogProb() << ")"
-             << endl;                                                                             //   print RV val
-      }
-  }
-  */
-
-
-  /*
-  cerr << "Writing hmm.writeCurr" << endl;
-  hmm.writeCurr(cerr,0);
-  hmm.writeCurr(cerr,1);
-  cerr << "...done writing hmm.writeCurr" << endl;
-  */
-  hmm.getCurrSum();
-
-
-
-  // Initialize observed variable
-  //  typename MX::RandVarType ov;
-  //  ov.set(word.c_str(),mO);
-  //  MY::WORD = ov.getW();
-  //bool endOfSentence = prev->sentenceStart;//true; 
-
-  //  std::cerr << "About to give HHMM a word of input:\t" << word << std::endl;
-
-  hmm.updateRanked(x, prev->sentenceStart);
-
-  //  cout << "Examining HHMM just after hmm.updateRanked(" << x << "," << prev->sentenceStart << ")" << endl;
-  //  hmm.debugPrint();
-/*
-  cerr << "*********** BEGIN writeCurr() ******************" << endl;
-  hmm.writeCurr(cout,0);
-  hmm.writeCurr(cout,1);
-  cerr << "*********** END writeCurr() ******************" << endl;
-  */
-/*
-{
-
-  int wnum=1;
-  list<TrellNode<YS,B> > lys = hmm.getMLSnodes(ysEND);                                           // get mls list
-      for ( typename list<TrellNode<YS,B> >::iterator i=lys.begin(); i!=lys.end(); i++, wnum++ ) {   // for each frame
-        cout << "HYPOTH " << wnum
-             << " " << i->getBackData()
-             << " " << x
-             << " " << i->getId() 
-             << " (" << i->getLogProb() << ")"
-             << endl;                                                                             //   print RV val
-      }
-  }
-  */
-//  X ov(word.c_str());
-  //mH.setWord(ov);
-  // MY::WORD = ov;//ov.getW();
+  hmm.init(MAX_WORDS,next->beamSize,&prev.randomVariableStore);
+  typename MX::RandVarType x(word->GetString().c_str()); 
 
   // Update HHMM based on observed variable
-  //hmm.updateRanked(ov);
-  //mH.setRootObs(true);
-  //MY::F_ROOT_OBS = false;
-  
+  hmm.updateRanked(x, prev.sentenceStart);
+
   // Get the current score
-   double currSum = hmm.getCurrSum();
-   //VERBOSE(3,"Setting score using currSum for " << scientific << x << " = " << currSum << endl);
-  setScore(currSum);
-  //  cout << "Examining RV store just before RV init via gatherElementsInBeam" << endl;   
-  //  printRV();
+  double currSum = hmm.getCurrSum();
+  next->setScore(currSum);
 
   // Get new hidden random variable store from HHMM
-  hmm.gatherElementsInBeam(randomVariableStore);
-  //  cout << "Examining RV store just after RV init via gatherElementsInBeam" << endl;   
-  //  printRV();
-  /*
-  cerr << "Writing hmm.writeCurr..." << endl;
-  hmm.writeCurr(cerr,0);
-  hmm.writeCurr(cerr,1);
-  cerr << "...done writing hmm.writeCurr" << endl;
-  */
-}
-
+  hmm.gatherElementsInBeam(&next->randomVariableStore);
 
-template <class MY, class MX, class YS, class B>
-double SyntacticLanguageModelState<MY,MX,YS,B>::getProb() const {
-  
-  return prob;
-}
-
-template <class MY, class MX, class YS, class B>
-double SyntacticLanguageModelState<MY,MX,YS,B>::getScore() const {
-  
-  return score;
+  ++prev.stats->steps;
+  prev.stats->stepTime += clock() - start;
+  node = next;
+  VERBOSE(3,"SynLM evaluated a score of " << node->score << endl);
 }
 
 
 template <class MY, class MX, class YS, class B>
-  void SyntacticLanguageModelState<MY,MX,YS,B>::setScore(double score) {
+  void SyntacticLanguageModelState<MY,MX,YS,B>::Node::setScore(double score) {
 
   
 
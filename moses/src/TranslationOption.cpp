@@ -20,6 +20,7 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <algorithm>
 #include "TranslationOption.h"
 #include "WordsBitmap.h"
 #include "PhraseDictionaryMemory.h"
@@ -40,6 +41,8 @@ TranslationOption::TranslationOption(const WordsRange &wordsRange
                                      , const InputType &inputType)
   : m_targetPhrase(targetPhrase)
   , m_sourceWordsRange(wordsRange)
+  , m_lexReorderingScores()
+  , m_lexReorderingFound(0)
 {
   // set score
   m_scoreBreakdown.PlusEquals(targetPhrase.GetScoreBreakdown());
@@ -61,6 +64,8 @@ TranslationOption::TranslationOption(const WordsRange &wordsRange
   : m_targetPhrase(targetPhrase)
   , m_sourceWordsRange	(wordsRange)
   , m_futureScore(0)
+  , m_lexReorderingScores()
+  , m_lexReorderingFound(0)
 {
   if (up) {
     const ScoreProducer *scoreProducer = (const ScoreProducer *)up; // not sure why none of the c++ cast works
@@ -88,8 +93,11 @@ TranslationOption::TranslationOption(const TranslationOption &copy)
   , m_sourceWordsRange(copy.m_sourceWordsRange)
   , m_futureScore(copy.m_futureScore)
   , m_scoreBreakdown(copy.m_scoreBreakdown)
-  , m_cachedScores(copy.m_cachedScores)
-{}
+  , m_lexReorderingHeap(copy.m_lexReorderingHeap)
+  , m_lexReorderingFound(copy.m_lexReorderingFound)
+{
+  std::copy(copy.m_lexReorderingScores, copy.m_lexReorderingScores + MAX_NUM_LEXREORDERING_SCORES, m_lexReorderingScores);
+}
 
 TranslationOption::TranslationOption(const TranslationOption &copy, const WordsRange &sourceWordsRange)
   : m_targetPhrase(copy.m_targetPhrase)
@@ -98,8 +106,11 @@ TranslationOption::TranslationOption(const TranslationOption &copy, const WordsR
   , m_sourceWordsRange(sourceWordsRange)
   , m_futureScore(copy.m_futureScore)
   , m_scoreBreakdown(copy.m_scoreBreakdown)
-  , m_cachedScores(copy.m_cachedScores)
-{}
+  , m_lexReorderingHeap(copy.m_lexReorderingHeap)
+  , m_lexReorderingFound(copy.m_lexReorderingFound)
+{
+  std::copy(copy.m_lexReorderingScores, copy.m_lexReorderingScores + MAX_NUM_LEXREORDERING_SCORES, m_lexReorderingScores);
+}
 
 void TranslationOption::MergeNewFeatures(const Phrase& phrase, const ScoreComponentCollection& score, const std::vector<FactorType>& featuresToAdd)
 {
@@ -162,9 +173,18 @@ ostream& operator<<(ostream& out, const TranslationOption& possibleTranslation)
   return out;
 }
 
-void TranslationOption::CacheScores(const ScoreProducer &producer, const Scores &score)
+void TranslationOption::CacheLexReorderingScores(size_t model, size_t offset, size_t size, const Scores &score)
 {
-  m_cachedScores[&producer] = new Scores(score);
+  float *scores = m_lexReorderingScores;
+  if (offset + size > MAX_NUM_LEXREORDERING_SCORES || !m_lexReorderingHeap.empty()) {
+    if (m_lexReorderingHeap.empty())
+      m_lexReorderingHeap.assign(m_lexReorderingScores, m_lexReorderingScores + MAX_NUM_LEXREORDERING_SCORES);
+    if (m_lexReorderingHeap.size() < offset + size)
+      m_lexReorderingHeap.resize(offset + size, 0);
+    scores = &m_lexReorderingHeap[0];
+  }
+  std::copy(score.begin(), score.begin() + std::min(size, score.size()), scores + offset);
+  m_lexReorderingFound |= 1u << model;
 }
 
 }
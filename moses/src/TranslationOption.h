@@ -73,8 +73,9 @@ protected:
   //! possible to estimate, it is included here.
   ScoreComponentCollection	m_scoreBreakdown;
 
-  typedef std::map<const ScoreProducer *, const Scores *> _ScoreCacheMap;
-  _ScoreCacheMap m_cachedScores;
+  float m_lexReorderingScores[MAX_NUM_LEXREORDERING_SCORES]; /*< scores of all lexical reordering models, looked up when the option is created */
+  std::vector<float> m_lexReorderingHeap; /*< replaces m_lexReorderingScores if the models have more scores than fit there */
+  unsigned int m_lexReorderingFound; /*< one bit per lexical reordering model, set if its table has this phrase pair */
 
 public:
   /** constructor. Used by initial translation step */
@@ -94,8 +95,6 @@ public:
 
   ~TranslationOption() {
     delete m_sourcePhrase;
-    for(_ScoreCacheMap::const_iterator it = m_cachedScores.begin(); it != m_cachedScores.end(); ++it)
-      delete it->second;
   }
 
   /** returns true if all feature types in featuresToCheck are compatible between the two phrases */
@@ -152,19 +151,17 @@ public:
     return m_scoreBreakdown;
   }
 
-  /** returns cached scores */
-  inline const Scores *GetCachedScores(const ScoreProducer *scoreProducer) const {
-    _ScoreCacheMap::const_iterator it = m_cachedScores.find(scoreProducer);
-    if(it == m_cachedScores.end())
-      return NULL;
-    else
-      return it->second;
+  /** returns the cached scores of a lexical reordering model, or NULL if its table does not have this phrase pair */
+  inline const float *GetLexReorderingScores(size_t model, size_t offset) const {
+    if (m_lexReorderingFound & (1u << model))
+      return (m_lexReorderingHeap.empty() ? m_lexReorderingScores : &m_lexReorderingHeap[0]) + offset;
+    return NULL;
   }
 
   /** Calculate future score and n-gram score of this trans option, plus the score breakdowns */
   void CalcScore(const TranslationSystem* system);
 
-  void CacheScores(const ScoreProducer &scoreProducer, const Scores &score);
+  void CacheLexReorderingScores(size_t model, size_t offset, size_t size, const Scores &score);
 
   TO_STRING();
 };
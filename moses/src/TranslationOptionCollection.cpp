@@ -303,23 +303,7 @@ void TranslationOptionCollection::CalcFutureScore()
   //   we leave the +inf in the matrix
   // like in chart parsing we want each cell to contain the highest score
   // of the full-span trOpt or the sum of scores of joining two smaller spans
-
-  for(size_t colstart = 1; colstart < size ; colstart++) {
-    for(size_t diagshift = 0; diagshift < size-colstart ; diagshift++) {
-      size_t startPos = diagshift;
-      size_t endPos = colstart+diagshift;
-      for(size_t joinAt = startPos; joinAt < endPos ; joinAt++)  {
-        float joinedScore = m_futureScore.GetScore(startPos, joinAt)
-                            + m_futureScore.GetScore(joinAt+1, endPos);
-        /* // uncomment to see the cell filling scheme
-        TRACE_ERR( "[" <<startPos<<","<<endPos<<"] <-? ["<<startPos<<","<<joinAt<<"]+["<<joinAt+1<<","<<endPos
-          << "] (colstart: "<<colstart<<", diagshift: "<<diagshift<<")"<<endl);
-        */
-        if (joinedScore > m_futureScore.GetScore(startPos, endPos))
-          m_futureScore.SetScore(startPos, endPos, joinedScore);
-      }
-    }
-  }
+  m_futureScore.CalcJoinedScores();
 
   IFVERBOSE(3) {
     int total = 0;
@@ -692,7 +676,7 @@ void TranslationOptionCollection::CacheLexReordering()
             Scores score = lexreordering.GetProb(*sourcePhrase
                                                  , transOpt.GetTargetPhrase());
             if (!score.empty())
-              transOpt.CacheScores(lexreordering, score);
+              transOpt.CacheLexReorderingScores(lexreordering.GetCacheModel(), lexreordering.GetCacheOffset(), lexreordering.GetCacheSize(), score);
           }
         }
       }
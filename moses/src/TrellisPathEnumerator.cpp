@@ -0,0 +1,199 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+#include "util/check.hh"
+#include "TrellisPathEnumerator.h"
+#include "Hypothesis.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+TrellisPathEnumerator::TrellisPathEnumerator(const vector<const Hypothesis*> &finalHypos)
+{
+  // every final hypothesis starts a pure path
+  vector<const Hypothesis*>::const_iterator iter;
+  for (iter = finalHypos.begin(); iter != finalHypos.end(); ++iter) {
+    Push(NULL, *iter, NULL, (*iter)->GetTotalScore());
+  }
+}
+
+void TrellisPathEnumerator::Push(const Candidate *prefix, const Hypothesis *root, const HeapNode *sidetrack, float score)
+{
+  Candidate candidate;
+  candidate.prefix = prefix;
+  candidate.root = root;
+  candidate.sidetrack = sidetrack;
+  candidate.score = score;
+  m_candidates.push_back(candidate);
+  m_queue.push(&m_candidates.back());
+}
+
+//! persistent insertion: copies the nodes on the right spine, never modifies heap
+const TrellisPathEnumerator::HeapNode *TrellisPathEnumerator::Insert(const HeapNode *heap, HeapNode *node)
+{
+  if (heap == NULL || node->delta > heap->delta) {
+    node->left = heap;
+    node->right = NULL;
+    node->rank = 1;
+    return node;
+  }
+
+  m_nodes.push_back(*heap);
+  HeapNode &copy = m_nodes.back();
+  copy.right = Insert(heap->right, node);
+  size_t leftRank = copy.left ? copy.left->rank : 0;
+  if (leftRank < copy.right->rank) {
+    std::swap(copy.left, copy.right);
+  }
+  copy.rank = (copy.right ? copy.right->rank : 0) + 1;
+  return &copy;
+}
+
+namespace
+{
+struct ArcOrderer {
+  bool operator()(const Hypothesis *a, const Hypothesis *b) const {
+    return a->GetTotalScore() > b->GetTotalScore();
+  }
+};
+}
+
+const TrellisPathEnumerator::HeapNode *TrellisPathEnumerator::GetHeap(const Hypothesis *hypo)
+{
+  // find the hypotheses on the best path back whose heaps are not built yet
+  vector<const Hypothesis*> pending;
+  const HeapNode *heap = NULL;
+  while (hypo != NULL) {
+    boost::unordered_map<const Hypothesis*, const HeapNode*>::const_iterator iter = m_heaps.find(hypo);
+    if (iter != m_heaps.end()) {
+      heap = iter->second;
+      break;
+    }
+    pending.push_back(hypo);
+    hypo = hypo->GetPrevHypo();
+  }
+
+  // and build them from the initial hypothesis forwards
+  vector<const Hypothesis*>::const_reverse_iterator iter;
+  for (iter = pending.rbegin(); iter != pending.rend(); ++iter) {
+    const Hypothesis *winner = *iter;
+    const ArcList *arcList = winner->GetArcList();
+    if (arcList != NULL && !arcList->empty()) {
+      vector<const Hypothesis*> arcs(arcList->begin(), arcList->end());
+      std::sort(arcs.begin(), arcs.end(), ArcOrderer());
+
+      // arcs of one winner form a list hanging off the best one
+      HeapNode *next = NULL;
+      for (size_t i = arcs.size(); i-- > 0; ) {
+        HeapNode node;
+        node.arc = arcs[i];
+        node.delta = arcs[i]->GetTotalScore() - winner->GetTotalScore();
+        node.left = node.right = NULL;
+        node.next = next;
+        node.rank = 1;
+        m_nodes.push_back(node);
+        next = &m_nodes.back();
+      }
+      heap = Insert(heap, next);
+    }
+    m_heaps[winner] = heap;
+  }
+  return heap;
+}
+
+bool TrellisPathEnumerator::Next(vector<const Hypothesis*> &edges, float &score)
+{
+  if (m_queue.empty()) {
+    return false;
+  }
+  const Candidate *candidate = m_queue.top();
+  m_queue.pop();
+
+  // successors: take one more sidetrack further back, or swap the last
+  // sidetrack for the next best one in the same heap
+  const HeapNode *sidetrack = candidate->sidetrack;
+  if (sidetrack == NULL) {
+    const HeapNode *heap = GetHeap(candidate->root);
+    if (heap) {
+      Push(NULL, candidate->root, heap, candidate->score + heap->delta);
+    }
+  } else {
+    const HeapNode *heap = GetHeap(sidetrack->arc->GetPrevHypo());
+    if (heap) {
+      Push(candidate, candidate->root, heap, candidate->score + heap->delta);
+    }
+    float base = candidate->score - sidetrack->delta;
+    const HeapNode *alternatives[3] = { sidetrack->left, sidetrack->right, sidetrack->next };
+    for (size_t i = 0; i < 3; ++i) {
+      if (alternatives[i]) {
+        Push(candidate->prefix, candidate->root, alternatives[i], base + alternatives[i]->delta);
+      }
+    }
+  }
+
+  // materialise the path, last edge first
+  m_sidetracks.clear();
+  for (const Candidate *prefix = candidate; prefix && prefix->sidetrack; prefix = prefix->prefix) {
+    m_sidetracks.push_back(prefix->sidetrack);
+  }
+
+  edges.clear();
+  const Hypothesis *hypo = candidate->root;
+  vector<const HeapNode*>::const_reverse_iterator iter;
+  for (iter = m_sidetracks.rbegin(); iter != m_sidetracks.rend(); ++iter) {
+    const Hypothesis *arc = (*iter)->arc;
+    while (hypo != arc->GetWinningHypo()) {
+      CHECK(hypo);
+      edges.push_back(hypo);
+      hypo = hypo->GetPrevHypo();
+    }
+    edges.push_back(arc);
+    hypo = arc->GetPrevHypo();
+  }
+  while (hypo != NULL) {
+    edges.push_back(hypo);
+    hypo = hypo->GetPrevHypo();
+  }
+
+  score = candidate->score;
+  return true;
+}
+
+size_t HashSurface(const vector<const Hypothesis*> &edges, const vector<FactorType> &outputFactors)
+{
+  size_t seed = 0;
+  // skip the initial hypothesis at the end
+  for (size_t edge = edges.size() - 1; edge-- > 0; ) {
+    const Phrase &phrase = edges[edge]->GetCurrTargetPhrase();
+    for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+      for (size_t i = 0; i < outputFactors.size(); ++i) {
+        boost::hash_combine(seed, phrase.GetFactor(pos, outputFactors[i]));
+      }
+    }
+  }
+  return seed;
+}
+
+}
@@ -0,0 +1,109 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2012 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_TrellisPathEnumerator_h
+#define moses_TrellisPathEnumerator_h
+
+#include <deque>
+#include <queue>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include "TypeDef.h"
+
+namespace Moses
+{
+
+class Hypothesis;
+
+/** Lazily enumerates paths through the phrase-based search graph in order of
+ * decreasing score (Eppstein 1998, Huang & Chiang 2005).
+ *
+ * A path is the best path from one of the final hypotheses, with some of its
+ * hypotheses replaced by recombined arcs. Every arc costs
+ * arc->GetTotalScore() - winner->GetTotalScore(), so a path is fully
+ * described by its list of arcs ("sidetracks") and its score is the score of
+ * its final hypothesis plus the sum of those deltas.
+ *
+ * For each hypothesis h, the arcs that may still be taken once the path has
+ * reached h are those of h and of all hypotheses on its best path back to the
+ * initial hypothesis. They are kept in a persistent leftist heap which shares
+ * everything but one insertion path with the heap of h->GetPrevHypo(), and is
+ * only built when the enumeration first needs it. Candidates are then just a
+ * heap node plus a pointer to the candidate they were derived from, so paths
+ * share their tails and each step costs O(log) without copying edges or score
+ * breakdowns. Edges are only materialised for the paths that are returned.
+ */
+class TrellisPathEnumerator
+{
+public:
+  explicit TrellisPathEnumerator(const std::vector<const Hypothesis*> &finalHypos);
+
+  /** fetch the next best path.
+   * \param edges filled with the hypotheses/arcs of the path, last one first (as TrellisPath::GetEdges())
+   * \param score total score of the path
+   * \return false once all paths have been enumerated
+   */
+  bool Next(std::vector<const Hypothesis*> &edges, float &score);
+
+  size_t GetNumCandidates() const {
+    return m_candidates.size();
+  }
+
+protected:
+  struct HeapNode {
+    const Hypothesis *arc;
+    float delta; //! arc->GetTotalScore() - winner->GetTotalScore()
+    const HeapNode *left, *right;
+    const HeapNode *next; //! next best arc of the same winner
+    size_t rank;
+  };
+
+  struct Candidate {
+    const Candidate *prefix; //! candidate holding the sidetracks taken before this one, or NULL
+    const Hypothesis *root; //! final hypothesis the path starts from
+    const HeapNode *sidetrack; //! last sidetrack taken, NULL for a pure path
+    float score;
+  };
+
+  struct CandidateOrderer {
+    bool operator()(const Candidate *a, const Candidate *b) const {
+      return a->score < b->score;
+    }
+  };
+
+  const HeapNode *GetHeap(const Hypothesis *hypo);
+  const HeapNode *Insert(const HeapNode *heap, HeapNode *node);
+  void Push(const Candidate *prefix, const Hypothesis *root, const HeapNode *sidetrack, float score);
+
+  std::deque<HeapNode> m_nodes;
+  std::deque<Candidate> m_candidates;
+  boost::unordered_map<const Hypothesis*, const HeapNode*> m_heaps;
+  std::priority_queue<const Candidate*, std::vector<const Candidate*>, CandidateOrderer> m_queue;
+  std::vector<const HeapNode*> m_sidetracks;
+};
+
+/** hash of the output factors of the target words along a path, used to detect
+ * paths with identical surface strings without building a Phrase per path */
+size_t HashSurface(const std::vector<const Hypothesis*> &edges, const std::vector<FactorType> &outputFactors);
+
+}
+
+#endif
@@ -74,7 +74,14 @@ const size_t DEFAULT_VERBOSE_LEVEL = 1;
 // can only be 2 at the moment
 const int NUM_LANGUAGES = 2;
 
-const size_t MAX_NUM_FACTORS = 4;
+// set with --max-factors; each factor costs a pointer in every Word
+#ifndef MAX_NUM_FACTORS
+#define MAX_NUM_FACTORS 4
+#endif
+
+//! lexical reordering scores kept inline in each translation option, over
+//! all models.  Options of configurations with more scores keep them on the heap.
+const size_t MAX_NUM_LEXREORDERING_SCORES = 16;
 
 enum FactorDirection {
   Input,			//! Source factors
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <sstream>
+#include <boost/functional/hash.hpp>
 #include "memory.h"
 #include "Word.h"
 #include "TypeDef.h"
@@ -150,5 +151,28 @@ ostream& operator<<(ostream& out, const Word& word)
   return out;
 }
 
+size_t WordFactorHash::operator()(const Word &word) const
+{
+  size_t seed = 0;
+  for (size_t i = 0; i < m_factors.size(); ++i) {
+    const Factor *factor = word[m_factors[i]];
+    boost::hash_combine(seed, factor ? factor->GetId() : (size_t) -1);
+  }
+  return seed;
+}
+
+bool WordFactorHash::operator()(const Word &a, const Word &b) const
+{
+  if (a.IsNonTerminal() != b.IsNonTerminal()) {
+    return false;
+  }
+  for (size_t i = 0; i < m_factors.size(); ++i) {
+    if (a[m_factors[i]] != b[m_factors[i]]) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }
 
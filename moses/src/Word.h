@@ -143,6 +143,21 @@ struct WordComparer {
   }
 };
 
+/** Hash and equality of words on the given factor types only, for hash
+ * maps of words that have just these factors filled in.  Finds the same
+ * words as WordComparer when the looked up word has all of them.
+ */
+class WordFactorHash
+{
+public:
+  explicit WordFactorHash(const std::vector<FactorType> &factors = std::vector<FactorType>())
+    : m_factors(factors) {}
+  size_t operator()(const Word &word) const;
+  bool operator()(const Word &a, const Word &b) const;
+private:
+  std::vector<FactorType> m_factors;
+};
+
 }
 
 #endif
@@ -0,0 +1,2 @@
+#!/bin/sh
+./bjam -j2 cxxflags=-std=gnu++98 -include /tmp/absfix.h moses-cmd/src misc
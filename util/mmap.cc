@@ -7,13 +7,19 @@
 #include "util/exception.hh"
 #include "util/file.hh"
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
@@ -23,6 +29,10 @@
 #include <unistd.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
 namespace util {
 
 long SizePage() {
@@ -126,6 +136,107 @@ const int kFileFlags =
 #endif
   ;
 
+bool ParseLoadMethod(const char *name, LoadMethod &to) {
+  const struct {
+    const char *name;
+    LoadMethod method;
+  } kNames[] = {
+    {"lazy", LAZY},
+    {"populate", POPULATE_OR_LAZY},
+    {"populate_or_read", POPULATE_OR_READ},
+    {"read", READ},
+    {"huge", HUGE_READ},
+    {"huge_pool", HUGE_POOL_READ},
+    {"interleave", INTERLEAVE_READ}
+  };
+  for (std::size_t i = 0; i < sizeof(kNames) / sizeof(kNames[0]); ++i) {
+    if (!strcmp(name, kNames[i].name)) {
+      to = kNames[i].method;
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace {
+
+// The default huge page size on x86-64.  Only used for alignment, so a
+// different size costs some coverage but not correctness.  
+const std::size_t kHugePageSize = 2 * 1024 * 1024;
+
+#if defined(__linux__)
+const int kMPolInterleave = 3; // MPOL_INTERLEAVE from linux/mempolicy.h
+
+// Parse /sys/devices/system/node/online, e.g. "0-1,3", into a node mask.  
+bool OnlineNodes(std::vector<unsigned long> &mask, unsigned long &max_node) {
+  std::ifstream in("/sys/devices/system/node/online");
+  std::string list;
+  if (!(in >> list)) return false;
+  const std::size_t kBits = sizeof(unsigned long) * 8;
+  max_node = 0;
+  for (const char *i = list.c_str(); *i; ) {
+    char *end;
+    unsigned long from = strtoul(i, &end, 10), to = from;
+    if (end == i) return false;
+    if (*end == '-') {
+      i = end + 1;
+      to = strtoul(i, &end, 10);
+      if (end == i || to < from) return false;
+    }
+    for (unsigned long node = from; node <= to; ++node) {
+      if (node / kBits >= mask.size()) mask.resize(node / kBits + 1);
+      mask[node / kBits] |= 1UL << (node % kBits);
+    }
+    max_node = std::max(max_node, to);
+    i = (*end == ',') ? end + 1 : end;
+  }
+  return !mask.empty();
+}
+
+// Interleave the pages of a fresh mapping over all online nodes.  
+void InterleaveNodes(void *start, std::size_t size) {
+  std::vector<unsigned long> mask;
+  unsigned long max_node;
+  if (!OnlineNodes(mask, max_node) || max_node == 0) return;
+  // Failure leaves the default policy, which is still correct.  
+  syscall(SYS_mbind, start, size, kMPolInterleave, &mask[0], max_node + 2, 0);
+}
+#endif
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// Anonymous memory for method, which is one of the huge page methods.  Fills
+// to with a mapping of at least size bytes.  
+void HugeAnonymous(LoadMethod method, std::size_t size, scoped_memory &to) {
+#if defined(__linux__) && defined(MAP_HUGETLB)
+  if (method == HUGE_POOL_READ) {
+    std::size_t rounded = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+    void *ret = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+    if (ret != MAP_FAILED) {
+      to.reset(ret, rounded, scoped_memory::MMAP_ALLOCATED);
+      return;
+    }
+    std::cerr << "Could not get " << rounded << " bytes of huge pages from the pool: " << strerror(errno) << ".  Falling back to transparent huge pages." << std::endl;
+  }
+#endif
+  MapAnonymous(size, to);
+#if defined(__linux__)
+  if (method == INTERLEAVE_READ) InterleaveNodes(to.get(), size);
+#endif
+  AdviseHugePages(to.get(), size);
+}
+#endif
+
+} // namespace
+
+void AdviseHugePages(void *start, std::size_t size) {
+#if defined(MADV_HUGEPAGE)
+  uintptr_t begin = (reinterpret_cast<uintptr_t>(start) + kHugePageSize - 1) & ~static_cast<uintptr_t>(kHugePageSize - 1);
+  uintptr_t end = (reinterpret_cast<uintptr_t>(start) + size) & ~static_cast<uintptr_t>(kHugePageSize - 1);
+  // Failure (e.g. a kernel without transparent huge pages) just means normal pages.  
+  if (begin < end) madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+#endif
+}
+
 void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scoped_memory &out) {
   switch (method) {
     case LAZY:
@@ -146,6 +257,18 @@ void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scope
       SeekOrThrow(fd, offset);
       ReadOrThrow(fd, out.get(), size);
       break;
+    case HUGE_READ:
+    case HUGE_POOL_READ:
+    case INTERLEAVE_READ:
+#if defined(_WIN32) || defined(_WIN64)
+      out.reset(malloc(size), size, scoped_memory::MALLOC_ALLOCATED);
+      if (!out.get()) UTIL_THROW(util::ErrnoException, "Allocating " << size << " bytes with malloc");
+#else
+      HugeAnonymous(method, size, out);
+#endif
+      SeekOrThrow(fd, offset);
+      ReadOrThrow(fd, out.get(), size);
+      break;
   }
 }
 
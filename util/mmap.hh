@@ -90,9 +90,24 @@ typedef enum {
   // Populate on Linux.  malloc and read on non-Linux.  
   POPULATE_OR_READ,
   // malloc and read.  
-  READ
+  READ,
+  // Read into anonymous memory that the kernel is asked to back with
+  // transparent huge pages (madvise MADV_HUGEPAGE).  Random lookups then miss
+  // the TLB far less often.  Same as READ where unsupported.  
+  HUGE_READ,
+  // Read into explicit huge pages reserved by the administrator
+  // (vm.nr_hugepages, MAP_HUGETLB).  Falls back to HUGE_READ if the pool is
+  // too small.  
+  HUGE_POOL_READ,
+  // HUGE_READ with pages interleaved over all NUMA nodes, so every socket sees
+  // the same latency and all memory controllers share the traffic.  
+  INTERLEAVE_READ
 } LoadMethod;
 
+// Parse the name of a load method: lazy, populate, populate_or_read, read,
+// huge, huge_pool, or interleave.  Returns false if name is none of these.  
+bool ParseLoadMethod(const char *name, LoadMethod &to);
+
 extern const int kFileFlags;
 
 // Wrapper around mmap to check it worked and hide some platform macros.  
@@ -102,6 +117,11 @@ void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scope
 
 void MapAnonymous(std::size_t size, scoped_memory &to);
 
+// Ask for transparent huge pages on the whole huge pages inside [start,
+// start + size).  Pages already populated are collapsed in the background.
+// Best effort: does nothing where unsupported.  
+void AdviseHugePages(void *start, std::size_t size);
+
 // Open file name with mmap of size bytes, all of which are initially zero.  
 void *MapZeroedWrite(int fd, std::size_t size);
 void *MapZeroedWrite(const char *name, std::size_t size, scoped_fd &file);
@@ -4,6 +4,7 @@
 #include <ostream>
 
 #include <string.h>
+#include <time.h>
 #include <ctype.h>
 #if !defined(_WIN32) && !defined(_WIN64)
 #include <sys/resource.h>
@@ -43,4 +44,14 @@ void PrintUsage(std::ostream &out) {
 #endif
 }
 
+double WallTime() {
+#if !defined(_WIN32) && !defined(_WIN64)
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1000000.0;
+#else
+  return static_cast<double>(time(NULL));
+#endif
+}
+
 } // namespace util
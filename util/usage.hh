@@ -4,5 +4,8 @@
 
 namespace util {
 void PrintUsage(std::ostream &to);
+
+// Seconds since an arbitrary point, for timing phases of a computation.  
+double WallTime();
 } // namespace util
 #endif // UTIL_USAGE__
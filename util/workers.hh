@@ -0,0 +1,140 @@
+#ifndef UTIL_WORKERS__
+#define UTIL_WORKERS__
+
+#include "util/exception.hh"
+
+#include <boost/noncopyable.hpp>
+#ifdef WITH_THREADS
+#include <boost/exception_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
+#include <deque>
+
+namespace util {
+
+// A fixed pool of threads that run tasks from a queue, or runs each task
+// immediately if there is only one thread.  Join waits for all tasks so far
+// and rethrows the first exception thrown by one of them, so that errors
+// surface in the thread that started the tasks.  Only std::exception types
+// that boost can clone without C++11 keep their type; any other
+// util::Exception is rethrown as util::Exception with the same message.
+class Workers : boost::noncopyable {
+  public:
+    explicit Workers(unsigned int threads) : threads_(threads)
+#ifdef WITH_THREADS
+      , busy_(0), stopping_(false)
+#endif
+    {
+#ifdef WITH_THREADS
+      if (threads_ > 1) {
+        for (unsigned int i = 0; i < threads_; ++i) {
+          pool_.create_thread(Worker(*this));
+        }
+      }
+#endif
+    }
+
+    // Tasks still queued when an exception unwinds the stack are dropped and
+    // the running ones are waited for.
+    ~Workers() {
+#ifdef WITH_THREADS
+      {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+      }
+      work_.notify_all();
+      pool_.join_all();
+#endif
+    }
+
+    unsigned int Threads() const { return threads_; }
+
+    template <class Task> void Run(const Task &task) {
+#ifdef WITH_THREADS
+      if (threads_ > 1) {
+        {
+          boost::lock_guard<boost::mutex> lock(mutex_);
+          queue_.push_back(boost::function<void ()>(task));
+        }
+        work_.notify_one();
+        return;
+      }
+#endif
+      task();
+    }
+
+    void Join() {
+#ifdef WITH_THREADS
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (!queue_.empty() || busy_) idle_.wait(lock);
+      if (error_) {
+        boost::exception_ptr error(error_);
+        error_ = boost::exception_ptr();
+        lock.unlock();
+        boost::rethrow_exception(error);
+      }
+#endif
+    }
+
+  private:
+    const unsigned int threads_;
+
+#ifdef WITH_THREADS
+    class Worker {
+      public:
+        explicit Worker(Workers &workers) : workers_(workers) {}
+        void operator()() { workers_.Serve(); }
+      private:
+        Workers &workers_;
+    };
+
+    void Serve() {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (true) {
+        while (queue_.empty() && !stopping_) work_.wait(lock);
+        if (stopping_) return;
+        boost::function<void ()> task;
+        task.swap(queue_.front());
+        queue_.pop_front();
+        ++busy_;
+        lock.unlock();
+        boost::exception_ptr error;
+        try {
+          task();
+        }
+#ifdef BOOST_NO_CXX11_HDR_EXCEPTION
+        catch (const util::Exception &e) {
+          error = boost::copy_exception(e);
+        }
+#endif
+        catch (...) {
+          error = boost::current_exception();
+        }
+        // Destroy the task, which may own resources, before reporting it done.
+        task.clear();
+        lock.lock();
+        if (error && !error_) error_ = error;
+        if (!--busy_ && queue_.empty()) idle_.notify_all();
+      }
+    }
+
+    std::deque<boost::function<void ()> > queue_;
+    unsigned int busy_;
+    bool stopping_;
+    boost::exception_ptr error_;
+
+    boost::mutex mutex_;
+    boost::condition_variable work_, idle_;
+    boost::thread_group pool_;
+#endif
+};
+
+} // namespace util
+
+#endif // UTIL_WORKERS__
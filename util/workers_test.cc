@@ -0,0 +1,78 @@
+#include "util/workers.hh"
+
+#include <stdexcept>
+#include <vector>
+
+#define BOOST_TEST_MODULE WorkersTest
+#include <boost/test/unit_test.hpp>
+
+namespace util { namespace {
+
+class Add {
+  public:
+    Add(std::vector<unsigned int> &out, unsigned int index) : out_(out), index_(index) {}
+    void operator()() const { out_[index_] += index_; }
+  private:
+    std::vector<unsigned int> &out_;
+    unsigned int index_;
+};
+
+class ThrowRuntime {
+  public:
+    void operator()() const { throw std::runtime_error("runtime failure"); }
+};
+
+class ThrowUtil {
+  public:
+    void operator()() const { UTIL_THROW(util::Exception, "util failure"); }
+};
+
+void RunAll(unsigned int threads) {
+  Workers workers(threads);
+  std::vector<unsigned int> out(1000);
+  // more tasks than threads, and the pool is reused after Join
+  for (unsigned int round = 1; round <= 3; ++round) {
+    for (unsigned int i = 0; i < out.size(); ++i) {
+      workers.Run(Add(out, i));
+    }
+    workers.Join();
+    for (unsigned int i = 0; i < out.size(); ++i) {
+      BOOST_REQUIRE_EQUAL(i * round, out[i]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(run_all) {
+  RunAll(1);
+  RunAll(2);
+  RunAll(7);
+}
+
+BOOST_AUTO_TEST_CASE(rethrow) {
+  for (unsigned int threads = 1; threads <= 4; threads += 3) {
+    Workers workers(threads);
+    std::vector<unsigned int> out(10);
+    if (threads == 1) {
+      BOOST_CHECK_THROW(workers.Run(ThrowRuntime()), std::runtime_error);
+      continue;
+    }
+    workers.Run(ThrowRuntime());
+    for (unsigned int i = 0; i < out.size(); ++i) {
+      workers.Run(Add(out, i));
+    }
+    BOOST_CHECK_THROW(workers.Join(), std::runtime_error);
+    // the other tasks still ran and the error is reported once
+    BOOST_CHECK_EQUAL(9U, out[9]);
+    workers.Join();
+
+    workers.Run(ThrowUtil());
+    try {
+      workers.Join();
+      BOOST_FAIL("Join did not throw");
+    } catch (const util::Exception &e) {
+      BOOST_CHECK(std::string(e.what()).find("util failure") != std::string::npos);
+    }
+  }
+}
+
+}} // namespaces